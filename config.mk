@@ -1,13 +1,20 @@
 CXX = g++
 DEPS_BIN = g++
-CXXFLAGS = -O2 -std=c++11
-LDFLAGS = -O2
+CXXFLAGS = -O2 -std=c++11 -pthread
+LDFLAGS = -O2 -pthread
 LDLIBS = 
 AR = ar
 ARFLAGS = rc
 MKDIR = mkdir
 MKDIRFLAGS = -p
 
+# Set to 1 to read through io_uring on Linux, which needs <linux/io_uring.h>
+# (the reads otherwise go through a pool of threads):
+USE_IO_URING = 0
+ifeq ($(USE_IO_URING),1)
+CXXFLAGS += -DALUCELL_USE_IO_URING
+endif
+
 PREFIX = $(HOME)/.local/
 BIN_DIR = bin/
 INCLUDE_DIR = include/
@@ -18,22 +25,99 @@ PKG_NAME = alucelldb
 
 SOURCES = src/db.cpp \
           src/alucell_legacy_database.cpp \
+	  src/alucell_async_read.cpp \
+	  src/alucell_async_write.cpp \
+	  src/alucell_dbfile_catalog.cpp \
+	  src/alucell_query_server.cpp \
+	  src/alucell_query_client.cpp \
 	  test/string.cpp \
-	  test/write_dbfile.cpp
+	  test/write_dbfile.cpp \
+	  test/statistics.cpp \
+	  test/variable_cache.cpp \
+	  test/sky_matrix.cpp \
+	  test/parallel_write.cpp \
+	  test/async_write.cpp \
+	  test/catalog.cpp \
+	  test/query_server.cpp \
+	  test/extended_header.cpp \
+	  test/dbfile_copy.cpp \
+	  test/async_read.cpp \
+	  test/mesh_catalog.cpp \
+	  test/array_slice.cpp \
+	  test/batch_read.cpp \
+	  test/variable_selector.cpp \
+	  test/mesh_bvh.cpp \
+	  test/export_vtk.cpp \
+	  test/mesh_transfer.cpp \
+	  test/delta.cpp \
+	  test/mesh_reorder.cpp \
+	  test/mesh_geometry.cpp \
+	  test/field_integration.cpp \
+	  test/histogram.cpp \
+	  test/dense_matrix.cpp \
+	  test/batch.cpp
 
 HEADERS = include/alucelldb/alucell_datatypes.hpp \
 	  include/alucelldb/alucell_legacy_database.hpp \
+	  include/alucelldb/alucell_delta.hpp \
 	  include/alucelldb/alucell_legacy_variable.hpp \
 	  include/alucelldb/string_utils.hpp \
 	  include/alucelldb/alucell_database_index.hpp \
+	  include/alucelldb/alucell_mesh_catalog.hpp \
+	  include/alucelldb/alucell_dbfile_catalog.hpp \
+	  include/alucelldb/alucell_dbfile_copy.hpp \
+	  include/alucelldb/alucell_variable_selector.hpp \
+	  include/alucelldb/alucell_mesh.hpp \
+	  include/alucelldb/alucell_mesh_reorder.hpp \
+	  include/alucelldb/alucell_reference_element.hpp \
+	  include/alucelldb/alucell_mesh_bvh.hpp \
+	  include/alucelldb/alucell_mesh_geometry.hpp \
+	  include/alucelldb/alucell_field_integration.hpp \
+	  include/alucelldb/alucell_export.hpp \
+	  include/alucelldb/alucell_sparse.hpp \
+	  include/alucelldb/alucell_dense_matrix.hpp \
+	  include/alucelldb/alucell_async_read.hpp \
+	  include/alucelldb/alucell_async_write.hpp \
+	  include/alucelldb/alucell_array_slice.hpp \
+	  include/alucelldb/alucell_variable_cache.hpp \
+	  include/alucelldb/alucell_statistics.hpp \
+	  include/alucelldb/alucell_histogram.hpp \
+	  include/alucelldb/alucell_query_protocol.hpp \
+	  include/alucelldb/alucell_query_server.hpp \
+	  include/alucelldb/alucell_query_client.hpp \
+	  include/alucelldb/parallel_utils.hpp \
 	  include/alucelldb/alucelldb.hpp
 
-BIN = bin/db bin/test_string bin/test_write_dbfile
+BIN = bin/db bin/test_string bin/test_write_dbfile bin/test_statistics bin/test_variable_cache bin/test_sky_matrix bin/test_parallel_write bin/test_async_write bin/test_catalog bin/test_query_server bin/test_extended_header bin/test_dbfile_copy bin/test_async_read bin/test_mesh_catalog bin/test_array_slice bin/test_batch_read bin/test_variable_selector bin/test_mesh_bvh bin/test_export_vtk bin/test_mesh_transfer bin/test_delta bin/test_mesh_reorder bin/test_mesh_geometry bin/test_field_integration bin/test_histogram bin/test_dense_matrix bin/test_batch
 
-bin/db: build/src/db.o build/src/alucell_legacy_database.o
+bin/db: build/src/db.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o build/src/alucell_async_write.o build/src/alucell_dbfile_catalog.o build/src/alucell_query_server.o build/src/alucell_query_client.o
 bin/test_string: build/test/string.o
-bin/test_write_dbfile: build/test/write_dbfile.o build/src/alucell_legacy_database.o
+bin/test_write_dbfile: build/test/write_dbfile.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_statistics: build/test/statistics.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_variable_cache: build/test/variable_cache.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_sky_matrix: build/test/sky_matrix.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_parallel_write: build/test/parallel_write.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_async_write: build/test/async_write.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o build/src/alucell_async_write.o
+bin/test_catalog: build/test/catalog.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o build/src/alucell_dbfile_catalog.o
+bin/test_query_server: build/test/query_server.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o build/src/alucell_query_server.o build/src/alucell_query_client.o
+bin/test_extended_header: build/test/extended_header.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_dbfile_copy: build/test/dbfile_copy.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_mesh_catalog: build/test/mesh_catalog.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_array_slice: build/test/array_slice.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_batch_read: build/test/batch_read.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_variable_selector: build/test/variable_selector.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_mesh_bvh: build/test/mesh_bvh.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_export_vtk: build/test/export_vtk.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_mesh_transfer: build/test/mesh_transfer.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_delta: build/test/delta.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_mesh_reorder: build/test/mesh_reorder.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_mesh_geometry: build/test/mesh_geometry.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_field_integration: build/test/field_integration.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_histogram: build/test/histogram.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_dense_matrix: build/test/dense_matrix.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_batch: build/test/batch.o build/src/alucell_legacy_database.o build/src/alucell_async_read.o
+bin/test_async_read: build/test/async_read.o build/src/alucell_async_read.o
 
 LIB = lib/libalucelldb.a
 
-lib/libalucelldb.a: build/src/alucell_legacy_database.o
+lib/libalucelldb.a: build/src/alucell_legacy_database.o build/src/alucell_async_read.o build/src/alucell_async_write.o build/src/alucell_dbfile_catalog.o build/src/alucell_query_server.o build/src/alucell_query_client.o
@@ -0,0 +1,173 @@
+#ifndef _ALUCELL_DBFILE_CATALOG_H_
+#define _ALUCELL_DBFILE_CATALOG_H_
+
+#include <set>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <functional>
+
+#include "alucell_datatypes.hpp"
+
+namespace alucell {
+
+  /*
+   *  Bloom filter over strings, with 'hashes' probes derived from two 64
+   *  bits FNV-1a hashes. The filter is stored in the catalog files, so
+   *  the hash must not depend on the platform.
+   */
+  class bloom_filter {
+  public:
+    bloom_filter(): words(), hashes(0) {}
+
+    /*
+     *  Filter sized for 'keys' keys at 10 bits per key, which gives about
+     *  1% of false positives with 7 probes.
+     */
+    explicit bloom_filter(std::size_t keys)
+      : words((keys * 10 + 63) / 64 + 1, 0), hashes(7) {}
+
+    bloom_filter(const std::vector<std::uint64_t>& _words, unsigned int _hashes)
+      : words(_words), hashes(_hashes) {}
+
+    void insert(const std::string& key);
+
+    bool may_contain(const std::string& key) const;
+
+    const std::vector<std::uint64_t>& get_words() const { return words; }
+    unsigned int get_hashes() const { return hashes; }
+
+  private:
+    std::vector<std::uint64_t> words;
+    unsigned int hashes;
+  };
+
+
+  struct catalog_variable {
+    std::string name;
+    data_type type;
+    std::uint64_t size;
+    std::uint64_t rows;  // Arrays only, 0 otherwise
+    std::uint32_t components;
+  };
+
+  /*
+   *  Metadata of a file of the cataloged directory. The files which are
+   *  not dbfiles are kept, without variables, so they are not opened
+   *  again until they change.
+   */
+  struct catalog_file {
+    std::string path;  // Relative to the cataloged directory
+    std::int64_t size, mtime_sec, mtime_nsec;
+    bool is_dbfile;
+    std::uint32_t types;  // Bit 1 << t for each data_type t of the variables
+    std::uint32_t variables_number;
+    bloom_filter names;
+
+    /*
+     *  Variables and meshes, loaded from the catalog file on demand:
+     */
+    std::uint64_t details_offset;
+    bool details_loaded;
+    std::vector<catalog_variable> variables;
+    std::vector<std::string> meshes;
+  };
+
+  /*
+   *  Criteria of a catalog query. A variable matches if its name is one
+   *  of 'names' or matches one of the glob 'patterns' (if any of them is
+   *  given), its type is one of 'types' (if any), and its rows and
+   *  components are 'rows' and 'components' (if not -1). A file matches
+   *  if it holds a matching variable, when variable criteria are given,
+   *  and all the 'meshes'.
+   */
+  struct catalog_query {
+    std::vector<std::string> names;
+    std::vector<std::string> patterns;
+    std::set<data_type> types;
+    long long rows;
+    long long components;
+    std::vector<std::string> meshes;
+
+    catalog_query(): names(), patterns(), types(), rows(-1), components(-1), meshes() {}
+
+    bool has_variable_criteria() const {
+      return names.size() or patterns.size() or types.size() or rows >= 0 or components >= 0;
+    }
+  };
+
+
+  /*
+   *  Catalog of the dbfiles of a directory tree: names, types, sizes and
+   *  array dimensions of their variables, and their meshes, in a single
+   *  file.
+   *
+   *  The catalog file starts with the summary of every file: path, size,
+   *  modification time, mask of the types, and a bloom filter over the
+   *  names of the variables and over their '_' separated tokens. The
+   *  variables and meshes of the files follow, and are only read for the
+   *  files which pass the filters of a query: an exact name, a mesh (its
+   *  M_nodes variable), or the complete tokens of a glob pattern (the
+   *  tokens followed or preceded by a '_' in the pattern) which are not
+   *  in the filter of a file rule it out without reading its variables.
+   *
+   *  refresh only opens the files whose size or modification time
+   *  changed since the catalog was written.
+   */
+  class dbfile_catalog {
+  public:
+    static const char* const default_filename;
+
+    struct refresh_report {
+      std::size_t unchanged, added, updated, removed, skipped;
+    };
+
+    dbfile_catalog(): filename(), root(), files(), details() {}
+
+    /*
+     *  Load the summaries of the catalog file 'filename'.
+     */
+    void load(const std::string& filename);
+
+    /*
+     *  Write the catalog to 'filename', through 'filename'.partial.
+     */
+    void save(const std::string& filename);
+
+    /*
+     *  Bring the catalog up to date with the directory tree 'directory',
+     *  opening the new and the modified files with 'threads' threads.
+     */
+    refresh_report refresh(const std::string& directory, unsigned int threads);
+
+    /*
+     *  Call f(file, variables) for each file matching 'q', in path order,
+     *  'variables' being the indices of its matching variables.
+     */
+    void query(const catalog_query& q,
+	       std::function<void(const catalog_file&, const std::vector<std::size_t>&)> f);
+
+    const std::string& get_root() const { return root; }
+    const std::vector<catalog_file>& get_files() const { return files; }
+
+    /*
+     *  Keys of the bloom filters: a name, and a complete token.
+     */
+    static std::string token_key(const std::string& token) { return '\n' + token; }
+
+  private:
+    std::string filename;
+    std::string root;
+    std::vector<catalog_file> files;
+    std::ifstream details;
+
+    void load_details(catalog_file& file);
+
+    static catalog_file scan_file(const std::string& directory, const std::string& path,
+				  std::int64_t size, std::int64_t mtime_sec, std::int64_t mtime_nsec);
+  };
+
+}
+
+#endif /* _ALUCELL_DBFILE_CATALOG_H_ */
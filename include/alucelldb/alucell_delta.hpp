@@ -0,0 +1,237 @@
+#ifndef _ALUCELL_DELTA_H_
+#define _ALUCELL_DELTA_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+
+namespace alucell {
+
+  /*
+   *  Delta dbfiles.
+   *
+   *  A delta dbfile is a regular dbfile holding only the variables which
+   *  changed relative to a base dbfile, which can itself be a delta. It
+   *  is recognized by the following string variables:
+   *    __delta_base            Path of the base dbfile, relative to the
+   *                            directory of the delta if not absolute.
+   *    __delta_base_signature  Signature of the base dbfile, see below.
+   *    __delta_deleted         Names of the variables of the base which
+   *                            are not in the delta, one per line.
+   *  The changed variables are stored either as is, under their name, or
+   *  encoded relative to the variable of the same name in the base, under
+   *  the name '__xor_<name>', with the type of the variable. The other
+   *  variables of the delta are added after the variables of the base.
+   *  A delta thus keeps the order of its base: materializing it gives
+   *  back the bytes of the dbfile it was made from only if the variables
+   *  common to that dbfile and to the base are in the order of the base,
+   *  and the new ones come last.
+   *
+   *  The encoding is meant for slowly varying fields: the payload is
+   *  XORed with the payload of the base, which zeroes the sign, exponent
+   *  and leading mantissa bytes of the values which barely changed, and
+   *  all the bytes of the values which did not. The bytes are then
+   *  shuffled so that the k-th bytes of the 8 bytes words follow each
+   *  other, and the runs of zero bytes are coded by their length. The
+   *  encoded payload is:
+   *    uint64  size of the decoded payload
+   *    uint64  size of the coded bytes
+   *            coded bytes, padded to a multiple of 8 bytes
+   *  The coded bytes are a sequence of (zeros, literals) pairs, the number
+   *  of zero bytes and the number of literal bytes being coded as base 128
+   *  varints, followed by the literal bytes.
+   */
+  namespace delta {
+
+    const char* const base_variable = "__delta_base";
+    const char* const signature_variable = "__delta_base_signature";
+    const char* const deleted_variable = "__delta_deleted";
+    const char* const xor_prefix = "__xor_";
+
+    /*
+     *  64 bits FNV-1a hash.
+     */
+    inline std::uint64_t hash(const char* data, std::size_t size, std::uint64_t h = 14695981039346656037ull) {
+      for (std::size_t i(0); i < size; ++i) {
+	h ^= static_cast<unsigned char>(data[i]);
+	h *= 1099511628211ull;
+      }
+      return h;
+    }
+
+    /*
+     *  Signature of a dbfile: hash of its header, which holds the names,
+     *  sizes and offsets of the variables, and of its size. Rewriting a
+     *  payload in place without changing its size is not detected. The
+     *  table of an extended header is hashed after its first
+     *  'header_size' bytes.
+     */
+    inline std::string signature(const std::string& filename, std::size_t header_size) {
+      std::ifstream f(filename.c_str(), std::ios::binary | std::ios::ate);
+      if (not f)
+	throw "[error] delta::signature: Unable to open " + filename + ".";
+      const std::uint64_t size(f.tellg());
+      std::vector<char> header(header_size, 0);
+      f.seekg(0);
+      f.read(header.data(), header.size());
+      std::uint64_t h(hash(header.data(), header.size()));
+
+      if (header.size() >= sizeof(extended_header::preamble) and extended_header::has_magic(header.data())) {
+	extended_header::preamble p;
+	std::memcpy(&p, header.data(), sizeof(p));
+	if (p.table_size > size or p.table_offset > size - p.table_size)
+	  throw "[error] delta::signature: the table of variables of " + filename + " is not within the file.";
+	std::vector<char> table(p.table_size, 0);
+	f.clear();
+	f.seekg(p.table_offset);
+	f.read(table.data(), table.size());
+	h = hash(table.data(), table.size(), h);
+      }
+
+      h = hash(reinterpret_cast<const char*>(&size), sizeof(size), h);
+      char text[17];
+      std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(h));
+      return text;
+    }
+
+    /*
+     *  Payload of a string variable, and its value (see ds.f:25).
+     */
+    inline std::vector<char> string_payload(const std::string& value) {
+      std::vector<char> payload(2 * sizeof(double) + (value.size() + sizeof(double) - 1) / sizeof(double) * sizeof(double), 0);
+      const double length(value.size());
+      std::memcpy(payload.data(), &length, sizeof(length));
+      std::memcpy(payload.data() + 2 * sizeof(double), value.data(), value.size());
+      return payload;
+    }
+
+    inline std::string string_value(const std::vector<char>& payload) {
+      if (payload.size() < 2 * sizeof(double))
+	throw std::string("[error] delta: invalid string variable.");
+      double length;
+      std::memcpy(&length, payload.data(), sizeof(length));
+      if (2 * sizeof(double) + static_cast<std::size_t>(length) > payload.size())
+	throw std::string("[error] delta: invalid string variable.");
+      return std::string(payload.begin() + 2 * sizeof(double), payload.begin() + 2 * sizeof(double) + static_cast<std::size_t>(length));
+    }
+
+
+    inline void put_varint(std::vector<char>& out, std::size_t v) {
+      while (v >= 0x80) {
+	out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+	v >>= 7;
+      }
+      out.push_back(static_cast<char>(v));
+    }
+
+    inline std::size_t get_varint(const char*& p, const char* end) {
+      std::size_t v(0);
+      for (unsigned int shift(0); p < end and shift < 64; shift += 7) {
+	const unsigned char c(*p++);
+	v |= static_cast<std::size_t>(c & 0x7f) << shift;
+	if (not (c & 0x80))
+	  return v;
+      }
+      throw std::string("[error] delta: truncated encoded payload.");
+    }
+
+    /*
+     *  Position of the byte i of the payload in the shuffled bytes: the
+     *  'words' complete 8 bytes words are shuffled, the trailing bytes are
+     *  left in place.
+     */
+    inline std::size_t shuffled_position(std::size_t i, std::size_t words) {
+      return i < words * 8 ? (i % 8) * words + i / 8 : i;
+    }
+
+    /*
+     *  Encode 'payload' relative to 'base', both of 'size' bytes.
+     */
+    inline std::vector<char> encode(const char* payload, const char* base, std::size_t size) {
+      const std::size_t words(size / 8);
+      std::vector<char> shuffled(size);
+      for (std::size_t i(0); i < size; ++i)
+	shuffled[shuffled_position(i, words)] = payload[i] ^ base[i];
+
+      std::vector<char> coded;
+      for (std::size_t i(0); i < size;) {
+	std::size_t zeros(0), literals(0);
+	while (i + zeros < size and shuffled[i + zeros] == 0)
+	  ++zeros;
+	/*
+	 *  Literals stop at the first run of at least 3 zeros, shorter runs
+	 *  cost more to code than to copy:
+	 */
+	std::size_t j(i + zeros);
+	while (j + literals < size) {
+	  const std::size_t k(j + literals);
+	  if (shuffled[k] == 0 and k + 2 < size and shuffled[k + 1] == 0 and shuffled[k + 2] == 0)
+	    break;
+	  ++literals;
+	}
+	put_varint(coded, zeros);
+	put_varint(coded, literals);
+	coded.insert(coded.end(), shuffled.begin() + j, shuffled.begin() + j + literals);
+	i = j + literals;
+      }
+
+      std::vector<char> encoded(2 * sizeof(std::uint64_t) + (coded.size() + 7) / 8 * 8, 0);
+      const std::uint64_t sizes[2] = {size, coded.size()};
+      std::memcpy(encoded.data(), sizes, sizeof(sizes));
+      std::copy(coded.begin(), coded.end(), encoded.begin() + sizeof(sizes));
+      return encoded;
+    }
+
+    /*
+     *  Size of the payload decoded from 'encoded'.
+     */
+    inline std::size_t decoded_size(const char* encoded, std::size_t length) {
+      if (length < 2 * sizeof(std::uint64_t))
+	throw std::string("[error] delta: truncated encoded payload.");
+      std::uint64_t size;
+      std::memcpy(&size, encoded, sizeof(size));
+      return size;
+    }
+
+    /*
+     *  Decode 'encoded' relative to 'base', which has decoded_size bytes,
+     *  into 'payload'.
+     */
+    inline void decode(const char* encoded, std::size_t length, const char* base, char* payload) {
+      std::uint64_t sizes[2];
+      if (length < sizeof(sizes))
+	throw std::string("[error] delta: truncated encoded payload.");
+      std::memcpy(sizes, encoded, sizeof(sizes));
+      if (sizeof(sizes) + sizes[1] > length)
+	throw std::string("[error] delta: truncated encoded payload.");
+
+      const std::size_t size(sizes[0]), words(size / 8);
+      std::vector<char> shuffled(size, 0);
+      const char* p(encoded + sizeof(sizes));
+      const char* end(p + sizes[1]);
+      std::size_t i(0);
+      while (p < end) {
+	i += get_varint(p, end);
+	const std::size_t literals(get_varint(p, end));
+	if (i + literals > size or p + literals > end)
+	  throw std::string("[error] delta: corrupted encoded payload.");
+	std::copy(p, p + literals, shuffled.begin() + i);
+	p += literals;
+	i += literals;
+      }
+
+      for (std::size_t k(0); k < size; ++k)
+	payload[k] = shuffled[shuffled_position(k, words)] ^ base[k];
+    }
+
+  }
+
+}
+
+#endif /* _ALUCELL_DELTA_H_ */
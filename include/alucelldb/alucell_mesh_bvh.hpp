@@ -0,0 +1,391 @@
+#ifndef _ALUCELL_MESH_BVH_H_
+#define _ALUCELL_MESH_BVH_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_mesh.hpp"
+#include "alucell_reference_element.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  Bounding volume hierarchy over the elements of a mesh, to find the
+   *  element containing a point.
+   *
+   *  The tree is built top down: the elements of a node are split at the
+   *  median of their centers along the longest axis of the bounding box
+   *  of the centers, until at most 'leaf_size' elements remain. The
+   *  nodes are stored in depth first order, so the left child of an
+   *  inner node follows it, and it stores the index of its right child.
+   */
+  class mesh_bvh {
+  public:
+    static const unsigned int default_leaf_size = 4;
+
+    struct node {
+      double lower[3], upper[3];
+      unsigned int first;  // First element of a leaf, or right child of an inner node
+      unsigned int count;  // Number of elements of a leaf, 0 for an inner node
+    };
+
+    mesh_bvh(): elements_number(0), nodes(), element_indices() {}
+
+    explicit mesh_bvh(const mesh& m, unsigned int leaf_size = default_leaf_size)
+      : elements_number(m.get_elements_number()), nodes(), element_indices(elements_number) {
+      std::vector<node> boxes(elements_number);
+      std::vector<double> centers(3 * elements_number, 0.);
+      for (std::size_t e(0); e < elements_number; ++e) {
+	boxes[e] = element_box(m, e);
+	for (unsigned int d(0); d < 3; ++d)
+	  centers[3 * e + d] = 0.5 * (boxes[e].lower[d] + boxes[e].upper[d]);
+	element_indices[e] = e;
+      }
+
+      if (elements_number)
+	build(boxes, centers, 0, elements_number, std::max(1u, leaf_size));
+    }
+
+    std::size_t get_elements_number() const { return elements_number; }
+    const std::vector<node>& get_nodes() const { return nodes; }
+
+    /*
+     *  Call f(e) on the elements whose bounding box contains the point,
+     *  until f returns true. Returns whether f returned true.
+     */
+    template<typename F>
+    bool for_each_candidate(const double* p, unsigned int dimension, F f) const {
+      if (nodes.empty())
+	return false;
+
+      unsigned int stack[max_depth];
+      unsigned int top(0);
+      stack[top++] = 0;
+      while (top) {
+	const node& n(nodes[stack[--top]]);
+	if (not box_contains(n, p, dimension))
+	  continue;
+
+	if (n.count) {
+	  for (unsigned int i(n.first); i < n.first + n.count; ++i)
+	    if (f(element_indices[i]))
+	      return true;
+	} else {
+	  stack[top++] = n.first;
+	  stack[top++] = &n - &nodes[0] + 1;
+	}
+      }
+      return false;
+    }
+
+    /*
+     *  Find the element of the mesh containing the point p, and its
+     *  reference coordinates xi. Returns the number of elements of the
+     *  mesh if the point is outside of the mesh.
+     */
+    std::size_t locate(const mesh& m, const reference_element& r, const double* p, double* xi) const {
+      const unsigned int dimension(m.get_dimension());
+      double x[reference_element::max_nodes * 3];
+      std::size_t found(elements_number);
+
+      for_each_candidate(p, dimension, [&](unsigned int e) -> bool {
+	  const unsigned int* element(m.get_element(e));
+	  for (unsigned int k(0); k < r.get_nodes_number(); ++k) {
+	    if (element[k] == mesh::no_node)
+	      return false;
+	    std::copy(m.get_node(element[k]), m.get_node(element[k]) + dimension, x + k * dimension);
+	  }
+	  if (not r.locate(x, p, xi))
+	    return false;
+	  found = e;
+	  return true;
+	});
+
+      return found;
+    }
+
+    /*
+     *  Save the tree in a file, tagged with the identity of the dbfile
+     *  and the name of the mesh.
+     */
+    void save(const std::string& filename, const file_identity& identity, const std::string& mesh_name) const {
+      std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (not file)
+	throw "mesh_bvh: unable to create " + filename + ".";
+
+      write_tag(file, identity, mesh_name);
+      const unsigned long long sizes[] = { nodes.size(), element_indices.size() };
+      file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+      file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(node));
+      file.write(reinterpret_cast<const char*>(element_indices.data()),
+		 element_indices.size() * sizeof(unsigned int));
+      if (not file)
+	throw "mesh_bvh: unable to write " + filename + ".";
+    }
+
+    /*
+     *  Load a tree saved by save(). Returns false, leaving an empty tree,
+     *  if the file does not exist, was built for another mesh or another
+     *  version of the dbfile, or does not hold a valid tree (see
+     *  is_valid), so that the caller rebuilds it.
+     */
+    bool load(const std::string& filename, const file_identity& identity, const std::string& mesh_name) {
+      *this = mesh_bvh();
+      std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+      if (not file)
+	return false;
+
+      std::ostringstream expected;
+      write_tag(expected, identity, mesh_name);
+      std::string tag(expected.str().size(), '\0');
+      file.read(&tag[0], tag.size());
+      if (not file or tag != expected.str())
+	return false;
+
+      unsigned long long sizes[2];
+      file.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+      if (not file)
+	return false;
+
+      /*
+       *  The sizes must match the rest of the file before anything is
+       *  allocated:
+       */
+      const std::streamoff position(file.tellg());
+      file.seekg(0, std::ios::end);
+      const unsigned long long remaining(file.tellg() - position);
+      file.seekg(position);
+      if (sizes[0] > remaining / sizeof(node) or sizes[1] > remaining / sizeof(unsigned int)
+	  or sizes[0] * sizeof(node) + sizes[1] * sizeof(unsigned int) != remaining)
+	return false;
+
+      nodes.resize(sizes[0]);
+      element_indices.resize(sizes[1]);
+      file.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(node));
+      file.read(reinterpret_cast<char*>(element_indices.data()),
+		element_indices.size() * sizeof(unsigned int));
+      elements_number = element_indices.size();
+      if (not file or not is_valid()) {
+	*this = mesh_bvh();
+	return false;
+      }
+      return true;
+    }
+
+    /*
+     *  Whether the tree can be searched safely: the element indices are
+     *  a permutation of the elements, every node but the root is the
+     *  child of exactly one inner node, stored after it, the leaves cover
+     *  the elements once, and the tree is shallow enough for the stack
+     *  of for_each_candidate.
+     */
+    bool is_valid() const {
+      if (nodes.empty() or elements_number == 0)
+	return nodes.empty() and elements_number == 0 and element_indices.empty();
+      if (element_indices.size() != elements_number)
+	return false;
+
+      std::vector<bool> seen(elements_number, false);
+      for (const auto e: element_indices) {
+	if (e >= elements_number or seen[e])
+	  return false;
+	seen[e] = true;
+      }
+
+      std::vector<unsigned int> depths(nodes.size(), 0);
+      std::vector<bool> reached(nodes.size(), false);
+      reached[0] = true;
+      std::size_t covered(0);
+      for (std::size_t i(0); i < nodes.size(); ++i) {
+	const node& n(nodes[i]);
+	if (not reached[i])
+	  return false;
+
+	if (n.count) {
+	  if (n.first != covered or n.count > elements_number - covered)
+	    return false;
+	  covered += n.count;
+	  continue;
+	}
+
+	if (depths[i] + 2 > max_depth or i + 1 >= nodes.size() or n.first <= i + 1 or n.first >= nodes.size()
+	    or reached[i + 1] or reached[n.first])
+	  return false;
+	reached[i + 1] = reached[n.first] = true;
+	depths[i + 1] = depths[n.first] = depths[i] + 1;
+      }
+      return covered == elements_number;
+    }
+
+  private:
+    static const unsigned int max_depth = 64;
+
+    std::size_t elements_number;
+    std::vector<node> nodes;
+    std::vector<unsigned int> element_indices;
+
+    static node element_box(const mesh& m, std::size_t e) {
+      node b;
+      std::fill(b.lower, b.lower + 3, 0.);
+      std::fill(b.upper, b.upper + 3, 0.);
+      b.first = e;
+      b.count = 1;
+
+      const unsigned int dimension(std::min(3u, m.get_dimension()));
+      for (unsigned int d(0); d < dimension; ++d) {
+	b.lower[d] = std::numeric_limits<double>::infinity();
+	b.upper[d] = -std::numeric_limits<double>::infinity();
+      }
+
+      const unsigned int* element(m.get_element(e));
+      for (unsigned int k(0); k < m.get_nodes_per_element(); ++k) {
+	if (element[k] == mesh::no_node)
+	  continue;
+	for (unsigned int d(0); d < dimension; ++d) {
+	  b.lower[d] = std::min(b.lower[d], m.get_node(element[k])[d]);
+	  b.upper[d] = std::max(b.upper[d], m.get_node(element[k])[d]);
+	}
+      }
+
+      /*
+       *  Widen the box a little, so the points on the faces are found
+       *  despite the rounding errors:
+       */
+      for (unsigned int d(0); d < dimension; ++d) {
+	const double margin(1e-9 * std::max(1., b.upper[d] - b.lower[d]));
+	b.lower[d] -= margin;
+	b.upper[d] += margin;
+      }
+      return b;
+    }
+
+    static bool box_contains(const node& n, const double* p, unsigned int dimension) {
+      for (unsigned int d(0); d < std::min(3u, dimension); ++d)
+	if (p[d] < n.lower[d] or p[d] > n.upper[d])
+	  return false;
+      return true;
+    }
+
+    unsigned int build(const std::vector<node>& boxes, std::vector<double>& centers,
+		       std::size_t begin, std::size_t end, unsigned int leaf_size) {
+      const unsigned int index(nodes.size());
+      nodes.push_back(node());
+
+      node n;
+      std::fill(n.lower, n.lower + 3, std::numeric_limits<double>::infinity());
+      std::fill(n.upper, n.upper + 3, -std::numeric_limits<double>::infinity());
+      double center_lower[3], center_upper[3];
+      std::copy(n.lower, n.lower + 3, center_lower);
+      std::copy(n.upper, n.upper + 3, center_upper);
+      for (std::size_t i(begin); i < end; ++i) {
+	const node& b(boxes[element_indices[i]]);
+	for (unsigned int d(0); d < 3; ++d) {
+	  n.lower[d] = std::min(n.lower[d], b.lower[d]);
+	  n.upper[d] = std::max(n.upper[d], b.upper[d]);
+	  center_lower[d] = std::min(center_lower[d], centers[3 * element_indices[i] + d]);
+	  center_upper[d] = std::max(center_upper[d], centers[3 * element_indices[i] + d]);
+	}
+      }
+
+      if (end - begin <= leaf_size) {
+	n.first = begin;
+	n.count = end - begin;
+	nodes[index] = n;
+	return index;
+      }
+
+      unsigned int axis(0);
+      for (unsigned int d(1); d < 3; ++d)
+	if (center_upper[d] - center_lower[d] > center_upper[axis] - center_lower[axis])
+	  axis = d;
+
+      const std::size_t middle(begin + (end - begin) / 2);
+      std::nth_element(element_indices.begin() + begin, element_indices.begin() + middle,
+		       element_indices.begin() + end,
+		       [&](unsigned int a, unsigned int b) {
+			 return centers[3 * a + axis] < centers[3 * b + axis]
+			   or (centers[3 * a + axis] == centers[3 * b + axis] and a < b);
+		       });
+
+      build(boxes, centers, begin, middle, leaf_size);
+      n.first = build(boxes, centers, middle, end, leaf_size);
+      n.count = 0;
+      nodes[index] = n;
+      return index;
+    }
+
+    template<typename S>
+    static void write_tag(S& stream, const file_identity& identity, const std::string& mesh_name) {
+      const char magic[8] = {'A', 'L', 'U', 'B', 'V', 'H', '1', '\0'};
+      const long long fields[] = {
+	static_cast<long long>(identity.device), static_cast<long long>(identity.inode),
+	identity.size, identity.mtime_sec, identity.mtime_nsec,
+	static_cast<long long>(mesh_name.size()),
+	static_cast<long long>(sizeof(node))
+      };
+      stream.write(magic, sizeof(magic));
+      stream.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+      stream.write(mesh_name.data(), mesh_name.size());
+    }
+  };
+
+
+  /*
+   *  Values at 'points' of the field 'values' of 'rows' rows and
+   *  'components' components, nodal if it has a row per node of the mesh,
+   *  elemental if it has a row per element. The nodal fields are
+   *  interpolated with the shape functions of the element containing the
+   *  point. 'elements' receives the element of each point, or the number
+   *  of elements for the points outside the mesh, whose values are NaN.
+   */
+  template<typename T>
+  void probe_field_values(const mesh& m, const mesh_bvh& bvh, const T* values,
+			  std::size_t rows, unsigned int components,
+			  const std::vector<double>& points, unsigned int threads,
+			  std::vector<std::size_t>& elements, std::vector<double>& results) {
+    const bool nodal(rows == m.get_nodes_number());
+    if (not nodal and rows != m.get_elements_number())
+      throw "probe: the field is neither a nodal nor an elemental field of " + m.get_name() + ".";
+
+    const reference_element r(m.get_dimension(), m.get_nodes_per_element());
+    const unsigned int dimension(m.get_dimension());
+    const std::size_t points_number(points.size() / dimension);
+    elements.assign(points_number, m.get_elements_number());
+    results.assign(points_number * components, std::numeric_limits<double>::quiet_NaN());
+
+    parallel_for(0, points_number, threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   double xi[3], n[reference_element::max_nodes];
+		   for (std::size_t i(b); i < e; ++i) {
+		     const double* p(&points[i * dimension]);
+		     elements[i] = bvh.locate(m, r, p, xi);
+		     if (elements[i] == m.get_elements_number())
+		       continue;
+
+		     double* result(&results[i * components]);
+		     if (not nodal) {
+		       for (unsigned int c(0); c < components; ++c)
+			 result[c] = values[elements[i] * components + c];
+		       continue;
+		     }
+
+		     r.shape_functions(xi, n);
+		     const unsigned int* element(m.get_element(elements[i]));
+		     std::fill(result, result + components, 0.);
+		     for (unsigned int k(0); k < r.get_nodes_number(); ++k)
+		       for (unsigned int c(0); c < components; ++c)
+			 result[c] += n[k] * values[static_cast<std::size_t>(element[k]) * components + c];
+		   }
+		 });
+  }
+
+}
+
+#endif /* _ALUCELL_MESH_BVH_H_ */
@@ -0,0 +1,254 @@
+#ifndef _ALUCELL_MESH_GEOMETRY_H_
+#define _ALUCELL_MESH_GEOMETRY_H_
+
+#include <map>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "alucell_mesh.hpp"
+#include "alucell_reference_element.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  namespace geometry {
+
+    /*
+     *  Number of elements of the blocks of the reductions: the partial
+     *  results of the blocks are combined in block order, so the results
+     *  do not depend on the number of threads.
+     */
+    const std::size_t block_elements = 4096;
+
+
+    /*
+     *  Shape functions and gradients of a reference element tabulated at
+     *  the points of its quadrature rule, to be reused on every element.
+     */
+    struct tabulated_quadrature {
+      unsigned int points, nodes, dimension;
+      std::vector<double> weights;
+      std::vector<double> values;     // points x nodes
+      std::vector<double> gradients;  // points x nodes x dimension
+
+      explicit tabulated_quadrature(const reference_element& r)
+	: points(0), nodes(r.get_nodes_number()), dimension(r.get_dimension()),
+	  weights(), values(), gradients() {
+	std::vector<double> xi;
+	r.get_quadrature(xi, weights);
+	points = weights.size();
+	values.resize(points * nodes);
+	gradients.resize(points * nodes * dimension);
+	for (unsigned int q(0); q < points; ++q) {
+	  r.shape_functions(&xi[q * dimension], &values[q * nodes]);
+	  r.shape_gradients(&xi[q * dimension], &gradients[q * nodes * dimension]);
+	}
+      }
+
+      /*
+       *  Determinant of the jacobian of the element of vertices 'x'
+       *  (nodes x dimension) at each quadrature point.
+       */
+      void jacobians(const double* x, double* determinants) const {
+	for (unsigned int q(0); q < points; ++q) {
+	  double j[9] = {0., 0., 0., 0., 0., 0., 0., 0., 0.};
+	  const double* g(&gradients[q * nodes * dimension]);
+	  for (unsigned int i(0); i < nodes; ++i)
+	    for (unsigned int a(0); a < dimension; ++a)
+	      for (unsigned int d(0); d < dimension; ++d)
+		j[a * dimension + d] += x[i * dimension + a] * g[i * dimension + d];
+
+	  switch (dimension) {
+	  case 1:
+	    determinants[q] = j[0];
+	    break;
+	  case 2:
+	    determinants[q] = j[0] * j[3] - j[1] * j[2];
+	    break;
+	  default:
+	    determinants[q] = j[0] * (j[4] * j[8] - j[5] * j[7])
+	      - j[1] * (j[3] * j[8] - j[5] * j[6])
+	      + j[2] * (j[3] * j[7] - j[4] * j[6]);
+	  }
+	}
+      }
+    };
+
+
+    /*
+     *  Copy the coordinates of the vertices of the element e into x
+     *  (nodes x dimension). Returns false if a vertex is unused.
+     */
+    inline bool gather_element(const mesh& m, std::size_t e, double* x) {
+      const unsigned int* element(m.get_element(e));
+      const unsigned int dimension(m.get_dimension());
+      for (unsigned int k(0); k < m.get_nodes_per_element(); ++k) {
+	if (element[k] == mesh::no_node)
+	  return false;
+	std::copy(m.get_node(element[k]), m.get_node(element[k]) + dimension, x + k * dimension);
+      }
+      return true;
+    }
+
+
+    /*
+     *  Measure (length, area or volume) and centroid of each element,
+     *  computed with the quadrature rule of the element. The elements
+     *  whose jacobian vanishes or changes sign at the quadrature points
+     *  are counted as distorted. The elements with unused vertices get a
+     *  zero measure and a NaN centroid.
+     */
+    struct element_geometry {
+      std::vector<double> measures;
+      std::vector<double> centroids;  // elements x dimension
+      std::size_t distorted_elements;
+    };
+
+    inline element_geometry compute_element_geometry(const mesh& m,
+						     unsigned int threads = default_threads_number()) {
+      const reference_element r(m.get_dimension(), m.get_nodes_per_element());
+      const tabulated_quadrature t(r);
+      const unsigned int dimension(m.get_dimension());
+      const std::size_t elements_number(m.get_elements_number());
+
+      element_geometry g;
+      g.measures.assign(elements_number, 0.);
+      g.centroids.assign(elements_number * dimension, std::numeric_limits<double>::quiet_NaN());
+      std::vector<char> distorted(elements_number, 0);
+
+      parallel_for(0, elements_number, threads,
+		   [&](unsigned int, std::size_t b, std::size_t e) {
+		     double x[reference_element::max_nodes * 3], determinants[8];
+		     for (std::size_t i(b); i < e; ++i) {
+		       if (not gather_element(m, i, x))
+			 continue;
+		       t.jacobians(x, determinants);
+
+		       double measure(0.), centroid[3] = {0., 0., 0.};
+		       bool positive(false), negative(false);
+		       for (unsigned int q(0); q < t.points; ++q) {
+			 positive = positive or determinants[q] > 0.;
+			 negative = negative or determinants[q] < 0.;
+			 const double w(t.weights[q] * std::fabs(determinants[q]));
+			 measure += w;
+			 for (unsigned int k(0); k < t.nodes; ++k)
+			   for (unsigned int d(0); d < dimension; ++d)
+			     centroid[d] += w * t.values[q * t.nodes + k] * x[k * dimension + d];
+		       }
+
+		       g.measures[i] = measure;
+		       for (unsigned int d(0); d < dimension; ++d)
+			 g.centroids[i * dimension + d] = measure > 0. ? centroid[d] / measure
+			   : std::numeric_limits<double>::quiet_NaN();
+		       distorted[i] = positive == negative;
+		     }
+		   });
+
+      g.distorted_elements = std::count(distorted.begin(), distorted.end(), 1);
+      return g;
+    }
+
+
+    /*
+     *  Sums of 'components' values per element, per reference of the
+     *  elements: f(e, v) adds the values of the element e to v. The
+     *  elements are summed by blocks in parallel, and the partial sums of
+     *  the blocks are combined in block order.
+     */
+    struct region_sum {
+      std::size_t elements;
+      std::vector<double> sums;
+    };
+
+    template<typename F>
+    std::map<int, region_sum> reduce_by_region(const mesh& m, unsigned int components, F f,
+					       unsigned int threads = default_threads_number()) {
+      const std::size_t elements_number(m.get_elements_number());
+      const std::size_t blocks((elements_number + block_elements - 1) / block_elements);
+      std::vector<std::map<int, region_sum> > partials(blocks);
+
+      parallel_for(0, blocks, threads,
+		   [&](unsigned int, std::size_t b, std::size_t e) {
+		     for (std::size_t block(b); block < e; ++block) {
+		       std::map<int, region_sum>& partial(partials[block]);
+		       const std::size_t last(std::min(elements_number, (block + 1) * block_elements));
+		       for (std::size_t i(block * block_elements); i < last; ++i) {
+			 region_sum& s(partial[m.get_reference(i)]);
+			 if (s.sums.empty())
+			   s.sums.assign(components, 0.);
+			 ++s.elements;
+			 f(i, s.sums.data());
+		       }
+		     }
+		   });
+
+      std::map<int, region_sum> totals;
+      for (const auto& partial: partials)
+	for (const auto& p: partial) {
+	  region_sum& s(totals[p.first]);
+	  if (s.sums.empty())
+	    s.sums.assign(components, 0.);
+	  s.elements += p.second.elements;
+	  for (unsigned int c(0); c < components; ++c)
+	    s.sums[c] += p.second.sums[c];
+	}
+      return totals;
+    }
+
+    /*
+     *  Sums of the 'components' values of each element, per reference.
+     */
+    inline std::map<int, region_sum> sum_by_region(const mesh& m, const double* values, unsigned int components,
+						   unsigned int threads = default_threads_number()) {
+      return reduce_by_region(m, components,
+			      [&](std::size_t i, double* sums) {
+				for (unsigned int c(0); c < components; ++c)
+				  sums[c] += values[i * components + c];
+			      }, threads);
+    }
+
+
+    /*
+     *  Axis aligned bounding box of the nodes of a mesh.
+     */
+    struct bounding_box {
+      std::vector<double> lower, upper;
+    };
+
+    inline bounding_box compute_bounds(const mesh& m, unsigned int threads = default_threads_number()) {
+      const unsigned int dimension(m.get_dimension());
+      const std::size_t nodes_number(m.get_nodes_number());
+      const unsigned int workers(std::max(1u, threads));
+
+      std::vector<bounding_box> partials(workers);
+      for (auto& p: partials) {
+	p.lower.assign(dimension, std::numeric_limits<double>::infinity());
+	p.upper.assign(dimension, -std::numeric_limits<double>::infinity());
+      }
+
+      parallel_for(0, nodes_number, workers,
+		   [&](unsigned int t, std::size_t b, std::size_t e) {
+		     bounding_box& p(partials[t]);
+		     for (std::size_t n(b); n < e; ++n)
+		       for (unsigned int d(0); d < dimension; ++d) {
+			 p.lower[d] = std::min(p.lower[d], m.get_node(n)[d]);
+			 p.upper[d] = std::max(p.upper[d], m.get_node(n)[d]);
+		       }
+		   });
+
+      bounding_box box(partials[0]);
+      for (const auto& p: partials)
+	for (unsigned int d(0); d < dimension; ++d) {
+	  box.lower[d] = std::min(box.lower[d], p.lower[d]);
+	  box.upper[d] = std::max(box.upper[d], p.upper[d]);
+	}
+      return box;
+    }
+
+  }
+
+}
+
+#endif /* _ALUCELL_MESH_GEOMETRY_H_ */
@@ -0,0 +1,300 @@
+#ifndef _ALUCELL_MESH_REORDER_H_
+#define _ALUCELL_MESH_REORDER_H_
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "alucell_mesh.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  Renumbering of the nodes and elements of a mesh, to improve the
+   *  locality of the gathers over the connectivity. The orders map the
+   *  new indices to the old ones: the new node n is the old node
+   *  node_order[n].
+   */
+  struct mesh_ordering {
+    std::vector<unsigned int> node_order, element_order;
+  };
+
+
+  /*
+   *  Node to node adjacency of a mesh, in compressed sparse row layout:
+   *  the neighbours of the node n, sharing an element with it, are
+   *  neighbours[offsets[n]] to neighbours[offsets[n + 1] - 1], sorted.
+   */
+  inline void build_node_neighbours(const mesh& m, std::vector<std::size_t>& offsets,
+				    std::vector<unsigned int>& neighbours,
+				    unsigned int threads = default_threads_number()) {
+    const std::size_t nodes_number(m.get_nodes_number());
+    const std::vector<std::size_t>& element_offsets(m.get_node_elements_offsets());
+    const std::vector<unsigned int>& node_elements(m.get_node_elements());
+
+    auto gather = [&](std::size_t n, std::vector<unsigned int>& list) {
+      list.clear();
+      for (std::size_t k(element_offsets[n]); k < element_offsets[n + 1]; ++k) {
+	const unsigned int* element(m.get_element(node_elements[k]));
+	for (unsigned int j(0); j < m.get_nodes_per_element(); ++j)
+	  if (element[j] != mesh::no_node and element[j] != n)
+	    list.push_back(element[j]);
+      }
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    };
+
+    offsets.assign(nodes_number + 1, 0);
+    parallel_for(0, nodes_number, threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   std::vector<unsigned int> list;
+		   for (std::size_t n(b); n < e; ++n) {
+		     gather(n, list);
+		     offsets[n + 1] = list.size();
+		   }
+		 });
+
+    for (std::size_t n(0); n < nodes_number; ++n)
+      offsets[n + 1] += offsets[n];
+
+    neighbours.resize(offsets[nodes_number]);
+    parallel_for(0, nodes_number, threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   std::vector<unsigned int> list;
+		   for (std::size_t n(b); n < e; ++n) {
+		     gather(n, list);
+		     std::copy(list.begin(), list.end(), neighbours.begin() + offsets[n]);
+		   }
+		 });
+  }
+
+
+  /*
+   *  Order the elements by the smallest new index of their nodes, so the
+   *  element order follows the node order.
+   */
+  inline std::vector<unsigned int> element_order_from_nodes(const mesh& m,
+							    const std::vector<unsigned int>& node_order) {
+    std::vector<unsigned int> new_node(node_order.size());
+    for (std::size_t n(0); n < node_order.size(); ++n)
+      new_node[node_order[n]] = n;
+
+    std::vector<unsigned int> keys(m.get_elements_number(), std::numeric_limits<unsigned int>::max());
+    for (std::size_t e(0); e < keys.size(); ++e)
+      for (unsigned int k(0); k < m.get_nodes_per_element(); ++k)
+	if (m.get_element(e)[k] != mesh::no_node)
+	  keys[e] = std::min(keys[e], new_node[m.get_element(e)[k]]);
+
+    std::vector<unsigned int> order(keys.size());
+    for (std::size_t e(0); e < order.size(); ++e)
+      order[e] = e;
+    std::stable_sort(order.begin(), order.end(),
+		     [&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+    return order;
+  }
+
+
+  /*
+   *  Reverse Cuthill-McKee ordering of the nodes. Each connected
+   *  component is numbered by a breadth first traversal starting from a
+   *  pseudo peripheral node, the neighbours being visited by increasing
+   *  degree, and the whole order is reversed.
+   */
+  inline mesh_ordering reverse_cuthill_mckee_ordering(const mesh& m,
+						      unsigned int threads = default_threads_number()) {
+    std::vector<std::size_t> offsets;
+    std::vector<unsigned int> neighbours;
+    build_node_neighbours(m, offsets, neighbours, threads);
+
+    const std::size_t nodes_number(m.get_nodes_number());
+    auto degree = [&](unsigned int n) { return offsets[n + 1] - offsets[n]; };
+
+    /*
+     *  Breadth first traversal from 'start' of the nodes not yet numbered,
+     *  appending them to 'order' level by level.
+     */
+    std::vector<char> numbered(nodes_number, 0);
+    std::vector<unsigned int> order;
+    order.reserve(nodes_number);
+    auto traverse = [&](unsigned int start) {
+      std::size_t head(order.size());
+      order.push_back(start);
+      numbered[start] = 1;
+
+      std::vector<unsigned int> next;
+      for (; head < order.size(); ++head) {
+	const unsigned int n(order[head]);
+	next.clear();
+	for (std::size_t k(offsets[n]); k < offsets[n + 1]; ++k)
+	  if (not numbered[neighbours[k]]) {
+	    numbered[neighbours[k]] = 1;
+	    next.push_back(neighbours[k]);
+	  }
+	std::stable_sort(next.begin(), next.end(),
+			 [&](unsigned int a, unsigned int b) { return degree(a) < degree(b); });
+	order.insert(order.end(), next.begin(), next.end());
+      }
+    };
+
+    /*
+     *  Number of levels of the breadth first traversal from 'start', and
+     *  node of smallest degree of the last level.
+     */
+    std::vector<unsigned int> stamps(nodes_number, 0);
+    unsigned int stamp(0);
+    auto eccentricity = [&](unsigned int start, unsigned int& farthest) {
+      ++stamp;
+      std::vector<unsigned int> frontier(1, start), following;
+      stamps[start] = stamp;
+
+      std::size_t levels(1);
+      while (true) {
+	following.clear();
+	for (const auto n: frontier)
+	  for (std::size_t k(offsets[n]); k < offsets[n + 1]; ++k)
+	    if (stamps[neighbours[k]] != stamp) {
+	      stamps[neighbours[k]] = stamp;
+	      following.push_back(neighbours[k]);
+	    }
+	if (following.empty())
+	  break;
+	frontier.swap(following);
+	++levels;
+      }
+
+      farthest = frontier[0];
+      for (const auto n: frontier)
+	if (degree(n) < degree(farthest))
+	  farthest = n;
+      return levels;
+    };
+
+    std::vector<unsigned int> by_degree(nodes_number);
+    for (std::size_t n(0); n < nodes_number; ++n)
+      by_degree[n] = n;
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+		     [&](unsigned int a, unsigned int b) { return degree(a) < degree(b); });
+
+    for (const auto candidate: by_degree) {
+      if (numbered[candidate])
+	continue;
+
+      /*
+       *  Look for a pseudo peripheral node of the component: move to the
+       *  farthest node while the number of levels grows.
+       */
+      unsigned int start(candidate), farthest(candidate);
+      std::size_t depth(eccentricity(start, farthest));
+      for (unsigned int iteration(0); iteration < 8; ++iteration) {
+	unsigned int next(farthest);
+	const std::size_t levels(eccentricity(farthest, next));
+	if (levels <= depth)
+	  break;
+	depth = levels;
+	start = farthest;
+	farthest = next;
+      }
+
+      traverse(start);
+    }
+
+    mesh_ordering ordering;
+    ordering.node_order.assign(order.rbegin(), order.rend());
+    ordering.element_order = element_order_from_nodes(m, ordering.node_order);
+    return ordering;
+  }
+
+
+  /*
+   *  Space filling curve ordering: the nodes are sorted along a Morton
+   *  (Z order) curve over their bounding box, with 21 bits per axis in
+   *  3D and 31 bits per axis in 2D.
+   */
+  inline mesh_ordering morton_ordering(const mesh& m) {
+    const std::size_t nodes_number(m.get_nodes_number());
+    const unsigned int dimension(std::min(3u, m.get_dimension()));
+
+    std::vector<double> lower(dimension, std::numeric_limits<double>::infinity());
+    std::vector<double> upper(dimension, -std::numeric_limits<double>::infinity());
+    for (std::size_t n(0); n < nodes_number; ++n)
+      for (unsigned int d(0); d < dimension; ++d) {
+	lower[d] = std::min(lower[d], m.get_node(n)[d]);
+	upper[d] = std::max(upper[d], m.get_node(n)[d]);
+      }
+
+    const unsigned int bits(dimension == 0 ? 0 : std::min(32u, 63 / dimension));
+    const double cells(static_cast<double>((1ull << bits) - 1));
+    std::vector<unsigned long long> codes(nodes_number, 0);
+    for (std::size_t n(0); n < nodes_number; ++n) {
+      unsigned long long q[3] = {0, 0, 0};
+      for (unsigned int d(0); d < dimension; ++d)
+	if (upper[d] > lower[d])
+	  q[d] = (m.get_node(n)[d] - lower[d]) / (upper[d] - lower[d]) * cells;
+
+      unsigned long long code(0);
+      for (unsigned int b(bits); b-- > 0;)
+	for (unsigned int d(0); d < dimension; ++d)
+	  code = (code << 1) | ((q[d] >> b) & 1);
+      codes[n] = code;
+    }
+
+    mesh_ordering ordering;
+    ordering.node_order.resize(nodes_number);
+    for (std::size_t n(0); n < nodes_number; ++n)
+      ordering.node_order[n] = n;
+    std::stable_sort(ordering.node_order.begin(), ordering.node_order.end(),
+		     [&](unsigned int a, unsigned int b) { return codes[a] < codes[b]; });
+    ordering.element_order = element_order_from_nodes(m, ordering.node_order);
+    return ordering;
+  }
+
+
+  /*
+   *  Bandwidth of the node adjacency of a mesh: the largest difference
+   *  between the indices of two nodes of an element. The mean of this
+   *  difference over the elements is returned in 'mean_spread'.
+   */
+  inline std::size_t mesh_bandwidth(const mesh& m, double* mean_spread = NULL) {
+    std::size_t bandwidth(0);
+    double sum(0.);
+    for (std::size_t e(0); e < m.get_elements_number(); ++e) {
+      unsigned int lowest(std::numeric_limits<unsigned int>::max()), highest(0);
+      for (unsigned int k(0); k < m.get_nodes_per_element(); ++k) {
+	const unsigned int n(m.get_element(e)[k]);
+	if (n == mesh::no_node)
+	  continue;
+	lowest = std::min(lowest, n);
+	highest = std::max(highest, n);
+      }
+      if (highest >= lowest) {
+	bandwidth = std::max<std::size_t>(bandwidth, highest - lowest);
+	sum += highest - lowest;
+      }
+    }
+
+    if (mean_spread)
+      *mean_spread = m.get_elements_number() ? sum / m.get_elements_number() : 0.;
+    return bandwidth;
+  }
+
+
+  /*
+   *  Copy the rows of an array in the new order: the row r of 'out' is
+   *  the row order[r] of 'in'.
+   */
+  template<typename T>
+  void permute_rows(const T* in, unsigned int components, const std::vector<unsigned int>& order, T* out,
+		    unsigned int threads = default_threads_number()) {
+    parallel_for(0, order.size(), threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   for (std::size_t r(b); r < e; ++r)
+		     std::copy(in + static_cast<std::size_t>(order[r]) * components,
+			       in + static_cast<std::size_t>(order[r] + 1) * components,
+			       out + r * components);
+		 });
+  }
+
+}
+
+#endif /* _ALUCELL_MESH_REORDER_H_ */
@@ -0,0 +1,73 @@
+#ifndef _ALUCELL_QUERY_CLIENT_H_
+#define _ALUCELL_QUERY_CLIENT_H_
+
+#include <string>
+#include <vector>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_statistics.hpp"
+#include "alucell_query_protocol.hpp"
+
+namespace alucell {
+
+  /*
+   *  Client of the query server (see alucell_query_server.hpp), holding
+   *  one connection. The dbfile names are made absolute before they are
+   *  sent, the server having its own working directory. The error
+   *  responses of the server are thrown as strings.
+   */
+  class query_client {
+  public:
+    struct variable_description {
+      std::string name;
+      data_type type;
+      std::size_t size;
+    };
+
+    struct variable_summary {
+      data_type type;
+      std::size_t size, rows;
+      unsigned int components;
+      std::vector<double> values;  // See 'show' in alucell_query_protocol.hpp
+      std::string text;
+    };
+
+    struct array_values {
+      data_type type;
+      std::size_t rows;
+      unsigned int components;
+      std::vector<double> values;  // Row major
+    };
+
+    struct probe_values {
+      unsigned int dimension, components;
+      std::vector<std::size_t> elements;  // 1 based, 0 outside of the mesh
+      std::vector<double> values;
+    };
+
+    explicit query_client(const std::string& socket_path);
+    ~query_client();
+
+    query_client(const query_client&) = delete;
+    query_client& operator=(const query_client&) = delete;
+
+    std::vector<variable_description> ls(const std::string& db_filename);
+    variable_summary show(const std::string& db_filename, const std::string& name);
+    array_values dump(const std::string& db_filename, const std::string& spec);
+    std::vector<statistics::component_statistics>
+    stats(const std::string& db_filename, const std::string& name,
+	  const std::vector<double>& percentiles = std::vector<double>());
+    probe_values probe(const std::string& db_filename, const std::string& mesh, const std::string& name,
+		       const std::vector<double>& points);
+
+  private:
+    int fd;
+    std::vector<char> response;
+
+    query::message_writer request(query::operation op, const std::string& db_filename);
+    query::message_reader exchange(query::message_writer& request);
+  };
+
+}
+
+#endif /* _ALUCELL_QUERY_CLIENT_H_ */
@@ -0,0 +1,208 @@
+#ifndef _ALUCELL_QUERY_PROTOCOL_H_
+#define _ALUCELL_QUERY_PROTOCOL_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace alucell {
+
+  /*
+   *  Binary protocol of the query server (see alucell_query_server.hpp).
+   *
+   *  Each message is a frame: a uint32 length followed by 'length' bytes.
+   *  The integers and doubles are in the byte order of the host, the
+   *  server being local. The strings are a uint32 length followed by
+   *  their bytes. A client sends a request and waits for its response
+   *  before sending the next one on the same connection.
+   *
+   *  A request starts with the uint8 operation and the dbfile name,
+   *  followed by:
+   *    ls     -
+   *    show   string variable name
+   *    dump   string variable name, with an optional row selection
+   *           (see 'db dump -h')
+   *    stats  string variable name, uint32 n, n doubles percentiles
+   *    probe  string mesh name, string variable name, uint64 n,
+   *           n doubles point coordinates
+   *
+   *  A response starts with a uint8 status, 0 for success followed by:
+   *    ls     uint32 n, n times (uint8 data_type, uint64 size, string name)
+   *    show   uint8 data_type, uint64 size, uint64 rows, uint32 components,
+   *           uint32 n, n doubles, string
+   *           The doubles are the min and max of each component of the
+   *           arrays, the range of the matrices or the value of the real
+   *           numbers, and the string is the value of the strings.
+   *    dump   uint8 data_type, uint64 rows, uint32 components,
+   *           rows * components doubles
+   *    stats  uint64 rows, uint32 components, and for each component:
+   *           uint64 count, nan_count, inf_count, doubles min, max, sum,
+   *           mean, l1_norm, l2_norm, linf_norm, uint32 n, n pairs of
+   *           doubles (percentile, value)
+   *    probe  uint32 dimension, uint32 components, uint64 n, and for each
+   *           point: uint64 element (1 based, 0 outside of the mesh),
+   *           components doubles
+   *  or 1 for an error, followed by the string error message.
+   */
+  namespace query {
+
+    enum class operation: std::uint8_t { ls = 1, show, dump, stats, probe };
+
+    const std::uint8_t status_ok = 0;
+    const std::uint8_t status_error = 1;
+
+    /*
+     *  Largest frame accepted, to reject a corrupted length.
+     */
+    const std::uint32_t max_frame_size = 1u << 31;
+
+    class message_writer {
+    public:
+      message_writer(): data() {}
+
+      template<typename T>
+      message_writer& put(T value) {
+	const char* p(reinterpret_cast<const char*>(&value));
+	data.insert(data.end(), p, p + sizeof(value));
+	return *this;
+      }
+
+      message_writer& put_string(const std::string& s) {
+	put<std::uint32_t>(s.size());
+	data.insert(data.end(), s.begin(), s.end());
+	return *this;
+      }
+
+      message_writer& put_doubles(const double* values, std::size_t n) {
+	const char* p(reinterpret_cast<const char*>(values));
+	data.insert(data.end(), p, p + n * sizeof(double));
+	return *this;
+      }
+
+      std::vector<char>& get_data() { return data; }
+
+    private:
+      std::vector<char> data;
+    };
+
+    class message_reader {
+    public:
+      message_reader(const std::vector<char>& _data): data(_data), position(0) {}
+
+      template<typename T>
+      T get() {
+	T value;
+	check(sizeof(value));
+	std::memcpy(&value, &data[position], sizeof(value));
+	position += sizeof(value);
+	return value;
+      }
+
+      std::string get_string() {
+	const std::size_t n(get<std::uint32_t>());
+	check(n);
+	const std::string s(data.begin() + position, data.begin() + position + n);
+	position += n;
+	return s;
+      }
+
+      void get_doubles(double* values, std::size_t n) {
+	check(n * sizeof(double));
+	if (n)
+	  std::memcpy(values, &data[position], n * sizeof(double));
+	position += n * sizeof(double);
+      }
+
+      /*
+       *  Number of elements of 'element_size' bytes announced by a field
+       *  of type T, checked against the rest of the message before the
+       *  elements are allocated.
+       */
+      template<typename T>
+      std::size_t get_count(std::size_t element_size) {
+	const std::size_t n(get<T>());
+	if (n > remaining() / element_size)
+	  throw std::string("[error] query: truncated message.");
+	return n;
+      }
+
+      std::size_t remaining() const { return data.size() - position; }
+
+    private:
+      const std::vector<char>& data;
+      std::size_t position;
+
+      void check(std::size_t n) const {
+	if (n > data.size() - position)
+	  throw std::string("[error] query: truncated message.");
+      }
+    };
+
+    /*
+     *  Write a frame, retrying the partial writes. A peer which hung up
+     *  raises an error rather than a SIGPIPE, and a message larger than
+     *  max_frame_size is refused before anything is sent.
+     */
+    inline void send_frame(int fd, const std::vector<char>& message) {
+      if (message.size() > max_frame_size)
+	throw "[error] query: message of " + std::to_string(message.size()) + " bytes, larger than a frame.";
+      const std::uint32_t length(message.size());
+      std::vector<char> frame(sizeof(length) + message.size());
+      std::memcpy(frame.data(), &length, sizeof(length));
+      if (message.size())
+	std::memcpy(frame.data() + sizeof(length), message.data(), message.size());
+
+      std::size_t written(0);
+      while (written < frame.size()) {
+	const ssize_t n(::send(fd, frame.data() + written, frame.size() - written, MSG_NOSIGNAL));
+	if (n < 0 and errno == EINTR)
+	  continue;
+	if (n <= 0)
+	  throw std::string("[error] query: unable to send a message.");
+	written += n;
+      }
+    }
+
+    inline bool read_fully(int fd, char* dst, std::size_t size) {
+      std::size_t done(0);
+      while (done < size) {
+	const ssize_t n(::read(fd, dst + done, size - done));
+	if (n < 0 and errno == EINTR)
+	  continue;
+	if (n < 0 and (errno == EAGAIN or errno == EWOULDBLOCK))
+	  throw std::string("[error] query: timed out while receiving a message.");
+	if (n < 0)
+	  throw std::string("[error] query: unable to receive a message.");
+	if (n == 0)
+	  return false;
+	done += n;
+      }
+      return true;
+    }
+
+    /*
+     *  Read a frame. Returns false if the connection was closed before
+     *  the frame started.
+     */
+    inline bool receive_frame(int fd, std::vector<char>& message) {
+      std::uint32_t length(0);
+      if (not read_fully(fd, reinterpret_cast<char*>(&length), sizeof(length)))
+	return false;
+      if (length > max_frame_size)
+	throw std::string("[error] query: invalid message length.");
+      message.resize(length);
+      if (length and not read_fully(fd, message.data(), length))
+	throw std::string("[error] query: connection closed in the middle of a message.");
+      return true;
+    }
+
+  }
+
+}
+
+#endif /* _ALUCELL_QUERY_PROTOCOL_H_ */
@@ -0,0 +1,333 @@
+#ifndef _ALUCELL_REFERENCE_ELEMENT_H_
+#define _ALUCELL_REFERENCE_ELEMENT_H_
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace alucell {
+
+  /*
+   *  Lagrange P1/Q1 reference elements, identified by the dimension of
+   *  the mesh and the number of nodes per element.
+   *
+   *  The vertices are assumed to be numbered as in the usual conventions
+   *  of the meshers: the quadrangles and the two faces of the hexahedra
+   *  counterclockwise, the bottom face (z = 0) of the prisms and
+   *  hexahedra first. The reference coordinates are in [0, 1]:
+   *    segment      (0), (1)
+   *    triangle     (0, 0), (1, 0), (0, 1)
+   *    quadrangle   (0, 0), (1, 0), (1, 1), (0, 1)
+   *    tetrahedron  (0, 0, 0), (1, 0, 0), (0, 1, 0), (0, 0, 1)
+   *    prism        triangle x (0), then triangle x (1)
+   *    hexahedron   quadrangle x (0), then quadrangle x (1)
+   */
+  enum class element_kind { segment, triangle, quadrangle, tetrahedron, prism, hexahedron };
+
+  class reference_element {
+  public:
+    static const unsigned int max_nodes = 8;
+
+    reference_element(unsigned int _dimension, unsigned int nodes_per_element)
+      : kind(element_kind::segment), dimension(_dimension), nodes(nodes_per_element) {
+      if (dimension == 1 and nodes == 2)
+	kind = element_kind::segment;
+      else if (dimension == 2 and nodes == 3)
+	kind = element_kind::triangle;
+      else if (dimension == 2 and nodes == 4)
+	kind = element_kind::quadrangle;
+      else if (dimension == 3 and nodes == 4)
+	kind = element_kind::tetrahedron;
+      else if (dimension == 3 and nodes == 6)
+	kind = element_kind::prism;
+      else if (dimension == 3 and nodes == 8)
+	kind = element_kind::hexahedron;
+      else
+	throw "reference_element: unsupported element with " + std::to_string(nodes)
+	  + " nodes in dimension " + std::to_string(dimension) + ".";
+    }
+
+    element_kind get_kind() const { return kind; }
+    unsigned int get_dimension() const { return dimension; }
+    unsigned int get_nodes_number() const { return nodes; }
+
+    std::string get_name() const {
+      static const char* names[] = {"segment", "triangle", "quadrangle",
+				    "tetrahedron", "prism", "hexahedron"};
+      return names[static_cast<unsigned int>(kind)];
+    }
+
+    /*
+     *  Values of the shape functions at the reference point xi.
+     */
+    void shape_functions(const double* xi, double* n) const {
+      const double x(xi[0]), y(dimension > 1 ? xi[1] : 0.), z(dimension > 2 ? xi[2] : 0.);
+      switch (kind) {
+      case element_kind::segment:
+	n[0] = 1. - x; n[1] = x;
+	break;
+      case element_kind::triangle:
+	n[0] = 1. - x - y; n[1] = x; n[2] = y;
+	break;
+      case element_kind::quadrangle:
+	n[0] = (1. - x) * (1. - y); n[1] = x * (1. - y); n[2] = x * y; n[3] = (1. - x) * y;
+	break;
+      case element_kind::tetrahedron:
+	n[0] = 1. - x - y - z; n[1] = x; n[2] = y; n[3] = z;
+	break;
+      case element_kind::prism:
+	n[0] = (1. - x - y) * (1. - z); n[1] = x * (1. - z); n[2] = y * (1. - z);
+	n[3] = (1. - x - y) * z; n[4] = x * z; n[5] = y * z;
+	break;
+      case element_kind::hexahedron:
+	n[0] = (1. - x) * (1. - y) * (1. - z); n[1] = x * (1. - y) * (1. - z);
+	n[2] = x * y * (1. - z); n[3] = (1. - x) * y * (1. - z);
+	n[4] = (1. - x) * (1. - y) * z; n[5] = x * (1. - y) * z;
+	n[6] = x * y * z; n[7] = (1. - x) * y * z;
+	break;
+      }
+    }
+
+    /*
+     *  Gradients of the shape functions at the reference point xi:
+     *  g[i * dimension + d] is the derivative of the i-th function with
+     *  respect to the d-th reference coordinate.
+     */
+    void shape_gradients(const double* xi, double* g) const {
+      const double x(xi[0]), y(dimension > 1 ? xi[1] : 0.), z(dimension > 2 ? xi[2] : 0.);
+      switch (kind) {
+      case element_kind::segment: {
+	const double v[] = {-1., 1.};
+	std::copy(v, v + 2, g);
+	break;
+      }
+      case element_kind::triangle: {
+	const double v[] = {-1., -1., 1., 0., 0., 1.};
+	std::copy(v, v + 6, g);
+	break;
+      }
+      case element_kind::quadrangle: {
+	const double v[] = {-(1. - y), -(1. - x),
+			    1. - y, -x,
+			    y, x,
+			    -y, 1. - x};
+	std::copy(v, v + 8, g);
+	break;
+      }
+      case element_kind::tetrahedron: {
+	const double v[] = {-1., -1., -1., 1., 0., 0., 0., 1., 0., 0., 0., 1.};
+	std::copy(v, v + 12, g);
+	break;
+      }
+      case element_kind::prism: {
+	const double v[] = {-(1. - z), -(1. - z), -(1. - x - y),
+			    1. - z, 0., -x,
+			    0., 1. - z, -y,
+			    -z, -z, 1. - x - y,
+			    z, 0., x,
+			    0., z, y};
+	std::copy(v, v + 18, g);
+	break;
+      }
+      case element_kind::hexahedron: {
+	const double v[] = {-(1. - y) * (1. - z), -(1. - x) * (1. - z), -(1. - x) * (1. - y),
+			    (1. - y) * (1. - z), -x * (1. - z), -x * (1. - y),
+			    y * (1. - z), x * (1. - z), -x * y,
+			    -y * (1. - z), (1. - x) * (1. - z), -(1. - x) * y,
+			    -(1. - y) * z, -(1. - x) * z, (1. - x) * (1. - y),
+			    (1. - y) * z, -x * z, x * (1. - y),
+			    y * z, x * z, x * y,
+			    -y * z, (1. - x) * z, (1. - x) * y};
+	std::copy(v, v + 24, g);
+	break;
+      }
+      }
+    }
+
+    /*
+     *  Reference point at the center of the element.
+     */
+    void get_center(double* xi) const {
+      const bool simplex(kind == element_kind::triangle or kind == element_kind::tetrahedron);
+      for (unsigned int d(0); d < dimension; ++d)
+	xi[d] = simplex ? 1. / (dimension + 1) : 0.5;
+      if (kind == element_kind::prism)
+	xi[0] = xi[1] = 1. / 3.;
+    }
+
+    /*
+     *  Quadrature rule of the element: 'points' holds the reference
+     *  coordinates of the points (points x dimension). The rules are
+     *  exact for the products of a shape function by the determinant of
+     *  the jacobian: one point for the tetrahedra, three points for the
+     *  triangles, Gauss-Legendre with two points per direction for the
+     *  segments, quadrangles and hexahedra, and the product of both for
+     *  the prisms.
+     */
+    void get_quadrature(std::vector<double>& points, std::vector<double>& weights) const {
+      const double g[] = {0.5 - 0.5 / std::sqrt(3.), 0.5 + 0.5 / std::sqrt(3.)};
+      const double t[] = {1. / 6., 1. / 6., 2. / 3., 1. / 6., 1. / 6., 2. / 3.};
+      points.clear();
+      weights.clear();
+
+      switch (kind) {
+      case element_kind::segment:
+	for (unsigned int i(0); i < 2; ++i) {
+	  points.push_back(g[i]);
+	  weights.push_back(0.5);
+	}
+	break;
+      case element_kind::triangle:
+	points.assign(t, t + 6);
+	weights.assign(3, 1. / 6.);
+	break;
+      case element_kind::quadrangle:
+	for (unsigned int j(0); j < 2; ++j)
+	  for (unsigned int i(0); i < 2; ++i) {
+	    points.push_back(g[i]);
+	    points.push_back(g[j]);
+	    weights.push_back(0.25);
+	  }
+	break;
+      case element_kind::tetrahedron:
+	points.assign(3, 0.25);
+	weights.assign(1, 1. / 6.);
+	break;
+      case element_kind::prism:
+	for (unsigned int k(0); k < 2; ++k)
+	  for (unsigned int i(0); i < 3; ++i) {
+	    points.push_back(t[2 * i]);
+	    points.push_back(t[2 * i + 1]);
+	    points.push_back(g[k]);
+	    weights.push_back(1. / 12.);
+	  }
+	break;
+      case element_kind::hexahedron:
+	for (unsigned int k(0); k < 2; ++k)
+	  for (unsigned int j(0); j < 2; ++j)
+	    for (unsigned int i(0); i < 2; ++i) {
+	      points.push_back(g[i]);
+	      points.push_back(g[j]);
+	      points.push_back(g[k]);
+	      weights.push_back(0.125);
+	    }
+	break;
+      }
+    }
+
+    /*
+     *  Whether the reference point xi is inside the element, up to
+     *  'tolerance'.
+     */
+    bool contains(const double* xi, double tolerance) const {
+      for (unsigned int d(0); d < dimension; ++d)
+	if (xi[d] < -tolerance)
+	  return false;
+
+      switch (kind) {
+      case element_kind::triangle:
+	return xi[0] + xi[1] <= 1. + tolerance;
+      case element_kind::tetrahedron:
+	return xi[0] + xi[1] + xi[2] <= 1. + tolerance;
+      case element_kind::prism:
+	return xi[0] + xi[1] <= 1. + tolerance and xi[2] <= 1. + tolerance;
+      default:
+	for (unsigned int d(0); d < dimension; ++d)
+	  if (xi[d] > 1. + tolerance)
+	    return false;
+	return true;
+      }
+    }
+
+    /*
+     *  Jacobian matrix j[a * dimension + d] = dx_a / dxi_d of the mapping
+     *  of the element of vertices 'x' (nodes x dimension) at xi, and its
+     *  determinant.
+     */
+    double jacobian(const double* x, const double* xi, double* j) const {
+      double g[max_nodes * 3];
+      shape_gradients(xi, g);
+      std::fill(j, j + dimension * dimension, 0.);
+      for (unsigned int i(0); i < nodes; ++i)
+	for (unsigned int a(0); a < dimension; ++a)
+	  for (unsigned int d(0); d < dimension; ++d)
+	    j[a * dimension + d] += x[i * dimension + a] * g[i * dimension + d];
+      return determinant(j);
+    }
+
+    /*
+     *  Find the reference coordinates xi of the physical point p in the
+     *  element of vertices 'x', by Newton iterations. Returns false if
+     *  the iterations do not converge, or if the point is outside the
+     *  element.
+     */
+    bool locate(const double* x, const double* p, double* xi, double tolerance = 1e-8) const {
+      get_center(xi);
+      double n[max_nodes], j[9], r[3], dxi[3];
+
+      for (unsigned int iteration(0); iteration < 32; ++iteration) {
+	shape_functions(xi, n);
+	for (unsigned int a(0); a < dimension; ++a) {
+	  r[a] = p[a];
+	  for (unsigned int i(0); i < nodes; ++i)
+	    r[a] -= n[i] * x[i * dimension + a];
+	}
+
+	if (jacobian(x, xi, j) == 0. or not solve(j, r, dxi))
+	  return false;
+
+	double step(0.);
+	for (unsigned int d(0); d < dimension; ++d) {
+	  xi[d] += dxi[d];
+	  step = std::max(step, std::fabs(dxi[d]));
+	}
+
+	if (step < 1e-12)
+	  return contains(xi, tolerance);
+	if (std::fabs(xi[0]) > 1e3)
+	  return false;
+      }
+
+      return contains(xi, tolerance);
+    }
+
+  private:
+    element_kind kind;
+    unsigned int dimension, nodes;
+
+    double determinant(const double* j) const {
+      switch (dimension) {
+      case 1:
+	return j[0];
+      case 2:
+	return j[0] * j[3] - j[1] * j[2];
+      default:
+	return j[0] * (j[4] * j[8] - j[5] * j[7])
+	  - j[1] * (j[3] * j[8] - j[5] * j[6])
+	  + j[2] * (j[3] * j[7] - j[4] * j[6]);
+      }
+    }
+
+    /*
+     *  Solve j x = r by Cramer's rule.
+     */
+    bool solve(const double* j, const double* r, double* x) const {
+      const double det(determinant(j));
+      if (det == 0. or not std::isfinite(det))
+	return false;
+
+      double m[9];
+      for (unsigned int d(0); d < dimension; ++d) {
+	std::copy(j, j + dimension * dimension, m);
+	for (unsigned int a(0); a < dimension; ++a)
+	  m[a * dimension + d] = r[a];
+	x[d] = determinant(m) / det;
+      }
+      return true;
+    }
+  };
+
+}
+
+#endif /* _ALUCELL_REFERENCE_ELEMENT_H_ */
@@ -0,0 +1,282 @@
+#ifndef _ALUCELL_SPARSE_H_
+#define _ALUCELL_SPARSE_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <algorithm>
+
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  View over the payload of a sky_matrix variable, without copy.
+   *
+   *  The layout of the payload is not documented by the solver (see ds.f
+   *  and vpiter.f); it is assumed to follow the usual profile storage of
+   *  the Fortran finite element codes, with the header of the full
+   *  matrices:
+   *    int*4   neq            number of equations (rows and columns)
+   *    int*4   nsym           0 for a symmetric matrix, 1 otherwise
+   *    int*4   kld(neq + 1)   1-based pointers: the terms above the
+   *                           diagonal of the column j are vkgs(kld(j)) to
+   *                           vkgs(kld(j + 1) - 1), the last one being on
+   *                           the row j - 1
+   *            padding to a multiple of 8 bytes
+   *    real*8  vkgd(neq)      diagonal
+   *    real*8  vkgs(kld(neq + 1) - 1)  upper triangle, by columns
+   *    real*8  vkgi(kld(neq + 1) - 1)  lower triangle, by rows, with the
+   *                           profile of vkgs (nsym = 1 only)
+   *  A payload whose first pointer is not 1, whose columns are higher
+   *  than the diagonal, or which is shorter than its profile, is refused.
+   *  Unlike kld, the equations are numbered from 0 here.
+   */
+  class sky_matrix_view {
+  public:
+    sky_matrix_view(): size(0), symmetric(true), pointers(NULL), diagonal(NULL), upper(NULL), lower(NULL) {}
+
+    sky_matrix_view(const char* payload, std::size_t length)
+      : size(0), symmetric(true), pointers(NULL), diagonal(NULL), upper(NULL), lower(NULL) {
+      if (length < 2 * sizeof(std::int32_t))
+	throw std::string("sky_matrix: payload too short.");
+
+      const std::int32_t* header(reinterpret_cast<const std::int32_t*>(payload));
+      if (header[0] < 0 or (header[1] != 0 and header[1] != 1))
+	throw std::string("sky_matrix: invalid header.");
+      size = header[0];
+      symmetric = header[1] == 0;
+
+      const std::size_t pointers_bytes(padded((size + 1) * sizeof(std::int32_t)));
+      if (length < 2 * sizeof(std::int32_t) + pointers_bytes)
+	throw std::string("sky_matrix: payload too short for the pointers.");
+      pointers = header + 2;
+
+      if (pointers[0] != 1)
+	throw std::string("sky_matrix: the first pointer is not 1.");
+      for (std::size_t j(0); j < size; ++j)
+	if (pointers[j + 1] < pointers[j] or static_cast<std::size_t>(pointers[j + 1] - pointers[j]) > j)
+	  throw "sky_matrix: invalid height of the column " + std::to_string(j) + ".";
+
+      const char* values(payload + 2 * sizeof(std::int32_t) + pointers_bytes);
+      if (reinterpret_cast<std::uintptr_t>(values) % sizeof(double))
+	throw std::string("sky_matrix: misaligned payload.");
+
+      const std::size_t expected(2 * sizeof(std::int32_t) + pointers_bytes
+				 + (size + (symmetric ? 1 : 2) * get_profile_size()) * sizeof(double));
+      if (length < expected)
+	throw "sky_matrix: payload of " + std::to_string(length) + " bytes, expected "
+	  + std::to_string(expected) + ".";
+
+      diagonal = reinterpret_cast<const double*>(values);
+      upper = diagonal + size;
+      lower = symmetric ? upper : upper + get_profile_size();
+    }
+
+    std::size_t get_size() const { return size; }
+    bool is_symmetric() const { return symmetric; }
+
+    /*
+     *  Number of terms stored above the diagonal.
+     */
+    std::size_t get_profile_size() const { return size ? pointers[size] - 1 : 0; }
+
+    /*
+     *  First row of the profile of the column j, which is also the first
+     *  column of the profile of the row j.
+     */
+    std::size_t get_first(std::size_t j) const { return j - (pointers[j + 1] - pointers[j]); }
+
+    const double* get_diagonal() const { return diagonal; }
+
+    /*
+     *  Terms of the column j from the row get_first(j) to the row j - 1,
+     *  and of the row j from the column get_first(j) to the column j - 1.
+     */
+    const double* get_column(std::size_t j) const { return upper + pointers[j] - 1; }
+    const double* get_row(std::size_t j) const { return lower + pointers[j] - 1; }
+
+    double get_value(std::size_t i, std::size_t j) const {
+      if (i == j)
+	return diagonal[i];
+      if (i < j)
+	return i >= get_first(j) ? get_column(j)[i - get_first(j)] : 0.;
+      return j >= get_first(i) ? get_row(i)[j - get_first(i)] : 0.;
+    }
+
+    /*
+     *  Call f(row, column, value) on the terms of the rows [b, e): the
+     *  terms left of the diagonal and the diagonal, row by row, then the
+     *  terms right of the diagonal, by increasing column. The terms of
+     *  each row are thus given by increasing column.
+     */
+    template<typename F>
+    void for_each_term(std::size_t b, std::size_t e, F f) const {
+      for (std::size_t i(b); i < e; ++i) {
+	const double* row(get_row(i));
+	for (std::size_t j(get_first(i)); j < i; ++j)
+	  f(i, j, row[j - get_first(i)]);
+	f(i, i, diagonal[i]);
+      }
+
+      for (std::size_t j(b + 1); j < size; ++j) {
+	const double* column(get_column(j));
+	const std::size_t first(get_first(j));
+	for (std::size_t i(std::max(first, b)); i < std::min(j, e); ++i)
+	  f(i, j, column[i - first]);
+      }
+    }
+
+  private:
+    std::size_t size;
+    bool symmetric;
+    const std::int32_t* pointers;
+    const double* diagonal;
+    const double* upper;
+    const double* lower;
+
+    static std::size_t padded(std::size_t bytes) {
+      return (bytes + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    }
+  };
+
+
+  /*
+   *  Sparse matrix in compressed sparse row layout: the terms of the row
+   *  i are values[offsets[i]] to values[offsets[i + 1] - 1], in the
+   *  columns indices[offsets[i]] to indices[offsets[i + 1] - 1], sorted.
+   */
+  struct csr_matrix {
+    std::size_t rows, columns;
+    std::vector<std::size_t> offsets;
+    std::vector<unsigned int> indices;
+    std::vector<double> values;
+
+    csr_matrix(): rows(0), columns(0), offsets(1, 0), indices(), values() {}
+
+    std::size_t get_nonzeros() const { return values.size(); }
+  };
+
+
+  /*
+   *  Convert a sky_matrix to the CSR layout. The terms of the profile
+   *  which are zero are dropped unless 'keep_zeros' is set, the diagonal
+   *  is always kept. The rows are split between the threads, which count
+   *  the terms of their rows, then fill them.
+   */
+  inline csr_matrix sky_matrix_to_csr(const sky_matrix_view& a, bool keep_zeros = false,
+				      unsigned int threads = default_threads_number()) {
+    const std::size_t n(a.get_size());
+    csr_matrix c;
+    c.rows = c.columns = n;
+    c.offsets.assign(n + 1, 0);
+
+    auto kept = [&](std::size_t i, std::size_t j, double v) { return keep_zeros or i == j or v != 0.; };
+
+    parallel_for(0, n, threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   a.for_each_term(b, e, [&](std::size_t i, std::size_t j, double v) {
+		       if (kept(i, j, v))
+			 ++c.offsets[i + 1];
+		     });
+		 });
+
+    for (std::size_t i(0); i < n; ++i)
+      c.offsets[i + 1] += c.offsets[i];
+
+    c.indices.resize(c.offsets[n]);
+    c.values.resize(c.offsets[n]);
+    std::vector<std::size_t> cursors(c.offsets.begin(), c.offsets.end() - 1);
+    parallel_for(0, n, threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   a.for_each_term(b, e, [&](std::size_t i, std::size_t j, double v) {
+		       if (not kept(i, j, v))
+			 return;
+		       c.indices[cursors[i]] = j;
+		       c.values[cursors[i]++] = v;
+		     });
+		 });
+    return c;
+  }
+
+
+  /*
+   *  y = A x for a sky_matrix. Each thread computes a range of rows: the
+   *  terms left of the diagonal are gathered row by row, and the terms
+   *  right of the diagonal are gathered from the columns crossing the
+   *  range, so no two threads write the same row.
+   */
+  inline void multiply(const sky_matrix_view& a, const double* x, double* y,
+		       unsigned int threads = default_threads_number()) {
+    const std::size_t n(a.get_size());
+    parallel_for(0, n, threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   for (std::size_t i(b); i < e; ++i) {
+		     const std::size_t first(a.get_first(i));
+		     const double* row(a.get_row(i) - first);
+		     double s(a.get_diagonal()[i] * x[i]);
+		     for (std::size_t j(first); j < i; ++j)
+		       s += row[j] * x[j];
+		     y[i] = s;
+		   }
+
+		   for (std::size_t j(b + 1); j < n; ++j) {
+		     const std::size_t first(std::max(a.get_first(j), b)), last(std::min(j, e));
+		     const double* column(a.get_column(j) - a.get_first(j));
+		     const double xj(x[j]);
+		     for (std::size_t i(first); i < last; ++i)
+		       y[i] += column[i] * xj;
+		   }
+		 });
+  }
+
+
+  /*
+   *  y = A x for a CSR matrix. The rows are split between the threads in
+   *  ranges holding about the same number of terms.
+   */
+  inline void multiply(const csr_matrix& a, const double* x, double* y,
+		       unsigned int threads = default_threads_number()) {
+    threads = std::max(1u, std::min<unsigned int>(threads, std::max<std::size_t>(1, a.rows)));
+    auto boundary = [&](std::size_t t) -> std::size_t {
+      if (t == 0 or t == threads)
+	return t == 0 ? 0 : a.rows;
+      return std::upper_bound(a.offsets.begin(), a.offsets.end(), a.get_nonzeros() * t / threads)
+	- a.offsets.begin() - 1;
+    };
+
+    parallel_for(0, threads, threads,
+		 [&](unsigned int, std::size_t tb, std::size_t te) {
+		   for (std::size_t i(boundary(tb)); i < boundary(te); ++i) {
+		     double s(0.);
+		     for (std::size_t k(a.offsets[i]); k < a.offsets[i + 1]; ++k)
+		       s += a.values[k] * x[a.indices[k]];
+		     y[i] = s;
+		   }
+		 });
+  }
+
+
+  /*
+   *  Write a CSR matrix in the Matrix Market coordinate format, with
+   *  1-based indices. For a symmetric matrix, only the terms on and below
+   *  the diagonal are written.
+   */
+  inline void write_matrix_market(std::ostream& out, const csr_matrix& a, bool symmetric) {
+    std::size_t entries(0);
+    for (std::size_t i(0); i < a.rows; ++i)
+      for (std::size_t k(a.offsets[i]); k < a.offsets[i + 1]; ++k)
+	entries += not symmetric or a.indices[k] <= i;
+
+    out << "%%MatrixMarket matrix coordinate real " << (symmetric ? "symmetric" : "general") << "\n"
+	<< a.rows << " " << a.columns << " " << entries << "\n";
+    for (std::size_t i(0); i < a.rows; ++i)
+      for (std::size_t k(a.offsets[i]); k < a.offsets[i + 1]; ++k)
+	if (not symmetric or a.indices[k] <= i)
+	  out << i + 1 << " " << a.indices[k] + 1 << " " << a.values[k] << "\n";
+  }
+
+}
+
+#endif /* _ALUCELL_SPARSE_H_ */
@@ -0,0 +1,176 @@
+#ifndef _ALUCELL_VARIABLE_CACHE_H_
+#define _ALUCELL_VARIABLE_CACHE_H_
+
+#include <map>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <typeindex>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_legacy_variable.hpp"
+
+namespace alucell {
+
+  /*
+   *  Cache of decoded variables, shared by the threads of a process.
+   *
+   *  The entries are keyed by the identity of the dbfile, the variable
+   *  id and the decoded type, and are decoded with the payload
+   *  constructors (variable::array<T>, variable::string, ...). The cache
+   *  is split into shards, each one with its own lock, byte budget and
+   *  least recently used list, so concurrent lookups of different
+   *  variables rarely contend. The decoding is done outside of the
+   *  locks; a variable larger than the budget of a shard is returned
+   *  without being cached.
+   *
+   *  The database_read_access objects are not shared: each thread uses
+   *  its own, opened on the same dbfiles. The query server of 'db serve'
+   *  owns one, sized by its '-C' option.
+   */
+  class variable_cache {
+  public:
+    static const std::size_t default_byte_budget = 256 * 1024 * 1024;
+    static const unsigned int default_shards_number = 16;
+
+    struct counters {
+      std::size_t hits, misses, evictions, entries, bytes;
+    };
+
+    explicit variable_cache(std::size_t _byte_budget = default_byte_budget,
+			    unsigned int shards_number = default_shards_number)
+      : byte_budget(_byte_budget), shards(std::max(1u, shards_number)),
+	hits(0), misses(0), evictions(0) {}
+
+    /*
+     *  Return the variable 'id' of the dbfile, decoded as a V, from the
+     *  cache or from the dbfile.
+     */
+    template<typename V>
+    std::shared_ptr<const V> get(database_read_access* db, unsigned int id) {
+      const key k(db->get_file_identity(), id, std::type_index(typeid(V)));
+      shard& s(get_shard(k));
+
+      {
+	std::lock_guard<std::mutex> lock(s.mutex);
+	const auto it(s.entries.find(k));
+	if (it != s.entries.end()) {
+	  s.lru.splice(s.lru.begin(), s.lru, it->second);
+	  ++hits;
+	  return std::static_pointer_cast<const V>(it->second->value);
+	}
+      }
+
+      ++misses;
+      std::vector<char> payload(db->get_variable_size(id));
+      if (payload.size())
+	db->read_data_from_database(id, 0, payload.size(), payload.data());
+      const std::shared_ptr<const V> value(std::make_shared<V>(payload));
+
+      if (payload.size() > shard_budget())
+	return value;
+
+      std::lock_guard<std::mutex> lock(s.mutex);
+      const auto it(s.entries.find(k));
+      if (it != s.entries.end()) {
+	// Decoded concurrently by another thread:
+	s.lru.splice(s.lru.begin(), s.lru, it->second);
+	return std::static_pointer_cast<const V>(it->second->value);
+      }
+
+      entry e = { k, value, payload.size() };
+      s.lru.push_front(e);
+      s.entries[k] = s.lru.begin();
+      s.bytes += e.bytes;
+      evict(s, shard_budget());
+      return value;
+    }
+
+    /*
+     *  Change the byte budget, and evict the entries above it.
+     */
+    void set_byte_budget(std::size_t _byte_budget) {
+      byte_budget = _byte_budget;
+      for (auto& s: shards) {
+	std::lock_guard<std::mutex> lock(s.mutex);
+	evict(s, shard_budget());
+      }
+    }
+
+    std::size_t get_byte_budget() const { return byte_budget; }
+
+    void clear() {
+      for (auto& s: shards) {
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.entries.clear();
+	s.lru.clear();
+	s.bytes = 0;
+      }
+    }
+
+    counters get_counters() {
+      counters c = { hits, misses, evictions, 0, 0 };
+      for (auto& s: shards) {
+	std::lock_guard<std::mutex> lock(s.mutex);
+	c.entries += s.entries.size();
+	c.bytes += s.bytes;
+      }
+      return c;
+    }
+
+  private:
+    struct key {
+      file_identity file;
+      unsigned int id;
+      std::type_index type;
+
+      key(const file_identity& f, unsigned int i, std::type_index t): file(f), id(i), type(t) {}
+
+      bool operator<(const key& k) const {
+	if (id != k.id) return id < k.id;
+	if (type != k.type) return type < k.type;
+	return file < k.file;
+      }
+    };
+
+    struct entry {
+      key k;
+      std::shared_ptr<const void> value;
+      std::size_t bytes;
+    };
+
+    struct shard {
+      std::mutex mutex;
+      std::list<entry> lru;
+      std::map<key, std::list<entry>::iterator> entries;
+      std::size_t bytes;
+
+      shard(): mutex(), lru(), entries(), bytes(0) {}
+    };
+
+    std::atomic<std::size_t> byte_budget;
+    std::vector<shard> shards;
+    std::atomic<std::size_t> hits, misses, evictions;
+
+    std::size_t shard_budget() const { return byte_budget / shards.size(); }
+
+    shard& get_shard(const key& k) {
+      const std::size_t h(k.file.inode * 31 + k.file.device * 17 + k.id * 2654435761u);
+      return shards[h % shards.size()];
+    }
+
+    void evict(shard& s, std::size_t budget) {
+      while (s.bytes > budget and s.lru.size()) {
+	s.bytes -= s.lru.back().bytes;
+	s.entries.erase(s.lru.back().k);
+	s.lru.pop_back();
+	++evictions;
+      }
+    }
+  };
+
+}
+
+#endif /* _ALUCELL_VARIABLE_CACHE_H_ */
@@ -0,0 +1,32 @@
+#ifndef _ALUCELLDB_H_
+#define _ALUCELLDB_H_
+
+#include "alucell_datatypes.hpp"
+#include "alucell_async_read.hpp"
+#include "alucell_async_write.hpp"
+#include "alucell_legacy_database.hpp"
+#include "alucell_delta.hpp"
+#include "alucell_legacy_variable.hpp"
+#include "alucell_database_index.hpp"
+#include "alucell_mesh_catalog.hpp"
+#include "alucell_dbfile_catalog.hpp"
+#include "alucell_dbfile_copy.hpp"
+#include "alucell_variable_selector.hpp"
+#include "alucell_mesh.hpp"
+#include "alucell_mesh_reorder.hpp"
+#include "alucell_reference_element.hpp"
+#include "alucell_mesh_bvh.hpp"
+#include "alucell_mesh_geometry.hpp"
+#include "alucell_field_integration.hpp"
+#include "alucell_export.hpp"
+#include "alucell_sparse.hpp"
+#include "alucell_dense_matrix.hpp"
+#include "alucell_array_slice.hpp"
+#include "alucell_variable_cache.hpp"
+#include "alucell_statistics.hpp"
+#include "alucell_histogram.hpp"
+#include "alucell_query_protocol.hpp"
+#include "alucell_query_server.hpp"
+#include "alucell_query_client.hpp"
+
+#endif /* _ALUCELLDB_H_ */
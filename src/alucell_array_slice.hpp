@@ -0,0 +1,263 @@
+#ifndef _ALUCELL_ARRAY_SLICE_H_
+#define _ALUCELL_ARRAY_SLICE_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_legacy_variable.hpp"
+
+namespace alucell {
+
+  /*
+   *  Selection of rows of an array: either all the rows, a range
+   *  [first, last) with a step, or an explicit list of rows. The row
+   *  indices start at 0. The selected rows are enumerated in the order
+   *  of the range or of the list.
+   */
+  class row_selection {
+  public:
+    row_selection(): all(true), first(0), last(0), step(1), rows() {}
+
+    static row_selection range(std::size_t first, std::size_t last, std::size_t step = 1) {
+      if (step == 0)
+	throw std::string("row_selection: the step must be positive.");
+
+      row_selection s;
+      s.all = false;
+      s.first = first;
+      s.last = last;
+      s.step = step;
+      return s;
+    }
+
+    static row_selection list(const std::vector<std::size_t>& rows) {
+      row_selection s;
+      s.all = false;
+      s.rows = rows;
+      return s;
+    }
+
+    /*
+     *  Read the whitespace separated row indices of a text file.
+     */
+    static row_selection from_file(const std::string& filename) {
+      std::ifstream file(filename.c_str());
+      if (not file)
+	throw "row_selection: unable to open the row indices file " + filename + ".";
+
+      std::vector<std::size_t> rows;
+      std::string token;
+      while (file >> token) {
+	char* end(NULL);
+	const long long i(std::strtoll(token.c_str(), &end, 10));
+	if (*end != '\0' or i < 0)
+	  throw "row_selection: invalid row index '" + token + "' in " + filename + ".";
+	rows.push_back(i);
+      }
+
+      return list(rows);
+    }
+
+    bool is_all() const { return all; }
+
+    /*
+     *  Number of rows selected in an array of 'size' rows. Throws if a
+     *  row of the list, or the first row of a non empty range, is out of
+     *  range. The end of a range is clamped to the size.
+     */
+    std::size_t count(std::size_t size) const {
+      if (all)
+	return size;
+
+      if (rows.size()) {
+	for (const auto r: rows)
+	  if (r >= size)
+	    throw "row_selection: row " + std::to_string(r) + " is out of range.";
+	return rows.size();
+      }
+
+      if (first < last and first >= size)
+	throw "row_selection: row " + std::to_string(first) + " is out of range.";
+      const std::size_t end(std::min(last, size));
+      return first < end ? (end - first + step - 1) / step : 0;
+    }
+
+    /*
+     *  Index of the k-th selected row.
+     */
+    std::size_t row(std::size_t k) const {
+      if (all)
+	return k;
+      if (rows.size())
+	return rows[k];
+      return first + k * step;
+    }
+
+  private:
+    bool all;
+    std::size_t first, last, step;
+    std::vector<std::size_t> rows;
+  };
+
+
+  /*
+   *  Split a variable specification into the variable name and the row
+   *  selection. The accepted syntaxes are 'name', 'name[a:b]',
+   *  'name[a:b:step]', 'name[a]' and 'name@filename'. In the ranges,
+   *  the bounds a and b can be omitted.
+   */
+  inline std::pair<std::string, row_selection> parse_variable_slice(const std::string& spec) {
+    const std::size_t at(spec.rfind('@'));
+    if (at != std::string::npos and at > 0)
+      return std::make_pair(spec.substr(0, at), row_selection::from_file(spec.substr(at + 1)));
+
+    const std::size_t bracket(spec.find('['));
+    if (bracket == std::string::npos or bracket == 0 or spec[spec.size() - 1] != ']')
+      return std::make_pair(spec, row_selection());
+
+    const std::string name(spec.substr(0, bracket));
+    const std::string range(spec.substr(bracket + 1, spec.size() - bracket - 2));
+
+    std::vector<std::string> fields(1);
+    for (const auto c: range) {
+      if (c == ':')
+	fields.push_back(std::string());
+      else
+	fields.back() += c;
+    }
+
+    std::vector<std::size_t> bounds;
+    for (const auto& f: fields) {
+      const std::string t(trimmed(f));
+      char* end(NULL);
+      const long long i(std::strtoll(t.c_str(), &end, 10));
+      if (*end != '\0' or i < 0)
+	throw "Invalid row range in " + spec + ".";
+      bounds.push_back(t.size() ? i : -1);
+    }
+
+    const std::size_t none(-1);
+    if (fields.size() == 1 and bounds[0] != none)
+      return std::make_pair(name, row_selection::range(bounds[0], bounds[0] + 1));
+    if (fields.size() == 2 or fields.size() == 3)
+      return std::make_pair(name, row_selection::range(bounds[0] == none ? 0 : bounds[0],
+						       bounds[1],
+						       fields.size() == 3 and bounds[2] != none ? bounds[2] : 1));
+
+    throw "Invalid row range in " + spec + ".";
+  }
+
+
+  namespace variable {
+
+    /*
+     *  Sequential access to the selected rows of an array variable, in
+     *  windows of at most 'buffer_size' bytes, with the same interface
+     *  as array_stream.
+     *
+     *  The byte offset of each row is computed from the array header,
+     *  and only the selected rows are read: the rows of a window are
+     *  sorted, and the rows closer than 'max_gap' bytes from each other
+     *  are coalesced into a single read.
+     */
+    template<typename T>
+    class array_slice_stream {
+    public:
+      static const std::size_t default_max_gap = 64 * 1024;
+
+      array_slice_stream(database_read_access* _db, unsigned int _id, const row_selection& _selection,
+			 std::size_t _buffer_size = default_stream_buffer_size,
+			 std::size_t _max_gap = default_max_gap)
+	: db(_db), id(_id), selection(_selection), size(0), components(0),
+	  selected(0), window_capacity(0), window_first(0), window_rows(0),
+	  buffer_size(_buffer_size), max_gap(_max_gap), values(), extent_buffer() {
+	const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+	size = dimensions.first;
+	components = dimensions.second;
+
+	if (2 * sizeof(double) + size * components * sizeof(T) > db->get_variable_size(id))
+	  throw std::string("array_slice_stream: inconsistent array dimensions.");
+
+	selected = selection.count(size);
+	window_capacity = std::max<std::size_t>(1, buffer_size / std::max<std::size_t>(1, row_bytes()));
+	values.resize(std::min(window_capacity, std::max<std::size_t>(1, selected)) * components);
+      }
+
+      std::size_t get_size() const { return size; }
+      unsigned int get_components() const { return components; }
+      std::size_t get_selected_rows() const { return selected; }
+
+      bool next() {
+	window_first += window_rows;
+	if (window_first >= selected) {
+	  window_rows = 0;
+	  return false;
+	}
+	window_rows = std::min(window_capacity, selected - window_first);
+
+	/*
+	 *  Sort the rows of the window, and read them by extents:
+	 */
+	std::vector<std::pair<std::size_t, std::size_t> > order(window_rows);
+	for (std::size_t k(0); k < window_rows; ++k)
+	  order[k] = std::make_pair(selection.row(window_first + k), k);
+	if (not std::is_sorted(order.begin(), order.end()))
+	  std::sort(order.begin(), order.end());
+
+	const std::size_t gap_rows(max_gap / std::max<std::size_t>(1, row_bytes()));
+	const std::size_t extent_capacity(std::max<std::size_t>(1, buffer_size / std::max<std::size_t>(1, row_bytes())));
+	for (std::size_t b(0); b < order.size();) {
+	  std::size_t e(b + 1);
+	  while (e < order.size()
+		 and order[e].first - order[e - 1].first <= gap_rows + 1
+		 and order[e].first - order[b].first < extent_capacity)
+	    ++e;
+
+	  const std::size_t first_row(order[b].first), rows(order[e - 1].first - first_row + 1);
+	  extent_buffer.resize(rows * components);
+	  db->read_data_from_database(id,
+				      2 * sizeof(double) + first_row * row_bytes(),
+				      rows * row_bytes(),
+				      extent_buffer.data());
+
+	  for (std::size_t k(b); k < e; ++k)
+	    std::copy(extent_buffer.begin() + (order[k].first - first_row) * components,
+		      extent_buffer.begin() + (order[k].first - first_row + 1) * components,
+		      values.begin() + order[k].second * components);
+	  b = e;
+	}
+
+	return true;
+      }
+
+      std::size_t get_window_first_row() const { return window_first; }
+      std::size_t get_window_rows() const { return window_rows; }
+      const T* get_values() const { return values.data(); }
+
+      T get_value(std::size_t i, unsigned int j) const {
+	return values[i * components + j];
+      }
+
+    private:
+      database_read_access* db;
+      unsigned int id;
+      row_selection selection;
+      std::size_t size;
+      unsigned int components;
+      std::size_t selected;
+      std::size_t window_capacity, window_first, window_rows;
+      std::size_t buffer_size, max_gap;
+      std::vector<T> values, extent_buffer;
+
+      std::size_t row_bytes() const { return components * sizeof(T); }
+    };
+
+  }
+
+}
+
+#endif /* _ALUCELL_ARRAY_SLICE_H_ */
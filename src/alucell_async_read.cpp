@@ -0,0 +1,364 @@
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+
+#ifdef ALUCELL_USE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "alucell_async_read.hpp"
+
+namespace alucell {
+
+  async_read_engine::async_read_engine(unsigned int _queue_depth, unsigned int threads, bool use_io_uring)
+    : queue_depth(_queue_depth == 0 ? 1 : _queue_depth), in_flight(0), waiting(),
+      ring_fd(-1), sq_ring(NULL), cq_ring(NULL), sqes(NULL),
+      sq_ring_size(0), cq_ring_size(0), sqes_size(0),
+      sq_head(NULL), sq_tail(NULL), sq_mask(NULL), sq_array(NULL),
+      cq_head(NULL), cq_tail(NULL), cq_mask(NULL), cqes(NULL),
+      workers(), mutex(), work_available(), work_done(),
+      pool_queue(), pool_completed(), stopping(false) {
+    if (use_io_uring and setup_io_uring())
+      return;
+
+    /*
+     *  Fallback on the thread pool:
+     */
+    if (threads == 0)
+      threads = 1;
+    queue_depth = std::max(queue_depth, threads);
+    for (unsigned int t(0); t < threads; ++t)
+      workers.push_back(std::thread(&async_read_engine::worker_loop, this));
+  }
+
+  async_read_engine::~async_read_engine() {
+    /*
+     *  Wait for the reads in flight, whose buffers may still be written
+     *  to, without calling their callbacks:
+     */
+    std::vector<operation*> completed;
+    while (in_flight > 0) {
+      completed.clear();
+      try {
+	if (ring_fd >= 0)
+	  ring_wait(completed);
+	else
+	  pool_wait(completed);
+      }
+      catch (...) {
+	/*
+	 *  The ring is broken: give up, leaking the operations which
+	 *  the kernel may still complete.
+	 */
+	break;
+      }
+
+      for (auto op: completed) {
+	--in_flight;
+	delete op;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& w: workers)
+      w.join();
+
+    teardown_io_uring();
+
+    for (auto op: waiting)
+      delete op;
+    for (auto op: pool_queue)
+      delete op;
+    for (auto op: pool_completed)
+      delete op;
+  }
+
+  void async_read_engine::submit(int fd, std::size_t offset, std::size_t length, void* dst, completion done) {
+    operation* op(new operation);
+    op->fd = fd;
+    op->offset = offset;
+    op->length = length;
+    op->done_length = 0;
+    op->dst = reinterpret_cast<char*>(dst);
+    op->done = done;
+    op->result = 0;
+
+    if (in_flight < queue_depth)
+      start(op);
+    else
+      waiting.push_back(op);
+  }
+
+  /*
+   *  Start a read, which is deleted if it cannot be submitted.
+   */
+  void async_read_engine::start(operation* op) {
+    ++in_flight;
+    if (ring_fd >= 0) {
+      try {
+	ring_submit(op);
+      }
+      catch (...) {
+	--in_flight;
+	delete op;
+	throw;
+      }
+    } else {
+      {
+	std::lock_guard<std::mutex> lock(mutex);
+	pool_queue.push_back(op);
+      }
+      work_available.notify_one();
+    }
+  }
+
+  /*
+   *  Account for the completion of a read, and return true if the
+   *  operation is over. Short reads are resubmitted for the remaining
+   *  bytes, a read returning 0 byte before the end is an error.
+   */
+  bool async_read_engine::finish(operation* op, long result) {
+    --in_flight;
+
+    if (result > 0) {
+      op->done_length += result;
+      if (op->done_length < op->length) {
+	start(op);
+	return false;
+      }
+      op->result = op->done_length;
+    } else if (result == 0 and op->done_length < op->length) {
+      op->result = -EIO;
+    } else {
+      op->result = result == 0 ? static_cast<long>(op->done_length) : result;
+    }
+
+    return true;
+  }
+
+  void async_read_engine::run() {
+    std::vector<operation*> completed;
+    while (in_flight > 0 or waiting.size()) {
+      while (in_flight < queue_depth and waiting.size()) {
+	operation* op(waiting.front());
+	waiting.pop_front();
+	start(op);
+      }
+
+      completed.clear();
+      if (ring_fd >= 0)
+	ring_wait(completed);
+      else
+	pool_wait(completed);
+
+      /*
+       *  If a short read cannot be resubmitted, or a callback throws, the
+       *  other completed reads are dropped before the error is passed on:
+       */
+      for (std::size_t i(0); i < completed.size(); ++i) {
+	try {
+	  operation* op(completed[i]);
+	  if (not finish(op, op->result))
+	    continue;
+
+	  completion done(op->done);
+	  const long result(op->result);
+	  delete op;
+	  done(result);
+	}
+	catch (...) {
+	  for (std::size_t j(i + 1); j < completed.size(); ++j) {
+	    --in_flight;
+	    delete completed[j];
+	  }
+	  throw;
+	}
+      }
+    }
+  }
+
+
+  /*
+   *  Thread pool backend
+   */
+  void async_read_engine::worker_loop() {
+    while (true) {
+      operation* op(NULL);
+      {
+	std::unique_lock<std::mutex> lock(mutex);
+	work_available.wait(lock, [this]() { return stopping or pool_queue.size(); });
+	if (stopping)
+	  return;
+	op = pool_queue.front();
+	pool_queue.pop_front();
+      }
+
+      const ssize_t n(pread(op->fd, op->dst + op->done_length,
+			    op->length - op->done_length,
+			    op->offset + op->done_length));
+      op->result = n < 0 ? -errno : n;
+
+      {
+	std::lock_guard<std::mutex> lock(mutex);
+	pool_completed.push_back(op);
+      }
+      work_done.notify_one();
+    }
+  }
+
+  void async_read_engine::pool_wait(std::vector<operation*>& completed) {
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this]() { return pool_completed.size(); });
+    completed.swap(pool_completed);
+  }
+
+
+  /*
+   *  io_uring backend, on top of the raw system calls.
+   */
+#ifdef ALUCELL_USE_IO_URING
+
+  bool async_read_engine::setup_io_uring() {
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+
+    ring_fd = syscall(__NR_io_uring_setup, queue_depth, &p);
+    if (ring_fd < 0) {
+      ring_fd = -1;
+      return false;
+    }
+
+    sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+      sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+    sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+      sq_ring = NULL;
+      teardown_io_uring();
+      return false;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      cq_ring = sq_ring;
+    } else {
+      cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+      if (cq_ring == MAP_FAILED) {
+	cq_ring = NULL;
+	teardown_io_uring();
+	return false;
+      }
+    }
+
+    sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      sqes = NULL;
+      teardown_io_uring();
+      return false;
+    }
+
+    char* sq(reinterpret_cast<char*>(sq_ring));
+    sq_head = reinterpret_cast<unsigned int*>(sq + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned int*>(sq + p.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned int*>(sq + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned int*>(sq + p.sq_off.array);
+
+    char* cq(reinterpret_cast<char*>(cq_ring));
+    cq_head = reinterpret_cast<unsigned int*>(cq + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned int*>(cq + p.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned int*>(cq + p.cq_off.ring_mask);
+    cqes = cq + p.cq_off.cqes;
+
+    queue_depth = p.sq_entries;
+    return true;
+  }
+
+  void async_read_engine::teardown_io_uring() {
+    if (sqes)
+      munmap(sqes, sqes_size);
+    if (cq_ring and cq_ring != sq_ring)
+      munmap(cq_ring, cq_ring_size);
+    if (sq_ring)
+      munmap(sq_ring, sq_ring_size);
+    if (ring_fd >= 0)
+      ::close(ring_fd);
+
+    sqes = cq_ring = sq_ring = NULL;
+    ring_fd = -1;
+  }
+
+  void async_read_engine::ring_submit(operation* op) {
+    op->iov.iov_base = op->dst + op->done_length;
+    op->iov.iov_len = op->length - op->done_length;
+
+    const unsigned int tail(*sq_tail);
+    const unsigned int index(tail & *sq_mask);
+    struct io_uring_sqe* sqe(reinterpret_cast<struct io_uring_sqe*>(sqes) + index);
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = op->fd;
+    sqe->addr = reinterpret_cast<unsigned long>(&op->iov);
+    sqe->len = 1;
+    sqe->off = op->offset + op->done_length;
+    sqe->user_data = reinterpret_cast<unsigned long>(op);
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    /*
+     *  A failed io_uring_enter consumed no entry: the entry is withdrawn
+     *  from the ring before the error is thrown.
+     */
+    long submitted(0);
+    do
+      submitted = syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, NULL, 0);
+    while (submitted < 0 and errno == EINTR);
+    if (submitted < 0) {
+      const int error(errno);
+      __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+      throw std::string("[error] async_read_engine: io_uring_enter failed: ") + std::strerror(error);
+    }
+  }
+
+  void async_read_engine::ring_wait(std::vector<operation*>& completed) {
+    unsigned int head(__atomic_load_n(cq_head, __ATOMIC_RELAXED));
+    while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+      if (syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+	  and errno != EINTR)
+	throw std::string("[error] async_read_engine: io_uring_enter failed: ") + std::strerror(errno);
+    }
+
+    const unsigned int tail(__atomic_load_n(cq_tail, __ATOMIC_ACQUIRE));
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe* cqe(reinterpret_cast<const struct io_uring_cqe*>(cqes) + (head & *cq_mask));
+      operation* op(reinterpret_cast<operation*>(cqe->user_data));
+      op->result = cqe->res;
+      completed.push_back(op);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+  }
+
+#else
+
+  bool async_read_engine::setup_io_uring() { return false; }
+  void async_read_engine::teardown_io_uring() {}
+  void async_read_engine::ring_submit(operation*) {}
+  void async_read_engine::ring_wait(std::vector<operation*>&) {}
+
+#endif
+
+}
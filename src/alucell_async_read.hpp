@@ -0,0 +1,98 @@
+#ifndef _ALUCELL_ASYNC_READ_H_
+#define _ALUCELL_ASYNC_READ_H_
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <sys/uio.h>
+
+namespace alucell {
+
+  /*
+   *  Asynchronous positional reads on file descriptors.
+   *
+   *  The reads are submitted with a completion callback, and are executed
+   *  by io_uring when the kernel supports it (and the support was compiled
+   *  in with ALUCELL_USE_IO_URING, see USE_IO_URING in config.mk), or by a
+   *  pool of threads issuing pread otherwise. At most 'queue_depth' reads
+   *  are in flight, the others wait in a queue. The callbacks are called
+   *  by run(), on the calling thread, and can submit new reads. The
+   *  argument of a callback is the number of bytes read, or -errno on
+   *  failure. An exception thrown by a callback leaves run(), the reads
+   *  completed at the same time being dropped; the other reads stay in
+   *  flight and complete in the next run().
+   */
+  class async_read_engine {
+  public:
+    typedef std::function<void(long)> completion;
+
+    explicit async_read_engine(unsigned int queue_depth = 64,
+			       unsigned int threads = 8,
+			       bool use_io_uring = true);
+    ~async_read_engine();
+
+    void submit(int fd, std::size_t offset, std::size_t length, void* dst, completion done);
+
+    /*
+     *  Wait for the completion of the reads and call their callbacks,
+     *  until no read is pending.
+     */
+    void run();
+
+    bool uses_io_uring() const { return ring_fd >= 0; }
+    unsigned int get_queue_depth() const { return queue_depth; }
+
+  private:
+    struct operation {
+      int fd;
+      std::size_t offset, length, done_length;
+      char* dst;
+      completion done;
+      long result;
+      struct iovec iov;
+    };
+
+    unsigned int queue_depth;
+    unsigned int in_flight;
+    std::deque<operation*> waiting;
+
+    /*
+     *  io_uring state:
+     */
+    int ring_fd;
+    void* sq_ring;
+    void* cq_ring;
+    void* sqes;
+    std::size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned int *cq_head, *cq_tail, *cq_mask;
+    void* cqes;
+
+    bool setup_io_uring();
+    void teardown_io_uring();
+    void ring_submit(operation* op);
+    void ring_wait(std::vector<operation*>& completed);
+
+    /*
+     *  Thread pool state:
+     */
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_available, work_done;
+    std::deque<operation*> pool_queue;
+    std::vector<operation*> pool_completed;
+    bool stopping;
+
+    void worker_loop();
+    void pool_wait(std::vector<operation*>& completed);
+
+    void start(operation* op);
+    bool finish(operation* op, long result);
+  };
+
+}
+
+#endif /* _ALUCELL_ASYNC_READ_H_ */
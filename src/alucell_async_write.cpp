@@ -0,0 +1,162 @@
+
+#include <chrono>
+#include <cstring>
+
+#include "alucell_async_write.hpp"
+
+namespace alucell {
+
+  database_async_write_access::database_async_write_access(const std::string& _filename,
+							   std::size_t _queue_capacity)
+    : filename(_filename), db(_filename), queue_capacity(_queue_capacity), queued_bytes(0), queue(), free_buffers(),
+      barriers_requested(0), barriers_done(0), closing(false), error(), stalled_seconds(0.),
+      mutex(), work_available(), work_done(), worker() {
+    db.defer_infos(true);
+    worker = std::thread(&database_async_write_access::worker_loop, this);
+  }
+
+  database_async_write_access::~database_async_write_access() {
+    try {
+      close();
+    }
+    catch (const std::string&) {
+    }
+  }
+
+  std::vector<char> database_async_write_access::acquire(std::size_t size) {
+    std::vector<char> buffer;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (free_buffers.size()) {
+	buffer.swap(free_buffers.back());
+	free_buffers.pop_back();
+      }
+    }
+    buffer.resize(size);
+    return buffer;
+  }
+
+  void database_async_write_access::insert(const std::string& name, alucell::data_type t,
+					   std::vector<char>&& payload) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (closing)
+      throw std::string("[error] database_async_write_access::insert: the dbfile is closed.");
+
+    if (queued_bytes > 0 and queued_bytes + payload.size() > queue_capacity) {
+      const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+      work_done.wait(lock, [&]() {
+	  return queued_bytes == 0 or queued_bytes + payload.size() <= queue_capacity or error.size();
+	});
+      stalled_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    check_error();
+
+    queued_bytes += payload.size();
+    item i = {item_kind::variable, name, t, std::vector<char>()};
+    i.payload.swap(payload);
+    queue.push_back(std::move(i));
+    work_available.notify_one();
+  }
+
+  void database_async_write_access::insert(const std::string& name, alucell::data_type t,
+					   const void* data, std::size_t size) {
+    std::vector<char> payload(acquire(size));
+    std::memcpy(payload.data(), data, size);
+    insert(name, t, std::move(payload));
+  }
+
+  void database_async_write_access::flush() {
+    barrier(item_kind::flush);
+  }
+
+  void database_async_write_access::sync() {
+    barrier(item_kind::sync);
+  }
+
+  void database_async_write_access::barrier(item_kind kind) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (closing)
+      throw std::string("[error] database_async_write_access: the dbfile is closed.");
+
+    const unsigned long long ticket(++barriers_requested);
+    item i = {kind, std::string(), alucell::data_type::unknown, std::vector<char>()};
+    queue.push_back(std::move(i));
+    work_available.notify_one();
+
+    const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+    work_done.wait(lock, [&]() { return barriers_done >= ticket; });
+    stalled_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    check_error();
+  }
+
+  void database_async_write_access::close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (closing)
+	return;
+      closing = true;
+    }
+    work_available.notify_one();
+    worker.join();
+
+    db.close();
+    if (not db.good() and error.empty())
+      error = "[error] database_async_write_access::close: Unable to write " + filename + ".";
+    check_error();
+  }
+
+  void database_async_write_access::check_error() {
+    if (error.size())
+      throw error;
+  }
+
+  void database_async_write_access::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      work_available.wait(lock, [&]() { return queue.size() or closing; });
+      if (queue.empty())
+	return;
+
+      item i(std::move(queue.front()));
+      queue.pop_front();
+      const bool failed(error.size());
+      lock.unlock();
+
+      std::string failure;
+      if (not failed) {
+	try {
+	  switch (i.kind) {
+	  case item_kind::variable:
+	    db.insert(i.name, i.type, i.payload.data(), i.payload.size());
+	    break;
+	  case item_kind::flush:
+	    db.flush();
+	    break;
+	  case item_kind::sync:
+	    db.sync();
+	    break;
+	  }
+	  if (not db.good())
+	    throw "[error] database_async_write_access: Unable to write "
+	      + (i.kind == item_kind::variable ? i.name + " to " : std::string()) + filename + ".";
+	}
+	catch (const std::string& e) {
+	  failure = e;
+	}
+      }
+
+      lock.lock();
+      if (failure.size() and error.empty())
+	error = failure;
+      if (i.kind == item_kind::variable) {
+	queued_bytes -= i.payload.size();
+	if (free_buffers.size() < 2)
+	  free_buffers.push_back(std::move(i.payload));
+      } else {
+	++barriers_done;
+      }
+      work_done.notify_all();
+    }
+  }
+
+}
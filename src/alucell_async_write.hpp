@@ -0,0 +1,115 @@
+#ifndef _ALUCELL_ASYNC_WRITE_H_
+#define _ALUCELL_ASYNC_WRITE_H_
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "alucell_datatypes.hpp"
+#include "alucell_legacy_database.hpp"
+
+namespace alucell {
+
+  /*
+   *  Writer inserting the variables of a dbfile from a background thread.
+   *
+   *  The producer hands over the payloads, which are queued and written
+   *  in order by the background thread, so the computation of the next
+   *  variables overlaps the writing of the previous ones. The queue holds
+   *  at most 'queue_capacity' bytes of payloads, the variable being
+   *  written included: insert only blocks when the queue is full, and a
+   *  payload larger than the queue is accepted once the queue is empty.
+   *
+   *  The info block is only rewritten by the barriers: flush returns once
+   *  the variables inserted before it are written and visible to readers,
+   *  and sync once they are on the disk. close writes the remaining
+   *  variables and closes the dbfile. The dbfile is the same as the one
+   *  database_write_access writes with the same inserts.
+   *
+   *  The payload buffers written are kept for reuse by acquire, up to two
+   *  of them, so a producer alternating between acquire and insert fills
+   *  one buffer while the other one is written without allocating memory.
+   *
+   *  An error of the background thread, a write of the stream failing
+   *  included, is thrown by the next call of the producer, or by close,
+   *  and the variables inserted after it are dropped.
+   */
+  class database_async_write_access {
+  public:
+    static const std::size_t default_queue_capacity = 256 * 1024 * 1024;
+
+    explicit database_async_write_access(const std::string& filename,
+					 std::size_t queue_capacity = default_queue_capacity);
+
+    /*
+     *  Close the dbfile, ignoring the errors: call close to get them.
+     */
+    ~database_async_write_access();
+
+    database_async_write_access(const database_async_write_access&) = delete;
+    database_async_write_access& operator=(const database_async_write_access&) = delete;
+
+    /*
+     *  A buffer of 'size' bytes for a payload, reusing a written one if
+     *  possible.
+     */
+    std::vector<char> acquire(std::size_t size);
+
+    /*
+     *  Queue a variable, taking the ownership of its payload.
+     */
+    void insert(const std::string& name, alucell::data_type t, std::vector<char>&& payload);
+
+    /*
+     *  Queue a copy of the payload.
+     */
+    void insert(const std::string& name, alucell::data_type t, const void* data, std::size_t size);
+
+    void flush();
+
+    void sync();
+
+    void close();
+
+    /*
+     *  Time spent by the producer waiting for room in the queue, and for
+     *  the barriers.
+     */
+    double get_stalled_seconds() const { return stalled_seconds; }
+
+  private:
+    enum class item_kind { variable, flush, sync };
+
+    struct item {
+      item_kind kind;
+      std::string name;
+      alucell::data_type type;
+      std::vector<char> payload;
+    };
+
+    std::string filename;
+    database_write_access db;
+    std::size_t queue_capacity;
+    std::size_t queued_bytes;
+    std::deque<item> queue;
+    std::vector<std::vector<char> > free_buffers;
+    unsigned long long barriers_requested, barriers_done;
+    bool closing;
+    std::string error;
+    double stalled_seconds;
+
+    std::mutex mutex;
+    std::condition_variable work_available, work_done;
+    std::thread worker;
+
+    void worker_loop();
+    void barrier(item_kind kind);
+    void check_error();
+  };
+
+}
+
+#endif /* _ALUCELL_ASYNC_WRITE_H_ */
@@ -0,0 +1,496 @@
+
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <exception>
+#include <algorithm>
+
+#include <fnmatch.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "alucell_dbfile_catalog.hpp"
+#include "alucell_legacy_database.hpp"
+#include "alucell_mesh_catalog.hpp"
+#include "alucell_delta.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  const char* const dbfile_catalog::default_filename = ".dbcatalog";
+
+  namespace {
+
+    const char magic[8] = {'A', 'L', 'U', 'C', 'A', 'T', 'L', '1'};
+
+    /*
+     *  Seed of the second hash of the bloom filters: FNV-1a offset basis
+     *  with its bytes reversed.
+     */
+    const std::uint64_t second_seed = 0x25232284e49cf2cbull;
+
+    /*
+     *  Non empty '_' separated tokens of a name.
+     */
+    std::vector<std::string> name_tokens(const std::string& name) {
+      std::vector<std::string> tokens;
+      std::size_t begin(0);
+      while (begin <= name.size()) {
+	std::size_t end(name.find('_', begin));
+	if (end == std::string::npos)
+	  end = name.size();
+	if (end > begin)
+	  tokens.push_back(name.substr(begin, end - begin));
+	begin = end + 1;
+      }
+      return tokens;
+    }
+
+    /*
+     *  Tokens which a name matching the glob 'pattern' must hold: the
+     *  tokens of the pattern without wildcard. The patterns with bracket
+     *  expressions or escapes, which may hold a literal '_', give none.
+     */
+    std::vector<std::string> pattern_tokens(const std::string& pattern) {
+      std::vector<std::string> tokens;
+      if (pattern.find_first_of("[\\") != std::string::npos)
+	return tokens;
+      for (const auto& token: name_tokens(pattern))
+	if (token.find_first_of("*?") == std::string::npos)
+	  tokens.push_back(token);
+      return tokens;
+    }
+
+    bool is_array_type(data_type t) {
+      return t == data_type::real_array or t == data_type::int_array or t == data_type::element_array;
+    }
+
+    /*
+     *  Binary encoding of the catalog file, in the byte order of the host
+     *  like the dbfiles.
+     */
+    template<typename T>
+    void put(std::ostream& out, T value) {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_string(std::ostream& out, const std::string& s) {
+      put<std::uint32_t>(out, s.size());
+      out.write(s.data(), s.size());
+    }
+
+    template<typename T>
+    T get(std::istream& in) {
+      T value;
+      if (not in.read(reinterpret_cast<char*>(&value), sizeof(value)))
+	throw std::string("[error] dbfile_catalog: truncated catalog file.");
+      return value;
+    }
+
+    std::string get_string(std::istream& in) {
+      std::string s(get<std::uint32_t>(in), '\0');
+      if (not in.read(&s[0], s.size()))
+	throw std::string("[error] dbfile_catalog: truncated catalog file.");
+      return s;
+    }
+
+    std::size_t summary_size(const catalog_file& file) {
+      return sizeof(std::uint32_t) + file.path.size() + 3 * sizeof(std::int64_t) + 1
+	+ 3 * sizeof(std::uint32_t) + sizeof(std::uint64_t)
+	+ file.names.get_words().size() * sizeof(std::uint64_t) + sizeof(std::uint64_t);
+    }
+
+    std::size_t details_size(const catalog_file& file) {
+      std::size_t size(2 * sizeof(std::uint32_t));
+      for (const auto& v: file.variables)
+	size += sizeof(std::uint32_t) + v.name.size() + 1 + 2 * sizeof(std::uint64_t) + sizeof(std::uint32_t);
+      for (const auto& m: file.meshes)
+	size += sizeof(std::uint32_t) + m.size();
+      return size;
+    }
+
+    struct directory_entry {
+      std::string path;
+      std::int64_t size, mtime_sec, mtime_nsec;
+    };
+
+    /*
+     *  Regular files of the tree 'directory', symbolic links to regular
+     *  files included, sorted by path. The symbolic links to directories
+     *  are not followed.
+     */
+    std::vector<directory_entry> walk_directory(const std::string& directory) {
+      std::vector<directory_entry> entries;
+      std::vector<std::string> pending(1, std::string());
+      while (pending.size()) {
+	const std::string relative(pending.back());
+	pending.pop_back();
+
+	DIR* d(opendir((directory + "/" + relative).c_str()));
+	if (d == NULL) {
+	  if (relative.empty())
+	    throw "[error] dbfile_catalog: Unable to open the directory " + directory + ".";
+	  continue;
+	}
+
+	while (const struct dirent* e = readdir(d)) {
+	  const std::string name(e->d_name);
+	  if (name == "." or name == ".." or prefixed(name, dbfile_catalog::default_filename))
+	    continue;
+
+	  const std::string path(relative.empty() ? name : relative + "/" + name);
+	  const std::string full_path(directory + "/" + path);
+	  struct stat s;
+	  if (lstat(full_path.c_str(), &s) != 0)
+	    continue;
+	  if (S_ISDIR(s.st_mode)) {
+	    pending.push_back(path);
+	    continue;
+	  }
+	  if (S_ISLNK(s.st_mode) and stat(full_path.c_str(), &s) != 0)
+	    continue;
+	  if (not S_ISREG(s.st_mode))
+	    continue;
+
+	  directory_entry entry = {path, s.st_size, s.st_mtim.tv_sec, s.st_mtim.tv_nsec};
+	  entries.push_back(entry);
+	}
+	closedir(d);
+      }
+
+      std::sort(entries.begin(), entries.end(),
+		[](const directory_entry& a, const directory_entry& b) { return a.path < b.path; });
+      return entries;
+    }
+
+  }
+
+  void bloom_filter::insert(const std::string& key) {
+    if (words.empty())
+      return;
+    const std::uint64_t bits(words.size() * 64);
+    const std::uint64_t h1(delta::hash(key.data(), key.size()));
+    const std::uint64_t h2(delta::hash(key.data(), key.size(), second_seed) | 1);
+    for (unsigned int i(0); i < hashes; ++i) {
+      const std::uint64_t bit((h1 + i * h2) % bits);
+      words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+    }
+  }
+
+  bool bloom_filter::may_contain(const std::string& key) const {
+    if (words.empty())
+      return false;
+    const std::uint64_t bits(words.size() * 64);
+    const std::uint64_t h1(delta::hash(key.data(), key.size()));
+    const std::uint64_t h2(delta::hash(key.data(), key.size(), second_seed) | 1);
+    for (unsigned int i(0); i < hashes; ++i) {
+      const std::uint64_t bit((h1 + i * h2) % bits);
+      if (not (words[bit / 64] & (std::uint64_t(1) << (bit % 64))))
+	return false;
+    }
+    return true;
+  }
+
+  void dbfile_catalog::load(const std::string& _filename) {
+    details.close();
+    details.clear();
+    files.clear();
+    filename = _filename;
+
+    details.open(filename.c_str(), std::ios::in | std::ios::binary);
+    if (not details)
+      throw "[error] dbfile_catalog::load: Unable to open " + filename + ".";
+
+    char m[sizeof(magic)];
+    if (not details.read(m, sizeof(m)) or not std::equal(m, m + sizeof(m), magic))
+      throw "[error] dbfile_catalog::load: " + filename + " is not a dbfile catalog.";
+
+    root = get_string(details);
+    files.resize(get<std::uint64_t>(details));
+    for (auto& file: files) {
+      file.path = get_string(details);
+      file.size = get<std::int64_t>(details);
+      file.mtime_sec = get<std::int64_t>(details);
+      file.mtime_nsec = get<std::int64_t>(details);
+      file.is_dbfile = get<std::uint8_t>(details);
+      file.types = get<std::uint32_t>(details);
+      file.variables_number = get<std::uint32_t>(details);
+      const unsigned int hashes(get<std::uint32_t>(details));
+      std::vector<std::uint64_t> words(get<std::uint64_t>(details));
+      if (words.size() and not details.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(std::uint64_t)))
+	throw std::string("[error] dbfile_catalog: truncated catalog file.");
+      file.names = bloom_filter(words, hashes);
+      file.details_offset = get<std::uint64_t>(details);
+      file.details_loaded = false;
+    }
+  }
+
+  void dbfile_catalog::load_details(catalog_file& file) {
+    if (file.details_loaded)
+      return;
+
+    details.clear();
+    details.seekg(file.details_offset);
+    file.variables.resize(get<std::uint32_t>(details));
+    for (auto& v: file.variables) {
+      v.name = get_string(details);
+      v.type = static_cast<data_type>(get<std::uint8_t>(details));
+      v.size = get<std::uint64_t>(details);
+      v.rows = get<std::uint64_t>(details);
+      v.components = get<std::uint32_t>(details);
+    }
+    file.meshes.resize(get<std::uint32_t>(details));
+    for (auto& m: file.meshes)
+      m = get_string(details);
+    file.details_loaded = true;
+  }
+
+  void dbfile_catalog::save(const std::string& _filename) {
+    for (auto& file: files)
+      load_details(file);
+
+    const std::string partial_filename(_filename + ".partial");
+    {
+      std::ofstream out(partial_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (not out)
+	throw "[error] dbfile_catalog::save: Unable to open " + partial_filename + ".";
+
+      std::size_t offset(sizeof(magic) + sizeof(std::uint32_t) + root.size() + sizeof(std::uint64_t));
+      for (const auto& file: files)
+	offset += summary_size(file);
+
+      out.write(magic, sizeof(magic));
+      put_string(out, root);
+      put<std::uint64_t>(out, files.size());
+      for (auto& file: files) {
+	file.details_offset = offset;
+	offset += details_size(file);
+
+	put_string(out, file.path);
+	put<std::int64_t>(out, file.size);
+	put<std::int64_t>(out, file.mtime_sec);
+	put<std::int64_t>(out, file.mtime_nsec);
+	put<std::uint8_t>(out, file.is_dbfile);
+	put<std::uint32_t>(out, file.types);
+	put<std::uint32_t>(out, file.variables_number);
+	put<std::uint32_t>(out, file.names.get_hashes());
+	put<std::uint64_t>(out, file.names.get_words().size());
+	out.write(reinterpret_cast<const char*>(file.names.get_words().data()),
+		  file.names.get_words().size() * sizeof(std::uint64_t));
+	put<std::uint64_t>(out, file.details_offset);
+      }
+
+      for (const auto& file: files) {
+	put<std::uint32_t>(out, file.variables.size());
+	for (const auto& v: file.variables) {
+	  put_string(out, v.name);
+	  put<std::uint8_t>(out, static_cast<std::uint8_t>(v.type));
+	  put<std::uint64_t>(out, v.size);
+	  put<std::uint64_t>(out, v.rows);
+	  put<std::uint32_t>(out, v.components);
+	}
+	put<std::uint32_t>(out, file.meshes.size());
+	for (const auto& m: file.meshes)
+	  put_string(out, m);
+      }
+
+      if (not out.flush())
+	throw "[error] dbfile_catalog::save: Unable to write " + partial_filename + ".";
+    }
+
+    if (std::rename(partial_filename.c_str(), _filename.c_str()) != 0)
+      throw "[error] dbfile_catalog::save: Unable to rename " + partial_filename + ".";
+
+    details.close();
+    details.clear();
+    filename = _filename;
+    details.open(filename.c_str(), std::ios::in | std::ios::binary);
+  }
+
+  catalog_file dbfile_catalog::scan_file(const std::string& directory, const std::string& path,
+					 std::int64_t size, std::int64_t mtime_sec, std::int64_t mtime_nsec) {
+    catalog_file file;
+    file.path = path;
+    file.size = size;
+    file.mtime_sec = mtime_sec;
+    file.mtime_nsec = mtime_nsec;
+    file.is_dbfile = false;
+    file.types = 0;
+    file.variables_number = 0;
+    file.details_offset = 0;
+    file.details_loaded = true;
+
+    if (static_cast<std::size_t>(size) < database_read_access::header_size
+	and not database_read_access::has_extended_header(directory + "/" + path))
+      return file;
+
+    try {
+      database_read_access db(directory + "/" + path);
+      std::vector<unsigned int> array_ids;
+      for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+	catalog_variable v = {db.get_variable_name(id), db.get_variable_type(id),
+			      db.get_variable_size(id), 0, 0};
+	if (is_array_type(v.type) and v.size >= 2 * sizeof(double))
+	  array_ids.push_back(id);
+	file.variables.push_back(v);
+      }
+
+      const std::vector<std::pair<std::size_t, unsigned int> > dimensions(db.get_arrays_dimensions(array_ids));
+      for (std::size_t k(0); k < array_ids.size(); ++k) {
+	file.variables[array_ids[k]].rows = dimensions[k].first;
+	file.variables[array_ids[k]].components = dimensions[k].second;
+      }
+
+      const mesh_catalog meshes(&db);
+      for (const auto& mesh: meshes.get_meshes())
+	file.meshes.push_back(mesh.name);
+    }
+    catch (const std::string&) {
+      file.variables.clear();
+      file.meshes.clear();
+      return file;
+    }
+    catch (const std::exception&) {
+      file.variables.clear();
+      file.meshes.clear();
+      return file;
+    }
+
+    std::set<std::string> keys;
+    for (const auto& v: file.variables) {
+      keys.insert(v.name);
+      for (const auto& token: name_tokens(v.name))
+	keys.insert(token_key(token));
+      file.types |= 1u << static_cast<unsigned int>(v.type);
+    }
+    file.names = bloom_filter(keys.size());
+    for (const auto& key: keys)
+      file.names.insert(key);
+    file.variables_number = file.variables.size();
+    file.is_dbfile = true;
+    return file;
+  }
+
+  dbfile_catalog::refresh_report dbfile_catalog::refresh(const std::string& directory, unsigned int threads) {
+    char resolved[PATH_MAX];
+    if (realpath(directory.c_str(), resolved) == NULL)
+      throw "[error] dbfile_catalog::refresh: Unable to open the directory " + directory + ".";
+    if (root != resolved) {
+      root = resolved;
+      files.clear();
+    }
+
+    std::map<std::string, std::size_t> previous;
+    for (std::size_t k(0); k < files.size(); ++k)
+      previous[files[k].path] = k;
+
+    refresh_report report = {0, 0, 0, 0, 0};
+    const std::vector<directory_entry> entries(walk_directory(root));
+    std::vector<catalog_file> refreshed(entries.size());
+    std::vector<std::size_t> scanned;
+    for (std::size_t k(0); k < entries.size(); ++k) {
+      const directory_entry& e(entries[k]);
+      const auto it(previous.find(e.path));
+      if (it != previous.end()) {
+	catalog_file& file(files[it->second]);
+	previous.erase(it);
+	if (file.size == e.size and file.mtime_sec == e.mtime_sec and file.mtime_nsec == e.mtime_nsec) {
+	  load_details(file);
+	  refreshed[k] = std::move(file);
+	  ++report.unchanged;
+	  continue;
+	}
+	++report.updated;
+      } else {
+	++report.added;
+      }
+      scanned.push_back(k);
+    }
+    report.removed = previous.size();
+
+    parallel_for(0, scanned.size(), threads,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   for (std::size_t i(b); i < e; ++i) {
+		     const directory_entry& entry(entries[scanned[i]]);
+		     refreshed[scanned[i]] = scan_file(root, entry.path, entry.size,
+						       entry.mtime_sec, entry.mtime_nsec);
+		   }
+		 });
+
+    for (const auto& file: refreshed)
+      if (not file.is_dbfile)
+	++report.skipped;
+    files.swap(refreshed);
+    return report;
+  }
+
+  void dbfile_catalog::query(const catalog_query& q,
+			     std::function<void(const catalog_file&, const std::vector<std::size_t>&)> f) {
+    std::uint32_t types_mask(0);
+    for (const auto t: q.types)
+      types_mask |= 1u << static_cast<unsigned int>(t);
+    std::vector<std::vector<std::string> > tokens;
+    for (const auto& pattern: q.patterns)
+      tokens.push_back(pattern_tokens(pattern));
+
+    std::vector<std::size_t> matching;
+    for (auto& file: files) {
+      if (not file.is_dbfile)
+	continue;
+
+      /*
+       *  Rule the file out from its summary if possible:
+       */
+      if (types_mask and not (file.types & types_mask))
+	continue;
+      bool candidate(true);
+      for (const auto& mesh: q.meshes)
+	candidate = candidate and file.names.may_contain(mesh + "_nodes");
+      if (candidate and (q.names.size() or q.patterns.size())) {
+	bool named(false);
+	for (const auto& name: q.names)
+	  named = named or file.names.may_contain(name);
+	for (std::size_t p(0); not named and p < tokens.size(); ++p) {
+	  bool complete(true);
+	  for (const auto& token: tokens[p])
+	    complete = complete and file.names.may_contain(token_key(token));
+	  named = complete;
+	}
+	candidate = named;
+      }
+      if (not candidate)
+	continue;
+
+      load_details(file);
+      for (const auto& mesh: q.meshes)
+	candidate = candidate and std::find(file.meshes.begin(), file.meshes.end(), mesh) != file.meshes.end();
+      if (not candidate)
+	continue;
+
+      matching.clear();
+      if (q.has_variable_criteria()) {
+	for (std::size_t k(0); k < file.variables.size(); ++k) {
+	  const catalog_variable& v(file.variables[k]);
+	  if (q.names.size() or q.patterns.size()) {
+	    bool named(std::find(q.names.begin(), q.names.end(), v.name) != q.names.end());
+	    for (std::size_t p(0); not named and p < q.patterns.size(); ++p)
+	      named = fnmatch(q.patterns[p].c_str(), v.name.c_str(), 0) == 0;
+	    if (not named)
+	      continue;
+	  }
+	  if ((q.types.size() and not q.types.count(v.type))
+	      or (q.rows >= 0 and (not is_array_type(v.type) or v.rows != static_cast<std::uint64_t>(q.rows)))
+	      or (q.components >= 0 and (not is_array_type(v.type) or v.components != q.components)))
+	    continue;
+	  matching.push_back(k);
+	}
+	if (matching.empty())
+	  continue;
+      }
+
+      f(file, matching);
+    }
+  }
+
+}
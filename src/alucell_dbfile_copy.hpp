@@ -0,0 +1,97 @@
+#ifndef _ALUCELL_DBFILE_COPY_H_
+#define _ALUCELL_DBFILE_COPY_H_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  Variable 'id' of an open dbfile, to be copied under 'name'.
+   */
+  struct copied_variable {
+    const database_read_access* db;
+    unsigned int id;
+    std::string name;
+  };
+
+  /*
+   *  Copy variables of one or several dbfiles into a new dbfile, as
+   *  'db extract', 'db materialize' and 'db merge' do. The variables are
+   *  reserved first, in order, so that a layout not fitting the legacy
+   *  tables is refused before any payload is written. The payloads are
+   *  then split in chunks of at most 'buffer_size' / 'threads' bytes,
+   *  copied by 'threads' threads with copy_data. The encoded variables of
+   *  delta dbfiles are decoded at once, and written in one chunk. The
+   *  payloads which are not a multiple of 8 bytes, as found in extended
+   *  dbfiles, are padded by the writer. Return the number of encoded
+   *  variables.
+   */
+  inline std::size_t copy_dbfile_variables(const std::vector<copied_variable>& variables,
+					    const std::string& output_filename,
+					    unsigned int threads, std::size_t buffer_size) {
+    database_parallel_write_access output_db(output_filename);
+
+    struct chunk {
+      std::size_t variable;
+      unsigned int slot;
+      std::size_t offset, length;
+    };
+    threads = std::max(1u, threads);
+    const std::size_t chunk_size(std::max<std::size_t>(1, buffer_size / threads));
+    std::vector<chunk> chunks;
+    std::size_t encoded(0);
+    for (std::size_t k(0); k < variables.size(); ++k) {
+      const database_read_access& db(*variables[k].db);
+      const unsigned int id(variables[k].id);
+      const std::size_t size(db.get_variable_size(id));
+      const unsigned int slot(output_db.reserve(variables[k].name, db.get_variable_type(id), size));
+      const std::size_t step(db.is_variable_encoded(id) ? std::max<std::size_t>(1, size) : chunk_size);
+      encoded += db.is_variable_encoded(id);
+      for (std::size_t offset(0); offset < size; offset += step) {
+	const chunk c = {k, slot, offset, std::min(step, size - offset)};
+	chunks.push_back(c);
+      }
+    }
+
+    std::vector<std::string> errors(threads);
+    parallel_for(0, chunks.size(), threads,
+		 [&](unsigned int t, std::size_t b, std::size_t e) {
+		   try {
+		     std::vector<char> buffer;
+		     for (std::size_t k(b); k < e; ++k) {
+		       const chunk& c(chunks[k]);
+		       const database_read_access& db(*variables[c.variable].db);
+		       const unsigned int id(variables[c.variable].id);
+		       if (db.is_variable_encoded(id)) {
+			 buffer.resize(c.length);
+			 db.pread_data_from_database(id, c.offset, c.length, buffer.data());
+			 output_db.write_data(c.slot, c.offset, buffer.data(), c.length);
+		       } else {
+			 output_db.copy_data(c.slot, c.offset, db.get_variable_descriptor(id),
+					     db.get_variable_offset(id) + c.offset, c.length);
+		       }
+		     }
+		   }
+		   catch (const std::string& error) {
+		     errors[t] = error;
+		   }
+		   catch (...) {
+		     errors[t] = "[error] copy_dbfile_variables: Unable to copy the variables to " + output_filename + ".";
+		   }
+		 });
+
+    for (const auto& error: errors)
+      if (error.size())
+	throw error;
+    output_db.commit();
+    return encoded;
+  }
+
+}
+
+#endif /* _ALUCELL_DBFILE_COPY_H_ */
@@ -0,0 +1,129 @@
+#ifndef _ALUCELL_DENSE_MATRIX_H_
+#define _ALUCELL_DENSE_MATRIX_H_
+
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <algorithm>
+
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  Column-major view over a dense matrix, without copy: the term (i, j)
+   *  is data[i + j * ld], as in BLAS and LAPACK, with a leading dimension
+   *  ld >= rows so that a view can also cover a block of a larger matrix.
+   *
+   *  The payload of a matrix variable is (see ds.f):
+   *    int*4   rows
+   *    int*4   columns
+   *    real*8  a(rows, columns)   in fortran array layout
+   *  Negative dimensions and a payload shorter than rows x columns
+   *  terms are refused.
+   */
+  class matrix_view {
+  public:
+    matrix_view(): rows(0), columns(0), ld(1), data(NULL) {}
+
+    matrix_view(const double* _data, std::size_t _rows, std::size_t _columns, std::size_t _ld)
+      : rows(_rows), columns(_columns), ld(std::max<std::size_t>(1, _ld)), data(_data) {
+      if (ld < rows)
+	throw std::string("matrix: leading dimension smaller than the number of rows.");
+    }
+
+    matrix_view(const char* payload, std::size_t length): rows(0), columns(0), ld(1), data(NULL) {
+      if (length < 2 * sizeof(std::int32_t))
+	throw std::string("matrix: payload too short.");
+
+      const std::int32_t* header(reinterpret_cast<const std::int32_t*>(payload));
+      if (header[0] < 0 or header[1] < 0)
+	throw std::string("matrix: invalid dimensions.");
+      rows = header[0];
+      columns = header[1];
+      ld = std::max<std::size_t>(1, rows);
+
+      const char* values(payload + 2 * sizeof(std::int32_t));
+      if (reinterpret_cast<std::uintptr_t>(values) % sizeof(double))
+	throw std::string("matrix: misaligned payload.");
+
+      const std::size_t expected(2 * sizeof(std::int32_t) + rows * columns * sizeof(double));
+      if (length < expected)
+	throw "matrix: payload of " + std::to_string(length) + " bytes, expected "
+	  + std::to_string(expected) + " for " + std::to_string(rows) + " x " + std::to_string(columns) + ".";
+      data = reinterpret_cast<const double*>(values);
+    }
+
+    std::size_t get_rows() const { return rows; }
+    std::size_t get_columns() const { return columns; }
+    std::size_t get_leading_dimension() const { return ld; }
+    const double* get_data() const { return data; }
+
+    double operator()(std::size_t i, std::size_t j) const { return data[i + j * ld]; }
+    const double* get_column(std::size_t j) const { return data + j * ld; }
+
+    /*
+     *  View over the block of 'r' rows and 'c' columns starting at the
+     *  term (i, j), sharing the leading dimension of this view.
+     */
+    matrix_view block(std::size_t i, std::size_t j, std::size_t r, std::size_t c) const {
+      if (i + r > rows or j + c > columns)
+	throw std::string("matrix: block out of bounds.");
+      return matrix_view(data + i + j * ld, r, c, ld);
+    }
+
+  private:
+    std::size_t rows, columns, ld;
+    const double* data;
+  };
+
+
+  /*
+   *  Copy the transpose of 'a' into 'b', with a leading dimension ldb >=
+   *  a.get_columns(): b[j + i * ldb] = a(i, j), which is 'a' in row-major
+   *  layout. The copy goes by square tiles small enough for both the
+   *  source and destination lines to stay in the L1 cache, and the tiles
+   *  of rows of 'a' are split between the threads.
+   */
+  const std::size_t transpose_tile = 32;
+
+  inline void transpose(const matrix_view& a, double* b, std::size_t ldb,
+			unsigned int threads = default_threads_number()) {
+    const std::size_t rows(a.get_rows()), columns(a.get_columns());
+    if (ldb < columns)
+      throw std::string("transpose: leading dimension smaller than the number of columns.");
+
+    parallel_for(0, (rows + transpose_tile - 1) / transpose_tile, threads,
+		 [&](unsigned int, std::size_t tb, std::size_t te) {
+		   for (std::size_t ib(tb * transpose_tile); ib < std::min(rows, te * transpose_tile); ib += transpose_tile) {
+		     const std::size_t ie(std::min(rows, ib + transpose_tile));
+		     for (std::size_t jb(0); jb < columns; jb += transpose_tile) {
+		       const std::size_t je(std::min(columns, jb + transpose_tile));
+		       for (std::size_t j(jb); j < je; ++j) {
+			 const double* column(a.get_column(j));
+			 for (std::size_t i(ib); i < ie; ++i)
+			   b[j + i * ldb] = column[i];
+		       }
+		     }
+		   }
+		 });
+  }
+
+
+  /*
+   *  Write a dense matrix in the Matrix Market array format, by columns
+   *  as the format requires, which is the layout of the view.
+   */
+  inline void write_matrix_market(std::ostream& out, const matrix_view& a) {
+    out << "%%MatrixMarket matrix array real general\n"
+	<< a.get_rows() << " " << a.get_columns() << "\n";
+    for (std::size_t j(0); j < a.get_columns(); ++j) {
+      const double* column(a.get_column(j));
+      for (std::size_t i(0); i < a.get_rows(); ++i)
+	out << column[i] << "\n";
+    }
+  }
+
+}
+
+#endif /* _ALUCELL_DENSE_MATRIX_H_ */
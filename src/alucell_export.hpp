@@ -0,0 +1,484 @@
+#ifndef _ALUCELL_EXPORT_H_
+#define _ALUCELL_EXPORT_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_legacy_variable.hpp"
+#include "alucell_mesh_catalog.hpp"
+
+namespace alucell {
+
+  /*
+   *  Element types of the exported meshes, identified by the dimension of
+   *  the mesh and the number of nodes per element as in
+   *  reference_element, plus the points (one node per element). The
+   *  vertices are written in the order of the dbfile, except for the VTK
+   *  wedges whose bottom triangle is clockwise: vtk_order[k] is the
+   *  vertex of the dbfile written at the position k.
+   */
+  struct export_element_type {
+    const char* ensight_name;
+    unsigned char vtk_type;
+    unsigned int nodes;
+    unsigned int vtk_order[8];
+  };
+
+  inline export_element_type get_export_element_type(unsigned int dimension, unsigned int nodes) {
+    static const export_element_type point = {"point", 1, 1, {0}};
+    static const export_element_type bar = {"bar2", 3, 2, {0, 1}};
+    static const export_element_type triangle = {"tria3", 5, 3, {0, 1, 2}};
+    static const export_element_type quadrangle = {"quad4", 9, 4, {0, 1, 2, 3}};
+    static const export_element_type tetrahedron = {"tetra4", 10, 4, {0, 1, 2, 3}};
+    static const export_element_type prism = {"penta6", 13, 6, {0, 2, 1, 3, 5, 4}};
+    static const export_element_type hexahedron = {"hexa8", 12, 8, {0, 1, 2, 3, 4, 5, 6, 7}};
+
+    if (nodes == 1)
+      return point;
+    if (dimension == 1 and nodes == 2)
+      return bar;
+    if (dimension == 2 and nodes == 3)
+      return triangle;
+    if (dimension == 2 and nodes == 4)
+      return quadrangle;
+    if (dimension == 3 and nodes == 4)
+      return tetrahedron;
+    if (dimension == 3 and nodes == 6)
+      return prism;
+    if (dimension == 3 and nodes == 8)
+      return hexahedron;
+    throw "export: unsupported element with " + std::to_string(nodes)
+      + " nodes in dimension " + std::to_string(dimension) + ".";
+  }
+
+
+  /*
+   *  Field of a mesh to export: a real, integer or element array with
+   *  one row per node or per element.
+   */
+  struct export_field {
+    std::string name;
+    unsigned int id;
+    bool nodal, integer;
+    unsigned int components;
+  };
+
+
+  /*
+   *  Read the elements of a mesh by windows, and call f(element)
+   *  on each of them with 0-based node indices. The unused vertices
+   *  (non positive indices in the dbfile) are replaced by the first used
+   *  vertex of the element, so the element degenerates instead of
+   *  referring to a missing node.
+   */
+  template<typename F>
+  void for_each_export_element(database_read_access* db, unsigned int elems_id,
+			       std::size_t buffer_size, F f) {
+    variable::array_stream<int> elements(db, elems_id, buffer_size);
+    const unsigned int nodes(elements.get_components());
+    std::vector<int> element(nodes);
+    while (elements.next()) {
+      for (std::size_t i(0); i < elements.get_window_rows(); ++i) {
+	const int* raw(elements.get_values() + i * nodes);
+	int first_used(1);
+	for (unsigned int k(0); k < nodes; ++k)
+	  if (raw[k] > 0) {
+	    first_used = raw[k];
+	    break;
+	  }
+	for (unsigned int k(0); k < nodes; ++k)
+	  element[k] = (raw[k] > 0 ? raw[k] : first_used) - 1;
+	f(element.data());
+      }
+    }
+  }
+
+
+  /*
+   *  EnSight Gold binary files: a geometry file with one part for the
+   *  mesh, one file per variable and time step, and a case file tying
+   *  them together. The coordinates and the vectors are stored one
+   *  component after the other, so the rows read from the dbfile are
+   *  transposed on the fly: each component of a window is written at
+   *  its place in its block, the blocks being placed from the known
+   *  sizes of the arrays.
+   */
+  namespace ensight {
+
+    /*
+     *  Destination of one component: the block of 'rows' floats at
+     *  'offset' in 'file'. A negative component gives a block of zeros.
+     */
+    struct float_block {
+      std::ofstream* file;
+      std::streamoff offset;
+      int component;
+    };
+
+    inline void write_string(std::ostream& file, const std::string& s) {
+      char line[80];
+      std::memset(line, 0, sizeof(line));
+      std::strncpy(line, s.c_str(), sizeof(line) - 1);
+      file.write(line, sizeof(line));
+    }
+
+    inline void write_int(std::ostream& file, int i) {
+      file.write(reinterpret_cast<const char*>(&i), sizeof(i));
+    }
+
+    template<typename T>
+    void write_float_blocks(database_read_access* db, unsigned int id, const std::vector<float_block>& blocks,
+			    std::size_t buffer_size) {
+      variable::array_stream<T> values(db, id, buffer_size);
+      std::vector<float> block;
+      while (values.next()) {
+	const std::size_t rows(values.get_window_rows());
+	block.resize(rows);
+	for (const auto& b: blocks) {
+	  for (std::size_t i(0); i < rows; ++i)
+	    block[i] = b.component < 0 ? 0.f : static_cast<float>(values.get_value(i, b.component));
+	  b.file->seekp(b.offset + static_cast<std::streamoff>(values.get_window_first_row() * sizeof(float)));
+	  b.file->write(reinterpret_cast<const char*>(block.data()), rows * sizeof(float));
+	}
+      }
+    }
+
+    inline void open_file(std::ofstream& file, const std::string& filename) {
+      file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (not file)
+	throw "export: unable to create " + filename + ".";
+    }
+
+    inline void close_file(std::ofstream& file, const std::string& filename) {
+      file.close();
+      if (not file)
+	throw "export: unable to write " + filename + ".";
+    }
+
+    /*
+     *  Names of the EnSight variables of a field: the field itself for
+     *  scalars and vectors (3 components, or 2 in a 2D mesh), and one
+     *  scalar per component otherwise.
+     */
+    inline bool is_vector(const export_field& f, unsigned int dimension) {
+      return f.components == 3 or (f.components == 2 and dimension == 2);
+    }
+
+    inline std::vector<std::string> variable_names(const export_field& f, unsigned int dimension) {
+      std::vector<std::string> names;
+      if (f.components == 1 or is_vector(f, dimension))
+	names.push_back(f.name);
+      else
+	for (unsigned int c(0); c < f.components; ++c)
+	  names.push_back(f.name + "_" + std::to_string(c));
+      return names;
+    }
+
+    inline void write_geometry(database_read_access* db, const mesh_description& description,
+			       const std::string& filename, std::size_t buffer_size) {
+      const unsigned int dimension(db->get_array_dimensions(description.nodes_id).second);
+      const unsigned int nodes(db->get_array_dimensions(description.elems_id).second);
+      const export_element_type type(get_export_element_type(dimension, nodes));
+
+      std::ofstream file;
+      open_file(file, filename);
+      write_string(file, "C Binary");
+      write_string(file, "Alucell mesh " + description.name);
+      write_string(file, "Exported from " + db->get_filename());
+      write_string(file, "node id off");
+      write_string(file, "element id off");
+      write_string(file, "part");
+      write_int(file, 1);
+      write_string(file, description.name);
+      write_string(file, "coordinates");
+      write_int(file, description.nodes_number);
+
+      const std::streamoff coordinates(file.tellp());
+      std::vector<float_block> blocks;
+      for (int d(0); d < 3; ++d) {
+	const float_block b = { &file, coordinates + static_cast<std::streamoff>(d * description.nodes_number * sizeof(float)),
+				d < static_cast<int>(dimension) ? d : -1 };
+	blocks.push_back(b);
+      }
+      write_float_blocks<double>(db, description.nodes_id, blocks, buffer_size);
+
+      file.seekp(coordinates + static_cast<std::streamoff>(3 * description.nodes_number * sizeof(float)));
+      write_string(file, type.ensight_name);
+      write_int(file, description.elements_number);
+      std::vector<int> element(nodes);
+      for_each_export_element(db, description.elems_id, buffer_size, [&](const int* e) {
+	  for (unsigned int k(0); k < nodes; ++k)
+	    element[k] = e[k] + 1;
+	  file.write(reinterpret_cast<const char*>(element.data()), nodes * sizeof(int));
+	});
+      close_file(file, filename);
+    }
+
+    /*
+     *  Write the variable files of a field: 'filenames' are given in the
+     *  order of variable_names().
+     */
+    inline void write_field(database_read_access* db, const mesh_description& description,
+			    const export_field& f, const std::vector<std::string>& filenames,
+			    std::size_t buffer_size) {
+      const unsigned int dimension(db->get_array_dimensions(description.nodes_id).second);
+      const unsigned int nodes(db->get_array_dimensions(description.elems_id).second);
+      const export_element_type type(get_export_element_type(dimension, nodes));
+      const std::size_t rows(f.nodal ? description.nodes_number : description.elements_number);
+
+      std::vector<std::ofstream> files(filenames.size());
+      std::vector<float_block> blocks;
+      for (std::size_t k(0); k < files.size(); ++k) {
+	open_file(files[k], filenames[k]);
+	write_string(files[k], f.name);
+	write_string(files[k], "part");
+	write_int(files[k], 1);
+	write_string(files[k], f.nodal ? std::string("coordinates") : std::string(type.ensight_name));
+
+	const std::streamoff values(files[k].tellp());
+	if (is_vector(f, dimension))
+	  for (int c(0); c < 3; ++c) {
+	    const float_block b = { &files[k], values + static_cast<std::streamoff>(c * rows * sizeof(float)),
+				    c < static_cast<int>(f.components) ? c : -1 };
+	    blocks.push_back(b);
+	  }
+	else {
+	  const float_block b = { &files[k], values, static_cast<int>(k) };
+	  blocks.push_back(b);
+	}
+      }
+
+      if (f.integer)
+	write_float_blocks<int>(db, f.id, blocks, buffer_size);
+      else
+	write_float_blocks<double>(db, f.id, blocks, buffer_size);
+
+      for (std::size_t k(0); k < files.size(); ++k)
+	close_file(files[k], filenames[k]);
+    }
+
+    /*
+     *  Variable of a case file: its type (e.g. 'scalar per node'), its
+     *  description, and its file name relative to the case file, with '*'
+     *  wildcards in place of the step number.
+     */
+    struct case_variable {
+      std::string type, description, filename;
+    };
+
+    inline void write_case(const std::string& filename, const std::string& geometry,
+			   const std::vector<case_variable>& variables, const std::vector<double>& times) {
+      std::ofstream file(filename.c_str(), std::ios::out | std::ios::trunc);
+      if (not file)
+	throw "export: unable to create " + filename + ".";
+
+      file.precision(12);
+      file << "FORMAT" << std::endl
+	   << "type: ensight gold" << std::endl << std::endl
+	   << "GEOMETRY" << std::endl
+	   << "model: " << geometry << std::endl << std::endl;
+
+      if (variables.size()) {
+	file << "VARIABLE" << std::endl;
+	for (const auto& v: variables)
+	  file << v.type << ": 1 " << v.description << " " << v.filename << std::endl;
+	file << std::endl;
+      }
+
+      file << "TIME" << std::endl
+	   << "time set: 1" << std::endl
+	   << "number of steps: " << times.size() << std::endl
+	   << "filename start number: 0" << std::endl
+	   << "filename increment: 1" << std::endl
+	   << "time values:";
+      for (std::size_t k(0); k < times.size(); ++k)
+	file << (k % 6 ? " " : "\n") << times[k];
+      file << std::endl;
+
+      if (not file)
+	throw "export: unable to write " + filename + ".";
+    }
+
+  }
+
+
+  /*
+   *  VTK XML unstructured grids (.vtu) with the arrays in an appended
+   *  raw binary section, and a ParaView collection (.pvd) for the time
+   *  series. The sizes of the arrays are known from the dbfile, so the
+   *  XML header is written first and the arrays are streamed after it.
+   */
+  namespace vtk {
+
+    inline const char* byte_order() {
+      const std::uint16_t one(1);
+      return *reinterpret_cast<const unsigned char*>(&one) ? "LittleEndian" : "BigEndian";
+    }
+
+    template<typename T>
+    void write_raw(std::ostream& file, const T* values, std::size_t n) {
+      file.write(reinterpret_cast<const char*>(values), n * sizeof(T));
+    }
+
+    /*
+     *  Stream the rows of an array as Float64, padded with zeros or
+     *  truncated to 'components' components.
+     */
+    template<typename T>
+    void write_rows(std::ostream& file, database_read_access* db, unsigned int id, unsigned int components,
+		    std::size_t buffer_size) {
+      variable::array_stream<T> values(db, id, buffer_size);
+      const unsigned int source_components(values.get_components());
+      std::vector<double> window;
+      while (values.next()) {
+	window.assign(values.get_window_rows() * components, 0.);
+	for (std::size_t i(0); i < values.get_window_rows(); ++i)
+	  for (unsigned int c(0); c < std::min(components, source_components); ++c)
+	    window[i * components + c] = values.get_value(i, c);
+	write_raw(file, window.data(), window.size());
+      }
+    }
+
+    inline void write_unstructured_grid(database_read_access* db, const mesh_description& description,
+					const std::vector<export_field>& fields, const std::string& filename,
+					std::size_t buffer_size) {
+      const unsigned int dimension(db->get_array_dimensions(description.nodes_id).second);
+      const unsigned int nodes(db->get_array_dimensions(description.elems_id).second);
+      const export_element_type type(get_export_element_type(dimension, nodes));
+      const std::uint64_t nodes_number(description.nodes_number), elements_number(description.elements_number);
+
+      std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (not file)
+	throw "export: unable to create " + filename + ".";
+
+      /*
+       *  Offsets of the arrays in the appended section, each one preceded
+       *  by its size in bytes:
+       */
+      std::uint64_t offset(0);
+      auto next_array = [&](std::uint64_t bytes) {
+	const std::uint64_t o(offset);
+	offset += sizeof(std::uint64_t) + bytes;
+	return o;
+      };
+
+      std::ostringstream point_data, cell_data;
+      for (bool nodal: {true, false})
+	for (const auto& f: fields)
+	  if (f.nodal == nodal)
+	    (nodal ? point_data : cell_data)
+	      << "        <DataArray type=\"Float64\" Name=\"" << f.name << "\" NumberOfComponents=\""
+	      << f.components << "\" format=\"appended\" offset=\""
+	      << next_array((nodal ? nodes_number : elements_number) * f.components * sizeof(double))
+	      << "\"/>\n";
+      const std::uint64_t points_offset(next_array(nodes_number * 3 * sizeof(double)));
+      const std::uint64_t connectivity_offset(next_array(elements_number * nodes * sizeof(std::int32_t)));
+      const std::uint64_t offsets_offset(next_array(elements_number * sizeof(std::int64_t)));
+      const std::uint64_t types_offset(next_array(elements_number * sizeof(std::uint8_t)));
+
+      file << "<?xml version=\"1.0\"?>\n"
+	   << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << byte_order()
+	   << "\" header_type=\"UInt64\">\n"
+	   << "  <UnstructuredGrid>\n"
+	   << "    <Piece NumberOfPoints=\"" << nodes_number << "\" NumberOfCells=\"" << elements_number << "\">\n"
+	   << "      <PointData>\n" << point_data.str() << "      </PointData>\n"
+	   << "      <CellData>\n" << cell_data.str() << "      </CellData>\n"
+	   << "      <Points>\n"
+	   << "        <DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\""
+	   << points_offset << "\"/>\n"
+	   << "      </Points>\n"
+	   << "      <Cells>\n"
+	   << "        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\""
+	   << connectivity_offset << "\"/>\n"
+	   << "        <DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\""
+	   << offsets_offset << "\"/>\n"
+	   << "        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\""
+	   << types_offset << "\"/>\n"
+	   << "      </Cells>\n"
+	   << "    </Piece>\n"
+	   << "  </UnstructuredGrid>\n"
+	   << "  <AppendedData encoding=\"raw\">\n"
+	   << "_";
+
+      auto write_size = [&](std::uint64_t bytes) { write_raw(file, &bytes, 1); };
+
+      for (bool nodal: {true, false})
+	for (const auto& f: fields) {
+	  if (f.nodal != nodal)
+	    continue;
+	  write_size((nodal ? nodes_number : elements_number) * f.components * sizeof(double));
+	  if (f.integer)
+	    write_rows<int>(file, db, f.id, f.components, buffer_size);
+	  else
+	    write_rows<double>(file, db, f.id, f.components, buffer_size);
+	}
+
+      write_size(nodes_number * 3 * sizeof(double));
+      write_rows<double>(file, db, description.nodes_id, 3, buffer_size);
+
+      write_size(elements_number * nodes * sizeof(std::int32_t));
+      std::vector<std::int32_t> element(nodes);
+      for_each_export_element(db, description.elems_id, buffer_size, [&](const int* e) {
+	  for (unsigned int k(0); k < nodes; ++k)
+	    element[k] = e[type.vtk_order[k]];
+	  write_raw(file, element.data(), nodes);
+	});
+
+      /*
+       *  The offsets and types are generated by chunks:
+       */
+      const std::size_t chunk(std::max<std::size_t>(1, buffer_size / sizeof(std::int64_t)));
+      write_size(elements_number * sizeof(std::int64_t));
+      std::vector<std::int64_t> offsets;
+      for (std::uint64_t first(0); first < elements_number; first += chunk) {
+	offsets.resize(std::min<std::uint64_t>(chunk, elements_number - first));
+	for (std::size_t i(0); i < offsets.size(); ++i)
+	  offsets[i] = (first + i + 1) * nodes;
+	write_raw(file, offsets.data(), offsets.size());
+      }
+
+      write_size(elements_number * sizeof(std::uint8_t));
+      const std::vector<std::uint8_t> types(std::min<std::uint64_t>(chunk, elements_number), type.vtk_type);
+      for (std::uint64_t first(0); first < elements_number; first += chunk)
+	write_raw(file, types.data(), std::min<std::uint64_t>(chunk, elements_number - first));
+
+      file << "\n  </AppendedData>\n</VTKFile>\n";
+      file.close();
+      if (not file)
+	throw "export: unable to write " + filename + ".";
+    }
+
+    /*
+     *  ParaView collection of the time steps: 'filenames' are relative to
+     *  the collection file.
+     */
+    inline void write_collection(const std::string& filename, const std::vector<std::string>& filenames,
+				 const std::vector<double>& times) {
+      std::ofstream file(filename.c_str(), std::ios::out | std::ios::trunc);
+      if (not file)
+	throw "export: unable to create " + filename + ".";
+
+      file.precision(12);
+      file << "<?xml version=\"1.0\"?>\n"
+	   << "<VTKFile type=\"Collection\" version=\"1.0\">\n"
+	   << "  <Collection>\n";
+      for (std::size_t k(0); k < filenames.size(); ++k)
+	file << "    <DataSet timestep=\"" << times[k] << "\" part=\"0\" file=\"" << filenames[k] << "\"/>\n";
+      file << "  </Collection>\n"
+	   << "</VTKFile>\n";
+
+      if (not file)
+	throw "export: unable to write " + filename + ".";
+    }
+
+  }
+
+}
+
+#endif /* _ALUCELL_EXPORT_H_ */
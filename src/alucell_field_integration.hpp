@@ -0,0 +1,108 @@
+#ifndef _ALUCELL_FIELD_INTEGRATION_H_
+#define _ALUCELL_FIELD_INTEGRATION_H_
+
+#include <map>
+#include <vector>
+#include <cmath>
+
+#include "alucell_mesh.hpp"
+#include "alucell_mesh_geometry.hpp"
+#include "alucell_reference_element.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  Integration of nodal and elemental fields over the elements of a
+   *  mesh, per reference of the elements.
+   *
+   *  The nodal fields are interpolated with the shape functions of the
+   *  elements, and integrated with the quadrature rules of the reference
+   *  elements. Since the integral is linear in the nodal values, the
+   *  quadrature is folded once into a weight per vertex of each element,
+   *  the integral of its shape function, so integrating a field only
+   *  costs one weighted sum per element. The elemental fields are
+   *  constant on each element, and integrate to the value times the
+   *  measure of the element.
+   */
+  class field_integrator {
+  public:
+    field_integrator(const mesh& _m, unsigned int threads = default_threads_number())
+      : m(_m), nodes_per_element(m.get_nodes_per_element()),
+	weights(m.get_elements_number() * nodes_per_element, 0.), measures(m.get_elements_number(), 0.) {
+      const reference_element r(m.get_dimension(), nodes_per_element);
+      const geometry::tabulated_quadrature t(r);
+
+      parallel_for(0, m.get_elements_number(), threads,
+		   [&](unsigned int, std::size_t b, std::size_t e) {
+		     double x[reference_element::max_nodes * 3], determinants[8];
+		     for (std::size_t i(b); i < e; ++i) {
+		       if (not geometry::gather_element(m, i, x))
+			 continue;
+		       t.jacobians(x, determinants);
+
+		       double* w(&weights[i * nodes_per_element]);
+		       for (unsigned int q(0); q < t.points; ++q) {
+			 const double jw(t.weights[q] * std::fabs(determinants[q]));
+			 measures[i] += jw;
+			 for (unsigned int k(0); k < nodes_per_element; ++k)
+			   w[k] += jw * t.values[q * nodes_per_element + k];
+		       }
+		     }
+		   });
+    }
+
+    const mesh& get_mesh() const { return m; }
+    const std::vector<double>& get_measures() const { return measures; }
+
+    /*
+     *  Measure of the elements of each reference.
+     */
+    std::map<int, geometry::region_sum> measure(unsigned int threads = default_threads_number()) const {
+      return geometry::sum_by_region(m, measures.data(), 1, threads);
+    }
+
+    /*
+     *  Integrals of the components of a field with one row per node.
+     */
+    template<typename T>
+    std::map<int, geometry::region_sum> integrate_nodal(const T* values, unsigned int components,
+							unsigned int threads = default_threads_number()) const {
+      return geometry::reduce_by_region(m, components,
+					[&](std::size_t i, double* sums) {
+					  const unsigned int* element(m.get_element(i));
+					  const double* w(&weights[i * nodes_per_element]);
+					  for (unsigned int k(0); k < nodes_per_element; ++k) {
+					    if (element[k] == mesh::no_node)
+					      continue;
+					    const T* v(values + static_cast<std::size_t>(element[k]) * components);
+					    for (unsigned int c(0); c < components; ++c)
+					      sums[c] += w[k] * v[c];
+					  }
+					}, threads);
+    }
+
+    /*
+     *  Integrals of the components of a field with one row per element.
+     */
+    template<typename T>
+    std::map<int, geometry::region_sum> integrate_elemental(const T* values, unsigned int components,
+							    unsigned int threads = default_threads_number()) const {
+      return geometry::reduce_by_region(m, components,
+					[&](std::size_t i, double* sums) {
+					  const T* v(values + i * components);
+					  for (unsigned int c(0); c < components; ++c)
+					    sums[c] += measures[i] * v[c];
+					}, threads);
+    }
+
+  private:
+    const mesh& m;
+    unsigned int nodes_per_element;
+    std::vector<double> weights;   // elements x nodes per element
+    std::vector<double> measures;
+  };
+
+}
+
+#endif /* _ALUCELL_FIELD_INTEGRATION_H_ */
@@ -0,0 +1,340 @@
+#ifndef _ALUCELL_HISTOGRAM_H_
+#define _ALUCELL_HISTOGRAM_H_
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+#include "alucell_statistics.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  namespace statistics {
+
+    const unsigned int all_components = std::numeric_limits<unsigned int>::max();
+
+
+    /*
+     *  Histogram with fixed width or logarithmic bins over [lower, upper).
+     *  The values outside the range are counted in the underflow and
+     *  overflow counters, the non finite values in the nan and inf
+     *  counters. In logarithmic mode, the non positive values are
+     *  counted as underflow. Histograms with the same bins can be merged.
+     */
+    class histogram {
+    public:
+      histogram(double _lower, double _upper, unsigned int bins, bool _logarithmic = false)
+	: lower(_lower), upper(_upper), logarithmic(_logarithmic),
+	  scale(0.), counts(bins, 0),
+	  underflow(0), overflow(0), nan_count(0), inf_count(0) {
+	if (bins == 0)
+	  throw std::string("histogram: the number of bins must be positive.");
+	if (not (upper > lower))
+	  throw std::string("histogram: empty range.");
+	if (logarithmic and not (lower > 0.))
+	  throw std::string("histogram: logarithmic bins require a positive lower bound.");
+
+	scale = bins / (logarithmic ? std::log(upper / lower) : upper - lower);
+      }
+
+      unsigned int get_bins_number() const { return counts.size(); }
+      std::size_t get_count(unsigned int bin) const { return counts[bin]; }
+      std::size_t get_underflow() const { return underflow; }
+      std::size_t get_overflow() const { return overflow; }
+      std::size_t get_nan_count() const { return nan_count; }
+      std::size_t get_inf_count() const { return inf_count; }
+
+      double get_bin_lower(unsigned int bin) const {
+	if (logarithmic)
+	  return lower * std::exp(bin / scale);
+	return lower + bin / scale;
+      }
+
+      double get_bin_upper(unsigned int bin) const {
+	return bin + 1 == counts.size() ? upper : get_bin_lower(bin + 1);
+      }
+
+      template<typename T>
+      void insert(T v) {
+	if (is_nan(v)) {
+	  ++nan_count;
+	} else if (is_inf(v)) {
+	  ++inf_count;
+	} else {
+	  const double x(v);
+	  if (x < lower) {
+	    ++underflow;
+	  } else if (x >= upper) {
+	    ++overflow;
+	  } else {
+	    const std::size_t bin(logarithmic ? std::log(x / lower) * scale : (x - lower) * scale);
+	    ++counts[std::min(bin, counts.size() - 1)];
+	  }
+	}
+      }
+
+      /*
+       *  Insert the values of the component 'c' (or of all the components
+       *  if 'c' is all_components) of an array of 'rows' rows. Each thread
+       *  fills its own histogram, which are merged at the end.
+       */
+      template<typename T>
+      void accumulate(const T* values, std::size_t rows, unsigned int components,
+		      unsigned int c, unsigned int threads = default_threads_number()) {
+	const std::size_t first(c == all_components ? 0 : c);
+	const std::size_t stride(c == all_components ? 1 : components);
+	const std::size_t n(c == all_components ? rows * components : rows);
+
+	std::vector<histogram> locals(std::max(1u, threads), empty_copy());
+	parallel_for(0, n, threads,
+		     [&](unsigned int t, std::size_t b, std::size_t e) {
+		       histogram& h(locals[t]);
+		       for (std::size_t i(b); i < e; ++i)
+			 h.insert(values[first + i * stride]);
+		     });
+
+	for (const auto& h: locals)
+	  merge(h);
+      }
+
+      void merge(const histogram& h) {
+	if (h.counts.size() != counts.size() or h.lower != lower
+	    or h.upper != upper or h.logarithmic != logarithmic)
+	  throw std::string("histogram: cannot merge histograms with different bins.");
+
+	for (std::size_t i(0); i < counts.size(); ++i)
+	  counts[i] += h.counts[i];
+	underflow += h.underflow;
+	overflow += h.overflow;
+	nan_count += h.nan_count;
+	inf_count += h.inf_count;
+      }
+
+    private:
+      double lower, upper;
+      bool logarithmic;
+      double scale;
+      std::vector<std::size_t> counts;
+      std::size_t underflow, overflow, nan_count, inf_count;
+
+      histogram empty_copy() const {
+	return histogram(lower, upper, counts.size(), logarithmic);
+      }
+    };
+
+
+    /*
+     *  Mergeable quantile sketch with a relative accuracy guarantee on
+     *  the returned values (logarithmic buckets, in the spirit of the
+     *  DDSketch algorithm). Values of magnitude below 'min_magnitude' are
+     *  considered as zeros, non finite values are ignored.
+     */
+    class quantile_sketch {
+    public:
+      static constexpr double min_magnitude = 1.e-300;
+
+      explicit quantile_sketch(double _relative_accuracy = 0.005)
+	: relative_accuracy(_relative_accuracy),
+	  log_gamma(std::log((1. + _relative_accuracy) / (1. - _relative_accuracy))),
+	  positive(), negative(), zero_count(0),
+	  min(std::numeric_limits<double>::infinity()),
+	  max(-std::numeric_limits<double>::infinity()) {
+	if (not (relative_accuracy > 0. and relative_accuracy < 1.))
+	  throw std::string("quantile_sketch: the relative accuracy must be in (0, 1).");
+      }
+
+      double get_relative_accuracy() const { return relative_accuracy; }
+
+      std::size_t get_count() const {
+	return positive.get_count() + negative.get_count() + zero_count;
+      }
+
+      template<typename T>
+      void insert(T v) {
+	if (is_nan(v) or is_inf(v))
+	  return;
+
+	const double x(v);
+	min = x < min ? x : min;
+	max = x > max ? x : max;
+	if (x > min_magnitude)
+	  positive.add(key(x), 1);
+	else if (x < -min_magnitude)
+	  negative.add(key(-x), 1);
+	else
+	  ++zero_count;
+      }
+
+      template<typename T>
+      void accumulate(const T* values, std::size_t rows, unsigned int components,
+		      unsigned int c, unsigned int threads = default_threads_number()) {
+	const std::size_t first(c == all_components ? 0 : c);
+	const std::size_t stride(c == all_components ? 1 : components);
+	const std::size_t n(c == all_components ? rows * components : rows);
+
+	std::vector<quantile_sketch> locals(std::max(1u, threads), quantile_sketch(relative_accuracy));
+	parallel_for(0, n, threads,
+		     [&](unsigned int t, std::size_t b, std::size_t e) {
+		       quantile_sketch& s(locals[t]);
+		       for (std::size_t i(b); i < e; ++i)
+			 s.insert(values[first + i * stride]);
+		     });
+
+	for (const auto& s: locals)
+	  merge(s);
+      }
+
+      void merge(const quantile_sketch& s) {
+	if (s.relative_accuracy != relative_accuracy)
+	  throw std::string("quantile_sketch: cannot merge sketches with different accuracies.");
+
+	positive.merge(s.positive);
+	negative.merge(s.negative);
+	zero_count += s.zero_count;
+	min = std::min(min, s.min);
+	max = std::max(max, s.max);
+      }
+
+      /*
+       *  Value of the q-th percentile, q in [0, 100], with a relative
+       *  error bounded by the accuracy of the sketch.
+       */
+      double get_percentile(double q) const {
+	const std::size_t n(get_count());
+	if (n == 0)
+	  return std::numeric_limits<double>::quiet_NaN();
+
+	const std::size_t rank(std::min(100., std::max(0., q)) / 100. * (n - 1) + 0.5);
+	if (rank == 0)
+	  return min;
+	if (rank == n - 1)
+	  return max;
+
+	double result(0.);
+	if (rank < negative.get_count())
+	  result = -value(negative.key_at_rank(negative.get_count() - 1 - rank));
+	else if (rank < negative.get_count() + zero_count)
+	  result = 0.;
+	else
+	  result = value(positive.key_at_rank(rank - negative.get_count() - zero_count));
+
+	return std::min(max, std::max(min, result));
+      }
+
+    private:
+      /*
+       *  Dense store of the bucket counts, indexed by the bucket key
+       *  relative to the smallest key seen.
+       */
+      class store {
+      public:
+	store(): offset(0), counts(), count(0) {}
+
+	std::size_t get_count() const { return count; }
+
+	void add(int k, std::size_t n) {
+	  if (counts.empty()) {
+	    offset = k;
+	    counts.assign(1, 0);
+	  } else if (k < offset) {
+	    counts.insert(counts.begin(), offset - k, 0);
+	    offset = k;
+	  } else if (k >= offset + static_cast<int>(counts.size())) {
+	    counts.resize(k - offset + 1, 0);
+	  }
+	  counts[k - offset] += n;
+	  count += n;
+	}
+
+	void merge(const store& s) {
+	  for (std::size_t i(0); i < s.counts.size(); ++i)
+	    if (s.counts[i])
+	      add(s.offset + static_cast<int>(i), s.counts[i]);
+	}
+
+	int key_at_rank(std::size_t rank) const {
+	  std::size_t seen(0);
+	  for (std::size_t i(0); i < counts.size(); ++i) {
+	    seen += counts[i];
+	    if (seen > rank)
+	      return offset + static_cast<int>(i);
+	  }
+	  return offset + static_cast<int>(counts.size()) - 1;
+	}
+
+      private:
+	int offset;
+	std::vector<std::size_t> counts;
+	std::size_t count;
+      };
+
+      double relative_accuracy;
+      double log_gamma;
+      store positive, negative;
+      std::size_t zero_count;
+      double min, max;
+
+      int key(double x) const {
+	return static_cast<int>(std::ceil(std::log(x) / log_gamma));
+      }
+
+      double value(int k) const {
+	return 2. * std::exp(k * log_gamma) / (1. + std::exp(log_gamma));
+      }
+    };
+
+
+
+    /*
+     *  Compute the per component statistics of an array variable, reading
+     *  it by windows of at most 'buffer_size' bytes. The percentiles are
+     *  estimated with quantile sketches of relative accuracy 'accuracy'.
+     *  The windows are aligned on the reduction blocks, so the results
+     *  are the same as for the array held in memory. Each window is read
+     *  once by the threads, which fill their own sketches of all the
+     *  components with the blocks they reduce; the sketches are merged
+     *  at the end.
+     */
+    template<typename T>
+    std::vector<component_statistics> compute_statistics(database_read_access* db, unsigned int id,
+							 const std::vector<double>& percentiles = std::vector<double>(),
+							 unsigned int threads = default_threads_number(),
+							 std::size_t buffer_size = variable::default_stream_buffer_size,
+							 double accuracy = 0.005) {
+      variable::array_stream<T> v(db, id, buffer_size, statistics_accumulator::block_rows);
+      const unsigned int components(v.get_components());
+      statistics_accumulator acc(components, threads);
+      std::vector<std::vector<quantile_sketch> >
+	sketches(percentiles.size() ? acc.get_threads_number() : 0,
+		 std::vector<quantile_sketch>(components, quantile_sketch(accuracy)));
+
+      while (v.next())
+	acc.accumulate(v.get_values(), v.get_window_rows(),
+		       [&](unsigned int t, const T* values, std::size_t rows) {
+			 if (sketches.empty())
+			   return;
+			 std::vector<quantile_sketch>& s(sketches[t]);
+			 for (std::size_t i(0); i < rows; ++i)
+			   for (unsigned int c(0); c < components; ++c)
+			     s[c].insert(values[i * components + c]);
+		       });
+
+      std::vector<component_statistics> result(acc.get_statistics());
+      for (std::size_t t(1); t < sketches.size(); ++t)
+	for (unsigned int c(0); c < components; ++c)
+	  sketches[0][c].merge(sketches[t][c]);
+      if (sketches.size())
+	for (unsigned int c(0); c < components; ++c)
+	  for (const auto q: percentiles)
+	    result[c].percentiles.push_back(std::make_pair(q, sketches[0][c].get_percentile(q)));
+
+      return result;
+    }
+
+  }
+
+}
+
+#endif /* _ALUCELL_HISTOGRAM_H_ */
@@ -1,5 +1,18 @@
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <map>
+#include <set>
+#include <iterator>
+
 #include "alucell_legacy_database.hpp"
+#include "alucell_delta.hpp"
 
 namespace alucell {
 
@@ -8,29 +21,90 @@ namespace alucell {
     //       and that the state is clean (variablesInfos and blockInfos
     //       reinitialized).
 
-    // Random constant used in Alucell legacy code:
-    const unsigned int max_saved_vectors(26500);
+    /*
+     * Read the preamble of an extended header, and its table:
+     */
+    std::vector<char> header(header_size, 0);
+    dbfile.read(&header[0], sizeof(extended_header::preamble));
+    if (extended_header::has_magic(&header[0])) {
+      extended_header::preamble p;
+      std::memcpy(&p, &header[0], sizeof(p));
+      check_extended_preamble(p);
+      std::vector<char> table(p.table_size);
+      dbfile.seekg(p.table_offset, std::ios::beg);
+      dbfile.read(table.data(), table.size());
+      if (not dbfile)
+	throw "[error] database_read_access::read_header: Unable to read the table of " + filename + ".";
+      parse_extended_header(&header[0], table.data());
+      return;
+    }
 
-    std::vector<unsigned int>
-      lengths_buffer(max_saved_vectors, 0),
-      offsets_buffer(max_saved_vectors, 0);
-    std::vector<char> 
-      names_buffer(max_saved_vectors * 4 * sizeof(double), 0);
-  
     /* 
-     * Read the lengths, offsets, names and info block
+     * Or the rest of the lengths, offsets, names and info block
      * from the file into the buffer:
      */
-    dbfile.read(reinterpret_cast<char*>(&lengths_buffer[0]),
-		sizeof(unsigned int)*lengths_buffer.size());
+    dbfile.read(&header[sizeof(extended_header::preamble)], header.size() - sizeof(extended_header::preamble));
+
+    parse_header(&header[0]);
+  }
+
+  /*
+   *  The preamble is checked against the size of the file before its
+   *  table is allocated and read, and the entries of the table when they
+   *  are parsed, so that a truncated or foreign file is refused.
+   */
+  void database_read_access::check_extended_preamble(const extended_header::preamble& p) const {
+    const std::uint64_t file_size(identity.size);
+    if (p.version > extended_header::current_version)
+      throw "[error] database_read_access: " + filename + " has an extended header of version "
+	+ std::to_string(p.version) + ", newer than this reader.";
+    if (p.table_size > file_size or p.table_offset > file_size - p.table_size
+	or p.variables_number > p.table_size / sizeof(extended_header::entry))
+      throw "[error] database_read_access: the table of variables of " + filename
+	+ " is not within the file.";
+  }
 
-    dbfile.read(reinterpret_cast<char*>(&offsets_buffer[0]),
-		sizeof(unsigned int)*offsets_buffer.size());
+  void database_read_access::parse_extended_header(const char* header, const char* table) {
+    format = dbfile_format::extended;
+    std::memcpy(&extended_infos, header, sizeof(extended_infos));
+    check_extended_preamble(extended_infos);
+    const std::uint64_t file_size(identity.size);
 
-    dbfile.read(&names_buffer[0], names_buffer.size());
+    for (std::size_t v(0), position(0); v < extended_infos.variables_number; ++v) {
+      extended_header::entry e;
+      if (position + sizeof(e) > extended_infos.table_size)
+	throw "[error] database_read_access: truncated table of variables in " + filename + ".";
+      std::memcpy(&e, table + position, sizeof(e));
+      const std::size_t entry_size(extended_header::get_entry_size(e.name_size));
+      if (position + entry_size > extended_infos.table_size)
+	throw "[error] database_read_access: truncated table of variables in " + filename + ".";
+      if (e.length > file_size or e.offset > file_size - e.length)
+	throw "[error] database_read_access: the data of variable " + std::to_string(v) + " of " + filename
+	  + " is not within the file.";
 
-    dbfile.read(reinterpret_cast<char*>(&block_infos[0]),
-		sizeof(unsigned int)*block_infos.size());
+      const database_index_item item(std::string(table + position + sizeof(e), e.name_size), e.length, e.offset);
+      if (not (e.flags & extended_header::deleted_flag))
+	index.push_back(item);
+      position += entry_size;
+    }
+  }
+
+  bool database_read_access::has_extended_header(const std::string& _filename) {
+    char magic[8] = {0};
+    std::ifstream f(_filename.c_str(), std::ios::binary);
+    f.read(magic, sizeof(magic));
+    return f and extended_header::has_magic(magic);
+  }
+
+  void database_read_access::parse_header(const char* header) {
+    const unsigned int* lengths_buffer(reinterpret_cast<const unsigned int*>(header));
+    const unsigned int* offsets_buffer(lengths_buffer + max_saved_vectors);
+    const char* names_buffer(reinterpret_cast<const char*>(offsets_buffer + max_saved_vectors));
+
+    std::copy(reinterpret_cast<const unsigned int*>(names_buffer + max_saved_vectors * 4 * sizeof(double)),
+	      reinterpret_cast<const unsigned int*>(names_buffer + max_saved_vectors * 4 * sizeof(double))
+	      + block_infos.size(),
+	      block_infos.begin());
   
     /*
      * Read the vector names list:
@@ -50,41 +124,420 @@ namespace alucell {
 	/*
 	 * Extract the name of the stored vector:
 	 */
-	const std::string vector_name(names_buffer.begin()
+	const std::string vector_name(names_buffer
 				      + (offset - (vector_name_size - 1)) * 4 * sizeof(double), 
-				      names_buffer.begin()
+				      names_buffer
 				      + (offset + 1) * 4 * sizeof(double));
 
 	const database_index_item
 	  item(trimmed(vector_name),
-	       lengths_buffer[offset] * static_cast<unsigned int>(sizeof(double)),
-	       (offsets_buffer[offset] - 1) * static_cast<unsigned int>(sizeof(double)));
+	       lengths_buffer[offset] * sizeof(double),
+	       (offsets_buffer[offset] - 1) * sizeof(double));
 	if (not item.is_deleted())
 	  index.push_back(item);
       }
   }
 
 
-  database_read_access::database_read_access(): block_infos(8, 0) {}
+  database_read_access::database_read_access()
+    : fd(-1), block_infos(8, 0), format(dbfile_format::legacy), extended_infos(extended_header::make_preamble()),
+      base(), decoded(), decoded_id(-1) {}
   
   /*
    * Constuctor
    */
   database_read_access::database_read_access(const std::string& _filename)
-    : filename(), dbfile(), index(), block_infos(8, 0) {
+    : filename(), dbfile(), fd(-1), index(), block_infos(8, 0), format(dbfile_format::legacy),
+      extended_infos(extended_header::make_preamble()), base(), decoded(), decoded_id(-1) {
     open(_filename);
   }
 
-  std::pair<unsigned int, unsigned int> database_read_access::read_array_size_infos(unsigned int offset) {
+  database_read_access::~database_read_access() {
+    close();
+  }
+
+  std::pair<std::size_t, unsigned int> database_read_access::read_array_size_infos(std::size_t offset) {
     double meta[2] = {0.};
 
     dbfile.seekg(offset, std::ios::beg);
     dbfile.read(reinterpret_cast<char*>(meta), 2 * sizeof(double));
 
-    return std::make_pair(static_cast<unsigned int>(meta[0]),
+    return std::make_pair(static_cast<std::size_t>(meta[0]),
 			  static_cast<unsigned int>(meta[1]));
   }
 
+  std::pair<std::size_t, unsigned int> database_read_access::get_array_dimensions(unsigned int id) {
+    if (index[id].base_id >= 0)
+      return base->get_array_dimensions(index[id].base_id);
+    if (index[id].xor_base_id < 0)
+      return read_array_size_infos(index[id].offset);
+
+    double meta[2] = {0.};
+    read_data_from_database(id, 0, std::min(sizeof(meta), index[id].length), meta);
+    return std::make_pair(static_cast<std::size_t>(meta[0]),
+			  static_cast<unsigned int>(meta[1]));
+  }
+
+  void database_read_access::read_data_from_database(unsigned int id, std::size_t offset,
+						     std::size_t length, void* dst) {
+    if (offset + length > index[id].length)
+      throw std::string("[error] database_read_access::read_data_from_database: read past the end of the variable.");
+
+    if (index[id].base_id >= 0) {
+      base->read_data_from_database(index[id].base_id, offset, length, dst);
+      return;
+    }
+    if (index[id].xor_base_id >= 0) {
+      const std::vector<char>& payload(get_decoded_variable(id));
+      std::copy(payload.begin() + offset, payload.begin() + offset + length, reinterpret_cast<char*>(dst));
+      return;
+    }
+
+    dbfile.seekg(index[id].offset + offset, std::ios::beg);
+    dbfile.read(reinterpret_cast<char*>(dst), length);
+  }
+
+  /*
+   *  Read the encoded data of the variable and the data of its base
+   *  variable, with pread so that it can be used concurrently, and
+   *  decode them.
+   */
+  void database_read_access::decode_variable(unsigned int id, std::vector<char>& payload) const {
+    const database_index_item& item(index[id]);
+    std::vector<char> encoded(item.stored_length);
+    for (std::size_t done(0); done < encoded.size();) {
+      const ssize_t n(::pread(fd, &encoded[done], encoded.size() - done, item.offset + done));
+      if (n <= 0)
+	throw "[error] database_read_access: Unable to read " + item.name + " from " + filename + ".";
+      done += n;
+    }
+
+    std::vector<char> base_payload(base->get_variable_size(item.xor_base_id));
+    if (base_payload.size() != item.length)
+      throw "[error] database_read_access: " + item.name + " does not match its base variable.";
+    base->pread_data_from_database(item.xor_base_id, 0, base_payload.size(), base_payload.data());
+
+    payload.resize(item.length);
+    delta::decode(encoded.data(), encoded.size(), base_payload.data(), payload.data());
+  }
+
+  const std::vector<char>& database_read_access::get_decoded_variable(unsigned int id) {
+    if (decoded_id != static_cast<int>(id)) {
+      decoded_id = -1;
+      decode_variable(id, decoded);
+      decoded_id = id;
+    }
+    return decoded;
+  }
+
+  /*
+   *  Open the base of a delta dbfile, check it, and replace the index of
+   *  the delta by the index of the variables of the chain.
+   */
+  void database_read_access::open_delta_base() {
+    std::map<std::string, std::size_t> own;
+    for (std::size_t i(0); i < index.size(); ++i)
+      own[index[i].name] = i;
+    if (own.count(delta::base_variable) == 0)
+      return;
+
+    auto read_string = [&](const std::string& name) {
+      const auto it(own.find(name));
+      if (it == own.end())
+	return std::string();
+      std::vector<char> payload(index[it->second].length);
+      pread_data_from_database(it->second, 0, payload.size(), payload.data());
+      return delta::string_value(payload);
+    };
+
+    std::string base_filename(read_string(delta::base_variable));
+    if (base_filename.empty())
+      throw "[error] database_read_access: " + filename + " is a delta without base.";
+    if (base_filename[0] != '/' and filename.find('/') != std::string::npos)
+      base_filename = filename.substr(0, filename.rfind('/') + 1) + base_filename;
+
+    if (delta::signature(base_filename, header_size) != read_string(delta::signature_variable))
+      throw "[error] database_read_access: " + base_filename + " is not the base of the delta " + filename + ".";
+    base.reset(new database_read_access(base_filename));
+
+    std::set<std::string> deleted;
+    const std::string deleted_names(read_string(delta::deleted_variable));
+    for (std::size_t b(0), e(0); b < deleted_names.size(); b = e + 1) {
+      e = std::min(deleted_names.find('\n', b), deleted_names.size());
+      deleted.insert(deleted_names.substr(b, e - b));
+    }
+
+    const std::string xor_prefix(delta::xor_prefix);
+    std::vector<char> used(index.size(), 0);
+    for (const char* marker: {delta::base_variable, delta::signature_variable, delta::deleted_variable})
+      if (own.count(marker))
+	used[own[marker]] = 1;
+
+    std::vector<database_index_item> chain;
+    for (unsigned int id(0); id < base->get_variables_number(); ++id) {
+      const std::string& name(base->get_variable_name(id));
+      const auto plain(own.find(name)), encoded(own.find(xor_prefix + name));
+      if (plain != own.end() and not used[plain->second]) {
+	chain.push_back(index[plain->second]);
+	used[plain->second] = 1;
+      } else if (encoded != own.end() and not used[encoded->second]) {
+	database_index_item item(index[encoded->second]);
+	std::vector<char> sizes(2 * sizeof(std::uint64_t));
+	if (item.length < sizes.size())
+	  throw "[error] database_read_access: truncated encoded variable " + item.name + ".";
+	pread_data_from_database(encoded->second, 0, sizes.size(), sizes.data());
+	item.name = name;
+	item.length = delta::decoded_size(sizes.data(), sizes.size());
+	item.xor_base_id = id;
+	chain.push_back(item);
+	used[encoded->second] = 1;
+      } else if (deleted.count(name) == 0) {
+	database_index_item item(base->index[id]);
+	item.base_id = id;
+	item.xor_base_id = -1;
+	chain.push_back(item);
+      }
+    }
+
+    for (std::size_t i(0); i < index.size(); ++i)
+      if (not used[i]) {
+	if (index[i].name.compare(0, xor_prefix.size(), xor_prefix) == 0)
+	  throw "[error] database_read_access: encoded variable " + index[i].name + " without base variable.";
+	chain.push_back(index[i]);
+      }
+
+    index.swap(chain);
+  }
+
+  void database_read_access::pread_data_from_database(unsigned int id, std::size_t offset,
+						      std::size_t length, void* dst) const {
+    if (offset + length > index[id].length)
+      throw std::string("[error] database_read_access::pread_data_from_database: read past the end of the variable.");
+
+    if (index[id].base_id >= 0) {
+      base->pread_data_from_database(index[id].base_id, offset, length, dst);
+      return;
+    }
+    if (index[id].xor_base_id >= 0) {
+      std::vector<char> payload;
+      decode_variable(id, payload);
+      std::copy(payload.begin() + offset, payload.begin() + offset + length, reinterpret_cast<char*>(dst));
+      return;
+    }
+
+    char* p(reinterpret_cast<char*>(dst));
+    while (length) {
+      const ssize_t n(::pread(fd, p, length, index[id].offset + offset));
+      if (n <= 0)
+	throw "[error] database_read_access::pread_data_from_database: Unable to read from " + filename + ".";
+      p += n;
+      offset += n;
+      length -= n;
+    }
+  }
+
+  void database_read_access::read_batch_from_database(const std::vector<read_request>& requests,
+						      std::size_t max_gap, std::size_t max_extent) {
+    if (not base) {
+      read_own_batch(requests, max_gap, max_extent);
+      return;
+    }
+
+    /*
+     *  Delta dbfile: the requests of the variables of the base are read
+     *  by the base, the encoded variables are decoded one by one.
+     */
+    std::vector<read_request> own, delegated;
+    for (const auto& r: requests) {
+      if (r.offset + r.length > index[r.id].length)
+	throw std::string("[error] database_read_access::read_batch_from_database: read past the end of the variable.");
+      if (index[r.id].base_id >= 0) {
+	read_request b(r);
+	b.id = index[r.id].base_id;
+	delegated.push_back(b);
+      } else if (index[r.id].xor_base_id >= 0) {
+	read_data_from_database(r.id, r.offset, r.length, r.dst);
+      } else {
+	own.push_back(r);
+      }
+    }
+    if (delegated.size())
+      base->read_batch_from_database(delegated, max_gap, max_extent);
+    read_own_batch(own, max_gap, max_extent);
+  }
+
+  void database_read_access::read_own_batch(const std::vector<read_request>& requests,
+					    std::size_t max_gap, std::size_t max_extent) {
+    /*
+     * Sort the requests by file offset:
+     */
+    std::vector<std::size_t> order(requests.size());
+    for (std::size_t i(0); i < order.size(); ++i) {
+      const read_request& r(requests[i]);
+      if (r.offset + r.length > index[r.id].length)
+	throw std::string("[error] database_read_access::read_batch_from_database: read past the end of the variable.");
+      order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+		     [&](std::size_t a, std::size_t b) {
+		       return index[requests[a].id].offset + requests[a].offset
+			 < index[requests[b].id].offset + requests[b].offset;
+		     });
+
+    /*
+     * Merge the adjacent and nearly adjacent requests into extents
+     * [begin, end) of the sorted requests:
+     */
+    struct extent {
+      std::size_t begin, end;
+      std::size_t offset, length;
+    };
+    std::vector<extent> extents;
+    for (const auto i: order) {
+      const std::size_t start(index[requests[i].id].offset + requests[i].offset);
+      const std::size_t stop(start + requests[i].length);
+
+      if (extents.size()) {
+	extent& e(extents.back());
+	const std::size_t new_length(std::max(e.offset + e.length, stop) - e.offset);
+	if (start <= e.offset + e.length + max_gap and new_length <= max_extent) {
+	  e.end += 1;
+	  e.length = new_length;
+	  continue;
+	}
+      }
+
+      const std::size_t position(extents.size() ? extents.back().end : 0);
+      extent e = {position, position + 1, start, stop - start};
+      extents.push_back(e);
+    }
+
+    /*
+     * Hint the kernel about the whole plan, then read the extents:
+     */
+    if (fd >= 0)
+      for (const auto& e: extents)
+	posix_fadvise(fd, e.offset, e.length, POSIX_FADV_WILLNEED);
+
+    std::vector<char> buffer;
+    for (const auto& e: extents) {
+      if (e.end - e.begin == 1) {
+	const read_request& r(requests[order[e.begin]]);
+	dbfile.seekg(e.offset, std::ios::beg);
+	dbfile.read(reinterpret_cast<char*>(r.dst), r.length);
+	continue;
+      }
+
+      buffer.resize(e.length);
+      dbfile.seekg(e.offset, std::ios::beg);
+      dbfile.read(&buffer[0], e.length);
+
+      for (std::size_t k(e.begin); k < e.end; ++k) {
+	const read_request& r(requests[order[k]]);
+	std::copy(buffer.begin() + (index[r.id].offset + r.offset - e.offset),
+		  buffer.begin() + (index[r.id].offset + r.offset - e.offset + r.length),
+		  reinterpret_cast<char*>(r.dst));
+      }
+    }
+  }
+
+  std::vector<std::pair<std::size_t, unsigned int> >
+  database_read_access::get_arrays_dimensions(const std::vector<unsigned int>& ids) {
+    std::vector<double> meta(2 * ids.size(), 0.);
+    std::vector<read_request> requests;
+    for (std::size_t i(0); i < ids.size(); ++i) {
+      read_request r = {ids[i], 0, 2 * sizeof(double), &meta[2 * i]};
+      requests.push_back(r);
+    }
+    read_batch_from_database(requests);
+
+    std::vector<std::pair<std::size_t, unsigned int> > dimensions;
+    for (std::size_t i(0); i < ids.size(); ++i)
+      dimensions.push_back(std::make_pair(static_cast<std::size_t>(meta[2 * i]),
+					  static_cast<unsigned int>(meta[2 * i + 1])));
+    return dimensions;
+  }
+
+  void database_read_access::open_async(async_read_engine* engine, const std::string& _filename,
+					std::function<void()> on_open) {
+    close();
+
+    dbfile.open(_filename.c_str(), std::ios::in | std::ios::binary);
+    fd = ::open(_filename.c_str(), O_RDONLY);
+    if(!dbfile or fd < 0)
+      throw std::string("[error] database_read_access::open_async(filename): Unable to open dbfile.");
+
+    filename = _filename;
+    read_identity();
+
+    /*
+     *  The preamble is read first, then the table of an extended header
+     *  or the rest of a legacy one:
+     */
+    const std::size_t preamble_size(sizeof(extended_header::preamble));
+    std::shared_ptr<std::vector<char> > header(new std::vector<char>(header_size, 0));
+    engine->submit(fd, 0, preamble_size, &(*header)[0],
+		   [this, engine, header, preamble_size, on_open](long result) {
+		     if (result != static_cast<long>(preamble_size))
+		       throw "[error] database_read_access::open_async(filename): Unable to read the header of " + filename + ".";
+
+		     if (extended_header::has_magic(&(*header)[0])) {
+		       extended_header::preamble p;
+		       std::memcpy(&p, &(*header)[0], sizeof(p));
+		       check_extended_preamble(p);
+		       std::shared_ptr<std::vector<char> > table(new std::vector<char>(p.table_size));
+		       engine->submit(fd, p.table_offset, p.table_size, table->data(),
+				      [this, header, table, on_open](long result) {
+					if (result != static_cast<long>(table->size()))
+					  throw "[error] database_read_access::open_async(filename): Unable to read the table of " + filename + ".";
+					parse_extended_header(&(*header)[0], table->data());
+					open_delta_base();
+					on_open();
+				      });
+		       return;
+		     }
+
+		     engine->submit(fd, preamble_size, header_size - preamble_size, &(*header)[preamble_size],
+				    [this, header, preamble_size, on_open](long result) {
+				      if (result != static_cast<long>(header_size - preamble_size))
+					throw "[error] database_read_access::open_async(filename): Unable to read the header of " + filename + ".";
+				      parse_header(&(*header)[0]);
+				      open_delta_base();
+				      on_open();
+				    });
+		   });
+  }
+
+  void database_read_access::read_data_async(async_read_engine* engine, unsigned int id,
+					     std::size_t offset, std::size_t length, void* dst,
+					     std::function<void()> done) {
+    if (offset + length > index[id].length)
+      throw std::string("[error] database_read_access::read_data_async: read past the end of the variable.");
+
+    if (index[id].base_id >= 0) {
+      base->read_data_async(engine, index[id].base_id, offset, length, dst, done);
+      return;
+    }
+    if (index[id].xor_base_id >= 0) {
+      /*
+       *  Decoded now, the empty read only defers the callback to the
+       *  engine:
+       */
+      read_data_from_database(id, offset, length, dst);
+      engine->submit(fd, 0, 0, dst, [done](long) { done(); });
+      return;
+    }
+
+    const std::string name(filename);
+    engine->submit(fd, index[id].offset + offset, length, dst,
+		   [name, length, done](long result) {
+		     if (result != static_cast<long>(length))
+		       throw "[error] database_read_access::read_data_async: Unable to read from " + name + ".";
+		     done();
+		   });
+  }
+
   void database_read_access::open(const std::string& _filename) {
     close();
     
@@ -97,7 +550,22 @@ namespace alucell {
       throw std::string("[error] database_read_access::open(filename): Unable to open dbfile.");
 
     filename = _filename;
+    fd = ::open(_filename.c_str(), O_RDONLY);
+    read_identity();
     read_header();
+    open_delta_base();
+  }
+
+  void database_read_access::read_identity() {
+    struct stat s;
+    if (fd < 0 or fstat(fd, &s) != 0)
+      throw "[error] database_read_access: Unable to stat " + filename + ".";
+
+    identity.device = s.st_dev;
+    identity.inode = s.st_ino;
+    identity.size = s.st_size;
+    identity.mtime_sec = s.st_mtim.tv_sec;
+    identity.mtime_nsec = s.st_mtim.tv_nsec;
   }
 
   void database_read_access::close() {
@@ -105,9 +573,205 @@ namespace alucell {
      * Clear state:
      */
     dbfile.close();
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
     filename = "";
+    identity = file_identity();
     index.clear();
+    base.reset();
+    std::vector<char>().swap(decoded);
+    decoded_id = -1;
     std::fill(block_infos.begin(), block_infos.end(), 0);
+    format = dbfile_format::legacy;
+    extended_infos = extended_header::make_preamble();
+  }
+
+  void database_write_access::sync() {
+    flush();
+    const int fd(::open(filename.c_str(), O_WRONLY));
+    if (fd < 0 or ::fdatasync(fd) != 0) {
+      if (fd >= 0)
+	::close(fd);
+      throw "[error] database_write_access::sync: Unable to sync " + filename + ".";
+    }
+    ::close(fd);
+  }
+
+  database_parallel_write_access::database_parallel_write_access(const std::string& _filename)
+    : filename(_filename), partial_filename(_filename + ".partial"), fd(-1),
+      header(database_read_access::header_size, 0), reservations(),
+      lengths_buffer_offset(database_write_access::length_buffer_file_offset * sizeof(double)),
+      offsets_buffer_offset(database_write_access::offset_buffer_file_offset * sizeof(double)),
+      names_buffer_offset(database_write_access::name_buffer_file_offset * sizeof(double)),
+      last_block_offset(database_read_access::header_size),
+      used_slots_number(0), written_mutex(), writing(false) {
+    fd = ::open(partial_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+      throw "[error] database_parallel_write_access: Unable to open " + partial_filename + ".";
+  }
+
+  database_parallel_write_access::~database_parallel_write_access() {
+    abandon();
+  }
+
+  unsigned int database_parallel_write_access::reserve(const std::string& name, alucell::data_type t,
+							std::size_t size) {
+    if (fd < 0 or writing)
+      throw std::string("[error] database_parallel_write_access::reserve: the layout is already being written.");
+
+    /*
+     *  Same layout as database_write_access::begin_insert:
+     */
+    std::string item_name(database_write_access::prepend_type_char(name, t));
+    const unsigned int required_slots_number(item_name.size() / 32 + 1);
+    item_name.resize(required_slots_number * 4 * sizeof(double), ' ');
+
+    if (used_slots_number + required_slots_number > database_write_access::max_item_number)
+      throw std::string("[error] database_parallel_write_access::reserve: no name slot left.");
+    const std::size_t padded_size(database_write_access::get_padded_size(size));
+    if ((last_block_offset + padded_size) / sizeof(double) > INT_MAX)
+      throw "[error] database_parallel_write_access::reserve: " + name
+	+ " does not fit in the 32 bits tables of the dbfile.";
+
+    const int size_in_block(padded_size / sizeof(double));
+    const int last_block_offset_in_block(last_block_offset / sizeof(double) + 1);
+    std::memcpy(&header[lengths_buffer_offset + (required_slots_number - 1) * sizeof(int)],
+		&size_in_block, sizeof(int));
+    std::memcpy(&header[offsets_buffer_offset + (required_slots_number - 1) * sizeof(int)],
+		&last_block_offset_in_block, sizeof(int));
+    std::memcpy(&header[names_buffer_offset], item_name.data(), item_name.size());
+    lengths_buffer_offset += required_slots_number * sizeof(int);
+    offsets_buffer_offset += required_slots_number * sizeof(int);
+    names_buffer_offset += item_name.size();
+    used_slots_number += required_slots_number;
+
+    reservations.push_back(reservation());
+    reservations.back().offset = last_block_offset;
+    reservations.back().size = size;
+    last_block_offset += padded_size;
+    return reservations.size() - 1;
+  }
+
+  void database_parallel_write_access::write_data(unsigned int slot, std::size_t offset,
+						  const void* data, std::size_t size) {
+    if (slot >= reservations.size() or offset + size > reservations[slot].size)
+      throw std::string("[error] database_parallel_write_access::write_data: write past the end of the variable.");
+    writing = true;
+    record_written(slot, offset, size, "write_data");
+
+    const char* p(reinterpret_cast<const char*>(data));
+    std::size_t position(reservations[slot].offset + offset), remaining(size);
+    while (remaining) {
+      const ssize_t n(::pwrite(fd, p, remaining, position));
+      if (n <= 0)
+	throw "[error] database_parallel_write_access::write_data: Unable to write to " + partial_filename + ".";
+      p += n;
+      position += n;
+      remaining -= n;
+    }
+  }
+
+  void database_parallel_write_access::copy_data(unsigned int slot, std::size_t offset, int src_fd,
+						 std::size_t src_offset, std::size_t size) {
+    if (slot >= reservations.size() or offset + size > reservations[slot].size)
+      throw std::string("[error] database_parallel_write_access::copy_data: write past the end of the variable.");
+    writing = true;
+    record_written(slot, offset, size, "copy_data");
+
+    loff_t in(src_offset), out(reservations[slot].offset + offset);
+    std::size_t remaining(size);
+    while (remaining) {
+      const ssize_t n(::copy_file_range(src_fd, &in, fd, &out, remaining, 0));
+      if (n > 0) {
+	remaining -= n;
+	continue;
+      }
+      if (n < 0 and errno == EINTR)
+	continue;
+      if (n == 0 or (errno != EXDEV and errno != ENOSYS and errno != EOPNOTSUPP and errno != EINVAL))
+	throw "[error] database_parallel_write_access::copy_data: Unable to copy to " + partial_filename + ".";
+
+      /*
+       *  No kernel side copy between these files:
+       */
+      std::vector<char> buffer(std::min<std::size_t>(remaining, 1024 * 1024));
+      while (remaining) {
+	const std::size_t length(std::min(buffer.size(), remaining));
+	const ssize_t r(::pread(src_fd, buffer.data(), length, in));
+	if (r <= 0 or ::pwrite(fd, buffer.data(), r, out) != r)
+	  throw "[error] database_parallel_write_access::copy_data: Unable to copy to " + partial_filename + ".";
+	in += r;
+	out += r;
+	remaining -= r;
+      }
+    }
+  }
+
+  void database_parallel_write_access::record_written(unsigned int slot, std::size_t offset, std::size_t size,
+						      const std::string& method) {
+    if (not size)
+      return;
+    std::lock_guard<std::mutex> lock(written_mutex);
+    std::map<std::size_t, std::size_t>& written(reservations[slot].written);
+
+    /*
+     *  The ranges are disjoint and sorted by offset, so only the first one
+     *  starting after 'offset' and the one before it can overlap:
+     */
+    const auto next(written.upper_bound(offset));
+    if ((next != written.end() and next->first < offset + size)
+	or (next != written.begin() and std::prev(next)->second > offset))
+      throw "[error] database_parallel_write_access::" + method + ": bytes " + std::to_string(offset)
+	+ " to " + std::to_string(offset + size) + " of variable " + std::to_string(slot) + " are already written.";
+    written[offset] = offset + size;
+  }
+
+  void database_parallel_write_access::commit() {
+    if (fd < 0)
+      throw std::string("[error] database_parallel_write_access::commit: nothing to commit.");
+    {
+      std::lock_guard<std::mutex> lock(written_mutex);
+      for (std::size_t slot(0); slot < reservations.size(); ++slot) {
+	std::size_t written_size(0);
+	for (const auto& range: reservations[slot].written)
+	  written_size += range.second - range.first;
+	if (written_size != reservations[slot].size)
+	  throw "[error] database_parallel_write_access::commit: " + std::to_string(written_size) + " bytes of variable "
+	    + std::to_string(slot) + " written, " + std::to_string(reservations[slot].size) + " reserved.";
+      }
+    }
+
+    const int info_block[8] = {
+      static_cast<int>(last_block_offset / sizeof(double)),
+      database_write_access::fortran_io_unit,
+      used_slots_number,
+      database_write_access::length_buffer_file_offset + 1,
+      database_write_access::name_buffer_file_offset + 1,
+      database_write_access::info_block_file_offset + 1,
+      database_write_access::block_size,
+      database_write_access::max_item_number
+    };
+    std::memcpy(&header[database_write_access::info_block_file_offset * sizeof(double)],
+		info_block, sizeof(info_block));
+
+    if (::pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size())
+	or ::ftruncate(fd, std::max(last_block_offset, header.size())) != 0
+	or ::fdatasync(fd) != 0)
+      throw "[error] database_parallel_write_access::commit: Unable to write the header of " + partial_filename + ".";
+
+    ::close(fd);
+    fd = -1;
+    if (std::rename(partial_filename.c_str(), filename.c_str()) != 0)
+      throw "[error] database_parallel_write_access::commit: Unable to rename " + partial_filename + ".";
+  }
+
+  void database_parallel_write_access::abandon() {
+    if (fd < 0)
+      return;
+    ::close(fd);
+    fd = -1;
+    ::unlink(partial_filename.c_str());
   }
 
   void database_read_access::dump_database_infos(std::ostream& stream) {
@@ -116,6 +780,18 @@ namespace alucell {
      */
     stream << "Alucell database \"" << filename << "\":" << std::endl << std::endl;
 
+    if (format == dbfile_format::extended) {
+      stream << "Extended header version: " << extended_infos.version << std::endl;
+      stream << "Number of variables: " << extended_infos.variables_number << std::endl;
+      stream << "Offset of variable table: " << extended_infos.table_offset << std::endl;
+      stream << "Variable table size: " << extended_infos.table_size
+	     << " of " << extended_infos.table_capacity << " bytes" << std::endl;
+      stream << "End of data: " << extended_infos.data_end << std::endl;
+      if (base)
+	stream << "Delta of: " << base->get_filename() << std::endl;
+      return;
+    }
+
     stream << "Last used block offset: " << block_infos[0] << std::endl;
     stream << "Fortran i/o unit: " << block_infos[1] << std::endl;
     stream << "Total name slots used: " << block_infos[2] << std::endl;
@@ -124,6 +800,8 @@ namespace alucell {
     stream << "Offset of block info: " << block_infos[5] << std::endl;
     stream << "Block size in sizeof(double): " << block_infos[6] << std::endl;
     stream << "Max number of stored vectors: " << block_infos[7] << std::endl;
+    if (base)
+      stream << "Delta of: " << base->get_filename() << std::endl;
   }
   
 }
@@ -7,22 +7,139 @@
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <map>
+#include <mutex>
 
 #include "string_utils.hpp"
 #include "alucell_datatypes.hpp"
+#include "alucell_async_read.hpp"
 
 namespace alucell {
 
+  /*
+   *  Request of 'length' bytes of the data of the variable 'id', starting
+   *  'offset' bytes after the beginning of its data, to be read in 'dst'.
+   */
+  struct read_request {
+    unsigned int id;
+    std::size_t offset;
+    std::size_t length;
+    void* dst;
+  };
+
+
+  /*
+   *  Identity of a dbfile on disk: a file rewritten in place gets a new
+   *  identity as long as its size or modification time changes.
+   */
+  struct file_identity {
+    unsigned long long device, inode;
+    long long size, mtime_sec, mtime_nsec;
+
+    file_identity(): device(0), inode(0), size(0), mtime_sec(0), mtime_nsec(0) {}
+
+    bool operator<(const file_identity& f) const {
+      if (device != f.device) return device < f.device;
+      if (inode != f.inode) return inode < f.inode;
+      if (size != f.size) return size < f.size;
+      if (mtime_sec != f.mtime_sec) return mtime_sec < f.mtime_sec;
+      return mtime_nsec < f.mtime_nsec;
+    }
+
+    bool operator==(const file_identity& f) const {
+      return not (*this < f) and not (f < *this);
+    }
+  };
+
+
+  /*
+   *  Layout of the header of a dbfile. The legacy header holds fixed
+   *  tables of max_saved_vectors name slots with 32 bits lengths and
+   *  offsets in units of doubles (see database_read_access), and takes
+   *  more than 1 MB whatever the number of variables.
+   *
+   *  The extended header starts with the preamble below, whose magic
+   *  string reads as a length of about 9 GB in a legacy lengths table.
+   *  The preamble locates the table of the variables, which holds one
+   *  entry per variable, in file order: its data offset and length in
+   *  bytes, and the size of its name (type character, '_' and name),
+   *  followed by the name padded to 8 bytes. The table is first given
+   *  initial_table_capacity bytes after the preamble, and is moved after
+   *  the data with twice its capacity whenever it is full. The entries
+   *  past 'table_size' and the moved table are not seen by the readers
+   *  until the preamble is rewritten, after the data.
+   */
+  enum class dbfile_format { legacy, extended };
+
+  struct extended_header {
+    static const std::uint32_t current_version = 1;
+    static const std::size_t initial_table_capacity = 4096;
+    static const std::uint32_t deleted_flag = 1;
+
+    struct preamble {
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t reserved;
+      std::uint64_t variables_number;
+      std::uint64_t table_offset;
+      std::uint64_t table_capacity;
+      std::uint64_t table_size;
+      std::uint64_t data_end;
+      std::uint64_t reserved_end;
+    };
+
+    struct entry {
+      std::uint64_t offset;
+      std::uint64_t length;
+      std::uint32_t name_size;
+      std::uint32_t flags;
+    };
+
+    static bool has_magic(const char* header) {
+      return std::memcmp(header, "ALUCDBX", 8) == 0;
+    }
+
+    static preamble make_preamble() {
+      preamble p;
+      std::memset(&p, 0, sizeof(p));
+      std::memcpy(p.magic, "ALUCDBX", 8);
+      p.version = current_version;
+      return p;
+    }
+
+    static std::size_t get_entry_size(std::size_t name_size) {
+      return sizeof(entry) + (name_size + 7) / 8 * 8;
+    }
+  };
+
   class database_read_access {
   private:
     struct database_index_item {
       std::string name;  // Variable name
-      unsigned int length;  // variable data length
-      unsigned int offset;  // variable data offset in file
+      std::size_t length;  // variable data length
+      std::size_t offset;  // variable data offset in file
       data_type type;
 
-      database_index_item(const std::string& variable_id, unsigned int l, unsigned int o)
-	: name(), length(l), offset(o), type(data_type::unknown) {
+      /*
+       *  For a delta dbfile: id of the variable in the base dbfile if the
+       *  variable is not stored in this dbfile, or id of the variable of
+       *  the base which the variable is encoded against, -1 otherwise.
+       *  The data of an encoded variable takes 'stored_length' bytes.
+       */
+      int base_id;
+      int xor_base_id;
+      std::size_t stored_length;
+
+      database_index_item(const std::string& variable_id, std::size_t l, std::size_t o)
+	: name(), length(l), offset(o), type(data_type::unknown),
+	  base_id(-1), xor_base_id(-1), stored_length(l) {
 	if (variable_id.size() < 3)
 	  throw std::string("Invalid variable identifier");
 	
@@ -48,12 +165,40 @@ namespace alucell {
      */
     std::string filename;
     std::ifstream dbfile;
+    int fd;  // Descriptor used for the posix_fadvise hints and the asynchronous reads
     std::vector<database_index_item> index;
     std::vector<unsigned int> block_infos;
+    dbfile_format format;
+    extended_header::preamble extended_infos;  // Of an extended header only
+    file_identity identity;
+
+    /*
+     *  Delta dbfile state: the base dbfile, and the last decoded variable.
+     */
+    std::unique_ptr<database_read_access> base;
+    std::vector<char> decoded;
+    int decoded_id;
   
+    void read_identity();
+
     void read_header();
 
-    std::pair<unsigned int, unsigned int> read_array_size_infos(unsigned int offset);
+    void parse_header(const char* header);
+
+    void check_extended_preamble(const extended_header::preamble& p) const;
+
+    void parse_extended_header(const char* header, const char* table);
+
+    void open_delta_base();
+
+    void decode_variable(unsigned int id, std::vector<char>& payload) const;
+
+    const std::vector<char>& get_decoded_variable(unsigned int id);
+
+    void read_own_batch(const std::vector<read_request>& requests,
+			std::size_t max_gap, std::size_t max_extent);
+
+    std::pair<std::size_t, unsigned int> read_array_size_infos(std::size_t offset);
 
   public:
     /*
@@ -63,23 +208,126 @@ namespace alucell {
     
     database_read_access(const std::string& _filename);
 
+    ~database_read_access();
+
     void open(const std::string& _filename);
 
+    /*
+     *  Open a dbfile, and read its header through an asynchronous read
+     *  engine. The variables can be accessed once 'on_open' was called
+     *  by the engine.
+     */
+    void open_async(async_read_engine* engine, const std::string& _filename,
+		    std::function<void()> on_open);
+
     void close();
 
+    /*
+     *  Size of the header: lengths, offsets and names tables, and info block.
+     */
+    static const unsigned int max_saved_vectors = 26500;
+    static const std::size_t header_size =
+      max_saved_vectors * (2 * sizeof(unsigned int) + 4 * sizeof(double)) + 8 * sizeof(unsigned int);
+
+    /*
+     *  Format of the header of the open dbfile, and whether a file starts
+     *  with an extended header, without parsing it.
+     */
+    dbfile_format get_format() const { return format; }
+    static bool has_extended_header(const std::string& _filename);
+
     void dump_database_infos(std::ostream& stream);
 
     /*
      * Accessors for the variables properties.
      */
-    unsigned int get_variable_size(unsigned int id) const { return index[id].length; }
+    std::size_t get_variable_size(unsigned int id) const { return index[id].length; }
     data_type get_variable_type(unsigned int id) const { return index[id].type; }
     const std::string& get_variable_name(unsigned int id) const { return index[id].name; }
     void read_data_from_database(unsigned int id, void* dst) {
-      dbfile.seekg(index[id].offset, std::ios::beg);
-      dbfile.read(reinterpret_cast<char*>(dst), index[id].length);
+      read_data_from_database(id, 0, index[id].length, dst);
     }
     unsigned int get_variables_number() const { return index.size(); }
+    const std::string& get_filename() const { return filename; }
+    const file_identity& get_file_identity() const { return identity; }
+
+    /*
+     *  Read 'length' bytes of the data of the variable, starting 'offset'
+     *  bytes after the beginning of its data.
+     */
+    void read_data_from_database(unsigned int id, std::size_t offset, std::size_t length, void* dst);
+
+    /*
+     *  Same as above with pread on the descriptor of the dbfile, so
+     *  several threads can read concurrently.
+     */
+    void pread_data_from_database(unsigned int id, std::size_t offset, std::size_t length, void* dst) const;
+
+    /*
+     *  Same as above, through an asynchronous read engine: 'done' is
+     *  called by the engine once the data is in 'dst'.
+     */
+    void read_data_async(async_read_engine* engine, unsigned int id,
+			 std::size_t offset, std::size_t length, void* dst,
+			 std::function<void()> done);
+
+    /*
+     *  Number of rows and components of an array variable, read from the
+     *  two doubles at the beginning of its data.
+     */
+    std::pair<std::size_t, unsigned int> get_array_dimensions(unsigned int id);
+
+    /*
+     *  Offset of the data of the variable in the dbfile holding it.
+     */
+    std::size_t get_variable_offset(unsigned int id) const {
+      return index[id].base_id >= 0 ? base->get_variable_offset(index[id].base_id) : index[id].offset;
+    }
+
+    /*
+     *  Descriptor of the dbfile holding the data of the variable, for the
+     *  kernel side copies. The data of the encoded variables is not a
+     *  copy of their payload.
+     */
+    int get_variable_descriptor(unsigned int id) const {
+      return index[id].base_id >= 0 ? base->get_variable_descriptor(index[id].base_id) : fd;
+    }
+
+    /*
+     *  A delta dbfile (see alucell_delta.hpp) is opened with its chain of
+     *  base dbfiles: its variables are those of the base, replaced,
+     *  removed or added by the delta, and each variable is read from the
+     *  newest dbfile of the chain holding it. The encoded variables are
+     *  decoded in memory when read, the last one being kept for the next
+     *  reads.
+     */
+    bool is_delta() const { return base.get() != NULL; }
+    const database_read_access* get_base() const { return base.get(); }
+    bool is_variable_encoded(unsigned int id) const {
+      return index[id].base_id >= 0 ? base->is_variable_encoded(index[id].base_id) : index[id].xor_base_id >= 0;
+    }
+
+    /*
+     *  Batch read planner: the requests are sorted by file offset, and
+     *  the requests separated by less than 'max_gap' bytes are merged
+     *  into extents of at most 'max_extent' bytes. The kernel is told
+     *  about all the extents with posix_fadvise before they are read in
+     *  file order, and the data is copied to the destination of each
+     *  request.
+     */
+    static const std::size_t default_batch_max_gap = 64 * 1024;
+    static const std::size_t default_batch_max_extent = 16 * 1024 * 1024;
+
+    void read_batch_from_database(const std::vector<read_request>& requests,
+				  std::size_t max_gap = default_batch_max_gap,
+				  std::size_t max_extent = default_batch_max_extent);
+
+    /*
+     *  Dimensions of several array variables, read with the batch
+     *  planner, in the order of 'ids'.
+     */
+    std::vector<std::pair<std::size_t, unsigned int> >
+    get_arrays_dimensions(const std::vector<unsigned int>& ids);
   };
 
   
@@ -90,18 +338,34 @@ namespace alucell {
       offsets_buffer_offset(26500 / 2 * sizeof(double)),
       names_buffer_offset(132500 * sizeof(double)),
       last_block_offset(names_buffer_offset + 8 * sizeof(int)),
+      pending_data_size(0),
+      written_data_size(0),
       used_slots_number(0),
-      item_number(0) {};
+      item_number(0),
+      format(dbfile_format::legacy),
+      table(),
+      table_offset(0),
+      table_capacity(0),
+      deferred_infos(false),
+      outdated_infos(false) {};
 
     
-    database_write_access(const std::string& _filename):
+    database_write_access(const std::string& _filename, dbfile_format _format = dbfile_format::legacy):
       lengths_buffer_offset(0),
       offsets_buffer_offset(26500 / 2 * sizeof(double)),
       names_buffer_offset(132500 * sizeof(double)),
       last_block_offset(names_buffer_offset + 8 * sizeof(int)),
+      pending_data_size(0),
+      written_data_size(0),
       used_slots_number(0),
-      item_number(0) {
-      open(_filename);
+      item_number(0),
+      format(dbfile_format::legacy),
+      table(),
+      table_offset(0),
+      table_capacity(0),
+      deferred_infos(false),
+      outdated_infos(false) {
+      open(_filename, _format);
     };
 
     ~database_write_access() {
@@ -109,7 +373,11 @@ namespace alucell {
     }
     
 
-    void open(const std::string& _filename) {
+    /*
+     *  Create the dbfile, with a legacy header or an extended one (see
+     *  extended_header), which is written at once.
+     */
+    void open(const std::string& _filename, dbfile_format _format = dbfile_format::legacy) {
       close();
 
       dbfile.open(_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
@@ -122,11 +390,35 @@ namespace alucell {
       offsets_buffer_offset = 26500 / 2 * sizeof(double);
       names_buffer_offset = 26500 * sizeof(double);
       last_block_offset = info_block_file_offset * sizeof(double) + 8 * sizeof(int);
+      pending_data_size = 0;
+      written_data_size = 0;
       used_slots_number = 0;
       item_number = 0;
+
+      format = _format;
+      table.clear();
+      if (format == dbfile_format::extended) {
+	table_offset = sizeof(extended_header::preamble);
+	table_capacity = extended_header::initial_table_capacity;
+	last_block_offset = table_offset + table_capacity;
+	update_infos();
+      }
     }
 
+    dbfile_format get_format() const { return format; }
+
+    const std::string& get_filename() const { return filename; }
+
+    /*
+     *  Whether every write so far succeeded: the inserts do not check
+     *  the stream themselves.
+     */
+    bool good() const { return dbfile.good(); }
+
     void close() {
+      if (outdated_infos)
+	update_infos();
+      outdated_infos = false;
       dbfile.close();
       filename = "";
       
@@ -134,6 +426,16 @@ namespace alucell {
       lengths_buffer_offset = 0;
       offsets_buffer_offset = 0;
       names_buffer_offset = 0;
+      std::vector<char>().swap(table);
+    }
+
+    /*
+     *  The lengths and offsets of a legacy header being in units of
+     *  doubles, the data of each variable is padded with zeros to a
+     *  multiple of 8 bytes, which is read back as part of it.
+     */
+    static std::size_t get_padded_size(std::size_t size) {
+      return (size + sizeof(double) - 1) / sizeof(double) * sizeof(double);
     }
 
     static std::string prepend_type_char(const std::string& name, alucell::data_type t) {
@@ -143,17 +445,39 @@ namespace alucell {
       return  item_name;
     }
     
-    void insert(std::string name, const alucell::data_type t, void* const data, const int size) {
+    void insert(const std::string& name, const alucell::data_type t, const void* data, const std::size_t size) {
+      begin_insert(name, t, size);
+      write_data(data, size);
+      end_insert();
+    }
+
+    /*
+     *  Insert a variable whose data is given in several pieces: the name
+     *  and the tables entries are written by begin_insert, the data is
+     *  then appended by successive calls to write_data, and end_insert
+     *  checks that exactly 'size' bytes were written.
+     */
+    void begin_insert(std::string name, const alucell::data_type t, const std::size_t size) {
       /*
        * Prepend the type character code at the front of the name
        */
       name = prepend_type_char(name, t);
 
+      if (format == dbfile_format::extended) {
+	begin_extended_insert(name, size);
+	return;
+      }
       
       /*
        *  Resize the name to a multiple of the name slot's size
        */
       const unsigned int required_slots_number(name.size()/32 + 1);
+      if (used_slots_number + static_cast<int>(required_slots_number) > max_item_number)
+	throw "[error] database_write_access::begin_insert: no name slot left in " + filename
+	  + ", the extended format has no such limit.";
+      if ((last_block_offset + get_padded_size(size)) / sizeof(double) > INT_MAX)
+	throw "[error] database_write_access::begin_insert: " + name
+	  + " does not fit in the 32 bits tables of " + filename + ".";
       name.resize(required_slots_number * 4 * sizeof(double), ' ');
 
       if (false)
@@ -164,18 +488,18 @@ namespace alucell {
       
       /*
        *  Write the length of the variable in the length table,
-       *  in units of sizeof(double)
+       *  in units of sizeof(double), the data being padded to it
        */
-      int size_in_block(size / sizeof(double));
+      int size_in_block(get_padded_size(size) / sizeof(double));
       dbfile.seekp(lengths_buffer_offset
-		   + (required_slots_number - 1) * sizeof(size),
+		   + (required_slots_number - 1) * sizeof(size_in_block),
 		   std::ios::beg);
       dbfile.write(const_cast<char*>(reinterpret_cast<const char*>(&size_in_block)), sizeof(size_in_block));
-      lengths_buffer_offset += required_slots_number * sizeof(size);
+      lengths_buffer_offset += required_slots_number * sizeof(size_in_block);
 
       if (false)
       std::cout << "  writing the length (" << size_in_block << ") of the var at "
-		<< dbfile.tellp() - static_cast<std::ios::pos_type>(sizeof(size)) << std::endl;
+		<< dbfile.tellp() - static_cast<std::ios::pos_type>(sizeof(size_in_block)) << std::endl;
 
 
       /*
@@ -184,14 +508,14 @@ namespace alucell {
        */
       int last_block_offset_in_block(last_block_offset / sizeof(double) + 1);
       dbfile.seekp(offsets_buffer_offset
-		   + (required_slots_number - 1) * sizeof(last_block_offset),
+		   + (required_slots_number - 1) * sizeof(last_block_offset_in_block),
 		   std::ios::beg);
       dbfile.write(reinterpret_cast<char*>(&last_block_offset_in_block), sizeof(last_block_offset_in_block));
-      offsets_buffer_offset += required_slots_number * sizeof(last_block_offset);
+      offsets_buffer_offset += required_slots_number * sizeof(last_block_offset_in_block);
 
       if (false)
       std::cout << "  writing the data offset (" << last_block_offset_in_block << ") of the var at "
-		<< dbfile.tellp() - static_cast<std::ios::pos_type>(sizeof(last_block_offset)) << std::endl;
+		<< dbfile.tellp() - static_cast<std::ios::pos_type>(sizeof(last_block_offset_in_block)) << std::endl;
 
 
       /*
@@ -209,26 +533,75 @@ namespace alucell {
 
       
       /*
-       *  Write the variable's data
+       *  Position the stream at the variable's data
        */
       dbfile.seekp(last_block_offset, std::ios::beg);
-      dbfile.write(reinterpret_cast<char*>(data), size);
-      last_block_offset += size;
+      pending_data_size = size;
+      written_data_size = 0;
+    }
+
+    void write_data(const void* data, const std::size_t size) {
+      if (written_data_size + size > pending_data_size)
+	throw std::string("[error] database_write_access::write_data: too much data written.");
+
+      dbfile.write(reinterpret_cast<const char*>(data), size);
+      written_data_size += size;
+    }
+
+    void end_insert() {
+      if (written_data_size != pending_data_size)
+	throw std::string("[error] database_write_access::end_insert: incomplete variable data.");
 
       if (false)
       std::cout << "  writing the data of the var at "
-		<< dbfile.tellp() - static_cast<std::ios::pos_type>(size)
+		<< dbfile.tellp() - static_cast<std::ios::pos_type>(pending_data_size)
 		<< std::endl;
 
-      
+      if (format == dbfile_format::legacy) {
+	const std::vector<char> padding(get_padded_size(pending_data_size) - pending_data_size, 0);
+	dbfile.write(padding.data(), padding.size());
+	last_block_offset += padding.size();
+      }
+      last_block_offset += pending_data_size;
+      pending_data_size = 0;
+      written_data_size = 0;
       
       item_number += 1;
-      update_infos();
+      if (deferred_infos)
+	outdated_infos = true;
+      else
+	update_infos();
     }
 
+    /*
+     *  With deferred infos, the info block is not rewritten after each
+     *  insert, but only by flush, sync and close: a reader opening the
+     *  dbfile in between sees the variables of the last flush only.
+     */
+    void defer_infos(bool deferred) { deferred_infos = deferred; }
+
+    /*
+     *  Write the info block if it is outdated, and hand the buffered
+     *  data to the system. sync also waits for the data to reach the
+     *  disk.
+     */
+    void flush() {
+      if (outdated_infos)
+	update_infos();
+      outdated_infos = false;
+      dbfile.flush();
+    }
+
+    void sync();
+
     void update_infos() {
+      if (format == dbfile_format::extended) {
+	update_extended_infos();
+	return;
+      }
+
       std::vector<int> info_block = {
-	last_block_offset / static_cast<int>(sizeof(double)),
+	static_cast<int>(last_block_offset / sizeof(double)),
 	fortran_io_unit,
 	used_slots_number,
 	length_buffer_file_offset + 1,
@@ -248,10 +621,55 @@ namespace alucell {
 		<< std::endl;
     }
 
+    friend class database_parallel_write_access;
+
   private:
     std::string filename;
     std::ofstream dbfile;
 
+    /*
+     *  Entry of the variable in the table of an extended header, the
+     *  table being moved after the data if it is full.
+     */
+    void begin_extended_insert(const std::string& name, const std::size_t size) {
+      const std::size_t entry_size(extended_header::get_entry_size(name.size()));
+      if (table.size() + entry_size > table_capacity) {
+	table_capacity = std::max(2 * table_capacity, table.size() + entry_size);
+	table_offset = last_block_offset;
+	last_block_offset += table_capacity;
+	dbfile.seekp(table_offset, std::ios::beg);
+	dbfile.write(table.data(), table.size());
+      }
+
+      extended_header::entry e;
+      e.offset = last_block_offset;
+      e.length = size;
+      e.name_size = name.size();
+      e.flags = 0;
+      const std::size_t position(table.size());
+      table.resize(position + entry_size, 0);
+      std::memcpy(&table[position], &e, sizeof(e));
+      std::memcpy(&table[position + sizeof(e)], name.data(), name.size());
+      dbfile.seekp(table_offset + position, std::ios::beg);
+      dbfile.write(&table[position], entry_size);
+
+      dbfile.seekp(last_block_offset, std::ios::beg);
+      pending_data_size = size;
+      written_data_size = 0;
+    }
+
+    void update_extended_infos() {
+      extended_header::preamble p(extended_header::make_preamble());
+      p.variables_number = item_number;
+      p.table_offset = table_offset;
+      p.table_capacity = table_capacity;
+      p.table_size = table.size();
+      p.data_end = last_block_offset;
+
+      dbfile.seekp(0, std::ios::beg);
+      dbfile.write(reinterpret_cast<const char*>(&p), sizeof(p));
+    }
+
     static const int offset_buffer_file_offset = 26500 / 2;
     
     static const int fortran_io_unit = 3;
@@ -264,12 +682,123 @@ namespace alucell {
     int lengths_buffer_offset;
     int offsets_buffer_offset;
     int names_buffer_offset;
-    int last_block_offset;
+    std::size_t last_block_offset;
+    std::size_t pending_data_size;
+    std::size_t written_data_size;
 
     int used_slots_number;
     int item_number;
+
+    dbfile_format format;
+    std::vector<char> table;  // Of an extended header
+    std::size_t table_offset;
+    std::size_t table_capacity;
+
+    bool deferred_infos;
+    bool outdated_infos;
   };
-  
+
+
+  /*
+   *  Writer filling the payloads of the variables from several threads.
+   *
+   *  The variables are first reserved in order with their final size:
+   *  their name slots, lengths and data offsets are laid out exactly as
+   *  database_write_access would, in a copy of the header kept in memory.
+   *  The payloads can then be written concurrently and in any order with
+   *  write_data, which uses pwrite. The ranges written in each variable
+   *  are recorded: a write overlapping an earlier one is refused, and
+   *  commit checks that every reserved byte was written once, writes the header tables and info block with a
+   *  single pwrite, syncs the file, and renames it from
+   *  '<filename>.partial' to its name, so that readers never see a dbfile
+   *  with a header and missing data. The result is byte for byte the
+   *  dbfile the sequential writer produces with the same inserts, the
+   *  padding of the payloads to 8 bytes being left as zeros.
+   *
+   *  A writer destroyed without commit removes its partial file.
+   */
+  class database_parallel_write_access {
+  public:
+    explicit database_parallel_write_access(const std::string& _filename);
+    ~database_parallel_write_access();
+
+    database_parallel_write_access(const database_parallel_write_access&) = delete;
+    database_parallel_write_access& operator=(const database_parallel_write_access&) = delete;
+
+    /*
+     *  Reserve a variable of 'size' bytes, and return its slot. Not
+     *  thread safe, and not allowed once the payloads are being written.
+     */
+    unsigned int reserve(const std::string& name, alucell::data_type t, std::size_t size);
+
+    unsigned int get_variables_number() const { return reservations.size(); }
+    std::size_t get_variable_size(unsigned int slot) const { return reservations[slot].size; }
+
+    /*
+     *  Write 'size' bytes of the payload of the reserved variable
+     *  'slot', starting 'offset' bytes after the beginning of its data.
+     *  Thread safe.
+     */
+    void write_data(unsigned int slot, std::size_t offset, const void* data, std::size_t size);
+
+    void insert(unsigned int slot, const void* data) {
+      write_data(slot, 0, data, reservations[slot].size);
+    }
+
+    /*
+     *  Copy 'size' bytes of the file 'src_fd', from 'src_offset', into
+     *  the payload of 'slot' starting 'offset' bytes after its beginning.
+     *  The data is copied by the kernel with copy_file_range, or read and
+     *  written when the files are on different file systems or the kernel
+     *  does not support it. Thread safe.
+     */
+    void copy_data(unsigned int slot, std::size_t offset, int src_fd, std::size_t src_offset, std::size_t size);
+
+    /*
+     *  Name slots taken by a variable, out of the max_slots of a dbfile,
+     *  so that a layout can be checked before it is reserved.
+     */
+    static const unsigned int max_slots = database_read_access::max_saved_vectors;
+    static unsigned int get_required_slots(const std::string& name, alucell::data_type t) {
+      return database_write_access::prepend_type_char(name, t).size() / 32 + 1;
+    }
+    unsigned int get_used_slots() const { return used_slots_number; }
+
+    void commit();
+
+    void abandon();
+
+  private:
+    struct reservation {
+      std::size_t offset, size;
+      std::map<std::size_t, std::size_t> written;
+    };
+
+    /*
+     *  Record the range [offset, offset + size) of 'slot' as written, or
+     *  throw if it overlaps a range already written.
+     */
+    void record_written(unsigned int slot, std::size_t offset, std::size_t size, const std::string& method);
+
+    std::string filename;
+    std::string partial_filename;
+    int fd;
+    std::vector<char> header;
+    std::vector<reservation> reservations;
+
+    /*
+     *  Table cursors, as in database_write_access:
+     */
+    std::size_t lengths_buffer_offset;
+    std::size_t offsets_buffer_offset;
+    std::size_t names_buffer_offset;
+    std::size_t last_block_offset;
+    int used_slots_number;
+
+    std::mutex written_mutex;
+    std::atomic<bool> writing;
+  };
+
 }
 
 #endif
@@ -2,10 +2,14 @@
 #define _ALUCELL_LEGACY_VARIABLE_H_
 
 #include <map>
+#include <vector>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
 
 #include "string_utils.hpp"
+#include "alucell_sparse.hpp"
+#include "alucell_dense_matrix.hpp"
 
 namespace alucell {
 
@@ -30,6 +34,17 @@ namespace alucell {
 	db->read_data_from_database(id, reinterpret_cast<double*>(&buffer[0]));
 	string_length = static_cast<std::size_t>(*reinterpret_cast<double*>(&buffer[0]));
       }
+
+      explicit string(const std::vector<char>& payload):
+	buffer(payload),
+	string_length(0) {
+	if (buffer.size() < 2 * sizeof(double))
+	  throw std::string("string: payload too short.");
+	const double length(*reinterpret_cast<const double*>(&buffer[0]));
+	if (not (length >= 0. and length <= buffer.size() - 2 * sizeof(double)))
+	  throw std::string("string: inconsistent string length.");
+	string_length = static_cast<std::size_t>(length);
+      }
       
       std::string get_value() const {
 	return std::string(buffer.begin() + 2 * sizeof(double),
@@ -59,6 +74,12 @@ namespace alucell {
       number(database_read_access* db, unsigned int id) {
 	db->read_data_from_database(id, &value);
       }
+
+      explicit number(const std::vector<char>& payload) {
+	if (payload.size() < sizeof(value))
+	  throw std::string("number: payload too short.");
+	std::memcpy(&value, &payload[0], sizeof(value));
+      }
       
       double get_value() const { return value; }
 
@@ -92,6 +113,23 @@ namespace alucell {
 	components = *reinterpret_cast<double*>(buffer + sizeof(double));
       }
 
+      explicit array(const std::vector<char>& payload) {
+	if (payload.size() < 2 * sizeof(double))
+	  throw std::string("array: payload too short.");
+	const double* dimensions(reinterpret_cast<const double*>(&payload[0]));
+	if (not (dimensions[0] >= 0. and dimensions[1] >= 0.)
+	    or dimensions[0] * dimensions[1] * sizeof(T) > payload.size() - 2 * sizeof(double))
+	  throw std::string("array: inconsistent array dimensions.");
+
+	buffer_length = payload.size();
+	buffer = new unsigned char[buffer_length];
+	std::copy(payload.begin(), payload.end(), buffer);
+
+	values = reinterpret_cast<T*>(buffer + 2 * sizeof(double));
+	size = *reinterpret_cast<double*>(buffer);
+	components = *reinterpret_cast<double*>(buffer + sizeof(double));
+      }
+
       virtual ~array() { delete [] buffer; buffer = NULL; }
       
       unsigned int get_size() const { return size; }
@@ -99,6 +137,7 @@ namespace alucell {
       T get_value(unsigned int i, unsigned int j) const {
 	return values[i * components + j];
       }
+      const T* get_values() const { return values; }
 
       unsigned int get_length() { return size * components * sizeof(T); }
       void get_data(void* dst) {
@@ -117,9 +156,175 @@ namespace alucell {
       T* values;
     };
 
+
+
+    /*
+     *  Sequential access to the rows of an array variable, in windows
+     *  of at most 'buffer_size' bytes. Only the current window is held
+     *  in memory. The number of rows of a window is a multiple of
+     *  'row_alignment' (except for the last window), as long as one
+     *  aligned window fits in the buffer.
+     *
+     *  An array_stream can also be built on the payload of an array
+     *  already in memory, in which case all the rows are given in a
+     *  single window.
+     */
+    const std::size_t default_stream_buffer_size = 64 * 1024 * 1024;
+
+    template<typename T>
+    class array_stream {
+    public:
+      array_stream(database_read_access* _db, unsigned int _id,
+		   std::size_t buffer_size = default_stream_buffer_size,
+		   std::size_t row_alignment = 1)
+	: db(_db), id(_id), size(0), components(0),
+	  window_capacity(0), window_first_row(0), window_rows(0), buffer() {
+	const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+	size = dimensions.first;
+	components = dimensions.second;
+
+	if (2 * sizeof(double) + size * components * sizeof(T) > db->get_variable_size(id))
+	  throw std::string("array_stream: inconsistent array dimensions.");
+
+	const std::size_t row_bytes(std::max<std::size_t>(1, components * sizeof(T)));
+	window_capacity = std::max<std::size_t>(1, buffer_size / row_bytes);
+	if (window_capacity >= row_alignment)
+	  window_capacity -= window_capacity % row_alignment;
+	window_capacity = std::min(window_capacity, std::max<std::size_t>(1, size));
+	buffer.resize(window_capacity * components);
+      }
+
+      explicit array_stream(const std::vector<char>& payload)
+	: db(NULL), id(0), size(0), components(0),
+	  window_capacity(0), window_first_row(0), window_rows(0), buffer() {
+	if (payload.size() < 2 * sizeof(double))
+	  throw std::string("array_stream: payload too short.");
+
+	size = *reinterpret_cast<const double*>(&payload[0]);
+	components = *reinterpret_cast<const double*>(&payload[sizeof(double)]);
+	if (2 * sizeof(double) + size * components * sizeof(T) > payload.size())
+	  throw std::string("array_stream: inconsistent array dimensions.");
+
+	window_capacity = std::max<std::size_t>(1, size);
+	buffer.resize(size * components);
+	std::memcpy(buffer.data(), &payload[2 * sizeof(double)], buffer.size() * sizeof(T));
+      }
+
+      std::size_t get_size() const { return size; }
+      unsigned int get_components() const { return components; }
+
+      /*
+       *  Load the next window, return false when all the rows were read.
+       */
+      bool next() {
+	window_first_row += window_rows;
+	if (window_first_row >= size) {
+	  window_rows = 0;
+	  return false;
+	}
+
+	window_rows = std::min(window_capacity, size - window_first_row);
+	if (db == NULL)
+	  return true;
+
+	db->read_data_from_database(id,
+				    2 * sizeof(double) + window_first_row * components * sizeof(T),
+				    window_rows * components * sizeof(T),
+				    buffer.data());
+	return true;
+      }
+
+      std::size_t get_window_first_row() const { return window_first_row; }
+      std::size_t get_window_rows() const { return window_rows; }
+      const T* get_values() const { return buffer.data(); }
+
+      /*
+       *  Value of the component j of the row i of the current window.
+       */
+      T get_value(std::size_t i, unsigned int j) const {
+	return buffer[i * components + j];
+      }
+
+    private:
+      database_read_access* db;
+      unsigned int id;
+      std::size_t size;
+      unsigned int components;
+      std::size_t window_capacity, window_first_row, window_rows;
+      std::vector<T> buffer;
+    };
+
     
-    class matrix: public basic_variable {};
-    class sky_matrix: public basic_variable {};
+    /*
+     *  Full matrix, see matrix_view for the layout of the payload. The
+     *  payload is read once, and viewed in place.
+     */
+    class matrix: public basic_variable {
+    public:
+      matrix(database_read_access* db, unsigned int id):
+	buffer((db->get_variable_size(id) + sizeof(double) - 1) / sizeof(double)), view() {
+	db->read_data_from_database(id, buffer.data());
+	view = matrix_view(reinterpret_cast<const char*>(buffer.data()), db->get_variable_size(id));
+      }
+
+      explicit matrix(const std::vector<char>& payload):
+	buffer((payload.size() + sizeof(double) - 1) / sizeof(double)), view() {
+	std::memcpy(buffer.data(), payload.data(), payload.size());
+	view = matrix_view(reinterpret_cast<const char*>(buffer.data()), payload.size());
+      }
+
+      matrix(const matrix&) = delete;
+      matrix& operator=(const matrix&) = delete;
+
+      const matrix_view& get_view() const { return view; }
+
+      unsigned int get_length() { return buffer.size() * sizeof(double); }
+      void get_data(void* dst) { std::memcpy(dst, buffer.data(), get_length()); }
+
+      void insert_into(database_write_access* db, const std::string& name) {
+	db->insert(name, alucell::data_type::matrix, buffer.data(), get_length());
+      }
+
+    private:
+      std::vector<double> buffer;  // Holds the payload, aligned for the view
+      matrix_view view;
+    };
+
+
+    /*
+     *  Skyline matrix, see sky_matrix_view for the layout of the payload.
+     *  The payload is read once, and decoded in place by the view.
+     */
+    class sky_matrix: public basic_variable {
+    public:
+      sky_matrix(database_read_access* db, unsigned int id):
+	buffer((db->get_variable_size(id) + sizeof(double) - 1) / sizeof(double)), view() {
+	db->read_data_from_database(id, buffer.data());
+	view = sky_matrix_view(reinterpret_cast<const char*>(buffer.data()), db->get_variable_size(id));
+      }
+
+      explicit sky_matrix(const std::vector<char>& payload):
+	buffer((payload.size() + sizeof(double) - 1) / sizeof(double)), view() {
+	std::memcpy(buffer.data(), payload.data(), payload.size());
+	view = sky_matrix_view(reinterpret_cast<const char*>(buffer.data()), payload.size());
+      }
+
+      sky_matrix(const sky_matrix&) = delete;
+      sky_matrix& operator=(const sky_matrix&) = delete;
+
+      const sky_matrix_view& get_view() const { return view; }
+
+      unsigned int get_length() { return buffer.size() * sizeof(double); }
+      void get_data(void* dst) { std::memcpy(dst, buffer.data(), get_length()); }
+
+      void insert_into(database_write_access* db, const std::string& name) {
+	db->insert(name, alucell::data_type::sky_matrix, buffer.data(), get_length());
+      }
+
+    private:
+      std::vector<double> buffer;  // Holds the payload, aligned for the view
+      sky_matrix_view view;
+    };
 
     
     class expression: public basic_variable {
@@ -129,6 +334,9 @@ namespace alucell {
 	db->read_data_from_database(id, &buffer[0]);
       }
 
+      explicit expression(const std::vector<char>& payload):
+	buffer(payload.begin(), payload.end()) {}
+
       unsigned int get_length() { return buffer.size(); }
       void get_data(void* dst) { std::memcpy(dst, &buffer[0], get_length()); }
 
@@ -409,7 +617,7 @@ namespace alucell {
     }
   };
 
-  stack_machine::stack_machine()
+  inline stack_machine::stack_machine()
     : builtins(),
       call_stack(), instruction_pointers(),
       argument_stack(), computation_stack(), 
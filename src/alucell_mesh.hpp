@@ -0,0 +1,251 @@
+#ifndef _ALUCELL_MESH_H_
+#define _ALUCELL_MESH_H_
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_mesh_catalog.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  /*
+   *  Mesh loaded from the <mesh>_nodes, <mesh>_elems and <mesh>_refs
+   *  arrays of a dbfile.
+   *
+   *  The node indices of the elements are stored 1-based in the dbfile,
+   *  and 0-based here; the non positive indices mark unused vertices and
+   *  are stored as 'no_node'. The node to element adjacency is built
+   *  once, in compressed sparse row layout: the elements around the node
+   *  n are node_elements[node_elements_offsets[n]] to
+   *  node_elements[node_elements_offsets[n + 1] - 1], in increasing
+   *  order, each element appearing once even if it repeats the node.
+   */
+  class mesh {
+  public:
+    static const unsigned int no_node = -1;
+
+    mesh(database_read_access* db, const mesh_description& description)
+      : name(description.name), dimension(0), nodes_per_element(0),
+	nodes(), elements(), references(), node_elements_offsets(), node_elements() {
+      load(db, description);
+      build_node_elements();
+    }
+
+    mesh(database_read_access* db, const std::string& _name)
+      : name(_name), dimension(0), nodes_per_element(0),
+	nodes(), elements(), references(), node_elements_offsets(), node_elements() {
+      std::set<std::string> names;
+      names.insert(name);
+      const mesh_catalog catalog(db, names);
+      load(db, catalog.get_mesh(name));
+      build_node_elements();
+    }
+
+    const std::string& get_name() const { return name; }
+    std::size_t get_nodes_number() const { return dimension ? nodes.size() / dimension : 0; }
+    std::size_t get_elements_number() const { return references.size(); }
+    unsigned int get_dimension() const { return dimension; }
+    unsigned int get_nodes_per_element() const { return nodes_per_element; }
+
+    const double* get_node(std::size_t n) const { return &nodes[n * dimension]; }
+    const unsigned int* get_element(std::size_t e) const { return &elements[e * nodes_per_element]; }
+    int get_reference(std::size_t e) const { return references[e]; }
+
+    const std::vector<std::size_t>& get_node_elements_offsets() const { return node_elements_offsets; }
+    const std::vector<unsigned int>& get_node_elements() const { return node_elements; }
+
+    /*
+     *  Copy of the mesh with renumbered nodes and elements: the node n of
+     *  the copy is the node node_order[n] of this mesh, and the element e
+     *  of the copy is the element element_order[e].
+     */
+    mesh permuted(const std::vector<unsigned int>& node_order,
+		  const std::vector<unsigned int>& element_order) const {
+      if (node_order.size() != get_nodes_number() or element_order.size() != get_elements_number())
+	throw std::string("mesh: the permutations do not match the mesh sizes.");
+
+      std::vector<unsigned int> new_node(node_order.size());
+      for (std::size_t n(0); n < node_order.size(); ++n)
+	new_node[node_order[n]] = n;
+
+      mesh m;
+      m.name = name;
+      m.dimension = dimension;
+      m.nodes_per_element = nodes_per_element;
+
+      m.nodes.resize(nodes.size());
+      for (std::size_t n(0); n < node_order.size(); ++n)
+	std::copy(get_node(node_order[n]), get_node(node_order[n]) + dimension, &m.nodes[n * dimension]);
+
+      m.elements.resize(elements.size());
+      m.references.resize(references.size());
+      for (std::size_t e(0); e < element_order.size(); ++e) {
+	const unsigned int* element(get_element(element_order[e]));
+	for (unsigned int k(0); k < nodes_per_element; ++k)
+	  m.elements[e * nodes_per_element + k] = element[k] == no_node ? no_node : new_node[element[k]];
+	m.references[e] = references[element_order[e]];
+      }
+
+      m.build_node_elements();
+      return m;
+    }
+
+    /*
+     *  Average the values of an elemental field on the nodes: each node
+     *  gets the mean of the values of the elements around it, or 0 if it
+     *  belongs to no element. The nodes are split between the threads,
+     *  and each one gathers its values from the adjacency.
+     */
+    template<typename T>
+    void elements_to_nodes(const T* values, unsigned int components, double* result,
+			   unsigned int threads = default_threads_number()) const {
+      parallel_for(0, get_nodes_number(), threads,
+		   [&](unsigned int, std::size_t b, std::size_t e) {
+		     for (std::size_t n(b); n < e; ++n) {
+		       double* r(result + n * components);
+		       std::fill(r, r + components, 0.);
+
+		       const std::size_t first(node_elements_offsets[n]), last(node_elements_offsets[n + 1]);
+		       for (std::size_t k(first); k < last; ++k) {
+			 const T* v(values + static_cast<std::size_t>(node_elements[k]) * components);
+			 for (unsigned int c(0); c < components; ++c)
+			   r[c] += v[c];
+		       }
+
+		       if (last > first)
+			 for (unsigned int c(0); c < components; ++c)
+			   r[c] /= last - first;
+		     }
+		   });
+    }
+
+    /*
+     *  Average the values of a nodal field on the elements: each element
+     *  gets the mean of the values of its distinct nodes.
+     */
+    template<typename T>
+    void nodes_to_elements(const T* values, unsigned int components, double* result,
+			   unsigned int threads = default_threads_number()) const {
+      parallel_for(0, get_elements_number(), threads,
+		   [&](unsigned int, std::size_t b, std::size_t e) {
+		     for (std::size_t i(b); i < e; ++i) {
+		       double* r(result + i * components);
+		       std::fill(r, r + components, 0.);
+
+		       const unsigned int* element(get_element(i));
+		       unsigned int count(0);
+		       for (unsigned int k(0); k < nodes_per_element; ++k) {
+			 if (not is_first_occurrence(element, k))
+			   continue;
+			 const T* v(values + static_cast<std::size_t>(element[k]) * components);
+			 for (unsigned int c(0); c < components; ++c)
+			   r[c] += v[c];
+			 ++count;
+		       }
+
+		       if (count)
+			 for (unsigned int c(0); c < components; ++c)
+			   r[c] /= count;
+		     }
+		   });
+    }
+
+  private:
+    mesh(): name(), dimension(0), nodes_per_element(0),
+	    nodes(), elements(), references(), node_elements_offsets(), node_elements() {}
+
+    std::string name;
+    unsigned int dimension, nodes_per_element;
+    std::vector<double> nodes;
+    std::vector<unsigned int> elements;
+    std::vector<int> references;
+
+    std::vector<std::size_t> node_elements_offsets;
+    std::vector<unsigned int> node_elements;
+
+    /*
+     *  Whether the k-th vertex of the element is a node, which does not
+     *  appear in the previous vertices.
+     */
+    bool is_first_occurrence(const unsigned int* element, unsigned int k) const {
+      return element[k] != no_node and std::find(element, element + k, element[k]) == element + k;
+    }
+
+    void load(database_read_access* db, const mesh_description& description) {
+      std::vector<unsigned int> ids;
+      ids.push_back(description.nodes_id);
+      ids.push_back(description.elems_id);
+      ids.push_back(description.refs_id);
+      const std::vector<std::pair<std::size_t, unsigned int> > dimensions(db->get_arrays_dimensions(ids));
+
+      const std::size_t nodes_number(dimensions[0].first), elements_number(dimensions[1].first);
+      dimension = dimensions[0].second;
+      nodes_per_element = dimensions[1].second;
+      if (dimensions[2].first != elements_number)
+	throw "mesh: " + name + "_refs and " + name + "_elems have different sizes.";
+
+      nodes.resize(nodes_number * dimension);
+      std::vector<int> raw_elements(elements_number * nodes_per_element);
+      references.resize(elements_number * dimensions[2].second);
+
+      const std::size_t header(2 * sizeof(double));
+      const std::size_t lengths[3] = {
+	nodes.size() * sizeof(double),
+	raw_elements.size() * sizeof(int),
+	references.size() * sizeof(int)
+      };
+      void* destinations[3] = { nodes.data(), raw_elements.data(), references.data() };
+
+      std::vector<read_request> requests;
+      for (unsigned int k(0); k < 3; ++k) {
+	if (header + lengths[k] > db->get_variable_size(ids[k]))
+	  throw "mesh: inconsistent array dimensions for " + db->get_variable_name(ids[k]) + ".";
+	const read_request r = { ids[k], header, lengths[k], destinations[k] };
+	requests.push_back(r);
+      }
+      db->read_batch_from_database(requests);
+
+      if (dimensions[2].second != 1) {
+	// Keep the first component of the references only:
+	for (std::size_t e(0); e < elements_number; ++e)
+	  references[e] = references[e * dimensions[2].second];
+	references.resize(elements_number);
+      }
+
+      elements.resize(raw_elements.size());
+      for (std::size_t i(0); i < raw_elements.size(); ++i) {
+	if (raw_elements[i] > static_cast<long long>(nodes_number))
+	  throw "mesh: " + name + "_elems refers to node " + std::to_string(raw_elements[i])
+	    + " of " + std::to_string(nodes_number) + ".";
+	elements[i] = raw_elements[i] > 0 ? raw_elements[i] - 1 : no_node;
+      }
+    }
+
+    void build_node_elements() {
+      const std::size_t nodes_number(get_nodes_number()), elements_number(get_elements_number());
+
+      node_elements_offsets.assign(nodes_number + 1, 0);
+      for (std::size_t e(0); e < elements_number; ++e)
+	for (unsigned int k(0); k < nodes_per_element; ++k)
+	  if (is_first_occurrence(get_element(e), k))
+	    ++node_elements_offsets[get_element(e)[k] + 1];
+
+      for (std::size_t n(0); n < nodes_number; ++n)
+	node_elements_offsets[n + 1] += node_elements_offsets[n];
+
+      node_elements.resize(node_elements_offsets[nodes_number]);
+      std::vector<std::size_t> cursors(node_elements_offsets.begin(), node_elements_offsets.end() - 1);
+      for (std::size_t e(0); e < elements_number; ++e)
+	for (unsigned int k(0); k < nodes_per_element; ++k)
+	  if (is_first_occurrence(get_element(e), k))
+	    node_elements[cursors[get_element(e)[k]]++] = e;
+    }
+  };
+
+}
+
+#endif /* _ALUCELL_MESH_H_ */
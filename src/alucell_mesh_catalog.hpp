@@ -0,0 +1,264 @@
+#ifndef _ALUCELL_MESH_CATALOG_H_
+#define _ALUCELL_MESH_CATALOG_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+
+namespace alucell {
+
+  /*
+   *  Variable attached to a mesh: a real array with as many rows as the
+   *  mesh has nodes (nodal) or elements (elemental), or a real number
+   *  (scalar). The name is the variable name without the mesh prefix.
+   *  When the mesh has as many nodes as elements, an array of that many
+   *  rows is nodal, and 'also_elemental' tells it may be elemental too.
+   *  The integer arrays are only classified on request, and 'integer'
+   *  tells them apart.
+   */
+  struct mesh_variable {
+    enum kind_type { nodal, elemental, scalar };
+
+    unsigned int id;
+    std::string name;
+    kind_type kind;
+    bool also_elemental;
+    bool integer;
+    std::size_t rows;
+    unsigned int components;
+  };
+
+  struct mesh_description {
+    std::string name;
+    unsigned int nodes_id, elems_id, refs_id;
+    std::size_t nodes_number, elements_number;
+    std::vector<mesh_variable> variables;  // In variable id order
+  };
+
+
+  /*
+   *  Meshes of a dbfile, and the variables attached to them.
+   *
+   *  A mesh M is made of the real array M_nodes, the integer or element
+   *  array M_elems and the integer array M_refs, and its variables are
+   *  the variables named M_*, except the *_nodes and *_refs ones.
+   *
+   *  The variable names are split once on the '_' boundaries into a
+   *  trie, so the meshes are the nodes of the trie holding the three
+   *  mesh arrays, and the variables of a mesh are the variables of its
+   *  subtrie. The dimensions of the arrays involved are read in a single
+   *  batch. If 'mesh_names' is not empty, only these meshes are kept.
+   *  If 'integer_arrays', the integer and element arrays, except the
+   *  *_elems ones, are classified as the real arrays.
+   */
+  class mesh_catalog {
+  public:
+    explicit mesh_catalog(database_read_access* db,
+			  const std::set<std::string>& mesh_names = std::set<std::string>(),
+			  bool integer_arrays = false)
+      : meshes(), by_name() {
+      build_trie(db);
+
+      /*
+       *  Find the trie nodes holding valid meshes, and read the
+       *  dimensions of their arrays:
+       */
+      std::vector<std::pair<unsigned int, std::string> > mesh_nodes;
+      std::vector<unsigned int> array_ids;
+      for (const auto& candidate: candidates) {
+	const mesh_arrays& m(candidate.second);
+	if (m.nodes_id == none or m.elems_id == none or m.refs_id == none)
+	  continue;
+	if (db->get_variable_type(m.nodes_id) != data_type::real_array
+	    or (db->get_variable_type(m.elems_id) != data_type::int_array
+		and db->get_variable_type(m.elems_id) != data_type::element_array)
+	    or db->get_variable_type(m.refs_id) != data_type::int_array)
+	  continue;
+
+	const std::string& nodes_name(db->get_variable_name(m.nodes_id));
+	const std::string name(nodes_name.substr(0, nodes_name.size() - 6));
+	if (mesh_names.size() and not mesh_names.count(name))
+	  continue;
+
+	mesh_nodes.push_back(std::make_pair(candidate.first, name));
+	array_ids.push_back(m.nodes_id);
+	array_ids.push_back(m.elems_id);
+	collect_subtrie(candidate.first, db, true, integer_arrays, array_ids);
+      }
+
+      std::sort(array_ids.begin(), array_ids.end());
+      array_ids.erase(std::unique(array_ids.begin(), array_ids.end()), array_ids.end());
+      const std::vector<std::pair<std::size_t, unsigned int> > dimensions(db->get_arrays_dimensions(array_ids));
+      std::map<unsigned int, std::pair<std::size_t, unsigned int> > array_dimensions;
+      for (std::size_t k(0); k < array_ids.size(); ++k)
+	array_dimensions[array_ids[k]] = dimensions[k];
+
+      /*
+       *  Classify the variables of each mesh:
+       */
+      std::sort(mesh_nodes.begin(), mesh_nodes.end(),
+		[](const std::pair<unsigned int, std::string>& a,
+		   const std::pair<unsigned int, std::string>& b) { return a.second < b.second; });
+      for (const auto& mesh_node: mesh_nodes) {
+	const mesh_arrays& m(candidates[mesh_node.first]);
+	mesh_description mesh;
+	mesh.name = mesh_node.second;
+	mesh.nodes_id = m.nodes_id;
+	mesh.elems_id = m.elems_id;
+	mesh.refs_id = m.refs_id;
+	mesh.nodes_number = array_dimensions[m.nodes_id].first;
+	mesh.elements_number = array_dimensions[m.elems_id].first;
+
+	std::vector<unsigned int> ids;
+	collect_subtrie(mesh_node.first, db, false, integer_arrays, ids);
+	std::sort(ids.begin(), ids.end());
+
+	for (const auto id: ids) {
+	  mesh_variable v;
+	  v.id = id;
+	  v.name = db->get_variable_name(id).substr(mesh.name.size() + 1);
+	  v.also_elemental = false;
+	  v.integer = db->get_variable_type(id) != data_type::real_array
+	    and db->get_variable_type(id) != data_type::real_number;
+
+	  if (db->get_variable_type(id) == data_type::real_number) {
+	    v.kind = mesh_variable::scalar;
+	    v.rows = 1;
+	    v.components = 1;
+	  } else {
+	    v.rows = array_dimensions[id].first;
+	    v.components = array_dimensions[id].second;
+	    if (v.rows == mesh.nodes_number) {
+	      v.kind = mesh_variable::nodal;
+	      v.also_elemental = v.rows == mesh.elements_number;
+	    }
+	    else if (v.rows == mesh.elements_number)
+	      v.kind = mesh_variable::elemental;
+	    else
+	      continue;
+	  }
+	  mesh.variables.push_back(v);
+	}
+
+	by_name[mesh.name] = meshes.size();
+	meshes.push_back(mesh);
+      }
+
+      trie.clear();
+      candidates.clear();
+    }
+
+    /*
+     *  Meshes sorted by name.
+     */
+    const std::vector<mesh_description>& get_meshes() const { return meshes; }
+
+    bool exists(const std::string& name) const { return by_name.count(name); }
+
+    const mesh_description& get_mesh(const std::string& name) const {
+      const auto it(by_name.find(name));
+      if (it == by_name.end())
+	throw "mesh_catalog: mesh " + name + " not found.";
+      return meshes[it->second];
+    }
+
+  private:
+    static const unsigned int none = -1;
+
+    struct trie_node {
+      std::map<std::string, unsigned int> children;
+      std::vector<unsigned int> ids;  // Variables whose name ends here
+    };
+
+    struct mesh_arrays {
+      unsigned int nodes_id, elems_id, refs_id;
+      mesh_arrays(): nodes_id(none), elems_id(none), refs_id(none) {}
+    };
+
+    std::vector<trie_node> trie;
+    std::map<unsigned int, mesh_arrays> candidates;  // By trie node
+
+    std::vector<mesh_description> meshes;
+    std::map<std::string, std::size_t> by_name;
+
+    void build_trie(database_read_access* db) {
+      trie.assign(1, trie_node());
+      for (unsigned int id(0); id < db->get_variables_number(); ++id) {
+	const std::string& name(db->get_variable_name(id));
+
+	unsigned int node(0), parent(0);
+	std::size_t begin(0), end(0);
+	do {
+	  end = name.find('_', begin);
+	  const std::string token(name, begin, end == std::string::npos ? std::string::npos : end - begin);
+
+	  auto it(trie[node].children.find(token));
+	  if (it == trie[node].children.end()) {
+	    it = trie[node].children.insert(std::make_pair(token, trie.size())).first;
+	    trie.push_back(trie_node());
+	  }
+	  parent = node;
+	  node = it->second;
+	  begin = end + 1;
+	} while (end != std::string::npos);
+
+	trie[node].ids.push_back(id);
+
+	/*
+	 *  The last token tells whether the variable can be part of the
+	 *  mesh named by the other tokens:
+	 */
+	if (parent != 0) {
+	  const std::size_t last(name.rfind('_'));
+	  const std::string suffix(name, last + 1);
+	  if (suffix == "nodes")
+	    candidates[parent].nodes_id = id;
+	  else if (suffix == "elems")
+	    candidates[parent].elems_id = id;
+	  else if (suffix == "refs")
+	    candidates[parent].refs_id = id;
+	}
+      }
+    }
+
+    /*
+     *  Append the real arrays (and the real numbers unless 'arrays_only',
+     *  the integer and element arrays if 'integer_arrays') of the
+     *  subtrie of 'root', root excluded, which are not *_nodes or *_refs
+     *  variables, nor *_elems integer arrays.
+     */
+    void collect_subtrie(unsigned int root, database_read_access* db, bool arrays_only,
+			 bool integer_arrays, std::vector<unsigned int>& ids) const {
+      std::vector<unsigned int> stack;
+      for (const auto& child: trie[root].children)
+	stack.push_back(child.second);
+
+      while (stack.size()) {
+	const unsigned int node(stack.back());
+	stack.pop_back();
+
+	for (const auto id: trie[node].ids) {
+	  const std::string& name(db->get_variable_name(id));
+	  if (suffixed(name, "_nodes") or suffixed(name, "_refs"))
+	    continue;
+	  const data_type t(db->get_variable_type(id));
+	  if (t == data_type::real_array or (t == data_type::real_number and not arrays_only))
+	    ids.push_back(id);
+	  else if (integer_arrays and (t == data_type::int_array or t == data_type::element_array)
+		   and not suffixed(name, "_elems"))
+	    ids.push_back(id);
+	}
+
+	for (const auto& child: trie[node].children)
+	  stack.push_back(child.second);
+      }
+    }
+  };
+
+}
+
+#endif /* _ALUCELL_MESH_CATALOG_H_ */
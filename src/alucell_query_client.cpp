@@ -0,0 +1,152 @@
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "alucell_query_client.hpp"
+
+namespace alucell {
+
+  query_client::query_client(const std::string& socket_path): fd(-1), response() {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+      throw "[error] query_client: socket path too long: " + socket_path + ".";
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size());
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 or ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+      if (fd >= 0)
+	::close(fd);
+      throw "[error] query_client: no server listens on " + socket_path + ".";
+    }
+  }
+
+  query_client::~query_client() {
+    ::close(fd);
+  }
+
+  query::message_writer query_client::request(query::operation op, const std::string& db_filename) {
+    char path[PATH_MAX];
+    if (not ::realpath(db_filename.c_str(), path))
+      throw "[error] query_client: " + db_filename + " is not accessible.";
+
+    query::message_writer w;
+    w.put(op).put_string(path);
+    return w;
+  }
+
+  query::message_reader query_client::exchange(query::message_writer& request) {
+    query::send_frame(fd, request.get_data());
+    if (not query::receive_frame(fd, response))
+      throw std::string("[error] query_client: the server closed the connection.");
+
+    query::message_reader r(response);
+    if (r.get<std::uint8_t>() != query::status_ok)
+      throw r.get_string();
+    return r;
+  }
+
+  std::vector<query_client::variable_description> query_client::ls(const std::string& db_filename) {
+    query::message_writer w(request(query::operation::ls, db_filename));
+    query::message_reader r(exchange(w));
+
+    std::vector<variable_description> variables(r.get<std::uint32_t>());
+    for (auto& v: variables) {
+      v.type = static_cast<data_type>(r.get<std::uint8_t>());
+      v.size = r.get<std::uint64_t>();
+      v.name = r.get_string();
+    }
+    return variables;
+  }
+
+  query_client::variable_summary query_client::show(const std::string& db_filename, const std::string& name) {
+    query::message_writer w(request(query::operation::show, db_filename));
+    w.put_string(name);
+    query::message_reader r(exchange(w));
+
+    variable_summary s;
+    s.type = static_cast<data_type>(r.get<std::uint8_t>());
+    s.size = r.get<std::uint64_t>();
+    s.rows = r.get<std::uint64_t>();
+    s.components = r.get<std::uint32_t>();
+    s.values.resize(r.get<std::uint32_t>());
+    r.get_doubles(s.values.data(), s.values.size());
+    s.text = r.get_string();
+    return s;
+  }
+
+  query_client::array_values query_client::dump(const std::string& db_filename, const std::string& spec) {
+    query::message_writer w(request(query::operation::dump, db_filename));
+    w.put_string(spec);
+    query::message_reader r(exchange(w));
+
+    array_values a;
+    a.type = static_cast<data_type>(r.get<std::uint8_t>());
+    a.rows = r.get<std::uint64_t>();
+    a.components = r.get<std::uint32_t>();
+    if (a.rows * a.components > r.remaining() / sizeof(double))
+      throw std::string("[error] query: truncated message.");
+    a.values.resize(a.rows * a.components);
+    r.get_doubles(a.values.data(), a.values.size());
+    return a;
+  }
+
+  std::vector<statistics::component_statistics>
+  query_client::stats(const std::string& db_filename, const std::string& name,
+		      const std::vector<double>& percentiles) {
+    query::message_writer w(request(query::operation::stats, db_filename));
+    w.put_string(name).put<std::uint32_t>(percentiles.size()).put_doubles(percentiles.data(), percentiles.size());
+    query::message_reader r(exchange(w));
+
+    r.get<std::uint64_t>();
+    std::vector<statistics::component_statistics> stats(r.get<std::uint32_t>());
+    for (auto& s: stats) {
+      s.count = r.get<std::uint64_t>();
+      s.nan_count = r.get<std::uint64_t>();
+      s.inf_count = r.get<std::uint64_t>();
+      double values[7];
+      r.get_doubles(values, 7);
+      s.min = values[0];
+      s.max = values[1];
+      s.sum = values[2];
+      s.mean = values[3];
+      s.l1_norm = values[4];
+      s.l2_norm = values[5];
+      s.linf_norm = values[6];
+      s.percentiles.resize(r.get<std::uint32_t>());
+      for (auto& p: s.percentiles) {
+	p.first = r.get<double>();
+	p.second = r.get<double>();
+      }
+    }
+    return stats;
+  }
+
+  query_client::probe_values query_client::probe(const std::string& db_filename, const std::string& mesh,
+						 const std::string& name, const std::vector<double>& points) {
+    query::message_writer w(request(query::operation::probe, db_filename));
+    w.put_string(mesh).put_string(name).put<std::uint64_t>(points.size()).put_doubles(points.data(), points.size());
+    query::message_reader r(exchange(w));
+
+    probe_values p;
+    p.dimension = r.get<std::uint32_t>();
+    p.components = r.get<std::uint32_t>();
+    const std::size_t n(r.get<std::uint64_t>());
+    if (n > r.remaining() / sizeof(std::uint64_t))
+      throw std::string("[error] query: truncated message.");
+    p.elements.resize(n);
+    p.values.resize(n * p.components);
+    for (std::size_t i(0); i < n; ++i) {
+      p.elements[i] = r.get<std::uint64_t>();
+      r.get_doubles(&p.values[i * p.components], p.components);
+    }
+    return p;
+  }
+
+}
@@ -0,0 +1,571 @@
+
+#include <algorithm>
+#include <exception>
+#include <cstring>
+#include <cerrno>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "alucell_query_server.hpp"
+#include "alucell_legacy_variable.hpp"
+#include "alucell_array_slice.hpp"
+#include "alucell_dense_matrix.hpp"
+#include "alucell_histogram.hpp"
+
+namespace alucell {
+
+  namespace {
+
+    /*
+     *  Window of the arrays streamed by a worker, and largest array
+     *  decoded through the variable cache.
+     */
+    const std::size_t stream_buffer_size = 16 * 1024 * 1024;
+
+    bool is_array_type(data_type t) {
+      return t == data_type::real_array or t == data_type::int_array or t == data_type::element_array;
+    }
+
+    sockaddr_un socket_address(const std::string& path) {
+      sockaddr_un address;
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(address.sun_path))
+	throw "[error] query_server: socket path too long: " + path + ".";
+      std::memcpy(address.sun_path, path.c_str(), path.size());
+      return address;
+    }
+
+    template<typename S>
+    std::vector<double> compute_ranges(S& v) {
+      std::vector<double> range(2 * v.get_components(), 0.);
+      std::vector<bool> seen(v.get_components(), false);
+      while (v.next())
+	for (unsigned int c(0); c < v.get_components(); ++c)
+	  for (std::size_t i(0); i < v.get_window_rows(); ++i) {
+	    const double x(v.get_value(i, c));
+	    if (not seen[c] or x < range[2 * c])
+	      range[2 * c] = x;
+	    if (not seen[c] or x > range[2 * c + 1])
+	      range[2 * c + 1] = x;
+	    seen[c] = true;
+	  }
+      return range;
+    }
+
+    /*
+     *  Rows of a decoded array, seen as a single window like the array
+     *  streams.
+     */
+    template<typename T>
+    class cached_array_window {
+    public:
+      explicit cached_array_window(const variable::array<T>& _a): a(_a), done(false) {}
+      bool next() { const bool first(not done); done = true; return first; }
+      unsigned int get_components() const { return a.get_components(); }
+      std::size_t get_window_rows() const { return a.get_size(); }
+      T get_value(std::size_t i, unsigned int c) const { return a.get_value(i, c); }
+    private:
+      const variable::array<T>& a;
+      bool done;
+    };
+
+    template<typename T>
+    std::vector<double> array_ranges(database_read_access* db, unsigned int id, variable_cache& cache) {
+      if (db->get_variable_size(id) <= stream_buffer_size) {
+	const std::shared_ptr<const variable::array<T> > a(cache.get<variable::array<T> >(db, id));
+	cached_array_window<T> w(*a);
+	return compute_ranges(w);
+      }
+      variable::array_stream<T> v(db, id, stream_buffer_size);
+      return compute_ranges(v);
+    }
+
+    template<typename T>
+    void push_values(const T* values, std::size_t n, query::message_writer& response) {
+      const std::vector<double> converted(values, values + n);
+      response.put_doubles(converted.data(), n);
+    }
+
+    void push_values(const double* values, std::size_t n, query::message_writer& response) {
+      response.put_doubles(values, n);
+    }
+
+    /*
+     *  The whole arrays are sent at once from the variable cache, the
+     *  other ones by windows of the selected rows.
+     */
+    template<typename T>
+    void push_slice(database_read_access* db, unsigned int id, const row_selection& selection,
+		    variable_cache& cache, query::message_writer& response) {
+      if (selection.is_all() and db->get_variable_size(id) <= stream_buffer_size) {
+	const std::shared_ptr<const variable::array<T> > a(cache.get<variable::array<T> >(db, id));
+	response.put<std::uint64_t>(a->get_size());
+	response.put<std::uint32_t>(a->get_components());
+	push_values(a->get_values(), static_cast<std::size_t>(a->get_size()) * a->get_components(), response);
+	return;
+      }
+
+      variable::array_slice_stream<T> v(db, id, selection, stream_buffer_size);
+      response.put<std::uint64_t>(v.get_selected_rows());
+      response.put<std::uint32_t>(v.get_components());
+      std::vector<double> window;
+      while (v.next()) {
+	window.resize(v.get_window_rows() * v.get_components());
+	for (std::size_t i(0); i < v.get_window_rows(); ++i)
+	  for (unsigned int c(0); c < v.get_components(); ++c)
+	    window[i * v.get_components() + c] = v.get_value(i, c);
+	response.put_doubles(window.data(), window.size());
+      }
+    }
+
+    template<typename T>
+    std::vector<statistics::component_statistics>
+    array_statistics(database_read_access* db, unsigned int id, const std::vector<double>& percentiles,
+		     variable_cache& cache) {
+      if (db->get_variable_size(id) <= stream_buffer_size)
+	return statistics::compute_statistics<T>(*cache.get<variable::array<T> >(db, id), percentiles, 1);
+      return statistics::compute_statistics<T>(db, id, percentiles, 1, stream_buffer_size);
+    }
+
+    template<typename T>
+    void probe(const mesh& m, const mesh_bvh& bvh, database_read_access* db, unsigned int id,
+	       variable_cache& cache, const std::vector<double>& points, query::message_writer& response) {
+      const std::shared_ptr<const variable::array<T> > a(cache.get<variable::array<T> >(db, id));
+      std::vector<std::size_t> elements;
+      std::vector<double> results;
+      probe_field_values(m, bvh, a->get_values(), a->get_size(), a->get_components(), points, 1,
+			 elements, results);
+
+      response.put<std::uint32_t>(m.get_dimension()).put<std::uint32_t>(a->get_components());
+      response.put<std::uint64_t>(elements.size());
+      for (std::size_t i(0); i < elements.size(); ++i) {
+	response.put<std::uint64_t>(elements[i] == m.get_elements_number() ? 0 : elements[i] + 1);
+	response.put_doubles(&results[i * a->get_components()], a->get_components());
+      }
+    }
+
+  }
+
+  query_server::query_server(const std::string& _socket_path, unsigned int threads,
+			     std::size_t cache_byte_budget)
+    : socket_path(_socket_path), listen_fd(-1), wake_pipe(), stopping(false),
+      workers(), mutex(), work_available(), ready(), returned(),
+      cache(cache_byte_budget), meshes_mutex(), meshes(),
+      connections(0), requests(0), errors(0), reopened(0) {
+    wake_pipe[0] = wake_pipe[1] = -1;
+    const sockaddr_un address(socket_address(socket_path));
+
+    /*
+     *  Replace a socket left by a server which is gone, but not a live
+     *  one:
+     */
+    struct stat s;
+    if (lstat(socket_path.c_str(), &s) == 0) {
+      if (not S_ISSOCK(s.st_mode))
+	throw "[error] query_server: " + socket_path + " exists and is not a socket.";
+      const int probe_fd(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+      const bool live(probe_fd >= 0 and ::connect(probe_fd, reinterpret_cast<const sockaddr*>(&address),
+						  sizeof(address)) == 0);
+      if (probe_fd >= 0)
+	::close(probe_fd);
+      if (live)
+	throw "[error] query_server: a server already listens on " + socket_path + ".";
+      ::unlink(socket_path.c_str());
+    }
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0
+	or ::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+	or ::listen(listen_fd, 128) != 0) {
+      if (listen_fd >= 0)
+	::close(listen_fd);
+      throw "[error] query_server: unable to listen on " + socket_path + ".";
+    }
+
+    if (::pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+      ::close(listen_fd);
+      ::unlink(socket_path.c_str());
+      throw std::string("[error] query_server: unable to create the wake up pipe.");
+    }
+
+    for (unsigned int t(0); t < std::max(1u, threads); ++t)
+      workers.push_back(std::thread(&query_server::worker_loop, this));
+  }
+
+  query_server::~query_server() {
+    stopping = true;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      work_available.notify_all();
+    }
+    for (auto& w: workers)
+      w.join();
+
+    for (const int fd: ready)
+      ::close(fd);
+    for (const int fd: returned)
+      ::close(fd);
+    ::close(listen_fd);
+    ::close(wake_pipe[0]);
+    ::close(wake_pipe[1]);
+    ::unlink(socket_path.c_str());
+  }
+
+  void query_server::wake() {
+    const char c(0);
+    while (::write(wake_pipe[1], &c, 1) < 0 and errno == EINTR)
+      ;
+  }
+
+  void query_server::stop() {
+    stopping = true;
+    wake();
+  }
+
+  query_server::counters query_server::get_counters() const {
+    counters c = { connections, requests, errors, reopened };
+    return c;
+  }
+
+  void query_server::run() {
+    std::vector<int> idle;
+    std::vector<pollfd> fds;
+    while (not stopping) {
+      {
+	std::lock_guard<std::mutex> lock(mutex);
+	idle.insert(idle.end(), returned.begin(), returned.end());
+	returned.clear();
+      }
+
+      fds.clear();
+      const pollfd listening = { listen_fd, POLLIN, 0 };
+      const pollfd waking = { wake_pipe[0], POLLIN, 0 };
+      fds.push_back(listening);
+      fds.push_back(waking);
+      for (const int fd: idle) {
+	const pollfd connection = { fd, POLLIN, 0 };
+	fds.push_back(connection);
+      }
+
+      if (::poll(fds.data(), fds.size(), -1) < 0) {
+	if (errno == EINTR)
+	  continue;
+	throw std::string("[error] query_server: poll failed.");
+      }
+
+      if (fds[1].revents) {
+	char buffer[64];
+	while (::read(wake_pipe[0], buffer, sizeof(buffer)) > 0)
+	  ;
+      }
+
+      /*
+       *  Hand the connections with a pending request over to the workers,
+       *  and close the ones which hung up:
+       */
+      std::vector<int> still_idle;
+      for (std::size_t k(2); k < fds.size(); ++k) {
+	if (fds[k].revents & POLLIN) {
+	  std::lock_guard<std::mutex> lock(mutex);
+	  ready.push_back(fds[k].fd);
+	  work_available.notify_one();
+	} else if (fds[k].revents) {
+	  ::close(fds[k].fd);
+	} else {
+	  still_idle.push_back(fds[k].fd);
+	}
+      }
+      idle.swap(still_idle);
+
+      if (fds[0].revents & POLLIN) {
+	const int fd(::accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC));
+	if (fd >= 0) {
+	  const timeval timeout = {io_timeout, 0};
+	  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	  idle.push_back(fd);
+	  ++connections;
+	}
+      }
+    }
+
+    for (const int fd: idle)
+      ::close(fd);
+  }
+
+  void query_server::worker_loop() {
+    open_dbfiles dbfiles;
+    std::vector<char> request;
+    while (true) {
+      int fd(-1);
+      {
+	std::unique_lock<std::mutex> lock(mutex);
+	work_available.wait(lock, [&]() { return ready.size() or stopping; });
+	if (stopping)
+	  return;
+	fd = ready.front();
+	ready.pop_front();
+      }
+
+      bool keep(false);
+      try {
+	if (query::receive_frame(fd, request)) {
+	  ++requests;
+	  query::message_writer response;
+	  std::string error;
+	  try {
+	    answer(dbfiles, request, response);
+	  }
+	  catch (const std::string& e) {
+	    error = e;
+	  }
+	  catch (const std::exception& e) {
+	    error = std::string("[error] query_server: ") + e.what();
+	  }
+	  if (error.empty() and response.get_data().size() > query::max_frame_size)
+	    error = "[error] query_server: the response of " + std::to_string(response.get_data().size())
+	      + " bytes does not fit in a frame.";
+	  if (error.size()) {
+	    ++errors;
+	    response = query::message_writer();
+	    response.put(query::status_error).put_string(error);
+	  }
+	  query::send_frame(fd, response.get_data());
+	  keep = true;
+	}
+      }
+      catch (const std::string&) {
+      }
+
+      if (keep) {
+	std::lock_guard<std::mutex> lock(mutex);
+	returned.push_back(fd);
+	wake();
+      } else {
+	::close(fd);
+      }
+    }
+  }
+
+  query_server::open_dbfile& query_server::get_dbfile(open_dbfiles& dbfiles, const std::string& filename) {
+    struct stat s;
+    if (::stat(filename.c_str(), &s) != 0)
+      throw "[error] query_server: " + filename + " is not accessible.";
+
+    auto it(dbfiles.find(filename));
+    if (it != dbfiles.end()) {
+      const file_identity& i(it->second.db->get_file_identity());
+      if (i.device == static_cast<unsigned long long>(s.st_dev) and i.inode == static_cast<unsigned long long>(s.st_ino)
+	  and i.size == s.st_size and i.mtime_sec == s.st_mtim.tv_sec and i.mtime_nsec == s.st_mtim.tv_nsec)
+	return it->second;
+      dbfiles.erase(it);
+      ++reopened;
+    }
+
+    if (dbfiles.size() >= max_open_dbfiles)
+      dbfiles.clear();
+
+    open_dbfile f;
+    f.db.reset(new database_read_access(filename));
+    for (unsigned int id(0); id < f.db->get_variables_number(); ++id)
+      f.ids[f.db->get_variable_name(id)] = id;
+    return dbfiles[filename] = std::move(f);
+  }
+
+  unsigned int query_server::get_variable_id(const open_dbfile& dbfile, const std::string& name) {
+    const auto it(dbfile.ids.find(name));
+    if (it == dbfile.ids.end())
+      throw "[error] query_server: variable " + name + " not found in " + dbfile.db->get_filename() + ".";
+    return it->second;
+  }
+
+  std::shared_ptr<const query_server::mesh_entry>
+  query_server::get_mesh(database_read_access* db, const std::string& name) {
+    {
+      std::lock_guard<std::mutex> lock(meshes_mutex);
+      for (auto it(meshes.begin()); it != meshes.end(); ++it)
+	if ((*it)->name == name and (*it)->identity == db->get_file_identity()) {
+	  meshes.splice(meshes.begin(), meshes, it);
+	  return meshes.front();
+	}
+    }
+
+    /*
+     *  Built outside of the lock, possibly by several workers at once:
+     */
+    const std::shared_ptr<const mesh_entry> entry(std::make_shared<mesh_entry>(db, name));
+    std::lock_guard<std::mutex> lock(meshes_mutex);
+    meshes.push_front(entry);
+    if (meshes.size() > max_meshes)
+      meshes.pop_back();
+    return entry;
+  }
+
+  void query_server::answer(open_dbfiles& dbfiles, const std::vector<char>& request,
+			    query::message_writer& response) {
+    query::message_reader r(request);
+    const query::operation op(static_cast<query::operation>(r.get<std::uint8_t>()));
+    const std::string filename(r.get_string());
+    open_dbfile& dbfile(get_dbfile(dbfiles, filename));
+    database_read_access* db(dbfile.db.get());
+
+    response.put(query::status_ok);
+    switch (op) {
+    case query::operation::ls:
+      answer_ls(db, response);
+      break;
+
+    case query::operation::show:
+      answer_show(dbfile, get_variable_id(dbfile, r.get_string()), response);
+      break;
+
+    case query::operation::dump:
+      answer_dump(dbfile, r.get_string(), response);
+      break;
+
+    case query::operation::stats:
+      {
+	const unsigned int id(get_variable_id(dbfile, r.get_string()));
+	std::vector<double> percentiles(r.get_count<std::uint32_t>(sizeof(double)));
+	r.get_doubles(percentiles.data(), percentiles.size());
+	answer_stats(db, id, percentiles, response);
+      }
+      break;
+
+    case query::operation::probe:
+      {
+	const std::string mesh_name(r.get_string());
+	const unsigned int id(get_variable_id(dbfile, r.get_string()));
+	std::vector<double> points(r.get_count<std::uint64_t>(sizeof(double)));
+	r.get_doubles(points.data(), points.size());
+	answer_probe(db, mesh_name, id, points, response);
+      }
+      break;
+
+    default:
+      throw std::string("[error] query_server: unknown operation.");
+    }
+  }
+
+  void query_server::answer_ls(database_read_access* db, query::message_writer& response) {
+    response.put<std::uint32_t>(db->get_variables_number());
+    for (unsigned int id(0); id < db->get_variables_number(); ++id)
+      response.put<std::uint8_t>(static_cast<std::uint8_t>(db->get_variable_type(id)))
+	.put<std::uint64_t>(db->get_variable_size(id))
+	.put_string(db->get_variable_name(id));
+  }
+
+  void query_server::answer_show(open_dbfile& dbfile, unsigned int id, query::message_writer& response) {
+    database_read_access* db(dbfile.db.get());
+    const data_type t(db->get_variable_type(id));
+    response.put<std::uint8_t>(static_cast<std::uint8_t>(t)).put<std::uint64_t>(db->get_variable_size(id));
+
+    std::string text;
+    if (is_array_type(t)) {
+      const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+      response.put<std::uint64_t>(dimensions.first).put<std::uint32_t>(dimensions.second);
+      auto it(dbfile.ranges.find(id));
+      if (it == dbfile.ranges.end())
+	it = dbfile.ranges.insert(std::make_pair(id, t == data_type::real_array
+						 ? array_ranges<double>(db, id, cache)
+						 : array_ranges<int>(db, id, cache))).first;
+      response.put<std::uint32_t>(it->second.size()).put_doubles(it->second.data(), it->second.size());
+    } else if (t == data_type::matrix) {
+      std::vector<char> payload(db->get_variable_size(id));
+      db->read_data_from_database(id, 0, payload.size(), payload.data());
+      const matrix_view a(payload.data(), payload.size());
+      const std::size_t n(a.get_rows() * a.get_columns());
+      response.put<std::uint64_t>(a.get_rows()).put<std::uint32_t>(a.get_columns());
+      if (n) {
+	const auto range(std::minmax_element(a.get_data(), a.get_data() + n));
+	const double values[2] = {*range.first, *range.second};
+	response.put<std::uint32_t>(2).put_doubles(values, 2);
+      } else {
+	response.put<std::uint32_t>(0);
+      }
+    } else if (t == data_type::real_number) {
+      const double value(variable::number(db, id).get_value());
+      response.put<std::uint64_t>(1).put<std::uint32_t>(1).put<std::uint32_t>(1).put_doubles(&value, 1);
+    } else {
+      if (t == data_type::string)
+	text = variable::string(db, id).get_value();
+      response.put<std::uint64_t>(0).put<std::uint32_t>(0).put<std::uint32_t>(0);
+    }
+    response.put_string(text);
+  }
+
+  void query_server::answer_dump(const open_dbfile& dbfile, const std::string& spec,
+				 query::message_writer& response) {
+    database_read_access* db(dbfile.db.get());
+    std::pair<std::string, row_selection> slice(spec, row_selection());
+    if (not dbfile.ids.count(spec))
+      slice = parse_variable_slice(spec);
+    const unsigned int id(get_variable_id(dbfile, slice.first));
+    const data_type t(db->get_variable_type(id));
+
+    response.put<std::uint8_t>(static_cast<std::uint8_t>(t));
+    if (t == data_type::real_array) {
+      push_slice<double>(db, id, slice.second, cache, response);
+    } else if (t == data_type::int_array or t == data_type::element_array) {
+      push_slice<int>(db, id, slice.second, cache, response);
+    } else if (t == data_type::real_number and slice.second.is_all()) {
+      const double value(variable::number(db, id).get_value());
+      response.put<std::uint64_t>(1).put<std::uint32_t>(1).put_doubles(&value, 1);
+    } else {
+      throw "[error] query_server: " + slice.first + " is not an array.";
+    }
+  }
+
+  void query_server::answer_stats(database_read_access* db, unsigned int id, const std::vector<double>& percentiles,
+				  query::message_writer& response) {
+    const data_type t(db->get_variable_type(id));
+    if (not is_array_type(t))
+      throw "[error] query_server: " + db->get_variable_name(id) + " is not an array.";
+
+    const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+    const std::vector<statistics::component_statistics>
+      stats(t == data_type::real_array
+	    ? array_statistics<double>(db, id, percentiles, cache)
+	    : array_statistics<int>(db, id, percentiles, cache));
+
+    response.put<std::uint64_t>(dimensions.first).put<std::uint32_t>(stats.size());
+    for (const auto& s: stats) {
+      const double values[] = {s.min, s.max, s.sum, s.mean, s.l1_norm, s.l2_norm, s.linf_norm};
+      response.put<std::uint64_t>(s.count).put<std::uint64_t>(s.nan_count).put<std::uint64_t>(s.inf_count)
+	.put_doubles(values, sizeof(values) / sizeof(double))
+	.put<std::uint32_t>(s.percentiles.size());
+      for (const auto& p: s.percentiles)
+	response.put<double>(p.first).put<double>(p.second);
+    }
+  }
+
+  void query_server::answer_probe(database_read_access* db, const std::string& mesh_name, unsigned int id,
+				  const std::vector<double>& points, query::message_writer& response) {
+    const std::shared_ptr<const mesh_entry> entry(get_mesh(db, mesh_name));
+    if (entry->m.get_dimension() == 0 or points.size() % entry->m.get_dimension())
+      throw "[error] query_server: the number of coordinates is not a multiple of the dimension of "
+	+ mesh_name + ".";
+
+    switch (db->get_variable_type(id)) {
+    case data_type::real_array:
+      probe<double>(entry->m, entry->bvh, db, id, cache, points, response);
+      break;
+
+    case data_type::int_array:
+    case data_type::element_array:
+      probe<int>(entry->m, entry->bvh, db, id, cache, points, response);
+      break;
+
+    default:
+      throw "[error] query_server: " + db->get_variable_name(id) + " is not an array.";
+    }
+  }
+
+}
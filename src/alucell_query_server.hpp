@@ -0,0 +1,136 @@
+#ifndef _ALUCELL_QUERY_SERVER_H_
+#define _ALUCELL_QUERY_SERVER_H_
+
+#include <map>
+#include <list>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_mesh.hpp"
+#include "alucell_mesh_bvh.hpp"
+#include "alucell_variable_cache.hpp"
+#include "alucell_query_protocol.hpp"
+
+namespace alucell {
+
+  /*
+   *  Server answering the requests of alucell_query_protocol.hpp on a
+   *  Unix domain socket, keeping the dbfiles open between the requests.
+   *
+   *  The main thread polls the listening socket and the idle connections.
+   *  A connection with a pending request is handed over to the pool of
+   *  worker threads, which reads the request, answers it, and gives the
+   *  connection back to the main thread. Each worker keeps its own
+   *  database_read_access per dbfile, with its parsed header, so the
+   *  workers never share a file position, and remembers the ranges of the
+   *  arrays it showed. The decoded arrays go through a variable_cache
+   *  shared by the workers, and the meshes with their BVH through a small
+   *  shared cache of the 'max_meshes' last used meshes.
+   *
+   *  Before each request, the dbfile is stat'ed and reopened if its
+   *  identity (see file_identity) changed; the cache entries of the old
+   *  identity are never hit again and age out of the caches.
+   */
+  class query_server {
+  public:
+    static const unsigned int max_meshes = 8;
+
+    struct counters {
+      std::size_t connections, requests, errors, reopened;
+    };
+
+    query_server(const std::string& socket_path, unsigned int threads,
+		 std::size_t cache_byte_budget = variable_cache::default_byte_budget);
+
+    ~query_server();
+
+    query_server(const query_server&) = delete;
+    query_server& operator=(const query_server&) = delete;
+
+    /*
+     *  Serve the requests until stop is called.
+     */
+    void run();
+
+    /*
+     *  Make run return. Only writes to a pipe, so it can be called from a
+     *  signal handler.
+     */
+    void stop();
+
+    counters get_counters() const;
+
+    variable_cache& get_cache() { return cache; }
+
+  private:
+    static const std::size_t max_open_dbfiles = 64;  // Per worker
+
+    /*
+     *  Seconds a worker waits for the rest of a request, or for a client
+     *  to read its response, before dropping the connection.
+     */
+    static const int io_timeout = 10;
+
+    struct mesh_entry {
+      file_identity identity;
+      std::string name;
+      mesh m;
+      mesh_bvh bvh;
+
+      mesh_entry(database_read_access* db, const std::string& _name)
+	: identity(db->get_file_identity()), name(_name), m(db, _name), bvh(m) {}
+    };
+
+    struct open_dbfile {
+      std::unique_ptr<database_read_access> db;
+      std::unordered_map<std::string, unsigned int> ids;
+      std::unordered_map<unsigned int, std::vector<double> > ranges;  // Of the arrays shown
+    };
+
+    typedef std::map<std::string, open_dbfile> open_dbfiles;
+
+    std::string socket_path;
+    int listen_fd;
+    int wake_pipe[2];
+    std::atomic<bool> stopping;
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<int> ready;  // Connections with a pending request
+    std::vector<int> returned;  // Connections given back by the workers
+
+    variable_cache cache;
+    std::mutex meshes_mutex;
+    std::list<std::shared_ptr<const mesh_entry> > meshes;  // Most recently used first
+
+    std::atomic<std::size_t> connections, requests, errors, reopened;
+
+    void worker_loop();
+    void wake();
+
+    open_dbfile& get_dbfile(open_dbfiles& dbfiles, const std::string& filename);
+    static unsigned int get_variable_id(const open_dbfile& dbfile, const std::string& name);
+    std::shared_ptr<const mesh_entry> get_mesh(database_read_access* db, const std::string& name);
+
+    void answer(open_dbfiles& dbfiles, const std::vector<char>& request, query::message_writer& response);
+    void answer_ls(database_read_access* db, query::message_writer& response);
+    void answer_show(open_dbfile& dbfile, unsigned int id, query::message_writer& response);
+    void answer_dump(const open_dbfile& dbfile, const std::string& spec, query::message_writer& response);
+    void answer_stats(database_read_access* db, unsigned int id, const std::vector<double>& percentiles,
+		      query::message_writer& response);
+    void answer_probe(database_read_access* db, const std::string& mesh_name, unsigned int id,
+		      const std::vector<double>& points, query::message_writer& response);
+  };
+
+}
+
+#endif /* _ALUCELL_QUERY_SERVER_H_ */
@@ -0,0 +1,299 @@
+#ifndef _ALUCELL_STATISTICS_H_
+#define _ALUCELL_STATISTICS_H_
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_legacy_variable.hpp"
+#include "parallel_utils.hpp"
+
+namespace alucell {
+
+  namespace statistics {
+
+    /*
+     *  Summary of one component of an array. The non finite values
+     *  (NaN and +/-Inf) are counted separately and excluded from all
+     *  the other quantities.
+     */
+    struct component_statistics {
+      std::size_t count;
+      std::size_t nan_count;
+      std::size_t inf_count;
+      double min, max;
+      double sum, mean;
+      double l1_norm, l2_norm, linf_norm;
+      std::vector<std::pair<double, double> > percentiles;
+    };
+
+
+    inline bool is_nan(double x) { return std::isnan(x); }
+    inline bool is_nan(int) { return false; }
+    inline bool is_inf(double x) { return std::isinf(x); }
+    inline bool is_inf(int) { return false; }
+
+
+    /*
+     *  Accumulate the statistics of an array, possibly given in several
+     *  successive chunks of rows.
+     *
+     *  The rows are reduced by blocks of 'block_rows' rows, which are
+     *  processed in parallel. Inside a block, the sums are computed by
+     *  pairwise summation over leaves of 'leaf_rows' rows, and the block
+     *  results are combined in a binary cascade in the order of the rows.
+     *  The result is therefore deterministic and does not depend on the
+     *  number of threads, nor on the chunk size as long as it is a
+     *  multiple of 'block_rows'.
+     */
+    class statistics_accumulator {
+    public:
+      static const std::size_t block_rows = 4096;
+      static const std::size_t leaf_rows = 32;
+
+      explicit statistics_accumulator(unsigned int _components,
+				      unsigned int _threads = default_threads_number())
+	: components(_components), threads(_threads), cascade() {}
+
+      unsigned int get_threads_number() const { return std::max(1u, threads); }
+
+      template<typename T>
+      void accumulate(const T* values, std::size_t rows) {
+	accumulate(values, rows, [](unsigned int, const T*, std::size_t) {});
+      }
+
+      /*
+       *  Same, calling also f(t, block_values, block_rows) on each block
+       *  from the thread t < get_threads_number() which reduces it, so
+       *  that other reductions of the rows share the same parallel pass.
+       */
+      template<typename T, typename F>
+      void accumulate(const T* values, std::size_t rows, F f) {
+	const std::size_t blocks_number((rows + block_rows - 1) / block_rows);
+	std::vector<partial> blocks(blocks_number, partial(components));
+
+	parallel_for(0, blocks_number, threads,
+		     [&](unsigned int t, std::size_t b, std::size_t e) {
+		       std::vector<double> scratch(3 * components * (block_rows / leaf_rows));
+		       for (std::size_t i(b); i < e; ++i) {
+			 const std::size_t first(i * block_rows);
+			 const std::size_t last(std::min(rows, first + block_rows));
+			 reduce_block(values + first * components, last - first, blocks[i], scratch);
+			 f(t, values + first * components, last - first);
+		       }
+		     });
+
+	for (auto& p: blocks)
+	  push(p);
+      }
+
+      std::vector<component_statistics> get_statistics() const {
+	partial total(components);
+	for (auto it(cascade.rbegin()); it != cascade.rend(); ++it)
+	  total.merge(it->second);
+
+	std::vector<component_statistics> result(components);
+	for (unsigned int c(0); c < components; ++c) {
+	  component_statistics& s(result[c]);
+	  s.count = total.count[c];
+	  s.nan_count = total.nan_count[c];
+	  s.inf_count = total.inf_count[c];
+	  s.min = s.count ? total.min[c] : std::numeric_limits<double>::quiet_NaN();
+	  s.max = s.count ? total.max[c] : std::numeric_limits<double>::quiet_NaN();
+	  s.sum = total.sum[c];
+	  s.mean = s.count ? total.sum[c] / s.count : std::numeric_limits<double>::quiet_NaN();
+	  s.l1_norm = total.l1[c];
+	  s.l2_norm = std::sqrt(total.l2[c]);
+	  s.linf_norm = total.linf[c];
+	}
+
+	return result;
+      }
+
+    private:
+      struct partial {
+	explicit partial(unsigned int c)
+	  : count(c, 0), nan_count(c, 0), inf_count(c, 0),
+	    min(c, std::numeric_limits<double>::infinity()),
+	    max(c, -std::numeric_limits<double>::infinity()),
+	    sum(c, 0.), l1(c, 0.), l2(c, 0.), linf(c, 0.) {}
+
+	void merge(const partial& p) {
+	  for (std::size_t c(0); c < count.size(); ++c) {
+	    count[c] += p.count[c];
+	    nan_count[c] += p.nan_count[c];
+	    inf_count[c] += p.inf_count[c];
+	    min[c] = std::min(min[c], p.min[c]);
+	    max[c] = std::max(max[c], p.max[c]);
+	    sum[c] += p.sum[c];
+	    l1[c] += p.l1[c];
+	    l2[c] += p.l2[c];
+	    linf[c] = std::max(linf[c], p.linf[c]);
+	  }
+	}
+
+	std::vector<std::size_t> count, nan_count, inf_count;
+	std::vector<double> min, max, sum, l1, l2, linf;
+      };
+
+      unsigned int components;
+      unsigned int threads;
+
+      /*
+       *  Binary cascade of the block results: each entry holds the
+       *  reduction of 2^level consecutive blocks.
+       */
+      std::vector<std::pair<unsigned int, partial> > cascade;
+
+      void push(const partial& p) {
+	cascade.push_back(std::make_pair(0u, p));
+	while (cascade.size() >= 2
+	       and cascade[cascade.size() - 1].first == cascade[cascade.size() - 2].first) {
+	  partial& left(cascade[cascade.size() - 2].second);
+	  left.merge(cascade.back().second);
+	  cascade[cascade.size() - 2].first += 1;
+	  cascade.pop_back();
+	}
+      }
+
+      template<typename T>
+      void reduce_block(const T* values, std::size_t rows, partial& p, std::vector<double>& scratch) const {
+	const std::size_t leaves((rows + leaf_rows - 1) / leaf_rows);
+	double* sums(&scratch[0]);
+	double* l1s(sums + leaves * components);
+	double* l2s(l1s + leaves * components);
+
+	for (std::size_t l(0); l < leaves; ++l) {
+	  const std::size_t first(l * leaf_rows);
+	  const std::size_t last(std::min(rows, first + leaf_rows));
+
+	  for (unsigned int c(0); c < components; ++c) {
+	    double s(0.), s1(0.), s2(0.);
+	    double lmin(p.min[c]), lmax(p.max[c]), linf(p.linf[c]);
+	    std::size_t finite(0), nans(0), infs(0);
+
+	    for (std::size_t i(first); i < last; ++i) {
+	      const T v(values[i * components + c]);
+	      if (is_nan(v)) {
+		++nans;
+	      } else if (is_inf(v)) {
+		++infs;
+	      } else {
+		const double x(v), a(std::abs(x));
+		s += x;
+		s1 += a;
+		s2 += x * x;
+		lmin = x < lmin ? x : lmin;
+		lmax = x > lmax ? x : lmax;
+		linf = a > linf ? a : linf;
+		++finite;
+	      }
+	    }
+
+	    sums[l * components + c] = s;
+	    l1s[l * components + c] = s1;
+	    l2s[l * components + c] = s2;
+	    p.min[c] = lmin;
+	    p.max[c] = lmax;
+	    p.linf[c] = linf;
+	    p.count[c] += finite;
+	    p.nan_count[c] += nans;
+	    p.inf_count[c] += infs;
+	  }
+	}
+
+	pairwise_reduce(sums, leaves);
+	pairwise_reduce(l1s, leaves);
+	pairwise_reduce(l2s, leaves);
+
+	for (unsigned int c(0); c < components; ++c) {
+	  p.sum[c] = sums[c];
+	  p.l1[c] = l1s[c];
+	  p.l2[c] = l2s[c];
+	}
+      }
+
+      /*
+       *  In place pairwise summation of 'n' rows of 'components' values,
+       *  the result is left in the first row.
+       */
+      void pairwise_reduce(double* rows, std::size_t n) const {
+	while (n > 1) {
+	  const std::size_t half(n / 2);
+	  for (std::size_t i(0); i < half; ++i)
+	    for (unsigned int c(0); c < components; ++c)
+	      rows[i * components + c] = rows[2 * i * components + c] + rows[(2 * i + 1) * components + c];
+	  if (n % 2)
+	    for (unsigned int c(0); c < components; ++c)
+	      rows[half * components + c] = rows[(n - 1) * components + c];
+	  n = half + n % 2;
+	}
+      }
+    };
+
+
+    /*
+     *  Exact percentiles (linear interpolation between closest ranks) of
+     *  the finite values of the component 'c'. The values are copied,
+     *  'q' are given in percent.
+     */
+    template<typename T>
+    std::vector<std::pair<double, double> > exact_percentiles(const T* values, std::size_t rows,
+							       unsigned int components, unsigned int c,
+							       const std::vector<double>& q) {
+      std::vector<double> finite_values;
+      finite_values.reserve(rows);
+      for (std::size_t i(0); i < rows; ++i) {
+	const T v(values[i * components + c]);
+	if (not is_nan(v) and not is_inf(v))
+	  finite_values.push_back(v);
+      }
+
+      std::vector<std::pair<double, double> > result;
+      for (const auto p: q) {
+	if (finite_values.empty()) {
+	  result.push_back(std::make_pair(p, std::numeric_limits<double>::quiet_NaN()));
+	  continue;
+	}
+
+	const double rank(std::min(100., std::max(0., p)) / 100. * (finite_values.size() - 1));
+	const std::size_t lower(rank);
+	std::nth_element(finite_values.begin(), finite_values.begin() + lower, finite_values.end());
+	const double a(finite_values[lower]);
+	double b(a);
+	if (lower + 1 < finite_values.size())
+	  b = *std::min_element(finite_values.begin() + lower + 1, finite_values.end());
+
+	result.push_back(std::make_pair(p, a + (rank - lower) * (b - a)));
+      }
+
+      return result;
+    }
+
+
+    /*
+     *  Compute the per component statistics of an array variable.
+     */
+    template<typename T>
+    std::vector<component_statistics> compute_statistics(const variable::array<T>& a,
+							 const std::vector<double>& percentiles = std::vector<double>(),
+							 unsigned int threads = default_threads_number()) {
+      statistics_accumulator acc(a.get_components(), threads);
+      acc.accumulate(a.get_values(), a.get_size());
+
+      std::vector<component_statistics> result(acc.get_statistics());
+      if (percentiles.size())
+	for (unsigned int c(0); c < a.get_components(); ++c)
+	  result[c].percentiles = exact_percentiles(a.get_values(), a.get_size(),
+						    a.get_components(), c, percentiles);
+
+      return result;
+    }
+
+  }
+
+}
+
+#endif /* _ALUCELL_STATISTICS_H_ */
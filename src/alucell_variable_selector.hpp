@@ -0,0 +1,185 @@
+#ifndef _ALUCELL_VARIABLE_SELECTOR_H_
+#define _ALUCELL_VARIABLE_SELECTOR_H_
+
+#include <set>
+#include <regex>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <fnmatch.h>
+
+#include "alucell_legacy_database.hpp"
+#include "alucell_mesh_catalog.hpp"
+
+namespace alucell {
+
+  /*
+   *  Selection of the variables of a dbfile by name, type, size and mesh.
+   *
+   *  A variable is selected if its name is one of the names, matches one
+   *  of the glob patterns or contains a match of one of the regular
+   *  expressions (when any of them is given), its type is one of the
+   *  types (when any is given), its size in bytes satisfies all the size
+   *  predicates, and it belongs to one of the meshes (when any is given):
+   *  it is one of the M_nodes, M_elems and M_refs arrays of a mesh M, or
+   *  one of the variables attached to it, see mesh_catalog.
+   *
+   *  The criteria are compiled once: the names go in a hash set, the
+   *  regular expressions are compiled, and the literal prefix of the glob
+   *  patterns is compared before fnmatch is called. select then matches
+   *  the variables in a single pass over the index, in id order. The mesh
+   *  catalog is only built when meshes are given.
+   */
+  class variable_selector {
+  public:
+    enum class comparison { less, less_equal, greater, greater_equal, equal, not_equal };
+
+    variable_selector()
+      : names(), patterns(), expressions(), types_mask(0), sizes(), meshes() {}
+
+    void add_name(const std::string& name) { names.insert(name); }
+
+    void add_pattern(const std::string& pattern) {
+      patterns.push_back(std::make_pair(pattern.substr(0, pattern.find_first_of("*?[\\")), pattern));
+    }
+
+    void add_regex(const std::string& expression) {
+      try {
+	expressions.push_back(std::regex(expression, std::regex::ECMAScript | std::regex::optimize));
+      }
+      catch (const std::regex_error&) {
+	throw "variable_selector: invalid regular expression " + expression + ".";
+      }
+    }
+
+    void add_type(data_type t) { types_mask |= 1u << static_cast<unsigned int>(t); }
+
+    void add_size(comparison c, std::size_t size) { sizes.push_back(std::make_pair(c, size)); }
+
+    /*
+     *  Add a size predicate '<op><size>', <op> being one of <, <=, >, >=,
+     *  = and !=, and <size> a size in bytes as read by parse_size.
+     */
+    void add_size_predicate(const std::string& predicate) {
+      static const std::pair<const char*, comparison> operators[] = {
+	{"<=", comparison::less_equal}, {">=", comparison::greater_equal}, {"!=", comparison::not_equal},
+	{"<", comparison::less}, {">", comparison::greater}, {"=", comparison::equal}};
+      for (const auto& o: operators)
+	if (predicate.compare(0, std::strlen(o.first), o.first) == 0) {
+	  add_size(o.second, parse_size(predicate.substr(std::strlen(o.first))));
+	  return;
+	}
+      throw "variable_selector: invalid size predicate " + predicate + ".";
+    }
+
+    /*
+     *  Size in bytes, possibly 0, with an optional K, M or G suffix
+     *  (powers of 1024).
+     */
+    static std::size_t parse_size(const std::string& s) {
+      char* end(NULL);
+      const double value(std::strtod(s.c_str(), &end));
+      const std::string suffix(end);
+
+      double unit(1.);
+      if (suffix == "K" or suffix == "k")
+	unit = 1024.;
+      else if (suffix == "M" or suffix == "m")
+	unit = 1024. * 1024.;
+      else if (suffix == "G" or suffix == "g")
+	unit = 1024. * 1024. * 1024.;
+      else if (suffix.size())
+	throw "variable_selector: invalid size " + s + ".";
+
+      if (end == s.c_str() or not (value >= 0. and value * unit < 1.e18))
+	throw "variable_selector: invalid size " + s + ".";
+      return static_cast<std::size_t>(value * unit);
+    }
+
+    void add_mesh(const std::string& mesh) { meshes.insert(mesh); }
+
+    /*
+     *  No criterion at all, the selector selects every variable.
+     */
+    bool empty() const {
+      return names.empty() and patterns.empty() and expressions.empty() and types_mask == 0
+	and sizes.empty() and meshes.empty();
+    }
+
+    /*
+     *  Whether a variable matches the criteria other than the meshes.
+     */
+    bool matches(const std::string& name, data_type t, std::size_t size) const {
+      if (types_mask and not (types_mask & (1u << static_cast<unsigned int>(t))))
+	return false;
+
+      for (const auto& s: sizes)
+	if (not compare(size, s.first, s.second))
+	  return false;
+
+      if (names.empty() and patterns.empty() and expressions.empty())
+	return true;
+      if (names.count(name))
+	return true;
+      for (const auto& p: patterns)
+	if (name.compare(0, p.first.size(), p.first) == 0 and fnmatch(p.second.c_str(), name.c_str(), 0) == 0)
+	  return true;
+      for (const auto& e: expressions)
+	if (std::regex_search(name, e))
+	  return true;
+      return false;
+    }
+
+    /*
+     *  Ids of the selected variables of 'db', in increasing order.
+     */
+    std::vector<unsigned int> select(database_read_access* db) const {
+      std::vector<bool> in_meshes;
+      if (meshes.size()) {
+	in_meshes.assign(db->get_variables_number(), false);
+	const mesh_catalog catalog(db, meshes);
+	for (const auto& mesh: catalog.get_meshes()) {
+	  in_meshes[mesh.nodes_id] = true;
+	  in_meshes[mesh.elems_id] = true;
+	  in_meshes[mesh.refs_id] = true;
+	  for (const auto& v: mesh.variables)
+	    in_meshes[v.id] = true;
+	}
+      }
+
+      std::vector<unsigned int> ids;
+      for (unsigned int id(0); id < db->get_variables_number(); ++id)
+	if ((in_meshes.empty() or in_meshes[id])
+	    and matches(db->get_variable_name(id), db->get_variable_type(id), db->get_variable_size(id)))
+	  ids.push_back(id);
+      return ids;
+    }
+
+  private:
+    std::unordered_set<std::string> names;
+    std::vector<std::pair<std::string, std::string> > patterns;  // Literal prefix, pattern
+    std::vector<std::regex> expressions;
+    unsigned int types_mask;
+    std::vector<std::pair<comparison, std::size_t> > sizes;
+    std::set<std::string> meshes;
+
+    static bool compare(std::size_t size, comparison c, std::size_t value) {
+      switch (c) {
+      case comparison::less: return size < value;
+      case comparison::less_equal: return size <= value;
+      case comparison::greater: return size > value;
+      case comparison::greater_equal: return size >= value;
+      case comparison::equal: return size == value;
+      case comparison::not_equal: return size != value;
+      }
+      return false;
+    }
+  };
+
+}
+
+#endif /* _ALUCELL_VARIABLE_SELECTOR_H_ */
@@ -1,12 +1,25 @@
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <set>
 #include <map>
 #include <cctype>
+#include <cstring>
+#include <cstdio>
 #include <algorithm>
+#include <limits>
+#include <climits>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <csignal>
 
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "alucelldb.hpp"
 
@@ -16,8 +29,11 @@ const char* usage_message =
   "\n"
   "The db command is a toolbox, where each tool is selected by giving\n"
   "the appropriate <action> keyword. <action> can be one of 'ls', 'dump',\n"
-  "'mesh', 'info', 'extract' and 'show'. Each action needs a dbfile to work"
-  "with, and possibly some additional parameters.\n"
+  "'mesh', 'info', 'extract', 'show', 'stats', 'histogram', 'transfer',\n"
+  "'reorder', 'probe', 'geom', 'integrate', 'export', 'spmv', 'delta',\n"
+  "'materialize', 'catalog', 'serve', 'query', 'batch', 'merge' and 'convert'.\n"
+  "Each action needs a dbfile to work with, and possibly some additional\n"
+  "parameters.\n"
   "See 'dbfile <action> <db_filename> -h for more information about the\n"
   "action <action>.\n"
   "\n"
@@ -32,19 +48,6 @@ const char* usage_message =
   "the syntax <db_filename> is used to denote any possible textual\n"
   "representation of a valid path to a dbfile.";
 
-const char* matrix_message =
-  "Full matrix data type is long gone, dude. If you really wanna \n"
-  "see what's in this variable, you'll have to implement that. It's \n"
-  "pretty easy, the row and column number are stored in int*4 \n"
-  "format in the first 8 byte of the data. The rest are the \n"
-  "components of the matrix, in fortran array layout. Good luck!";
-
-const char* skymatrix_message =
-  "Sky matrix data type is long gone, dude. If you really wanna \n"
-  "see what's in this variable, you'll have to understand how it's \n"
-  "stored in memory, and implement that. You can start by reading ds.f \n"
-  "and vpiter.f. Good luck!";
-
 const char* meshes_help_message =
   "USAGE: db mesh <db_filename> [-h] [-a] [-n] [-e] [-s] -<n>* <mesh_name>*\n"
   "  List meshes that are defined in the dbfile, and associated variables.\n"
@@ -78,7 +81,8 @@ const char* meshes_help_message =
   "     'POINT02', ..., 'POINT09' detected in the file 'dbfile_stat'.\n";
 
 const char* dump_help_message =
-  "USAGE: db dump <db_filename> [-h] <var_name>+\n"
+  "USAGE: db dump <db_filename> [-h] [-B <buffer_size>] [-f <format>] [<selection>]*\n"
+  "               <var_name>*\n"
   "  Show the content of the variable names given on the \n"
   "  command line. Minimal formatting is performed to make\n"
   "  the content readable.\n"
@@ -91,10 +95,43 @@ const char* dump_help_message =
   "For expressions, a disassembly of the bytecode is displayed, which\n"
   "can allow, in principle, evaluation of the function by hand.\n"
   "\n"
-  "The matrix and sky_matrix are not yet supported.";
+  "The arrays are read by windows of at most <buffer_size> bytes (64M by\n"
+  "default, K, M and G suffixes are accepted), so the memory use does not\n"
+  "depend on the size of the variables.\n"
+  "\n"
+  "For the arrays, only some rows can be dumped with the following syntaxes:\n"
+  "  <var_name>[<a>]           The row <a>.\n"
+  "  <var_name>[<a>:<b>]       The rows <a> to <b> excluded. <a> and <b> can be\n"
+  "                            omitted, and default to the first and last rows.\n"
+  "  <var_name>[<a>:<b>:<s>]   Every <s>-th row from <a> to <b> excluded.\n"
+  "  <var_name>@<filename>     The rows whose indices are listed in the text file\n"
+  "                            <filename>, in this order.\n"
+  "The row indices start at 0, also in <filename>: the Alucell node and element\n"
+  "numbers, which start at 1, must be decremented. A row, or the start of a\n"
+  "range, past the last row is an error. Only the selected rows are read from\n"
+  "the dbfile.\n"
+  "Remember to quote the brackets in most shells.\n"
+  "\n"
+  "The variables selected with the -g, -e, -T, -S and -M options (see 'db ls -h')\n"
+  "are dumped after the variables named on the command line, in their order in\n"
+  "the dbfile.\n"
+  "\n"
+  "The sky_matrix variables are dumped in the Matrix Market coordinate format,\n"
+  "with 17 significant digits, without the zero terms of the profile. Only the\n"
+  "lower triangle of the symmetric matrices is written. See 'db spmv -h' for\n"
+  "the assumed layout of the sky_matrix.\n"
+  "\n"
+  "The matrix variables are dumped according to <format>:\n"
+  "  text    One line per row, the default.\n"
+  "  binary  The raw real*8 terms in row-major layout, without header.\n"
+  "  market  The Matrix Market array format, by columns, with 17 significant\n"
+  "          digits.\n"
+  "The matrix are stored by columns in the dbfile, after two int*4 holding\n"
+  "the number of rows and columns. The text and binary outputs are transposed\n"
+  "by panels of rows of at most <buffer_size> bytes.";
 
 const char* list_help_message =
-  "USAGE: db ls <db_filename> [-h] [-t <datatype>]*\n"
+  "USAGE: db ls <db_filename> [-h] [-v] [-H] [-t <datatype>]* [<selection>]*\n"
   "  List the variables in the 'db_filename' file.\n"
   "\n"
   "Without options, all the variables are listed, alongside with its\n"
@@ -102,29 +139,514 @@ const char* list_help_message =
   "'element_array', 'matrix', 'sky_matrix', 'int_array', 'real_number',\n"
   "'expression' and 'string'.\n"
   "\n"
+  "The listed variables can be selected with the following options, which\n"
+  "are also accepted by 'show', 'dump', 'extract' and 'export':\n"
+  "  -g <pattern>     Variables whose name matches the glob <pattern>.\n"
+  "  -e <regex>       Variables whose name contains a match of the ECMAScript\n"
+  "                   regular expression <regex>. Use ^ and $ to anchor it.\n"
+  "  -T <datatype>    Variables of this datatype.\n"
+  "  -S <op><size>    Variables whose size in bytes compares to <size> with <op>,\n"
+  "                   one of <, <=, >, >=, = and != (K, M and G suffixes are\n"
+  "                   accepted), e.g. '>=1M' or '=0'.\n"
+  "  -M <mesh_name>   The arrays of the mesh <mesh_name> and the variables\n"
+  "                   attached to it, see 'db mesh -h'.\n"
+  "Each option can be repeated. A variable is selected if its name matches one\n"
+  "of the -g and -e options, if any, its datatype is one of the -T options, if\n"
+  "any, its size satisfies all the -S options, and it belongs to one of the\n"
+  "-M meshes, if any. The criteria are compiled once and matched in a single\n"
+  "pass over the variables of the dbfile. Remember to quote the patterns in\n"
+  "most shells.\n"
+  "\n"
   "The 'ls' action accepts the following options:\n"
-  "  -t <datatype>  Restrict the listed variable to this datatype only.\n"
-  "                 Multiple occurences of this option can be used. In this\n"
-  "                 case, only variable whose datatype is one of the datatypes\n"
-  "                 specified with the -t option are listed.\n"
+  "  -t <datatype>  Same as -T.\n"
   "  -v             Verbose ouput. For each variable, the datatype as well as it's\n"
   "                 size in byte is printed.\n"
   "  -H             Human readable units are used to print variable sizes.\n"
   "  -h             Print this message.\n";
 
 const char* show_help_message =
-  "USAGE: db show <db_filename> [-h] <var_name>+\n"
+  "USAGE: db show <db_filename> [-h] [-B <buffer_size>] [<selection>]* <var_name>*\n"
   "  Show a human readable summary of the content of the variable names given \n"
-  "  on the command line.\n";
+  "  on the command line.\n"
+  "\n"
+  "The arrays are read by windows of at most <buffer_size> bytes (64M by\n"
+  "default, K, M and G suffixes are accepted). The summary can be restricted\n"
+  "to some rows of an array with the syntaxes <var_name>[<a>:<b>],\n"
+  "<var_name>[<a>:<b>:<s>] and <var_name>@<filename>, see 'db dump -h'. The\n"
+  "variables selected with the -g, -e, -T, -S and -M options (see 'db ls -h')\n"
+  "are shown after the variables named on the command line.\n";
 
 const char* info_help_message =
   "USAGE: db info <db_filename> [-h]\n"
   "  Show the content of the infoblock stored in the dbfile.\n";
 
 
+const char* stats_help_message =
+  "USAGE: db stats <db_filename> [-h] [-j <threads>] [-B <buffer_size>] [-p <percentile>]*\n"
+  "                <var_name>*\n"
+  "  Compute per component statistics of the real, integer and element arrays\n"
+  "  given on the command line.\n"
+  "\n"
+  "Without any <var_name>, all the real arrays of the dbfile are processed.\n"
+  "For each component, the minimum, maximum, mean, L1, L2 and Linf norms are\n"
+  "computed on the finite values, and the NaN and Inf values are counted.\n"
+  "The sums are computed by pairwise summation in a fixed order, so the\n"
+  "results do not depend on the number of threads, nor on the buffer size.\n"
+  "\n"
+  "The 'stats' action accepts the following options:\n"
+  "  -p <percentile>  Also estimate the given percentile, in [0, 100], of each\n"
+  "                   component, with a relative error below 0.5%. This option\n"
+  "                   can occur multiple times.\n"
+  "  -j <threads>     Number of threads used for the reductions. Defaults to\n"
+  "                   the number of hardware threads.\n"
+  "  -B <buffer_size> The arrays are read by windows of at most <buffer_size>\n"
+  "                   bytes (64M by default, K, M and G suffixes are accepted).\n"
+  "  -h               Print this message.\n";
+
+
+const char* histogram_help_message =
+  "USAGE: db histogram <db_filename>+ [-h] -v <var_name> [-c <component>] [-b <bins>]\n"
+  "                    [-r <min> <max>] [-l] [-q <percentile>]* [-a <accuracy>] [-j <threads>]\n"
+  "                    [-B <buffer_size>]\n"
+  "  Compute the histogram of the values of the real, integer or element array\n"
+  "  <var_name>, aggregated over all the dbfiles given on the command line.\n"
+  "\n"
+  "The dbfiles are processed one at a time. Without the '-r' option, a first\n"
+  "pass over the dbfiles determines the range of the values. The percentiles\n"
+  "are estimated in the same pass as the histogram with a mergeable quantile\n"
+  "sketch, whose relative error is bounded by the accuracy.\n"
+  "\n"
+  "The 'histogram' action accepts the following options:\n"
+  "  -v <var_name>    The array variable to process. Mandatory.\n"
+  "  -c <component>   Only process the component <component> of the array.\n"
+  "                   By default, the values of all the components are used.\n"
+  "  -b <bins>        Number of bins. Defaults to 20.\n"
+  "  -r <min> <max>   Range of the histogram. Values outside the range are\n"
+  "                   counted as underflow or overflow.\n"
+  "  -l               Use logarithmic bins. The non positive values are counted\n"
+  "                   as underflow.\n"
+  "  -q <percentile>  Estimate the given percentile, in [0, 100]. This option\n"
+  "                   can occur multiple times.\n"
+  "  -a <accuracy>    Relative accuracy of the quantile sketch. Defaults to 0.005.\n"
+  "  -j <threads>     Number of threads. Defaults to the number of hardware threads.\n"
+  "  -B <buffer_size> The arrays are read by windows of at most <buffer_size>\n"
+  "                   bytes (64M by default, K, M and G suffixes are accepted).\n"
+  "  -h               Print this message.\n";
+
+
+const char* transfer_help_message =
+  "USAGE: db transfer <db_filename> [-h] [-j <threads>] [-B <buffer_size>] <mesh_name> <var_name>\n"
+  "                   --to nodes|elems -o <output_db_filename> [-n <output_var_name>]\n"
+  "  Transfer a field of the mesh <mesh_name> from its elements to its nodes, or\n"
+  "  from its nodes to its elements, and write it into a new dbfile.\n"
+  "\n"
+  "<var_name> is either the full name of the real, integer or element array, or\n"
+  "its name without the '<mesh_name>_' prefix. With '--to nodes', the field must\n"
+  "have one row per element, and each node gets the mean of the values of the\n"
+  "elements around it (0 for the nodes outside of any element). With '--to elems',\n"
+  "the field must have one row per node, and each element gets the mean of the\n"
+  "values of its distinct nodes. All the components are transferred.\n"
+  "\n"
+  "The output dbfile holds the <mesh_name>_nodes, <mesh_name>_elems and\n"
+  "<mesh_name>_refs arrays, and the transferred field as a real array, named\n"
+  "after the input field unless the '-n' option is given.\n"
+  "\n"
+  "The mesh, the whole input field and the transferred field are held in memory,\n"
+  "since the rows gathered by a node or an element may lie anywhere in the field:\n"
+  "the '-B' option does not bound the memory used by the transfer itself.\n"
+  "\n"
+  "The 'transfer' action accepts the following options:\n"
+  "  -j <threads>     Number of threads. Defaults to the number of hardware threads.\n"
+  "  -B <buffer_size> The mesh arrays are copied by chunks of at most <buffer_size>\n"
+  "                   bytes (64M by default, K, M and G suffixes are accepted).\n"
+  "  -h               Print this message.\n";
+
+
+const char* reorder_help_message =
+  "USAGE: db reorder <db_filename> [-h] [-m rcm|morton] [-j <threads>] [-B <buffer_size>]\n"
+  "                  [-r <repetitions>] <mesh_name> -o <output_db_filename>\n"
+  "  Renumber the nodes and elements of the mesh <mesh_name> to improve the\n"
+  "  memory locality of the computations over the connectivity, and write the\n"
+  "  renumbered dbfile.\n"
+  "\n"
+  "The node order is either the reverse Cuthill-McKee order of the node\n"
+  "adjacency ('rcm', by default), or the order along a Morton space filling\n"
+  "curve ('morton'). The elements are sorted by the smallest new index of their\n"
+  "nodes. The rows of <mesh_name>_nodes, <mesh_name>_elems, <mesh_name>_refs and\n"
+  "of the nodal and elemental variables of the mesh (see 'db mesh -h'), real or\n"
+  "integer, are permuted, and the node indices in <mesh_name>_elems are\n"
+  "renumbered. The other variables are copied unchanged.\n"
+  "\n"
+  "The bandwidth of the node adjacency is reported before and after the\n"
+  "renumbering, as well as the time taken by nodal to elemental and elemental\n"
+  "to nodal transfers of a 3 components field on both numberings.\n"
+  "\n"
+  "The 'reorder' action accepts the following options:\n"
+  "  -m rcm|morton    Ordering method. Defaults to 'rcm'.\n"
+  "  -r <repetitions> Number of repetitions of the transfer benchmark. Defaults\n"
+  "                   to 5, 0 disables the benchmark.\n"
+  "  -j <threads>     Number of threads. Defaults to the number of hardware threads.\n"
+  "  -B <buffer_size> The variables are written by a background thread while\n"
+  "                   the next ones are permuted, through a queue of at most\n"
+  "                   <buffer_size> bytes (64M by default, K, M and G suffixes\n"
+  "                   are accepted).\n"
+  "  -h               Print this message.\n";
+
+
+const char* probe_help_message =
+  "USAGE: db probe <db_filename> [-h] [-j <threads>] [-I] [-f <points_filename>]\n"
+  "                <mesh_name> <var_name> [<x> <y> <z>]*\n"
+  "  Interpolate a nodal or elemental field of the mesh <mesh_name> at the\n"
+  "  given points.\n"
+  "\n"
+  "<var_name> is either the full name of the real, integer or element array, or\n"
+  "its name without the '<mesh_name>_' prefix. The points are given on the\n"
+  "command line, or in a text file of whitespace separated coordinates, with as\n"
+  "many coordinates per point as the mesh has dimensions. The element containing\n"
+  "each point is found with a bounding volume hierarchy over the elements, then\n"
+  "nodal fields are interpolated with the P1/Q1 shape functions of the element,\n"
+  "and elemental fields take the value of the element. The meshes of segments,\n"
+  "triangles, quadrangles, tetrahedra, prisms and hexahedra are supported.\n"
+  "\n"
+  "One line is printed per point, with its coordinates, the 1-based index of\n"
+  "the element containing it (0 if the point is outside of the mesh, in which\n"
+  "case the values are NaN), and the components of the field.\n"
+  "\n"
+  "The 'probe' action accepts the following options:\n"
+  "  -f <points_filename>  Read the points from this file.\n"
+  "  -I                    Save the hierarchy in <db_filename>.<mesh_name>.bvh, and\n"
+  "                        reuse it in the next calls, as long as the dbfile is\n"
+  "                        not modified.\n"
+  "  -j <threads>          Number of threads. Defaults to the number of hardware\n"
+  "                        threads.\n"
+  "  -h                    Print this message.\n";
+
+
+const char* geom_help_message =
+  "USAGE: db geom <db_filename> [-h] [-j <threads>] [-B <buffer_size>]\n"
+  "               [-o <output_db_filename>] <mesh_name>*\n"
+  "  Compute the geometry of the meshes: bounding boxes, element measures\n"
+  "  (lengths, areas or volumes) and centroids, and their totals per reference.\n"
+  "\n"
+  "Without <mesh_name>, all the meshes of the dbfile are processed. For each\n"
+  "mesh, the axis aligned bounding box of the nodes is printed. For the meshes\n"
+  "of segments, triangles, quadrangles, tetrahedra, prisms and hexahedra, the\n"
+  "measures of the elements are computed by quadrature of the determinant of\n"
+  "the jacobian, and the total measure, the smallest and largest element\n"
+  "measures, the number of distorted elements (whose jacobian vanishes or\n"
+  "changes sign at the quadrature points), and the number of elements and\n"
+  "the measure of each reference of <mesh_name>_refs are printed. The totals\n"
+  "do not depend on the number of threads. Only the bounding box is printed for\n"
+  "the other meshes, such as the POINT meshes.\n"
+  "\n"
+  "With the '-o' option, a new dbfile is written with, for each mesh, the\n"
+  "<mesh_name>_nodes, <mesh_name>_elems and <mesh_name>_refs arrays, and when\n"
+  "they are computed, the <mesh_name>_measure and <mesh_name>_centroid real\n"
+  "arrays, with one row per element.\n"
+  "\n"
+  "The 'geom' action accepts the following options:\n"
+  "  -o <output_db_filename>  Write the measures and centroids in this dbfile.\n"
+  "  -j <threads>             Number of threads. Defaults to the number of hardware\n"
+  "                           threads.\n"
+  "  -B <buffer_size>         The mesh arrays are copied by chunks of at most\n"
+  "                           <buffer_size> bytes (64M by default, K, M and G\n"
+  "                           suffixes are accepted).\n"
+  "  -h                       Print this message.\n";
+
+
+const char* integrate_help_message =
+  "USAGE: db integrate <db_filename>+ [-h] -m <mesh_name> -v <var_name>+ [-r <reference>]*\n"
+  "                    [-M] [-j <threads>]\n"
+  "  Integrate nodal or elemental fields of the mesh <mesh_name> over the\n"
+  "  elements of each reference of <mesh_name>_refs, in each dbfile given on the\n"
+  "  command line.\n"
+  "\n"
+  "<var_name> is either the full name of the real, integer or element array, or\n"
+  "its name without the '<mesh_name>_' prefix. The nodal fields are interpolated\n"
+  "with the P1/Q1 shape functions of the elements and integrated with the\n"
+  "quadrature rules of 'db geom', and the elemental fields are integrated as\n"
+  "constants on each element. All the components are integrated. The meshes of\n"
+  "segments, triangles, quadrangles, tetrahedra, prisms and hexahedra are\n"
+  "supported.\n"
+  "\n"
+  "The mesh is read from the first dbfile, and the quadrature weights computed\n"
+  "once, then the fields of the dbfiles are read one after the other, the next\n"
+  "dbfile being read while the current one is integrated. The sums are reduced\n"
+  "in a fixed order, so the results do not depend on the number of threads.\n"
+  "\n"
+  "For each dbfile and each field, one line is printed per reference, with the\n"
+  "reference, its number of elements, its measure and the integrals of the\n"
+  "components, followed by the totals over the printed references.\n"
+  "\n"
+  "The 'integrate' action accepts the following options:\n"
+  "  -m <mesh_name>   The mesh to integrate on. Mandatory.\n"
+  "  -v <var_name>    A field to integrate. This option can occur multiple times,\n"
+  "                   at least once.\n"
+  "  -r <reference>   Only print this reference. This option can occur multiple\n"
+  "                   times. By default, all the references are printed.\n"
+  "  -M               Read the mesh from each dbfile, for the meshes which move or\n"
+  "                   change between the dbfiles.\n"
+  "  -j <threads>     Number of threads. Defaults to the number of hardware threads.\n"
+  "  -h               Print this message.\n";
+
+
+const char* export_help_message =
+  "USAGE: db export <db_filename>+ [-h] -m <mesh_name> [-v <var_name>]* [<selection>]*\n"
+  "                 -f ensight|vtk -o <output_prefix> [-t <time_var_name>] [-j <threads>]\n"
+  "                 [-B <buffer_size>]\n"
+  "  Export the mesh <mesh_name> and some of its nodal and elemental fields to\n"
+  "  EnSight Gold or VTK binary files, as a time series over the dbfiles given\n"
+  "  on the command line.\n"
+  "\n"
+  "<var_name> is either the full name of the real, integer or element array, or\n"
+  "its name without the '<mesh_name>_' prefix, and must have one row per node\n"
+  "or per element in every dbfile. The nodal and elemental real arrays of the\n"
+  "mesh selected in the first dbfile with the -g, -e, -T and -S options (see\n"
+  "'db ls -h') are exported as well. The <mesh_name>_refs array is always\n"
+  "exported as the elemental field 'refs'. The meshes of points, segments,\n"
+  "triangles, quadrangles, tetrahedra, prisms and hexahedra are supported.\n"
+  "\n"
+  "With '-f ensight', the files are <output_prefix>.case, the geometry\n"
+  "<output_prefix>.geo, read from the first dbfile, and one file\n"
+  "<output_prefix>.<field>.<step> per field and dbfile, in single precision.\n"
+  "The fields with 3 components (or 2 in a 2D mesh) are exported as vectors,\n"
+  "the others as one scalar per component, named <field>_<component>.\n"
+  "With '-f vtk', one unstructured grid <output_prefix>.<step>.vtu is written\n"
+  "per dbfile, in double precision, and the <output_prefix>.pvd collection lists\n"
+  "them.\n"
+  "\n"
+  "The time of each step is the real number <time_var_name> of the dbfile,\n"
+  "<mesh_name>_time by default, or the number of the step if it does not exist.\n"
+  "\n"
+  "The arrays are streamed from the dbfiles to the output files, and the\n"
+  "dbfiles are exported in parallel.\n"
+  "\n"
+  "The 'export' action accepts the following options:\n"
+  "  -m <mesh_name>       The mesh to export. Mandatory.\n"
+  "  -v <var_name>        A field to export. This option can occur multiple times.\n"
+  "  -f ensight|vtk       The output format. Mandatory.\n"
+  "  -o <output_prefix>   The prefix of the output files, possibly with a\n"
+  "                       directory. Mandatory.\n"
+  "  -t <time_var_name>   The real number holding the time of the dbfiles.\n"
+  "  -j <threads>         Number of dbfiles exported at the same time. Defaults\n"
+  "                       to the number of hardware threads.\n"
+  "  -B <buffer_size>     The arrays are read by windows of at most <buffer_size>\n"
+  "                       bytes per thread (64M by default, K, M and G suffixes\n"
+  "                       are accepted).\n"
+  "  -h                   Print this message.\n";
+
+
+const char* spmv_help_message =
+  "USAGE: db spmv <db_filename> [-h] [-j <threads>] [-r <repetitions>] <var_name>+\n"
+  "  Benchmark the sparse matrix-vector products on the sky_matrix variables\n"
+  "  <var_name>, in their skyline layout and converted to the CSR layout.\n"
+  "\n"
+  "The layout of the sky_matrix is assumed to be the profile storage of the\n"
+  "Fortran finite element codes: two int*4, the number of equations neq and\n"
+  "0 for a symmetric matrix or 1 otherwise, neq + 1 int*4 pointers to the\n"
+  "first term of each column of the upper triangle (1-based), padded to 8\n"
+  "bytes, then the real*8 diagonal, the upper triangle by columns, and for the\n"
+  "non symmetric matrices, the lower triangle by rows with the same profile.\n"
+  "The variables which do not match this layout are rejected.\n"
+  "\n"
+  "The time of the conversion to CSR, without the zero terms of the profile,\n"
+  "is reported, then the mean time and the rate of the products in both\n"
+  "layouts, and the largest difference between their results relative to the\n"
+  "largest value of the product.\n"
+  "\n"
+  "The 'spmv' action accepts the following options:\n"
+  "  -r <repetitions> Number of products timed in each layout. Defaults to 10.\n"
+  "  -j <threads>     Number of threads. Defaults to the number of hardware threads.\n"
+  "  -h               Print this message.\n";
+
+
+const char* delta_help_message =
+  "USAGE: db delta <db_filename> [-h] [-x] [-B <buffer_size>] -b <base_db_filename>\n"
+  "                -o <output_db_filename>\n"
+  "  Write the delta of <db_filename> relative to <base_db_filename>: a dbfile\n"
+  "  holding only the variables which changed, and the name of its base.\n"
+  "\n"
+  "A variable is stored in the delta if it is not in the base, or if its type,\n"
+  "size or data differ, the data being compared by chunks of at most\n"
+  "<buffer_size> bytes (64M by default, K, M and G suffixes are accepted). The\n"
+  "variables of the base which are not in <db_filename> are recorded as\n"
+  "deleted. The base can itself be a delta.\n"
+  "\n"
+  "With -x, a changed variable of the same type and size as in the base is\n"
+  "stored XORed with the base variable, byte shuffled and with its runs of\n"
+  "zero bytes coded by their length, if that saves a quarter of its size. This\n"
+  "suits the slowly varying fields, whose leading bytes barely change.\n"
+  "\n"
+  "The delta is opened with its chain of bases by all the actions, each\n"
+  "variable being read from the newest dbfile holding it. The variables of the\n"
+  "base come first, in their order, followed by the new ones. The base path is\n"
+  "recorded relative to the delta if both are in the same directory, and\n"
+  "absolute otherwise, with a signature of the base which is checked when the\n"
+  "delta is opened. See 'db materialize' to write a delta as a full dbfile.\n";
+
+const char* materialize_help_message =
+  "USAGE: db materialize <db_filename> [-h] [-j <threads>] [-B <buffer_size>]\n"
+  "                      -o <output_db_filename>\n"
+  "  Write all the variables of <db_filename>, usually a delta dbfile read\n"
+  "  through its chain of bases, as a full dbfile.\n"
+  "\n"
+  "The variables are copied as by 'db extract', by <threads> threads and by\n"
+  "chunks of at most <buffer_size> / <threads> bytes, except the encoded\n"
+  "variables of the deltas, which are decoded at once.\n"
+  "\n"
+  "The variables of a delta are those of its base, in their order, followed by\n"
+  "the new ones. The output is byte-identical to the full dbfile the delta was\n"
+  "made from only if that dbfile has its variables in the same order; otherwise\n"
+  "it holds the same variables in another order.\n";
+
+const char* catalog_help_message =
+  "USAGE: db catalog build <directory> [-h] [-j <threads>] [-o <catalog_filename>]\n"
+  "       db catalog query <catalog> [-h] [-v] [-n <var_name>]* [-g <pattern>]*\n"
+  "                        [-t <datatype>]* [-r <rows>] [-c <components>] [-m <mesh>]*\n"
+  "  Record the variables and the meshes of all the dbfiles of a directory\n"
+  "  tree in a catalog file, and find the dbfiles holding given variables.\n"
+  "\n"
+  "'build' writes the catalog of <directory> and its subdirectories, by\n"
+  "default in <directory>/.dbcatalog. If the catalog exists, only the files\n"
+  "whose size or modification time changed since are opened, by <threads>\n"
+  "threads (all the cores by default). The name, datatype and size of the\n"
+  "variables, the rows and components of the arrays, and the meshes of each\n"
+  "dbfile are recorded, with a bloom filter over the names of its variables\n"
+  "and their '_' separated tokens.\n"
+  "\n"
+  "'query' lists the dbfiles of the catalog <catalog> (or <catalog>/.dbcatalog\n"
+  "if <catalog> is a directory) holding a variable which matches all the\n"
+  "following criteria, and all the meshes given with -m. The bloom filters\n"
+  "rule out most of the dbfiles for the queries by name, by mesh, and by\n"
+  "pattern with complete tokens (e.g. 'cuveb_*' but not 'cuv*').\n"
+  "\n"
+  "The 'query' action accepts the following options:\n"
+  "  -n <var_name>    Variables named <var_name>. Can be repeated.\n"
+  "  -g <pattern>     Variables whose name matches the glob <pattern>. Can be\n"
+  "                   repeated, and combined with -n.\n"
+  "  -t <datatype>    Variables of this datatype. Can be repeated.\n"
+  "  -r <rows>        Arrays of <rows> rows.\n"
+  "  -c <components>  Arrays of <components> components.\n"
+  "  -m <mesh>        DBfiles holding the mesh <mesh>. Can be repeated.\n"
+  "  -v               Print the matching variables of each dbfile, with their\n"
+  "                   datatype, size, rows and components.\n"
+  "  -h               Print this message.\n";
+
+const char* serve_help_message =
+  "USAGE: db serve <socket_path> [-h] [-j <threads>] [-C <cache_size>]\n"
+  "  Answer the requests of 'db query' on the Unix domain socket <socket_path>,\n"
+  "  until interrupted.\n"
+  "\n"
+  "The dbfiles stay open between the requests, with their parsed headers and\n"
+  "name indexes, so a request only costs the reads it needs. The decoded\n"
+  "arrays of at most 16M are kept in a cache of <cache_size> bytes (256M by\n"
+  "default, K, M and G suffixes are accepted), shared with the meshes and\n"
+  "their bounding volume hierarchies, which are built once for 'probe'. Each\n"
+  "dbfile is stat'ed before a request, and reopened if it changed since.\n"
+  "\n"
+  "The requests are answered by <threads> threads (all the cores by default),\n"
+  "one request at a time per connection. A connection which stalls for 10\n"
+  "seconds in the middle of a request or of its response is dropped, and a\n"
+  "response larger than 2G is replaced by an error. On exit, the numbers of\n"
+  "connections, requests, errors and reopened dbfiles are printed.\n";
+
+const char* query_help_message =
+  "USAGE: db query <socket_path> ls <db_filename>\n"
+  "       db query <socket_path> show <db_filename> <var_name>\n"
+  "       db query <socket_path> dump <db_filename> <var_name>[<rows>]\n"
+  "       db query <socket_path> stats <db_filename> [-p <percentile>]* <var_name>\n"
+  "       db query <socket_path> probe <db_filename> <mesh> <var_name> <coordinates>+\n"
+  "       db query <socket_path> bench <db_filename> [-n <requests>] [-c <clients>]\n"
+  "                <var_name>[<rows>]\n"
+  "  Send a request to the server started by 'db serve' on <socket_path>.\n"
+  "\n"
+  "'ls' lists the variables, 'show' prints the dimensions of a variable with\n"
+  "the range of each component of the arrays, 'dump' prints the rows of an\n"
+  "array, possibly selected as with 'db dump', 'stats' prints the statistics\n"
+  "of an array as 'db stats', and 'probe' prints the values of a field at the\n"
+  "given points, whose coordinates follow each other.\n"
+  "\n"
+  "'bench' sends <requests> 'show' and as many 'dump' requests of <var_name>,\n"
+  "the dumps being restricted to the optional row selection (1000 requests by\n"
+  "default), from <clients> connections (1 by default). It prints the mean,\n"
+  "median, 99th percentile and maximum latencies, next to the time to open the\n"
+  "dbfile, read its header and read the variable in this process.\n";
+
+const char* batch_help_message =
+  "USAGE: db batch <db_filename> [-h] [-e] [-f <commands_filename>] [-B <buffer_size>]\n"
+  "  Run the actions read from <commands_filename>, or from the standard input,\n"
+  "  on <db_filename>, opened and indexed once for all of them.\n"
+  "\n"
+  "Each line holds an action and its parameters without the dbfile, as\n"
+  "'show -B 16M box_temperature', the single and double quotes grouping\n"
+  "words. The empty lines and the lines starting with '#' are ignored. The\n"
+  "actions 'ls', 'show', 'dump', 'mesh', 'info', 'extract', 'stats',\n"
+  "'histogram', 'transfer', 'reorder', 'probe', 'geom', 'integrate', 'export',\n"
+  "'spmv', 'delta', 'materialize' and 'convert' are accepted, and all the\n"
+  "lines are checked before the first one is run.\n"
+  "\n"
+  "The variables named by the 'show' and 'dump' lines are read ahead in a\n"
+  "single plan, in file order, up to <buffer_size> bytes (64M by default, K,\n"
+  "M and G suffixes are accepted). The output of the n-th action is enclosed\n"
+  "between the lines '#@ begin <n> <line>' and '#@ end <n> ok', or\n"
+  "'#@ end <n> error <message>' if it failed. The following actions are still\n"
+  "run, unless -e is given, and the batch fails if any of them did.\n";
+
+const char* merge_help_message =
+  "USAGE: db merge -o <output_db_filename> [-h] [-j <threads>] [-B <buffer_size>]\n"
+  "                [-p first|last|prefix] [<selection>]* <db_filename>+\n"
+  "  Write the variables of several dbfiles in a single new dbfile.\n"
+  "\n"
+  "The variables of each <db_filename> selected with the -g, -e, -T, -S and -M\n"
+  "options (see 'db ls -h'), all of them by default, are written in the order\n"
+  "of the dbfiles and of their variables. A name held by several dbfiles is\n"
+  "resolved by the -p policy:\n"
+  "  first   The variable of the first dbfile holding it is kept (default).\n"
+  "  last    The variable of the last dbfile holding it is kept.\n"
+  "  prefix  All are kept, the name being prefixed by the name of the dbfile\n"
+  "          without its directory and extension, and an underscore.\n"
+  "\n"
+  "The layout and the name slots of the new dbfile are checked before\n"
+  "anything is written, and its header is written once. The payloads are\n"
+  "copied by the kernel (copy_file_range) when possible, by <threads> threads\n"
+  "(all the cores by default) and by chunks of at most <buffer_size> /\n"
+  "<threads> bytes (64M by default, K, M and G suffixes are accepted). The\n"
+  "encoded variables of delta dbfiles are decoded and written instead. The\n"
+  "payloads which are not a multiple of 8 bytes, as found in extended dbfiles\n"
+  "(see 'db convert'), are padded with zeros. The new dbfile is written as\n"
+  "<output_db_filename>.partial, and renamed once complete.\n";
+
+const char* convert_help_message =
+  "USAGE: db convert <db_filename> [-h] [-f legacy|extended] [-B <buffer_size>]\n"
+  "                  -o <output_db_filename>\n"
+  "  Write the variables of <db_filename> in a new dbfile with the legacy\n"
+  "  header or the extended one, the other format by default.\n"
+  "\n"
+  "The legacy header has fixed tables of 26500 name slots, a name taking one\n"
+  "slot per 32 characters, 32 bits lengths and offsets in units of doubles,\n"
+  "and takes about 1 MB. The extended header holds a table of the variables\n"
+  "with 64 bits lengths and offsets, which grows with the number of variables\n"
+  "and the length of their names. The variables, their names, types and\n"
+  "payloads are kept, in their order; a conversion to the legacy format is\n"
+  "refused if the variables do not fit in its tables or if a payload is not a\n"
+  "multiple of 8 bytes. The payloads are copied by chunks of at most\n"
+  "<buffer_size> bytes (64M by default, K, M and G suffixes are accepted).\n"
+  "Delta dbfiles are not converted, see 'db materialize'. The new dbfile is\n"
+  "written as <output_db_filename>.partial, and renamed once complete.\n";
+
 const char* extract_help_message =
-  "USAGE: db extract <db_filename> -o <output_db_filename> <var_name>+\n"
-  "  Create a new dbfile from the list of variables <var_name>.";
+  "USAGE: db extract <db_filename> [-j <threads>] [-B <buffer_size>] -o <output_db_filename>\n"
+  "                  [<selection>]* <var_name>*\n"
+  "  Create a new dbfile from the list of variables <var_name>, and the\n"
+  "  variables selected with the -g, -e, -T, -S and -M options (see 'db ls -h').\n"
+  "\n"
+  "The layout of the new dbfile is reserved first, then the variables are\n"
+  "copied by <threads> threads (all the cores by default), by chunks of at\n"
+  "most <buffer_size> / <threads> bytes (64M by default, K, M and G suffixes\n"
+  "are accepted). The payloads which are not a multiple of 8 bytes, as found\n"
+  "in extended dbfiles (see 'db convert'), are padded with zeros. The new\n"
+  "dbfile is written as <output_db_filename>.partial, and renamed once\n"
+  "complete.";
 
 inline
 void check_file_read_accessibility(const std::string& filename, const std::string& error_msg) {
@@ -145,6 +667,260 @@ void check_file_read_accessibility(const std::string& filename, const std::strin
     }
 }
 
+/*
+ *  DBfile shared by all the commands of 'db batch': the actions open
+ *  their dbfile with open_dbfile and index it with index_dbfile, which
+ *  return the ones of the batch instead of opening and indexing the file
+ *  again. The payloads read ahead by the batch are used by
+ *  for_each_variable_payload.
+ */
+struct batch_dbfile {
+  std::string filename;
+  std::shared_ptr<alucell::database_read_access> db;
+  std::shared_ptr<alucell::database_index> index;
+  std::map<unsigned int, std::vector<char> > payloads;
+};
+
+batch_dbfile* current_batch(NULL);
+
+std::shared_ptr<alucell::database_read_access> open_dbfile(const std::string& filename) {
+  if (current_batch and filename == current_batch->filename)
+    return current_batch->db;
+  return std::make_shared<alucell::database_read_access>(filename);
+}
+
+std::shared_ptr<alucell::database_index> index_dbfile(alucell::database_read_access* db) {
+  if (current_batch and db == current_batch->db.get())
+    return current_batch->index;
+  return std::make_shared<alucell::database_index>(db);
+}
+
+/*
+ *  Parse a memory size given in bytes, with an optional K, M or G
+ *  suffix (powers of 1024). A null size is refused.
+ */
+std::size_t parse_memory_size(const std::string& s) {
+  std::size_t size(0);
+  try {
+    size = alucell::variable_selector::parse_size(s);
+  }
+  catch (const std::string&) {
+    size = 0;
+  }
+
+  if (size == 0)
+    throw "Invalid memory size " + s + ".";
+  return size;
+}
+
+inline bool is_array_type(alucell::data_type t) {
+  return t == alucell::data_type::real_array
+    or t == alucell::data_type::int_array
+    or t == alucell::data_type::element_array;
+}
+
+/*
+ *  Parse the variable selection option at argv[0], if it is one (see
+ *  list_help_message), and consume its parameter.
+ */
+bool parse_selection_option(int& argc, char**& argv, alucell::variable_selector& selector) {
+  const std::string option(argv[0]);
+  if (option != "-g" and option != "-e" and option != "-T" and option != "-S" and option != "-M")
+    return false;
+  if (argc < 2)
+    throw "expected parameter following '" + option + "' option.";
+
+  const std::string value(argv[1]);
+  if (option == "-g") {
+    selector.add_pattern(value);
+  } else if (option == "-e") {
+    selector.add_regex(value);
+  } else if (option == "-T") {
+    const alucell::data_type t(alucell::pretty_name_to_data_type(value));
+    if (t == alucell::data_type::unknown)
+      throw "Invalid datatype name " + value + ".";
+    selector.add_type(t);
+  } else if (option == "-S") {
+    selector.add_size_predicate(value);
+  } else {
+    selector.add_mesh(value);
+  }
+
+  --argc;
+  ++argv;
+  return true;
+}
+
+/*
+ *  Read the data of the variables 'ids' with the batch read planner, by
+ *  batches of at most 'buffer_size' bytes, and call f(k, payload) for
+ *  each variable, in the order of 'ids'. The variables flagged in
+ *  'streamed' are not read, they are given an empty payload and are
+ *  expected to be streamed by 'f'. The payloads already read by 'db
+ *  batch' are not read again.
+ */
+template<typename F>
+void for_each_variable_payload(alucell::database_read_access* db,
+			       const std::vector<unsigned int>& ids,
+			       const std::vector<bool>& streamed,
+			       std::size_t buffer_size, F f) {
+  std::vector<std::vector<char> > payloads(ids.size());
+  const std::vector<char> empty_payload;
+  const std::map<unsigned int, std::vector<char> >* read_ahead(NULL);
+  if (current_batch and db == current_batch->db.get())
+    read_ahead = &current_batch->payloads;
+
+  for (std::size_t b(0), e(0); b < ids.size(); b = e) {
+    std::size_t batch_size(0);
+    std::vector<alucell::read_request> requests;
+    for (e = b; e < ids.size(); ++e) {
+      if (streamed[e] or (read_ahead and read_ahead->count(ids[e])))
+	continue;
+
+      const std::size_t size(db->get_variable_size(ids[e]));
+      if (batch_size > 0 and batch_size + size > buffer_size)
+	break;
+
+      batch_size += size;
+      payloads[e].resize(size);
+      alucell::read_request r = {ids[e], 0, size, payloads[e].data()};
+      requests.push_back(r);
+    }
+
+    db->read_batch_from_database(requests);
+
+    for (std::size_t k(b); k < e; ++k) {
+      if (streamed[k])
+	f(k, empty_payload);
+      else if (read_ahead and read_ahead->count(ids[k]))
+	f(k, read_ahead->at(ids[k]));
+      else
+	f(k, payloads[k]);
+      std::vector<char>().swap(payloads[k]);
+    }
+  }
+}
+
+/*
+ *  Resolve a variable specification, possibly with a row selection, to
+ *  a variable id. A variable whose name is the whole specification takes
+ *  precedence over the slicing syntax.
+ */
+std::pair<unsigned int, alucell::row_selection>
+resolve_variable_slice(alucell::database_read_access* db, alucell::database_index* index,
+		       const std::string& spec) {
+  if (index->exists(spec))
+    return std::make_pair(index->get_variable_id(spec), alucell::row_selection());
+
+  const std::pair<std::string, alucell::row_selection> slice(alucell::parse_variable_slice(spec));
+  const unsigned int id(index->get_variable_id(slice.first));
+
+  if (not slice.second.is_all()
+      and db->get_variable_type(id) != alucell::data_type::real_array
+      and db->get_variable_type(id) != alucell::data_type::int_array
+      and db->get_variable_type(id) != alucell::data_type::element_array)
+    throw "Row selection on " + slice.first + ", which is not an array.";
+
+  return std::make_pair(id, slice.second);
+}
+
+/*
+ *  Resolve the variables named on the command line, with their row
+ *  selections, followed by the other variables selected by 'selector',
+ *  whose names are appended to 'names'. The arrays which are sliced or
+ *  larger than 'buffer_size' are flagged in 'streamed'.
+ */
+void resolve_variables(alucell::database_read_access* db, std::vector<std::string>& names,
+		       const alucell::variable_selector& selector, std::size_t buffer_size,
+		       std::vector<unsigned int>& ids, std::vector<alucell::row_selection>& selections,
+		       std::vector<bool>& streamed) {
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(db));
+  for (const auto& name: names) {
+    const std::pair<unsigned int, alucell::row_selection> slice(resolve_variable_slice(db, index.get(), name));
+    ids.push_back(slice.first);
+    selections.push_back(slice.second);
+  }
+
+  if (not selector.empty()) {
+    const std::set<unsigned int> named(ids.begin(), ids.end());
+    for (const auto id: selector.select(db))
+      if (not named.count(id)) {
+	names.push_back(db->get_variable_name(id));
+	ids.push_back(id);
+	selections.push_back(alucell::row_selection());
+      }
+  }
+
+  for (std::size_t k(0); k < ids.size(); ++k)
+    streamed.push_back((is_array_type(db->get_variable_type(ids[k]))
+			and (not selections[k].is_all()
+			     or db->get_variable_size(ids[k]) > buffer_size)));
+}
+
+template<typename S>
+void dump_rows(S& v) {
+  std::cout.precision(12);
+
+  while (v.next()) {
+    for (std::size_t i(0); i < v.get_window_rows(); ++i) {
+      for (unsigned int j(0); j < v.get_components(); ++j)
+	std::cout << std::setw(16) << std::right << v.get_value(i, j);
+      std::cout << std::endl;
+    }
+  }
+}
+
+template<typename T>
+void dump_array(alucell::database_read_access* db, unsigned int id,
+		const alucell::row_selection& selection, std::size_t buffer_size,
+		const std::vector<char>& payload) {
+  if (payload.size()) {
+    alucell::variable::array_stream<T> v(payload);
+    dump_rows(v);
+  } else if (selection.is_all()) {
+    alucell::variable::array_stream<T> v(db, id, buffer_size);
+    dump_rows(v);
+  } else {
+    alucell::variable::array_slice_stream<T> v(db, id, selection, buffer_size);
+    dump_rows(v);
+  }
+}
+
+/*
+ *  Dump a full matrix. The text and binary outputs are by rows, so the
+ *  matrix is transposed by panels of rows holding at most 'buffer_size'
+ *  bytes.
+ */
+void dump_matrix(const alucell::matrix_view& a, const std::string& format, std::size_t buffer_size) {
+  if (format == "market") {
+    std::cout.precision(17);
+    alucell::write_matrix_market(std::cout, a);
+    std::cout.flush();
+    return;
+  }
+
+  const std::size_t columns(a.get_columns());
+  const std::size_t panel_rows(std::max<std::size_t>(1, buffer_size / std::max<std::size_t>(1, columns * sizeof(double))));
+  std::vector<double> panel(std::min(panel_rows, a.get_rows()) * columns);
+  std::cout.precision(12);
+
+  for (std::size_t b(0); b < a.get_rows(); b += panel_rows) {
+    const std::size_t rows(std::min(panel_rows, a.get_rows() - b));
+    alucell::transpose(a.block(b, 0, rows, columns), panel.data(), columns);
+
+    if (format == "binary") {
+      std::cout.write(reinterpret_cast<const char*>(panel.data()), rows * columns * sizeof(double));
+      continue;
+    }
+    for (std::size_t i(0); i < rows; ++i) {
+      for (std::size_t j(0); j < columns; ++j)
+	std::cout << std::setw(16) << std::right << panel[i * columns + j];
+      std::cout << "\n";
+    }
+  }
+  std::cout.flush();
+}
+
 void dump_variable_value(int argc, char* argv[]) {
   if (argc == 0)
     throw std::string("Expecting database filename.");
@@ -159,10 +935,28 @@ void dump_variable_value(int argc, char* argv[]) {
     ++argv;
 
     std::vector<std::string> variables_to_dump;
+    alucell::variable_selector selector;
+    std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+    std::string matrix_format("text");
     while (argc > 0) {
       if (argv[0] == std::string("-h")) {
 	std::cout << dump_help_message << std::endl;
 	return;
+      } else if (parse_selection_option(argc, argv, selector)) {
+      } else if (argv[0] == std::string("-B")) {
+	if (argc < 2)
+	  throw std::string("dump: expected parameter following '-B' option.");
+	buffer_size = parse_memory_size(argv[1]);
+	--argc;
+	++argv;
+      } else if (argv[0] == std::string("-f")) {
+	if (argc < 2)
+	  throw std::string("dump: expected parameter following '-f' option.");
+	matrix_format = argv[1];
+	if (matrix_format != "text" and matrix_format != "binary" and matrix_format != "market")
+	  throw "dump: unknown matrix format '" + matrix_format + "'.";
+	--argc;
+	++argv;
       } else {
 	variables_to_dump.push_back(argv[0]);
       }
@@ -171,73 +965,99 @@ void dump_variable_value(int argc, char* argv[]) {
       ++argv;
     }
   
-    alucell::database_read_access db(db_filename);
-    alucell::database_index index(&db);
+    if (variables_to_dump.empty() and selector.empty())
+      throw std::string("Expecting variable name(s).");
+
+    const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+    alucell::database_read_access& db(*db_access);
+    std::vector<unsigned int> ids;
+    std::vector<alucell::row_selection> selections;
+    std::vector<bool> streamed;
+    resolve_variables(&db, variables_to_dump, selector, buffer_size, ids, selections, streamed);
 
-    for (const auto& name: variables_to_dump) {
-      const unsigned int id(index.get_variable_id(name));
+    for_each_variable_payload(&db, ids, streamed, buffer_size,
+			      [&](std::size_t k, const std::vector<char>& payload) {
+      const unsigned int id(ids[k]);
 
       switch (db.get_variable_type(id)) {
       case alucell::data_type::real_array:
-	{
-	  std::cout.precision(12);
-	    
-	  alucell::variable::array<double> v(&db, id);
-	  for (unsigned int i(0); i < v.get_size(); ++i) {
-	    for (unsigned int j(0); j < v.get_components(); ++j)
-	      std::cout << std::setw(16) << std::right << v.get_value(i, j);
-	    std::cout << std::endl;
-	  }
-	}
+	dump_array<double>(&db, id, selections[k], buffer_size, payload);
 	break;
 	  
       case alucell::data_type::matrix:
-	std::cout << matrix_message << std::endl;
+	dump_matrix(alucell::matrix_view(payload.data(), payload.size()), matrix_format, buffer_size);
 	break;
 	  
       case alucell::data_type::sky_matrix:
-	std::cout << skymatrix_message << std::endl;
+	{
+	  const alucell::sky_matrix_view a(payload.data(), payload.size());
+	  std::cout.precision(17);
+	  alucell::write_matrix_market(std::cout, alucell::sky_matrix_to_csr(a), a.is_symmetric());
+	  std::cout.flush();
+	}
 	break;
 	  
       case alucell::data_type::element_array:	  
       case alucell::data_type::int_array:
-	{
-	  std::cout.precision(12);
-	    
-	  alucell::variable::array<int> v(&db, id);
-	  for (unsigned int i(0); i < v.get_size(); ++i) {
-	    for (unsigned int j(0); j < v.get_components(); ++j)
-	      std::cout << std::setw(16) << std::right << v.get_value(i, j);
-	    std::cout << std::endl;
-	  }
-	}
+	dump_array<int>(&db, id, selections[k], buffer_size, payload);
 	break;
 	  
       case alucell::data_type::real_number:
-	std::cout << alucell::variable::number(&db, id).get_value() << std::endl;
+	std::cout << alucell::variable::number(payload).get_value() << std::endl;
 	break;
 	  
       case alucell::data_type::expression:
 	{
-	  alucell::variable::expression v(&db, id);
+	  alucell::variable::expression v(payload);
 	  alucell::expression_decoder d(&v);
 	  d.dump_bytecode_assembly(std::cout);
 	}
 	break;
 	  
       case alucell::data_type::string:
-	std::cout << alucell::variable::string(&db, id).get_value() << std::endl;
+	std::cout << alucell::variable::string(payload).get_value() << std::endl;
 	break;
 
       case alucell::data_type::unknown:
       default:
 	throw std::string("unknown datatype.");
       }
+    });
+  }
+}
 
-      --argc;
-      ++argv;
-    }
+/*
+ *  Copy the raw data of a variable into another dbfile, by chunks of at
+ *  most 'buffer_size' bytes.
+ */
+void copy_variable(alucell::database_read_access* db, unsigned int id,
+		   alucell::database_write_access* output_db, const std::string& name,
+		   std::size_t buffer_size, std::vector<char>& buffer) {
+  const std::size_t size(db->get_variable_size(id));
+  buffer.resize(std::min(size, buffer_size));
+
+  output_db->begin_insert(name, db->get_variable_type(id), size);
+  for (std::size_t offset(0); offset < size; offset += buffer.size()) {
+    const std::size_t length(std::min(buffer.size(), size - offset));
+    db->read_data_from_database(id, offset, length, &buffer[0]);
+    output_db->write_data(&buffer[0], length);
+  }
+  output_db->end_insert();
+}
+
+/*
+ *  Copy the variables 'ids' of a dbfile into a new dbfile, see
+ *  alucell::copy_dbfile_variables.
+ */
+void copy_variables_in_parallel(alucell::database_read_access* db, const std::vector<unsigned int>& ids,
+				const std::string& output_db_filename, unsigned int threads,
+				std::size_t buffer_size) {
+  std::vector<alucell::copied_variable> variables;
+  for (const auto id: ids) {
+    const alucell::copied_variable v = {db, id, db->get_variable_name(id)};
+    variables.push_back(v);
   }
+  alucell::copy_dbfile_variables(variables, output_db_filename, threads, buffer_size);
 }
 
 void extract_dbfile_variables(int argc, char* argv[]) {
@@ -251,9 +1071,25 @@ void extract_dbfile_variables(int argc, char* argv[]) {
   ++argv;
 
   std::set<std::string> variables_to_extract;
+  alucell::variable_selector selector;
   std::string output_db_filename;
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  unsigned int threads(default_threads_number());
   while (argc) {
-    if (argv[0] == std::string("-o")) {
+    if (parse_selection_option(argc, argv, selector)) {
+    } else if (argv[0] == std::string("-B")) {
+      if (argc < 2)
+	throw std::string("extract dbfile variables: expected parameter following '-B' option.");
+      buffer_size = parse_memory_size(argv[1]);
+      --argc;
+      ++argv;
+    } else if (argv[0] == std::string("-j")) {
+      if (argc < 2)
+	throw std::string("extract dbfile variables: expected parameter following '-j' option.");
+      threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else if (argv[0] == std::string("-o")) {
       if (argc < 2)
 	throw std::string("extract dbfile variables: expected parameter following '-o' option.");
       output_db_filename = argv[1];
@@ -273,39 +1109,72 @@ void extract_dbfile_variables(int argc, char* argv[]) {
   if (output_db_filename.size() == 0)
     throw std::string("extract_dbfile_variables: mandatory '-o' option missing.");
 
-  alucell::database_read_access db(db_filename);
-  alucell::database_write_access output_db(output_db_filename);
-  
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  std::vector<bool> selected(db.get_variables_number(), false);
+  if (not selector.empty())
+    for (const auto i: selector.select(&db))
+      selected[i] = true;
+
+  std::vector<unsigned int> ids;
   for (unsigned int i(0); i < db.get_variables_number(); ++i) {
-    if (variables_to_extract.count(db.get_variable_name(i)) != 0) {
+    if (selected[i] or variables_to_extract.count(db.get_variable_name(i)) != 0) {
       switch(db.get_variable_type(i)) {
       case alucell::data_type::real_array:
-	alucell::variable::array<double>(&db, i).insert_into(&output_db, db.get_variable_name(i));
-	break;
       case alucell::data_type::element_array:
       case alucell::data_type::int_array:
-	alucell::variable::array<int>(&db, i).insert_into(&output_db, db.get_variable_name(i));
-	break;
       case alucell::data_type::real_number:
-	alucell::variable::number(&db, i).insert_into(&output_db, db.get_variable_name(i));
-	break;
       case alucell::data_type::expression:
-	alucell::variable::expression(&db, i).insert_into(&output_db, db.get_variable_name(i));
-	break;
       case alucell::data_type::string:
-	alucell::variable::string(&db, i).insert_into(&output_db, db.get_variable_name(i));
+	ids.push_back(i);
 	break;
       default:
 	break;
       }
     }
   }
+
+  copy_variables_in_parallel(&db, ids, output_db_filename, threads, buffer_size);
 }
 
 
-void list_dbfile_meshes(int argc, char* argv[]) {
+/*
+ *  Read the values of an array variable, and transfer them with the
+ *  mesh kernel matching 'to_nodes'. The field is read whole, not by
+ *  windows: the kernels gather the rows of the elements around a node,
+ *  or of the nodes of an element, which may lie anywhere in the field.
+ */
+template<typename T>
+std::vector<double> transfer_field(alucell::database_read_access* db, unsigned int id,
+				   const alucell::mesh& m, bool to_nodes, unsigned int threads) {
+  const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+  const std::size_t rows(dimensions.first);
+  const unsigned int components(dimensions.second);
+
+  const std::size_t expected_rows(to_nodes ? m.get_elements_number() : m.get_nodes_number());
+  if (rows != expected_rows)
+    throw "transfer: " + db->get_variable_name(id) + " has " + std::to_string(rows)
+      + " rows, expected one per " + (to_nodes ? "element" : "node")
+      + " (" + std::to_string(expected_rows) + ").";
+  if (2 * sizeof(double) + rows * components * sizeof(T) > db->get_variable_size(id))
+    throw "transfer: inconsistent array dimensions for " + db->get_variable_name(id) + ".";
+
+  std::vector<T> values(rows * components);
+  db->read_data_from_database(id, 2 * sizeof(double), values.size() * sizeof(T), values.data());
+
+  std::vector<double> result(2 + (to_nodes ? m.get_nodes_number() : m.get_elements_number()) * components);
+  result[0] = (result.size() - 2) / std::max(1u, components);
+  result[1] = components;
+  if (to_nodes)
+    m.elements_to_nodes(values.data(), components, &result[2], threads);
+  else
+    m.nodes_to_elements(values.data(), components, &result[2], threads);
+  return result;
+}
+
+void transfer_mesh_field(int argc, char* argv[]) {
   if (argc < 1)
-    throw std::string("Wrong number of arguments");
+    throw std::string("transfer: wrong number of arguments.");
 
   const std::string db_filename(argv[0]);
   check_file_read_accessibility(db_filename, db_filename + " is not accessible");
@@ -313,129 +1182,144 @@ void list_dbfile_meshes(int argc, char* argv[]) {
   --argc;
   ++argv;
 
-  bool list_scalar(false), list_nodal(false), list_elemental(false);
-  std::set<std::string> meshes_to_list;
-  std::set<unsigned int> vector_ranks_to_list;
+  std::vector<std::string> positionals;
+  std::string to, output_db_filename, output_name;
+  unsigned int threads(default_threads_number());
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
   while (argc) {
-    if (argv[0] == std::string("-h")) {
-      std::cout << meshes_help_message << std::endl;
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << transfer_help_message << std::endl;
       return;
-    } else if (argv[0] == std::string("-e")) {
-      list_elemental = true;
-    } else if (argv[0] == std::string("-s")) {
-      list_scalar = true;
-    } else if (argv[0] == std::string("-n")) {
-      list_nodal = true;
-    } else if (argv[0] == std::string("-a")) {
-      list_scalar = true;
-      list_nodal = true;
-      list_elemental = true;
-    } else if (argv[0][0] == '-'
-               and std::all_of<const char*, int (*)(int)>(argv[0] + 1,
-                                                          argv[0] + std::strlen(argv[0]),
-                                                          std::isdigit)) {
-      vector_ranks_to_list.insert(std::strtoul(argv[0] + 1,
-                                                 NULL,
-                                                 10));
+    } else if (option == "--to" or option == "-o" or option == "-n"
+	       or option == "-j" or option == "-B") {
+      if (argc < 2)
+	throw "transfer: expected parameter following '" + option + "' option.";
+      if (option == "--to")
+	to = argv[1];
+      else if (option == "-o")
+	output_db_filename = argv[1];
+      else if (option == "-n")
+	output_name = argv[1];
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
     } else {
-      meshes_to_list.insert(argv[0]);
+      positionals.push_back(option);
     }
+
     --argc;
     ++argv;
   }
 
-  alucell::database_read_access db(db_filename);
-  alucell::database_index index(&db);
-
-  std::set<std::string> potential_mesh_names;
-  for (unsigned int i(0); i < db.get_variables_number(); ++i) {
-    const std::string var_name(db.get_variable_name(i));
-    if (suffixed(var_name, "_nodes")
-	and db.get_variable_type(i) == alucell::data_type::real_array)
-      potential_mesh_names.insert(var_name.substr(0, var_name.size() - 6));
+  if (positionals.size() != 2)
+    throw std::string("transfer: expecting a mesh name and a variable name.");
+  if (to != "nodes" and to != "elems")
+    throw std::string("transfer: mandatory '--to nodes|elems' option missing.");
+  if (output_db_filename.empty())
+    throw std::string("transfer: mandatory '-o' option missing.");
+
+  const std::string& mesh_name(positionals[0]);
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(&db));
+
+  const alucell::mesh_catalog catalog(&db, std::set<std::string>({mesh_name}));
+  if (not catalog.exists(mesh_name))
+    throw "transfer: mesh " + mesh_name + " not found.";
+
+  const std::string prefixed_name(mesh_name + "_" + positionals[1]);
+  const std::string var_name(index->exists(prefixed_name) ? prefixed_name : positionals[1]);
+  if (not index->exists(var_name))
+    throw "transfer: variable " + positionals[1] + " not found.";
+  const unsigned int id(index->get_variable_id(var_name));
+
+  const alucell::mesh_description& description(catalog.get_mesh(mesh_name));
+  const alucell::mesh m(&db, description);
+  const bool to_nodes(to == "nodes");
+
+  std::vector<double> result;
+  switch (db.get_variable_type(id)) {
+  case alucell::data_type::real_array:
+    result = transfer_field<double>(&db, id, m, to_nodes, threads);
+    break;
+
+  case alucell::data_type::int_array:
+  case alucell::data_type::element_array:
+    result = transfer_field<int>(&db, id, m, to_nodes, threads);
+    break;
+
+  default:
+    throw "transfer: " + var_name + " is not an array.";
   }
-  
-  for (auto it(potential_mesh_names.begin());
-       it != potential_mesh_names.end();) {
-    if (meshes_to_list.size() and not meshes_to_list.count(*it)) {
-      potential_mesh_names.erase(it++);
-      continue;
-    }
-
-    const std::string elems_array_name(*it + "_elems");
-    const std::string refs_array_name(*it + "_refs");
-
-    if (index.exists(elems_array_name)) {
-      const unsigned int id(index.get_variable_id(elems_array_name));
-      if (db.get_variable_type(id) != alucell::data_type::int_array and
-	  db.get_variable_type(id) != alucell::data_type::element_array) {
-	potential_mesh_names.erase(it++);
-	continue;
-      }
-    } else {
-      potential_mesh_names.erase(it++);
-      continue;
-    }
 
-    if (index.exists(refs_array_name)) {
-      const unsigned int id(index.get_variable_id(refs_array_name));
-      if (db.get_variable_type(id) != alucell::data_type::int_array) {
-	potential_mesh_names.erase(it++);
-	continue;
-      }
-    } else {
-      potential_mesh_names.erase(it++);
-      continue;
-    }
-    ++it;
-  }
+  alucell::database_write_access output_db(output_db_filename);
+  std::vector<char> buffer;
+  copy_variable(&db, description.nodes_id, &output_db, mesh_name + "_nodes", buffer_size, buffer);
+  copy_variable(&db, description.elems_id, &output_db, mesh_name + "_elems", buffer_size, buffer);
+  copy_variable(&db, description.refs_id, &output_db, mesh_name + "_refs", buffer_size, buffer);
+  output_db.insert(output_name.size() ? output_name : var_name, alucell::data_type::real_array,
+		   result.data(), result.size() * sizeof(double));
+}
 
-  for (const auto& mesh_name: potential_mesh_names) {
-    std::cout << mesh_name << ": ";
 
-    alucell::variable::array<double> nodes(&db, index.get_variable_id(mesh_name + "_nodes"));
-    std::cout << nodes.get_size() << " nodes, ";
+/*
+ *  Copy an array variable into another dbfile with its rows permuted
+ *  by 'order', and, if 'new_node' is given, its positive values
+ *  renumbered as 1-based node indices.
+ */
+template<typename T>
+void write_permuted_array(alucell::database_read_access* db, unsigned int id,
+			  const std::vector<unsigned int>& order,
+			  const std::vector<unsigned int>* new_node,
+			  alucell::database_async_write_access* output_db, unsigned int threads) {
+  const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+  const std::size_t header(2 * sizeof(double));
+  if (dimensions.first != order.size()
+      or header + dimensions.first * dimensions.second * sizeof(T) > db->get_variable_size(id))
+    throw "reorder: inconsistent array dimensions for " + db->get_variable_name(id) + ".";
+
+  std::vector<char> payload(db->get_variable_size(id));
+  db->read_data_from_database(id, 0, payload.size(), payload.data());
+
+  std::vector<char> permuted(output_db->acquire(payload.size()));
+  std::copy(payload.begin(), payload.begin() + header, permuted.begin());
+  const T* values(reinterpret_cast<const T*>(&payload[header]));
+  T* permuted_values(reinterpret_cast<T*>(&permuted[header]));
+  alucell::permute_rows(values, dimensions.second, order, permuted_values, threads);
+
+  if (new_node)
+    for (std::size_t i(0); i < dimensions.first * dimensions.second; ++i)
+      if (permuted_values[i] > 0)
+	permuted_values[i] = (*new_node)[permuted_values[i] - 1] + 1;
+
+  output_db->insert(db->get_variable_name(id), db->get_variable_type(id), std::move(permuted));
+}
 
-    alucell::variable::array<int> elements(&db, index.get_variable_id(mesh_name + "_elems"));
-    std::cout << elements.get_size() << " elements." << std::endl;
-    
-    for (unsigned int i(0); i < db.get_variables_number(); ++i) {
-      const std::string var_name(db.get_variable_name(i));
-      if (prefixed(var_name, mesh_name + "_")
-	  and not suffixed(var_name, "_nodes")
-	  and not suffixed(var_name, "_refs")) {
-	switch (db.get_variable_type(i)) {
-	case alucell::data_type::real_array:
-	  if (list_nodal or list_elemental) {
-	    alucell::variable::array<double> a(&db, i);
-            if (vector_ranks_to_list.size() == 0 or
-                vector_ranks_to_list.count(a.get_components())) {
-              if (a.get_size() == nodes.get_size() and list_nodal)
-                std::cout << "  nodal variable: " << var_name.substr(mesh_name.size() + 1) << std::endl;
-              else if (a.get_size() == elements.get_size() and list_elemental)
-                std::cout << "  elemental variable: " << var_name.substr(mesh_name.size() + 1) << std::endl;
-            }
-	  }
-	  break;
-	  
-	case alucell::data_type::real_number:
-	  if (list_scalar)
-	    std::cout << "  scalar variable: " << var_name.substr(mesh_name.size() + 1) << std::endl;
-	  break;
-	  
-	default:
-	  break;
-	}
-      }
-    }
-    std::cout << std::endl;
+/*
+ *  Time 'repetitions' elemental to nodal and nodal to elemental
+ *  transfers of a 3 components field, in seconds.
+ */
+double time_mesh_transfers(const alucell::mesh& m, unsigned int repetitions, unsigned int threads) {
+  const unsigned int components(3);
+  std::vector<double> elemental(m.get_elements_number() * components), nodal(m.get_nodes_number() * components);
+  for (std::size_t i(0); i < elemental.size(); ++i)
+    elemental[i] = i % 17;
+
+  const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+  for (unsigned int r(0); r < repetitions; ++r) {
+    m.elements_to_nodes(elemental.data(), components, nodal.data(), threads);
+    m.nodes_to_elements(nodal.data(), components, elemental.data(), threads);
   }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
-
-void database_info(int argc, char* argv[]) {
+void reorder_mesh(int argc, char* argv[]) {
   if (argc < 1)
-    throw std::string("info: wrong number of arguments.");
+    throw std::string("reorder: wrong number of arguments.");
 
   const std::string db_filename(argv[0]);
   check_file_read_accessibility(db_filename, db_filename + " is not accessible");
@@ -443,36 +1327,152 @@ void database_info(int argc, char* argv[]) {
   --argc;
   ++argv;
 
+  std::string mesh_name, method("rcm"), output_db_filename;
+  unsigned int threads(default_threads_number()), repetitions(5);
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
   while (argc) {
-    if (argv[0] == std::string("-h")) {
-      std::cout << info_help_message << std::endl;
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << reorder_help_message << std::endl;
       return;
+    } else if (option == "-m" or option == "-o" or option == "-r"
+	       or option == "-j" or option == "-B") {
+      if (argc < 2)
+	throw "reorder: expected parameter following '" + option + "' option.";
+      if (option == "-m")
+	method = argv[1];
+      else if (option == "-o")
+	output_db_filename = argv[1];
+      else if (option == "-r")
+	repetitions = std::strtoul(argv[1], NULL, 10);
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else if (mesh_name.empty()) {
+      mesh_name = option;
     } else {
-      throw std::string("Wrong argument.");
+      throw "reorder: unexpected argument " + option + ".";
     }
+
     --argc;
     ++argv;
   }
 
-  alucell::database_read_access db(db_filename);
-  db.dump_database_infos(std::cout);
+  if (mesh_name.empty())
+    throw std::string("reorder: expecting a mesh name.");
+  if (method != "rcm" and method != "morton")
+    throw "reorder: unknown ordering method " + method + ".";
+  if (output_db_filename.empty())
+    throw std::string("reorder: mandatory '-o' option missing.");
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const alucell::mesh_catalog catalog(&db, std::set<std::string>({mesh_name}), true);
+  if (not catalog.exists(mesh_name))
+    throw "reorder: mesh " + mesh_name + " not found.";
+  const alucell::mesh_description& description(catalog.get_mesh(mesh_name));
+  const alucell::mesh m(&db, description);
+
+  const alucell::mesh_ordering ordering(method == "rcm"
+					? alucell::reverse_cuthill_mckee_ordering(m, threads)
+					: alucell::morton_ordering(m));
+  const alucell::mesh reordered(m.permuted(ordering.node_order, ordering.element_order));
+
+  std::cout.precision(4);
+  double spread(0.), reordered_spread(0.);
+  const std::size_t bandwidth(alucell::mesh_bandwidth(m, &spread));
+  const std::size_t reordered_bandwidth(alucell::mesh_bandwidth(reordered, &reordered_spread));
+  std::cout << mesh_name << ": " << m.get_nodes_number() << " nodes, "
+	    << m.get_elements_number() << " elements, " << method << " ordering." << std::endl;
+  std::cout << "  bandwidth: " << bandwidth << " -> " << reordered_bandwidth << std::endl;
+  std::cout << "  mean element spread: " << spread << " -> " << reordered_spread << std::endl;
+
+  if (repetitions) {
+    const double before(time_mesh_transfers(m, repetitions, threads));
+    const double after(time_mesh_transfers(reordered, repetitions, threads));
+    std::cout << "  transfer benchmark (" << repetitions << " repetitions): "
+	      << before * 1e3 << " ms -> " << after * 1e3 << " ms, speedup "
+	      << (after > 0. ? before / after : 0.) << std::endl;
+  }
+
+  /*
+   *  Write the permuted mesh arrays and variables, and copy the others:
+   */
+  std::map<unsigned int, const std::vector<unsigned int>*> permuted_ids;
+  permuted_ids[description.nodes_id] = &ordering.node_order;
+  permuted_ids[description.elems_id] = &ordering.element_order;
+  permuted_ids[description.refs_id] = &ordering.element_order;
+  for (const auto& v: description.variables)
+    if (v.kind == alucell::mesh_variable::nodal)
+      permuted_ids[v.id] = &ordering.node_order;
+    else if (v.kind == alucell::mesh_variable::elemental)
+      permuted_ids[v.id] = &ordering.element_order;
+
+  std::vector<unsigned int> new_node(ordering.node_order.size());
+  for (std::size_t n(0); n < ordering.node_order.size(); ++n)
+    new_node[ordering.node_order[n]] = n;
+
+  alucell::database_async_write_access output_db(output_db_filename, buffer_size);
+  for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+    const auto it(permuted_ids.find(id));
+    if (it == permuted_ids.end()) {
+      std::vector<char> payload(output_db.acquire(db.get_variable_size(id)));
+      db.read_data_from_database(id, 0, payload.size(), payload.data());
+      output_db.insert(db.get_variable_name(id), db.get_variable_type(id), std::move(payload));
+    } else if (db.get_variable_type(id) == alucell::data_type::real_array)
+      write_permuted_array<double>(&db, id, *it->second, NULL, &output_db, threads);
+    else
+      write_permuted_array<int>(&db, id, *it->second,
+				id == description.elems_id ? &new_node : NULL, &output_db, threads);
+  }
+  output_db.close();
 }
 
-std::string print_memory_size(unsigned long s) {
-  const char* prefixes[] = {" byte", " Kilobyte", " Megabyte", " Gigabyte", " Terabyte", " Exabyte", " Petabyte"};
 
-  unsigned int prefix_id(0);
-  while (s > 1000 and prefix_id < 7) {
-    ++prefix_id;
-    s /= 1000;
+/*
+ *  Interpolate the field 'id' of the mesh at the points, and print one
+ *  line per point.
+ */
+template<typename T>
+void probe_field(alucell::database_read_access* db, unsigned int id, const alucell::mesh& m,
+		 const alucell::mesh_bvh& bvh, const std::vector<double>& points, unsigned int threads) {
+  const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+  const std::size_t rows(dimensions.first);
+  const unsigned int components(dimensions.second);
+
+  if (rows != m.get_nodes_number() and rows != m.get_elements_number())
+    throw "probe: " + db->get_variable_name(id) + " is neither a nodal nor an elemental field of "
+      + m.get_name() + ".";
+  if (2 * sizeof(double) + rows * components * sizeof(T) > db->get_variable_size(id))
+    throw "probe: inconsistent array dimensions for " + db->get_variable_name(id) + ".";
+
+  std::vector<T> values(rows * components);
+  db->read_data_from_database(id, 2 * sizeof(double), values.size() * sizeof(T), values.data());
+
+  std::vector<std::size_t> elements;
+  std::vector<double> results;
+  alucell::probe_field_values(m, bvh, values.data(), rows, components, points, threads, elements, results);
+
+  const unsigned int dimension(m.get_dimension());
+  const std::size_t points_number(elements.size());
+  std::cout.precision(12);
+  for (std::size_t i(0); i < points_number; ++i) {
+    for (unsigned int d(0); d < dimension; ++d)
+      std::cout << std::setw(20) << std::right << points[i * dimension + d];
+    std::cout << std::setw(12) << std::right
+	      << (elements[i] == m.get_elements_number() ? 0 : elements[i] + 1);
+    for (unsigned int c(0); c < components; ++c)
+      std::cout << std::setw(20) << std::right << results[i * components + c];
+    std::cout << std::endl;
   }
-
-  return std::to_string(s) + prefixes[prefix_id];
 }
 
-void list_dbfile_content(int argc, char* argv[]) {
+void probe_mesh_field(int argc, char* argv[]) {
   if (argc < 1)
-    throw std::string("ls: wrong number of arguments.");
+    throw std::string("probe: wrong number of arguments.");
 
   const std::string db_filename(argv[0]);
   check_file_read_accessibility(db_filename, db_filename + " is not accessible");
@@ -480,69 +1480,1737 @@ void list_dbfile_content(int argc, char* argv[]) {
   --argc;
   ++argv;
 
-  bool verbose_output(false);
-  bool human_units(false);
-  std::set<alucell::data_type> included_types;
+  std::vector<std::string> positionals;
+  std::string points_filename;
+  bool use_index_file(false);
+  unsigned int threads(default_threads_number());
   while (argc) {
-    if (argv[0] == std::string("-t") and argc >= 2) {
-      alucell::data_type t(alucell::pretty_name_to_data_type(argv[1]));
-      if (t == alucell::data_type::unknown)
-	throw std::string("Invalid datatype name.");
-      
-      included_types.insert(t);
-      argc -= 1;
-      argv += 1;
-    } else if (argv[0] == std::string("-v")) {
-      verbose_output = true;
-    } else if (argv[0] == std::string("-H")) {
-      human_units = true;
-    } else if (argv[0] == std::string("-h")) {
-      std::cout << list_help_message << std::endl;
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << probe_help_message << std::endl;
       return;
-    } else {
-      throw std::string("Wrong argument.");
+    } else if (option == "-I") {
+      use_index_file = true;
+    } else if (option == "-f" or option == "-j") {
+      if (argc < 2)
+	throw "probe: expected parameter following '" + option + "' option.";
+      if (option == "-f")
+	points_filename = argv[1];
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      positionals.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (positionals.size() < 2)
+    throw std::string("probe: expecting a mesh name and a variable name.");
+
+  const std::string& mesh_name(positionals[0]);
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(&db));
+
+  const alucell::mesh_catalog catalog(&db, std::set<std::string>({mesh_name}));
+  if (not catalog.exists(mesh_name))
+    throw "probe: mesh " + mesh_name + " not found.";
+
+  const std::string prefixed_name(mesh_name + "_" + positionals[1]);
+  const std::string var_name(index->exists(prefixed_name) ? prefixed_name : positionals[1]);
+  if (not index->exists(var_name))
+    throw "probe: variable " + positionals[1] + " not found.";
+  const unsigned int id(index->get_variable_id(var_name));
+
+  /*
+   *  Gather the points:
+   */
+  std::vector<double> points;
+  for (std::size_t k(2); k < positionals.size(); ++k) {
+    char* end(NULL);
+    points.push_back(std::strtod(positionals[k].c_str(), &end));
+    if (*end != '\0')
+      throw "probe: invalid coordinate " + positionals[k] + ".";
+  }
+  if (points_filename.size()) {
+    std::ifstream file(points_filename.c_str());
+    if (not file)
+      throw "probe: unable to open " + points_filename + ".";
+    double x(0.);
+    while (file >> x)
+      points.push_back(x);
+    if (not file.eof())
+      throw "probe: invalid coordinate in " + points_filename + ".";
+  }
+
+  const alucell::mesh m(&db, catalog.get_mesh(mesh_name));
+  if (m.get_dimension() == 0 or points.size() % m.get_dimension())
+    throw "probe: the number of coordinates is not a multiple of the dimension of "
+      + mesh_name + " (" + std::to_string(m.get_dimension()) + ").";
+
+  /*
+   *  Build the hierarchy, or load it from the index file:
+   */
+  alucell::mesh_bvh bvh;
+  const std::string index_filename(db_filename + "." + mesh_name + ".bvh");
+  if (not (use_index_file and bvh.load(index_filename, db.get_file_identity(), mesh_name)
+	   and bvh.get_elements_number() == m.get_elements_number())) {
+    bvh = alucell::mesh_bvh(m);
+    if (use_index_file)
+      bvh.save(index_filename, db.get_file_identity(), mesh_name);
+  }
+
+  switch (db.get_variable_type(id)) {
+  case alucell::data_type::real_array:
+    probe_field<double>(&db, id, m, bvh, points, threads);
+    break;
+
+  case alucell::data_type::int_array:
+  case alucell::data_type::element_array:
+    probe_field<int>(&db, id, m, bvh, points, threads);
+    break;
+
+  default:
+    throw "probe: " + var_name + " is not an array.";
+  }
+}
+
+
+/*
+ *  Print the geometry of a mesh, and write its measures and centroids
+ *  into 'output_db' if it is given.
+ */
+void print_mesh_geometry(alucell::database_read_access* db, const alucell::mesh_description& description,
+			 alucell::database_write_access* output_db, std::size_t buffer_size,
+			 std::vector<char>& buffer, unsigned int threads) {
+  const alucell::mesh m(db, description);
+  const unsigned int dimension(m.get_dimension());
+  const std::string& name(description.name);
+
+  std::cout.precision(12);
+  std::cout << name << ": " << m.get_nodes_number() << " nodes, "
+	    << m.get_elements_number() << " elements of " << m.get_nodes_per_element()
+	    << " nodes, dimension " << dimension << std::endl;
+
+  if (m.get_nodes_number()) {
+    const alucell::geometry::bounding_box box(alucell::geometry::compute_bounds(m, threads));
+    std::cout << "  bounds:";
+    for (unsigned int d(0); d < dimension; ++d)
+      std::cout << (d ? " x [" : " [") << box.lower[d] << ", " << box.upper[d] << "]";
+    std::cout << std::endl;
+  }
+
+  if (output_db) {
+    copy_variable(db, description.nodes_id, output_db, name + "_nodes", buffer_size, buffer);
+    copy_variable(db, description.elems_id, output_db, name + "_elems", buffer_size, buffer);
+    copy_variable(db, description.refs_id, output_db, name + "_refs", buffer_size, buffer);
+  }
+
+  std::unique_ptr<alucell::reference_element> r;
+  try {
+    r.reset(new alucell::reference_element(dimension, m.get_nodes_per_element()));
+  }
+  catch (const std::string&) {
+    std::cout << "  unsupported element type, no measures." << std::endl;
+    return;
+  }
+
+  const alucell::geometry::element_geometry g(alucell::geometry::compute_element_geometry(m, threads));
+  const std::map<int, alucell::geometry::region_sum> regions(
+    alucell::geometry::sum_by_region(m, g.measures.data(), 1, threads));
+
+  double total(0.);
+  for (const auto& region: regions)
+    total += region.second.sums[0];
+  const auto extrema(std::minmax_element(g.measures.begin(), g.measures.end()));
+
+  std::cout << "  element type: " << r->get_name() << std::endl
+	    << "  total measure: " << total << std::endl;
+  if (m.get_elements_number())
+    std::cout << "  element measures: min " << *extrema.first << ", max " << *extrema.second << std::endl;
+  std::cout << "  distorted elements: " << g.distorted_elements << std::endl;
+  for (const auto& region: regions)
+    std::cout << "  reference" << std::setw(8) << std::right << region.first
+	      << std::setw(12) << std::right << region.second.elements << " elements"
+	      << std::setw(20) << std::right << region.second.sums[0] << std::endl;
+
+  if (output_db) {
+    std::vector<double> measures(2 + g.measures.size());
+    measures[0] = g.measures.size();
+    measures[1] = 1;
+    std::copy(g.measures.begin(), g.measures.end(), measures.begin() + 2);
+    output_db->insert(name + "_measure", alucell::data_type::real_array,
+		      measures.data(), measures.size() * sizeof(double));
+
+    std::vector<double> centroids(2 + g.centroids.size());
+    centroids[0] = m.get_elements_number();
+    centroids[1] = dimension;
+    std::copy(g.centroids.begin(), g.centroids.end(), centroids.begin() + 2);
+    output_db->insert(name + "_centroid", alucell::data_type::real_array,
+		      centroids.data(), centroids.size() * sizeof(double));
+  }
+}
+
+void compute_mesh_geometry(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("geom: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  std::set<std::string> mesh_names;
+  std::string output_db_filename;
+  unsigned int threads(default_threads_number());
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << geom_help_message << std::endl;
+      return;
+    } else if (option == "-o" or option == "-j" or option == "-B") {
+      if (argc < 2)
+	throw "geom: expected parameter following '" + option + "' option.";
+      if (option == "-o")
+	output_db_filename = argv[1];
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      mesh_names.insert(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const alucell::mesh_catalog catalog(&db, mesh_names);
+  for (const auto& name: mesh_names)
+    if (not catalog.exists(name))
+      throw "geom: mesh " + name + " not found.";
+
+  std::unique_ptr<alucell::database_write_access> output_db;
+  if (output_db_filename.size())
+    output_db.reset(new alucell::database_write_access(output_db_filename));
+
+  std::vector<char> buffer;
+  for (const auto& description: catalog.get_meshes())
+    print_mesh_geometry(&db, description, output_db.get(), buffer_size, buffer, threads);
+}
+
+
+/*
+ *  Fields of a dbfile to integrate, converted to real numbers, and its
+ *  mesh when it is read.
+ */
+struct integration_input {
+  struct field {
+    std::string name;
+    std::size_t rows;
+    unsigned int components;
+    std::vector<double> values;
+  };
+
+  std::vector<field> fields;
+  std::unique_ptr<alucell::mesh> m;
+};
+
+template<typename T>
+void read_integration_field(alucell::database_read_access* db, unsigned int id,
+			    integration_input::field& f) {
+  if (2 * sizeof(double) + f.rows * f.components * sizeof(T) > db->get_variable_size(id))
+    throw "integrate: inconsistent array dimensions for " + db->get_variable_name(id) + ".";
+
+  std::vector<T> values(f.rows * f.components);
+  db->read_data_from_database(id, 2 * sizeof(double), values.size() * sizeof(T), values.data());
+  f.values.assign(values.begin(), values.end());
+}
+
+template<>
+void read_integration_field<double>(alucell::database_read_access* db, unsigned int id,
+				    integration_input::field& f) {
+  if (2 * sizeof(double) + f.rows * f.components * sizeof(double) > db->get_variable_size(id))
+    throw "integrate: inconsistent array dimensions for " + db->get_variable_name(id) + ".";
+
+  f.values.resize(f.rows * f.components);
+  db->read_data_from_database(id, 2 * sizeof(double), f.values.size() * sizeof(double), f.values.data());
+}
+
+integration_input read_integration_input(const std::string& db_filename, const std::string& mesh_name,
+					 const std::vector<std::string>& var_names, bool read_mesh) {
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(&db));
+
+  integration_input input;
+  if (read_mesh) {
+    const alucell::mesh_catalog catalog(&db, std::set<std::string>({mesh_name}));
+    if (not catalog.exists(mesh_name))
+      throw "integrate: mesh " + mesh_name + " not found in " + db_filename + ".";
+    input.m.reset(new alucell::mesh(&db, catalog.get_mesh(mesh_name)));
+  }
+
+  for (const auto& var_name: var_names) {
+    const std::string prefixed_name(mesh_name + "_" + var_name);
+    integration_input::field f;
+    f.name = index->exists(prefixed_name) ? prefixed_name : var_name;
+    if (not index->exists(f.name))
+      throw "integrate: variable " + var_name + " not found in " + db_filename + ".";
+
+    const unsigned int id(index->get_variable_id(f.name));
+    switch (db.get_variable_type(id)) {
+    case alucell::data_type::real_array:
+    case alucell::data_type::int_array:
+    case alucell::data_type::element_array:
+      break;
+
+    default:
+      throw "integrate: " + f.name + " is not an array.";
+    }
+
+    const std::pair<std::size_t, unsigned int> dimensions(db.get_array_dimensions(id));
+    f.rows = dimensions.first;
+    f.components = dimensions.second;
+    if (db.get_variable_type(id) == alucell::data_type::real_array)
+      read_integration_field<double>(&db, id, f);
+    else
+      read_integration_field<int>(&db, id, f);
+    input.fields.push_back(std::move(f));
+  }
+  return input;
+}
+
+void print_region_integrals(const std::map<int, alucell::geometry::region_sum>& measures,
+			    const std::map<int, alucell::geometry::region_sum>& integrals,
+			    const std::set<int>& references, unsigned int components) {
+  std::size_t total_elements(0);
+  double total_measure(0.);
+  std::vector<double> totals(components, 0.);
+  for (const auto& region: integrals) {
+    if (references.size() and not references.count(region.first))
+      continue;
+
+    const double measure(measures.at(region.first).sums[0]);
+    total_elements += region.second.elements;
+    total_measure += measure;
+    std::cout << "  reference" << std::setw(8) << std::right << region.first
+	      << std::setw(12) << std::right << region.second.elements
+	      << std::setw(20) << std::right << measure;
+    for (unsigned int c(0); c < components; ++c) {
+      totals[c] += region.second.sums[c];
+      std::cout << std::setw(20) << std::right << region.second.sums[c];
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "  total" << std::setw(12) << "" << std::setw(12) << std::right << total_elements
+	    << std::setw(20) << std::right << total_measure;
+  for (unsigned int c(0); c < components; ++c)
+    std::cout << std::setw(20) << std::right << totals[c];
+  std::cout << std::endl;
+}
+
+void integrate_mesh_fields(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("integrate: wrong number of arguments.");
+
+  std::vector<std::string> db_filenames, var_names;
+  std::string mesh_name;
+  std::set<int> references;
+  bool read_each_mesh(false);
+  unsigned int threads(default_threads_number());
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << integrate_help_message << std::endl;
+      return;
+    } else if (option == "-M") {
+      read_each_mesh = true;
+    } else if (option == "-m" or option == "-v" or option == "-r" or option == "-j") {
+      if (argc < 2)
+	throw "integrate: expected parameter following '" + option + "' option.";
+      if (option == "-m")
+	mesh_name = argv[1];
+      else if (option == "-v")
+	var_names.push_back(argv[1]);
+      else if (option == "-r")
+	references.insert(std::strtol(argv[1], NULL, 10));
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      check_file_read_accessibility(option, option + " is not accessible");
+      db_filenames.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (db_filenames.empty())
+    throw std::string("integrate: expecting database filename(s).");
+  if (mesh_name.empty())
+    throw std::string("integrate: mandatory '-m' option missing.");
+  if (var_names.empty())
+    throw std::string("integrate: mandatory '-v' option missing.");
+
+  std::unique_ptr<alucell::mesh> m;
+  std::unique_ptr<alucell::field_integrator> integrator;
+  std::map<int, alucell::geometry::region_sum> measures;
+
+  /*
+   *  Read the next dbfile in the background while the current one is
+   *  integrated:
+   */
+  std::future<integration_input> next(std::async(std::launch::async, read_integration_input,
+						 db_filenames[0], mesh_name, var_names, true));
+  std::cout.precision(12);
+  for (std::size_t k(0); k < db_filenames.size(); ++k) {
+    integration_input input(next.get());
+    if (k + 1 < db_filenames.size())
+      next = std::async(std::launch::async, read_integration_input,
+			db_filenames[k + 1], mesh_name, var_names, read_each_mesh);
+
+    if (input.m) {
+      integrator.reset();
+      m = std::move(input.m);
+      integrator.reset(new alucell::field_integrator(*m, threads));
+      measures = integrator->measure(threads);
+    }
+
+    for (const auto& f: input.fields) {
+      std::cout << db_filenames[k] << ": " << f.name << " over " << mesh_name << std::endl;
+      if (f.rows == m->get_nodes_number())
+	print_region_integrals(measures, integrator->integrate_nodal(f.values.data(), f.components, threads),
+			       references, f.components);
+      else if (f.rows == m->get_elements_number())
+	print_region_integrals(measures, integrator->integrate_elemental(f.values.data(), f.components, threads),
+			       references, f.components);
+      else
+	throw "integrate: " + f.name + " of " + db_filenames[k] + " is neither a nodal nor an elemental field of "
+	  + mesh_name + ".";
+    }
+  }
+}
+
+
+/*
+ *  Resolve the fields to export in a dbfile, and check that they are
+ *  nodal or elemental fields of the mesh.
+ */
+std::vector<alucell::export_field> find_export_fields(alucell::database_read_access* db,
+						       const alucell::mesh_description& description,
+						       const std::vector<std::string>& var_names) {
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(db));
+  std::vector<alucell::export_field> fields;
+  for (const auto& var_name: var_names) {
+    const std::string prefixed_name(description.name + "_" + var_name);
+    const bool prefixed(index->exists(prefixed_name));
+    if (not prefixed and not index->exists(var_name))
+      throw "export: variable " + var_name + " not found in " + db->get_filename() + ".";
+
+    alucell::export_field f;
+    f.id = index->get_variable_id(prefixed ? prefixed_name : var_name);
+    f.name = prefixed ? var_name : var_name.substr(var_name.find(description.name + "_") == 0
+						   ? description.name.size() + 1 : 0);
+    switch (db->get_variable_type(f.id)) {
+    case alucell::data_type::real_array:
+      f.integer = false;
+      break;
+
+    case alucell::data_type::int_array:
+    case alucell::data_type::element_array:
+      f.integer = true;
+      break;
+
+    default:
+      throw "export: " + db->get_variable_name(f.id) + " is not an array.";
+    }
+
+    const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(f.id));
+    f.components = dimensions.second;
+    f.nodal = dimensions.first == description.nodes_number;
+    if (not f.nodal and dimensions.first != description.elements_number)
+      throw "export: " + db->get_variable_name(f.id) + " of " + db->get_filename()
+	+ " is neither a nodal nor an elemental field of " + description.name + ".";
+    fields.push_back(f);
+  }
+
+  alucell::export_field refs = { "refs", description.refs_id, false, true, 1 };
+  fields.push_back(refs);
+  return fields;
+}
+
+void export_mesh_fields(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("export: wrong number of arguments.");
+
+  std::vector<std::string> db_filenames, var_names;
+  alucell::variable_selector selector;
+  std::string mesh_name, format, output_prefix, time_name;
+  unsigned int threads(default_threads_number());
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << export_help_message << std::endl;
+      return;
+    } else if (parse_selection_option(argc, argv, selector)) {
+    } else if (option == "-m" or option == "-v" or option == "-f" or option == "-o"
+	       or option == "-t" or option == "-j" or option == "-B") {
+      if (argc < 2)
+	throw "export: expected parameter following '" + option + "' option.";
+      if (option == "-m")
+	mesh_name = argv[1];
+      else if (option == "-v")
+	var_names.push_back(argv[1]);
+      else if (option == "-f")
+	format = argv[1];
+      else if (option == "-o")
+	output_prefix = argv[1];
+      else if (option == "-t")
+	time_name = argv[1];
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      check_file_read_accessibility(option, option + " is not accessible");
+      db_filenames.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (db_filenames.empty())
+    throw std::string("export: expecting database filename(s).");
+  if (mesh_name.empty())
+    throw std::string("export: mandatory '-m' option missing.");
+  if (format != "ensight" and format != "vtk")
+    throw std::string("export: mandatory '-f ensight|vtk' option missing.");
+  if (output_prefix.empty())
+    throw std::string("export: mandatory '-o' option missing.");
+  if (time_name.empty())
+    time_name = mesh_name + "_time";
+
+  const bool ensight(format == "ensight");
+  const std::string base_name(output_prefix.substr(output_prefix.find_last_of('/') + 1));
+  const std::size_t steps(db_filenames.size());
+  const unsigned int step_digits(std::max<std::size_t>(4, std::to_string(steps - 1).size()));
+  auto step_suffix = [&](std::size_t k) {
+    const std::string number(std::to_string(k));
+    return std::string(step_digits - number.size(), '0') + number;
+  };
+
+  /*
+   *  The geometry and the list of variables come from the first dbfile:
+   */
+  std::vector<alucell::export_field> fields;
+  unsigned int dimension(0);
+  {
+    const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filenames[0]));
+    alucell::database_read_access& db(*db_access);
+    const alucell::mesh_catalog catalog(&db, std::set<std::string>({mesh_name}));
+    if (not catalog.exists(mesh_name))
+      throw "export: mesh " + mesh_name + " not found in " + db_filenames[0] + ".";
+    const alucell::mesh_description& description(catalog.get_mesh(mesh_name));
+    dimension = db.get_array_dimensions(description.nodes_id).second;
+    alucell::get_export_element_type(dimension, db.get_array_dimensions(description.elems_id).second);
+    if (not selector.empty())
+      for (const auto& v: description.variables)
+	if (v.kind != alucell::mesh_variable::scalar
+	    and selector.matches(db.get_variable_name(v.id), db.get_variable_type(v.id), db.get_variable_size(v.id))
+	    and std::find(var_names.begin(), var_names.end(), v.name) == var_names.end())
+	  var_names.push_back(v.name);
+    fields = find_export_fields(&db, description, var_names);
+    if (ensight)
+      alucell::ensight::write_geometry(&db, description, output_prefix + ".geo", buffer_size);
+  }
+
+  /*
+   *  Export the steps in parallel, and report the first error. The
+   *  dbfile of 'db batch' is shared, so the steps reading it take turns:
+   */
+  std::vector<double> times(steps);
+  std::vector<std::string> errors(steps);
+  std::mutex batch_dbfile_mutex;
+  parallel_for(0, steps, threads,
+	       [&](unsigned int, std::size_t b, std::size_t e) {
+		 for (std::size_t k(b); k < e; ++k) {
+		   try {
+		     const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filenames[k]));
+		     alucell::database_read_access& db(*db_access);
+		     std::unique_lock<std::mutex> batch_lock(batch_dbfile_mutex, std::defer_lock);
+		     if (current_batch and db_access == current_batch->db)
+		       batch_lock.lock();
+		     const alucell::mesh_catalog catalog(&db, std::set<std::string>({mesh_name}));
+		     if (not catalog.exists(mesh_name))
+		       throw "export: mesh " + mesh_name + " not found in " + db_filenames[k] + ".";
+		     const alucell::mesh_description& description(catalog.get_mesh(mesh_name));
+		     const std::vector<alucell::export_field> step_fields(find_export_fields(&db, description, var_names));
+		     for (std::size_t i(0); i < fields.size(); ++i)
+		       if (step_fields[i].nodal != fields[i].nodal or step_fields[i].components != fields[i].components)
+			 throw "export: " + db.get_variable_name(step_fields[i].id) + " of " + db_filenames[k]
+			   + " does not match the first dbfile.";
+
+		     const std::shared_ptr<alucell::database_index> index(index_dbfile(&db));
+		     times[k] = k;
+		     if (index->exists(time_name)
+			 and db.get_variable_type(index->get_variable_id(time_name)) == alucell::data_type::real_number)
+		       times[k] = alucell::variable::number(&db, index->get_variable_id(time_name)).get_value();
+
+		     if (ensight) {
+		       for (const auto& f: step_fields) {
+			 std::vector<std::string> filenames;
+			 for (const auto& name: alucell::ensight::variable_names(f, dimension))
+			   filenames.push_back(output_prefix + "." + name + "." + step_suffix(k));
+			 alucell::ensight::write_field(&db, description, f, filenames, buffer_size);
+		       }
+		     } else {
+		       alucell::vtk::write_unstructured_grid(&db, description, step_fields,
+							     output_prefix + "." + step_suffix(k) + ".vtu", buffer_size);
+		     }
+		   }
+		   catch (const std::string& error) {
+		     errors[k] = error;
+		   }
+		   catch (const std::exception& error) {
+		     errors[k] = "export: unable to export " + db_filenames[k] + ": " + error.what() + ".";
+		   }
+		   catch (...) {
+		     errors[k] = "export: unable to export " + db_filenames[k] + ".";
+		   }
+		 }
+	       });
+
+  for (const auto& error: errors)
+    if (error.size())
+      throw error;
+
+  if (ensight) {
+    std::vector<alucell::ensight::case_variable> variables;
+    for (const auto& f: fields) {
+      const std::string type(std::string(alucell::ensight::is_vector(f, dimension) ? "vector" : "scalar")
+			     + (f.nodal ? " per node" : " per element"));
+      for (const auto& name: alucell::ensight::variable_names(f, dimension)) {
+	const alucell::ensight::case_variable v = { type, name, base_name + "." + name + "."
+						    + std::string(step_digits, '*') };
+	variables.push_back(v);
+      }
+    }
+    alucell::ensight::write_case(output_prefix + ".case", base_name + ".geo", variables, times);
+  } else {
+    std::vector<std::string> filenames;
+    for (std::size_t k(0); k < steps; ++k)
+      filenames.push_back(base_name + "." + step_suffix(k) + ".vtu");
+    alucell::vtk::write_collection(output_prefix + ".pvd", filenames, times);
+  }
+}
+
+
+void benchmark_sparse_products(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("spmv: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  std::vector<std::string> var_names;
+  unsigned int threads(default_threads_number()), repetitions(10);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << spmv_help_message << std::endl;
+      return;
+    } else if (option == "-j" or option == "-r") {
+      if (argc < 2)
+	throw "spmv: expected parameter following '" + option + "' option.";
+      if (option == "-r")
+	repetitions = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      var_names.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (var_names.empty())
+    throw std::string("spmv: expecting variable name(s).");
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(&db));
+
+  typedef std::chrono::steady_clock clock;
+  auto seconds = [](clock::time_point b, clock::time_point e) {
+    return std::chrono::duration<double>(e - b).count();
+  };
+
+  std::cout.precision(6);
+  for (const auto& name: var_names) {
+    const unsigned int id(index->get_variable_id(name));
+    if (db.get_variable_type(id) != alucell::data_type::sky_matrix)
+      throw "spmv: " + name + " is not a sky_matrix.";
+
+    const alucell::variable::sky_matrix m(&db, id);
+    const alucell::sky_matrix_view& a(m.get_view());
+    const std::size_t n(a.get_size());
+
+    const clock::time_point conversion(clock::now());
+    const alucell::csr_matrix c(alucell::sky_matrix_to_csr(a, false, threads));
+    const double conversion_time(seconds(conversion, clock::now()));
+
+    std::vector<double> x(n), y_sky(n), y_csr(n);
+    for (std::size_t i(0); i < n; ++i)
+      x[i] = 1. + (i % 10) * 0.1;
+
+    alucell::multiply(a, x.data(), y_sky.data(), threads);
+    clock::time_point b(clock::now());
+    for (unsigned int r(0); r < repetitions; ++r)
+      alucell::multiply(a, x.data(), y_sky.data(), threads);
+    const double sky_time(seconds(b, clock::now()) / repetitions);
+
+    alucell::multiply(c, x.data(), y_csr.data(), threads);
+    b = clock::now();
+    for (unsigned int r(0); r < repetitions; ++r)
+      alucell::multiply(c, x.data(), y_csr.data(), threads);
+    const double csr_time(seconds(b, clock::now()) / repetitions);
+
+    double difference(0.), largest(0.);
+    for (std::size_t i(0); i < n; ++i) {
+      difference = std::max(difference, std::fabs(y_sky[i] - y_csr[i]));
+      largest = std::max(largest, std::fabs(y_sky[i]));
+    }
+
+    const double sky_terms(n + 2. * a.get_profile_size());
+    std::cout << name << ": sky matrix, " << n << " equations, "
+	      << (a.is_symmetric() ? "symmetric" : "non symmetric") << std::endl
+	      << "  skyline: " << sky_terms << " terms, " << sky_time * 1e3 << " ms per product, "
+	      << 2. * sky_terms / sky_time * 1e-9 << " GFlop/s" << std::endl
+	      << "  CSR: " << c.get_nonzeros() << " terms, converted in " << conversion_time * 1e3 << " ms, "
+	      << csr_time * 1e3 << " ms per product, "
+	      << 2. * c.get_nonzeros() / csr_time * 1e-9 << " GFlop/s" << std::endl
+	      << "  relative difference: " << (largest > 0. ? difference / largest : difference) << std::endl;
+  }
+}
+
+
+/*
+ *  Compare the data of two variables of the same size by chunks of at
+ *  most 'buffer_size' bytes.
+ */
+bool same_variable_data(alucell::database_read_access* a, unsigned int a_id,
+			alucell::database_read_access* b, unsigned int b_id,
+			std::size_t buffer_size, std::vector<char>& a_buffer, std::vector<char>& b_buffer) {
+  const std::size_t size(a->get_variable_size(a_id));
+  a_buffer.resize(std::min(size, buffer_size / 2 + 1));
+  b_buffer.resize(a_buffer.size());
+  for (std::size_t offset(0); offset < size; offset += a_buffer.size()) {
+    const std::size_t length(std::min(a_buffer.size(), size - offset));
+    a->read_data_from_database(a_id, offset, length, a_buffer.data());
+    b->read_data_from_database(b_id, offset, length, b_buffer.data());
+    if (not std::equal(a_buffer.begin(), a_buffer.begin() + length, b_buffer.begin()))
+      return false;
+  }
+  return true;
+}
+
+/*
+ *  Path of the base recorded in a delta: relative to the delta if both
+ *  are in the same directory, absolute otherwise.
+ */
+std::string delta_base_path(const std::string& base_filename, const std::string& delta_filename) {
+  auto directory = [](const std::string& f) {
+    return f.find('/') == std::string::npos ? std::string() : f.substr(0, f.rfind('/') + 1);
+  };
+  if (directory(base_filename) == directory(delta_filename))
+    return base_filename.substr(directory(base_filename).size());
+
+  char* resolved(realpath(base_filename.c_str(), NULL));
+  if (resolved == NULL)
+    throw "delta: unable to resolve the path of " + base_filename + ".";
+  const std::string path(resolved);
+  free(resolved);
+  return path;
+}
+
+void write_delta_dbfile(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("delta: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  std::string base_db_filename, output_db_filename;
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  bool encode(false);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << delta_help_message << std::endl;
+      return;
+    } else if (option == "-x") {
+      encode = true;
+    } else if (option == "-b" or option == "-o" or option == "-B") {
+      if (argc < 2)
+	throw "delta: expected parameter following '" + option + "' option.";
+      if (option == "-b")
+	base_db_filename = argv[1];
+      else if (option == "-o")
+	output_db_filename = argv[1];
+      else
+	buffer_size = parse_memory_size(argv[1]);
+      --argc;
+      ++argv;
+    } else {
+      throw "delta: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (base_db_filename.empty())
+    throw std::string("delta: mandatory '-b' option missing.");
+  if (output_db_filename.empty())
+    throw std::string("delta: mandatory '-o' option missing.");
+  check_file_read_accessibility(base_db_filename, base_db_filename + " is not accessible");
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  alucell::database_read_access base_db(base_db_filename);
+  std::map<std::string, unsigned int> base_ids;
+  for (unsigned int id(0); id < base_db.get_variables_number(); ++id)
+    base_ids[base_db.get_variable_name(id)] = id;
+
+  std::set<std::string> names;
+  for (unsigned int id(0); id < db.get_variables_number(); ++id)
+    names.insert(db.get_variable_name(id));
+  std::string deleted;
+  for (unsigned int id(0); id < base_db.get_variables_number(); ++id)
+    if (names.count(base_db.get_variable_name(id)) == 0)
+      deleted += base_db.get_variable_name(id) + "\n";
+
+  alucell::database_write_access output_db(output_db_filename);
+  output_db.defer_infos(true);
+  const std::vector<char> base_path(alucell::delta::string_payload(delta_base_path(base_db_filename, output_db_filename)));
+  const std::vector<char> signature(alucell::delta::string_payload(alucell::delta::signature(base_db_filename, alucell::database_read_access::header_size)));
+  const std::vector<char> deleted_names(alucell::delta::string_payload(deleted));
+  output_db.insert(alucell::delta::base_variable, alucell::data_type::string, base_path.data(), base_path.size());
+  output_db.insert(alucell::delta::signature_variable, alucell::data_type::string, signature.data(), signature.size());
+  output_db.insert(alucell::delta::deleted_variable, alucell::data_type::string, deleted_names.data(), deleted_names.size());
+
+  std::size_t total_size(0), stored_size(0), unchanged(0), stored(0), encoded(0);
+  std::vector<char> buffer, base_buffer;
+  for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+    const std::string& name(db.get_variable_name(id));
+    const std::size_t size(db.get_variable_size(id));
+    total_size += size;
+
+    const auto it(base_ids.find(name));
+    const bool comparable(it != base_ids.end()
+			  and base_db.get_variable_type(it->second) == db.get_variable_type(id)
+			  and base_db.get_variable_size(it->second) == size);
+    if (comparable and same_variable_data(&db, id, &base_db, it->second, buffer_size, buffer, base_buffer)) {
+      ++unchanged;
+      continue;
+    }
+
+    if (comparable and encode) {
+      buffer.resize(size);
+      base_buffer.resize(size);
+      db.read_data_from_database(id, 0, size, buffer.data());
+      base_db.read_data_from_database(it->second, 0, size, base_buffer.data());
+      const std::vector<char> e(alucell::delta::encode(buffer.data(), base_buffer.data(), size));
+      if (e.size() <= size / 4 * 3) {
+	output_db.insert(alucell::delta::xor_prefix + name, db.get_variable_type(id), e.data(), e.size());
+	stored_size += e.size();
+	++encoded;
+	continue;
+      }
+    }
+
+    copy_variable(&db, id, &output_db, name, buffer_size, buffer);
+    stored_size += size;
+    ++stored;
+  }
+  output_db.close();
+
+  std::cout << db_filename << ": " << db.get_variables_number() << " variables, "
+	    << unchanged << " unchanged, " << stored << " stored, " << encoded << " encoded, "
+	    << std::count(deleted.begin(), deleted.end(), '\n') << " deleted." << std::endl;
+  std::cout << "  data: " << stored_size << " bytes stored for " << total_size << " bytes." << std::endl;
+}
+
+void materialize_dbfile(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("materialize: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  std::string output_db_filename;
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  unsigned int threads(default_threads_number());
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << materialize_help_message << std::endl;
+      return;
+    } else if (option == "-o" or option == "-j" or option == "-B") {
+      if (argc < 2)
+	throw "materialize: expected parameter following '" + option + "' option.";
+      if (option == "-o")
+	output_db_filename = argv[1];
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      throw "materialize: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (output_db_filename.empty())
+    throw std::string("materialize: mandatory '-o' option missing.");
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  std::vector<unsigned int> ids(db.get_variables_number());
+  for (unsigned int id(0); id < ids.size(); ++id)
+    ids[id] = id;
+  copy_variables_in_parallel(&db, ids, output_db_filename, threads, buffer_size);
+}
+
+/*
+ *  Name of a dbfile without its directory and extension, used as the
+ *  prefix of its conflicting variables by 'db merge -p prefix'.
+ */
+std::string dbfile_prefix(const std::string& filename) {
+  std::string name(filename.substr(filename.rfind('/') == std::string::npos ? 0 : filename.rfind('/') + 1));
+  if (name.find('.') != std::string::npos and name.find('.') > 0)
+    name.erase(name.find('.'));
+  return name;
+}
+
+void merge_dbfiles(int argc, char* argv[]) {
+  std::vector<std::string> db_filenames;
+  std::string output_db_filename, policy("first");
+  alucell::variable_selector selector;
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  unsigned int threads(default_threads_number());
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << merge_help_message << std::endl;
+      return;
+    } else if (parse_selection_option(argc, argv, selector)) {
+    } else if (option == "-o" or option == "-j" or option == "-B" or option == "-p") {
+      if (argc < 2)
+	throw "merge: expected parameter following '" + option + "' option.";
+      if (option == "-o")
+	output_db_filename = argv[1];
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else if (option == "-p")
+	policy = argv[1];
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      check_file_read_accessibility(option, option + " is not accessible");
+      db_filenames.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (output_db_filename.empty())
+    throw std::string("merge: mandatory '-o' option missing.");
+  if (db_filenames.empty())
+    throw std::string("merge: expecting dbfile(s) to merge.");
+  if (policy != "first" and policy != "last" and policy != "prefix")
+    throw "merge: unknown conflict policy " + policy + ".";
+
+  /*
+   *  Selected variables, and the dbfiles holding each name:
+   */
+  std::vector<std::shared_ptr<alucell::database_read_access> > dbs;
+  std::vector<std::vector<unsigned int> > selected;
+  std::map<std::string, std::vector<std::size_t> > holders;
+  for (std::size_t f(0); f < db_filenames.size(); ++f) {
+    dbs.push_back(open_dbfile(db_filenames[f]));
+    selected.push_back(selector.select(dbs.back().get()));
+    for (const auto id: selected.back()) {
+      std::vector<std::size_t>& h(holders[dbs.back()->get_variable_name(id)]);
+      if (h.empty() or h.back() != f)
+	h.push_back(f);
+    }
+  }
+
+  std::vector<alucell::copied_variable> variables;
+  std::set<std::string> names;
+  std::size_t conflicts(0), slots(0), data_size(0);
+  for (std::size_t f(0); f < dbs.size(); ++f)
+    for (const auto id: selected[f]) {
+      const alucell::database_read_access& db(*dbs[f]);
+      const std::vector<std::size_t>& h(holders[db.get_variable_name(id)]);
+      std::string name(db.get_variable_name(id));
+      if (h.size() > 1) {
+	if ((policy == "first" and h.front() != f) or (policy == "last" and h.back() != f)) {
+	  ++conflicts;
+	  continue;
+	}
+	if (policy == "prefix")
+	  name = dbfile_prefix(db_filenames[f]) + "_" + name;
+      }
+      if (not names.insert(name).second)
+	throw "merge: several variables would be named " + name + " in " + output_db_filename + ".";
+
+      const alucell::copied_variable v = {&db, id, name};
+      variables.push_back(v);
+      slots += alucell::database_parallel_write_access::get_required_slots(name, db.get_variable_type(id));
+      data_size += alucell::database_write_access::get_padded_size(db.get_variable_size(id));
+    }
+
+  if (slots > alucell::database_parallel_write_access::max_slots)
+    throw "merge: the " + std::to_string(variables.size()) + " variables need " + std::to_string(slots)
+      + " name slots, more than the " + std::to_string(alucell::database_parallel_write_access::max_slots)
+      + " of a dbfile.";
+  if ((alucell::database_read_access::header_size + data_size) / sizeof(double) >= INT_MAX)
+    throw "merge: the " + std::to_string(data_size) + " bytes of data do not fit in the 32 bits tables of a dbfile.";
+
+  const std::size_t encoded(alucell::copy_dbfile_variables(variables, output_db_filename, threads, buffer_size));
+
+  std::cout << output_db_filename << ": " << variables.size() << " variables from " << dbs.size()
+	    << " dbfiles, " << data_size << " bytes, " << slots << " name slots, "
+	    << conflicts << " conflicting variables dropped";
+  if (encoded)
+    std::cout << ", " << encoded << " encoded variables decoded";
+  std::cout << "." << std::endl;
+}
+
+void convert_dbfile(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("convert: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  std::string output_db_filename, format_name;
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << convert_help_message << std::endl;
+      return;
+    } else if (option == "-o" or option == "-f" or option == "-B") {
+      if (argc < 2)
+	throw "convert: expected parameter following '" + option + "' option.";
+      if (option == "-o")
+	output_db_filename = argv[1];
+      else if (option == "-f")
+	format_name = argv[1];
+      else
+	buffer_size = parse_memory_size(argv[1]);
+      --argc;
+      ++argv;
+    } else {
+      throw "convert: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (output_db_filename.empty())
+    throw std::string("convert: mandatory '-o' option missing.");
+  if (format_name.size() and format_name != "legacy" and format_name != "extended")
+    throw "convert: unknown format " + format_name + ".";
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  if (db.is_delta())
+    throw "convert: " + db_filename + " is a delta dbfile, see 'db materialize'.";
+
+  const alucell::dbfile_format format(format_name.empty()
+				      ? (db.get_format() == alucell::dbfile_format::legacy
+					 ? alucell::dbfile_format::extended : alucell::dbfile_format::legacy)
+				      : (format_name == "legacy"
+					 ? alucell::dbfile_format::legacy : alucell::dbfile_format::extended));
+
+  /*
+   *  The legacy tables are checked before anything is written:
+   */
+  std::size_t slots(0), data_size(0);
+  for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+    slots += alucell::database_parallel_write_access::get_required_slots(db.get_variable_name(id),
+									db.get_variable_type(id));
+    data_size += db.get_variable_size(id);
+    if (format == alucell::dbfile_format::legacy and db.get_variable_size(id) % sizeof(double))
+      throw "convert: the " + std::to_string(db.get_variable_size(id)) + " bytes of "
+	+ db.get_variable_name(id) + " are not a multiple of 8, as required by the legacy format.";
+  }
+  if (format == alucell::dbfile_format::legacy) {
+    if (slots > alucell::database_parallel_write_access::max_slots)
+      throw "convert: the " + std::to_string(db.get_variables_number()) + " variables need "
+	+ std::to_string(slots) + " name slots, more than the "
+	+ std::to_string(alucell::database_parallel_write_access::max_slots) + " of a legacy dbfile.";
+    if ((alucell::database_read_access::header_size + data_size) / sizeof(double) >= INT_MAX)
+      throw "convert: the " + std::to_string(data_size)
+	+ " bytes of data do not fit in the 32 bits tables of a legacy dbfile.";
+  }
+
+  const std::string partial_filename(output_db_filename + ".partial");
+  try {
+    alucell::database_write_access output_db(partial_filename, format);
+    output_db.defer_infos(true);
+    std::vector<char> buffer;
+    for (unsigned int id(0); id < db.get_variables_number(); ++id)
+      copy_variable(&db, id, &output_db, db.get_variable_name(id), buffer_size, buffer);
+    output_db.sync();
+    output_db.close();
+  }
+  catch (...) {
+    std::remove(partial_filename.c_str());
+    throw;
+  }
+  if (std::rename(partial_filename.c_str(), output_db_filename.c_str()) != 0)
+    throw "convert: unable to rename " + partial_filename + ".";
+
+  struct stat input_stat, output_stat;
+  stat(db_filename.c_str(), &input_stat);
+  stat(output_db_filename.c_str(), &output_stat);
+  std::cout << output_db_filename << ": " << db.get_variables_number() << " variables, "
+	    << data_size << " bytes of data, "
+	    << (format == alucell::dbfile_format::legacy ? "legacy" : "extended") << " format, "
+	    << output_stat.st_size << " bytes (" << input_stat.st_size << " bytes for "
+	    << db_filename << ")." << std::endl;
+}
+
+void build_dbfile_catalog(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("catalog build: wrong number of arguments.");
+
+  const std::string directory(argv[0]);
+  --argc;
+  ++argv;
+
+  std::string catalog_filename(directory + "/" + alucell::dbfile_catalog::default_filename);
+  unsigned int threads(default_threads_number());
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << catalog_help_message << std::endl;
+      return;
+    } else if (option == "-o" or option == "-j") {
+      if (argc < 2)
+	throw "catalog build: expected parameter following '" + option + "' option.";
+      if (option == "-o")
+	catalog_filename = argv[1];
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      throw "catalog build: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  alucell::dbfile_catalog catalog;
+  if (access(catalog_filename.c_str(), F_OK) == 0)
+    catalog.load(catalog_filename);
+  const alucell::dbfile_catalog::refresh_report report(catalog.refresh(directory, threads));
+  catalog.save(catalog_filename);
+
+  const std::size_t files(catalog.get_files().size());
+  std::cout << catalog_filename << ": " << files - report.skipped << " dbfiles, "
+	    << report.added << " added, " << report.updated << " updated, "
+	    << report.removed << " removed, " << report.unchanged << " unchanged, "
+	    << report.skipped << " other files." << std::endl;
+}
+
+void query_dbfile_catalog(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("catalog query: wrong number of arguments.");
+
+  std::string catalog_filename(argv[0]);
+  --argc;
+  ++argv;
+
+  alucell::catalog_query q;
+  bool verbose_output(false);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << catalog_help_message << std::endl;
+      return;
+    } else if (option == "-v") {
+      verbose_output = true;
+    } else if (option == "-n" or option == "-g" or option == "-t" or option == "-r"
+	       or option == "-c" or option == "-m") {
+      if (argc < 2)
+	throw "catalog query: expected parameter following '" + option + "' option.";
+      const std::string value(argv[1]);
+      if (option == "-n") {
+	q.names.push_back(value);
+      } else if (option == "-g") {
+	q.patterns.push_back(value);
+      } else if (option == "-t") {
+	const alucell::data_type t(alucell::pretty_name_to_data_type(value));
+	if (t == alucell::data_type::unknown)
+	  throw "catalog query: invalid datatype name " + value + ".";
+	q.types.insert(t);
+      } else if (option == "-r") {
+	q.rows = std::strtoull(argv[1], NULL, 10);
+      } else if (option == "-c") {
+	q.components = std::strtoul(argv[1], NULL, 10);
+      } else {
+	q.meshes.push_back(value);
+      }
+      --argc;
+      ++argv;
+    } else {
+      throw "catalog query: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  struct stat s;
+  if (stat(catalog_filename.c_str(), &s) == 0 and S_ISDIR(s.st_mode))
+    catalog_filename += std::string("/") + alucell::dbfile_catalog::default_filename;
+  check_file_read_accessibility(catalog_filename, catalog_filename + " is not accessible");
+
+  alucell::dbfile_catalog catalog;
+  catalog.load(catalog_filename);
+  const std::string& root(catalog.get_root());
+  catalog.query(q, [&](const alucell::catalog_file& file, const std::vector<std::size_t>& variables) {
+      std::cout << root << "/" << file.path << std::endl;
+      if (not verbose_output)
+	return;
+      for (const auto k: variables) {
+	const alucell::catalog_variable& v(file.variables[k]);
+	std::cout << "  " << std::setw(14) << std::left << alucell::pretty_data_type(v.type)
+		  << std::setw(13) << std::right << v.size;
+	if (is_array_type(v.type))
+	  std::cout << std::setw(11) << std::right << v.rows << " x " << std::setw(3) << std::left << v.components;
+	else
+	  std::cout << std::string(17, ' ');
+	std::cout << "  " << v.name << std::endl;
+      }
+    });
+}
+
+void dbfile_catalog_action(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("catalog: wrong number of arguments.");
+
+  if (std::string("build") == argv[0]) {
+    build_dbfile_catalog(argc - 1, argv + 1);
+  } else if (std::string("query") == argv[0]) {
+    query_dbfile_catalog(argc - 1, argv + 1);
+  } else if (std::string("-h") == argv[0]) {
+    std::cout << catalog_help_message << std::endl;
+  } else {
+    throw std::string("catalog: unknown command ") + argv[0] + ".";
+  }
+}
+
+alucell::query_server* running_query_server(NULL);
+
+extern "C" void stop_query_server(int) {
+  if (running_query_server)
+    running_query_server->stop();
+}
+
+void serve_queries(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("serve: wrong number of arguments.");
+
+  const std::string socket_path(argv[0]);
+  --argc;
+  ++argv;
+
+  unsigned int threads(default_threads_number());
+  std::size_t cache_size(alucell::variable_cache::default_byte_budget);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << serve_help_message << std::endl;
+      return;
+    } else if (option == "-j" or option == "-C") {
+      if (argc < 2)
+	throw "serve: expected parameter following '" + option + "' option.";
+      if (option == "-j")
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      else
+	cache_size = parse_memory_size(argv[1]);
+      --argc;
+      ++argv;
+    } else {
+      throw "serve: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  alucell::query_server server(socket_path, threads, cache_size);
+  running_query_server = &server;
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = stop_query_server;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  std::cout << "serve: listening on " << socket_path << " with " << threads << " threads." << std::endl;
+  server.run();
+  running_query_server = NULL;
+
+  const alucell::query_server::counters c(server.get_counters());
+  std::cout << "serve: " << c.connections << " connections, " << c.requests << " requests, "
+	    << c.errors << " errors, " << c.reopened << " dbfiles reopened." << std::endl;
+}
+
+/*
+ *  Latencies of 'requests' show and dump requests of the variable 'spec',
+ *  possibly with a row selection for the dumps, from 'clients'
+ *  connections, against the time to open the dbfile and read the variable
+ *  in this process.
+ */
+void benchmark_query_server(const std::string& socket_path, const std::string& db_filename,
+			    const std::string& spec, std::size_t requests, unsigned int clients) {
+  const std::string name(alucell::parse_variable_slice(spec).first);
+  typedef std::chrono::steady_clock clock;
+  auto seconds = [](clock::time_point b, clock::time_point e) {
+    return std::chrono::duration<double>(e - b).count();
+  };
+  auto print_latencies = [](const std::string& what, std::vector<double>& latencies) {
+    if (latencies.empty())
+      return;
+    std::sort(latencies.begin(), latencies.end());
+    double sum(0.);
+    for (const double l: latencies)
+      sum += l;
+    std::cout << "  " << std::setw(10) << std::left << what << std::right
+	      << " mean " << std::setw(9) << sum / latencies.size() * 1e6
+	      << " us, p50 " << std::setw(9) << latencies[latencies.size() / 2] * 1e6
+	      << " us, p99 " << std::setw(9) << latencies[latencies.size() * 99 / 100] * 1e6
+	      << " us, max " << std::setw(9) << latencies.back() * 1e6 << " us" << std::endl;
+  };
+
+  std::vector<std::vector<double> > show_latencies(clients), dump_latencies(clients);
+  std::vector<std::string> errors(clients);
+  std::vector<std::thread> threads;
+  const clock::time_point start(clock::now());
+  for (unsigned int t(0); t < clients; ++t)
+    threads.push_back(std::thread([&, t]() {
+	  try {
+	    alucell::query_client client(socket_path);
+	    for (std::size_t r(t); r < requests; r += clients) {
+	      clock::time_point b(clock::now());
+	      client.show(db_filename, name);
+	      clock::time_point e(clock::now());
+	      show_latencies[t].push_back(seconds(b, e));
+	      client.dump(db_filename, spec);
+	      dump_latencies[t].push_back(seconds(e, clock::now()));
+	    }
+	  }
+	  catch (const std::string& e) {
+	    errors[t] = e;
+	  }
+	}));
+  for (auto& t: threads)
+    t.join();
+  const double elapsed(seconds(start, clock::now()));
+  for (const auto& e: errors)
+    if (e.size())
+      throw e;
+
+  std::vector<double> show, dump, local;
+  for (unsigned int t(0); t < clients; ++t) {
+    show.insert(show.end(), show_latencies[t].begin(), show_latencies[t].end());
+    dump.insert(dump.end(), dump_latencies[t].begin(), dump_latencies[t].end());
+  }
+
+  std::vector<char> payload;
+  for (std::size_t r(0); r < std::min<std::size_t>(requests, 100); ++r) {
+    const clock::time_point b(clock::now());
+    alucell::database_read_access db(db_filename);
+    alucell::database_index index(&db);
+    const unsigned int id(index.get_variable_id(name));
+    payload.resize(db.get_variable_size(id));
+    db.read_data_from_database(id, payload.data());
+    local.push_back(seconds(b, clock::now()));
+  }
+
+  std::cout.precision(4);
+  std::cout << spec << ": " << 2 * requests << " requests from " << clients << " clients in "
+	    << elapsed << " s, " << 2 * requests / elapsed << " requests/s" << std::endl;
+  print_latencies("show", show);
+  print_latencies("dump", dump);
+  print_latencies("open+read", local);
+}
+
+void send_query(int argc, char* argv[]) {
+  for (int k(0); k < argc; ++k)
+    if (std::string("-h") == argv[k]) {
+      std::cout << query_help_message << std::endl;
+      return;
+    }
+  if (argc < 3)
+    throw std::string("query: wrong number of arguments.");
+
+  const std::string socket_path(argv[0]), command(argv[1]), db_filename(argv[2]);
+  argc -= 3;
+  argv += 3;
+
+  std::vector<std::string> arguments;
+  std::vector<double> percentiles;
+  std::size_t requests(1000);
+  unsigned int clients(1);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-p" or option == "-n" or option == "-c") {
+      if (argc < 2)
+	throw "query: expected parameter following '" + option + "' option.";
+      if (option == "-p")
+	percentiles.push_back(std::strtod(argv[1], NULL));
+      else if (option == "-n")
+	requests = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      else
+	clients = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      arguments.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  const std::size_t expected(command == "ls" ? 0 : command == "probe" ? 2 : 1);
+  if (arguments.size() < expected or (command != "probe" and arguments.size() > expected))
+    throw "query: wrong number of arguments for " + command + ".";
+
+  std::cout.precision(12);
+  if (command == "bench") {
+    benchmark_query_server(socket_path, db_filename, arguments[0], requests, clients);
+    return;
+  }
+
+  alucell::query_client client(socket_path);
+  if (command == "ls") {
+    for (const auto& v: client.ls(db_filename))
+      std::cout << std::setw(14) << std::left << alucell::pretty_data_type(v.type)
+		<< std::setw(13) << std::right << v.size << "  " << v.name << std::endl;
+  } else if (command == "show") {
+    const alucell::query_client::variable_summary s(client.show(db_filename, arguments[0]));
+    std::cout << arguments[0] << ": " << alucell::pretty_data_type(s.type) << ", " << s.size << " bytes";
+    if (s.rows or s.components)
+      std::cout << ", " << s.rows << " x " << s.components;
+    std::cout << std::endl;
+    if (is_array_type(s.type))
+      for (std::size_t c(0); 2 * c + 1 < s.values.size(); ++c)
+	std::cout << "  component " << c << ": [" << s.values[2 * c] << ", " << s.values[2 * c + 1] << "]" << std::endl;
+    else if (s.type == alucell::data_type::matrix and s.values.size() == 2)
+      std::cout << "  range: [" << s.values[0] << ", " << s.values[1] << "]" << std::endl;
+    else if (s.values.size())
+      std::cout << "  value: " << s.values[0] << std::endl;
+    else if (s.text.size())
+      std::cout << "  value: " << s.text << std::endl;
+  } else if (command == "dump") {
+    const alucell::query_client::array_values a(client.dump(db_filename, arguments[0]));
+    for (std::size_t i(0); i < a.rows; ++i) {
+      for (unsigned int c(0); c < a.components; ++c)
+	std::cout << (c ? " " : "") << a.values[i * a.components + c];
+      std::cout << std::endl;
+    }
+  } else if (command == "stats") {
+    const std::vector<alucell::statistics::component_statistics>
+      stats(client.stats(db_filename, arguments[0], percentiles));
+    for (unsigned int c(0); c < stats.size(); ++c) {
+      const alucell::statistics::component_statistics& s(stats[c]);
+      std::cout << "  component " << c << ":" << std::endl;
+      std::cout << "    min: " << s.min << std::endl;
+      std::cout << "    max: " << s.max << std::endl;
+      std::cout << "    mean: " << s.mean << std::endl;
+      std::cout << "    L1 norm: " << s.l1_norm << std::endl;
+      std::cout << "    L2 norm: " << s.l2_norm << std::endl;
+      std::cout << "    Linf norm: " << s.linf_norm << std::endl;
+      std::cout << "    NaN: " << s.nan_count << std::endl;
+      std::cout << "    Inf: " << s.inf_count << std::endl;
+      for (const auto& p: s.percentiles)
+	std::cout << "    percentile " << p.first << ": " << p.second << std::endl;
+    }
+  } else if (command == "probe") {
+    std::vector<double> points;
+    for (std::size_t k(2); k < arguments.size(); ++k)
+      points.push_back(std::strtod(arguments[k].c_str(), NULL));
+    const alucell::query_client::probe_values p(client.probe(db_filename, arguments[0], arguments[1], points));
+    for (std::size_t i(0); i < p.elements.size(); ++i) {
+      for (unsigned int d(0); d < p.dimension; ++d)
+	std::cout << points[i * p.dimension + d] << " ";
+      std::cout << p.elements[i];
+      for (unsigned int c(0); c < p.components; ++c)
+	std::cout << " " << p.values[i * p.components + c];
+      std::cout << std::endl;
+    }
+  } else {
+    throw "query: unknown command " + command + ".";
+  }
+}
+
+void list_dbfile_meshes(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("Wrong number of arguments");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  bool list_scalar(false), list_nodal(false), list_elemental(false);
+  std::set<std::string> meshes_to_list;
+  std::set<unsigned int> vector_ranks_to_list;
+  while (argc) {
+    if (argv[0] == std::string("-h")) {
+      std::cout << meshes_help_message << std::endl;
+      return;
+    } else if (argv[0] == std::string("-e")) {
+      list_elemental = true;
+    } else if (argv[0] == std::string("-s")) {
+      list_scalar = true;
+    } else if (argv[0] == std::string("-n")) {
+      list_nodal = true;
+    } else if (argv[0] == std::string("-a")) {
+      list_scalar = true;
+      list_nodal = true;
+      list_elemental = true;
+    } else if (argv[0][0] == '-'
+               and std::all_of<const char*, int (*)(int)>(argv[0] + 1,
+                                                          argv[0] + std::strlen(argv[0]),
+                                                          std::isdigit)) {
+      vector_ranks_to_list.insert(std::strtoul(argv[0] + 1,
+                                                 NULL,
+                                                 10));
+    } else {
+      meshes_to_list.insert(argv[0]);
+    }
+    --argc;
+    ++argv;
+  }
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const alucell::mesh_catalog catalog(&db, meshes_to_list);
+
+  for (const auto& mesh: catalog.get_meshes()) {
+    std::cout << mesh.name << ": ";
+    std::cout << mesh.nodes_number << " nodes, ";
+    std::cout << mesh.elements_number << " elements." << std::endl;
+
+    for (const auto& v: mesh.variables) {
+      switch (v.kind) {
+      case alucell::mesh_variable::nodal:
+      case alucell::mesh_variable::elemental:
+	if (vector_ranks_to_list.size() == 0 or vector_ranks_to_list.count(v.components)) {
+	  if (v.kind == alucell::mesh_variable::nodal and list_nodal)
+	    std::cout << "  nodal variable: " << v.name << std::endl;
+	  else if ((v.kind == alucell::mesh_variable::elemental or v.also_elemental) and list_elemental)
+	    std::cout << "  elemental variable: " << v.name << std::endl;
+	}
+	break;
+
+      case alucell::mesh_variable::scalar:
+	if (list_scalar)
+	  std::cout << "  scalar variable: " << v.name << std::endl;
+	break;
+      }
+    }
+    std::cout << std::endl;
+  }
+}
+
+
+void database_info(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("info: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  while (argc) {
+    if (argv[0] == std::string("-h")) {
+      std::cout << info_help_message << std::endl;
+      return;
+    } else {
+      throw std::string("Wrong argument.");
+    }
+    --argc;
+    ++argv;
+  }
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  db.dump_database_infos(std::cout);
+}
+
+std::string print_memory_size(unsigned long s) {
+  const char* prefixes[] = {" byte", " Kilobyte", " Megabyte", " Gigabyte", " Terabyte", " Exabyte", " Petabyte"};
+
+  unsigned int prefix_id(0);
+  while (s > 1000 and prefix_id < 7) {
+    ++prefix_id;
+    s /= 1000;
+  }
+
+  return std::to_string(s) + prefixes[prefix_id];
+}
+
+void list_dbfile_content(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("ls: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  bool verbose_output(false);
+  bool human_units(false);
+  alucell::variable_selector selector;
+  while (argc) {
+    if (argv[0] == std::string("-t") and argc >= 2) {
+      alucell::data_type t(alucell::pretty_name_to_data_type(argv[1]));
+      if (t == alucell::data_type::unknown)
+	throw std::string("Invalid datatype name.");
+      
+      selector.add_type(t);
+      argc -= 1;
+      argv += 1;
+    } else if (parse_selection_option(argc, argv, selector)) {
+    } else if (argv[0] == std::string("-v")) {
+      verbose_output = true;
+    } else if (argv[0] == std::string("-H")) {
+      human_units = true;
+    } else if (argv[0] == std::string("-h")) {
+      std::cout << list_help_message << std::endl;
+      return;
+    } else {
+      throw std::string("Wrong argument.");
     }
     
     --argc;
     ++argv;
   }
 
-  alucell::database_read_access db(db_filename);
-  for (unsigned int i(0); i < db.get_variables_number(); ++i) {
-    if (included_types.size() == 0
-	or (included_types.count(db.get_variable_type(i)) > 0)) {
-      if (verbose_output) {
-	std::string size;
-	if (human_units) size = print_memory_size(db.get_variable_size(i));
-	else size = std::to_string(db.get_variable_size(i));
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  for (const auto i: selector.select(&db)) {
+    if (verbose_output) {
+      std::string size;
+      if (human_units) size = print_memory_size(db.get_variable_size(i));
+      else size = std::to_string(db.get_variable_size(i));
 	
-	std::cout << std::setw(14) << std::left << alucell::pretty_data_type(db.get_variable_type(i))
-		  << std::setw(13) << std::right << size
-		  << "  " << db.get_variable_name(i) << std::endl;
-      } else {
-	std::cout << db.get_variable_name(i) << std::endl;
-      }
+      std::cout << std::setw(14) << std::left << alucell::pretty_data_type(db.get_variable_type(i))
+		<< std::setw(13) << std::right << size
+		<< "  " << db.get_variable_name(i) << std::endl;
+    } else {
+      std::cout << db.get_variable_name(i) << std::endl;
     }
   }
 }
 
 
-template<typename T>
-void show_array(alucell::database_read_access* db, unsigned int id) {
-  alucell::variable::array<T> v(db, id);
+template<typename T, typename S>
+void show_rows(S& v, std::size_t selected_rows) {
   std::cout << "  rows: " << v.get_size() << std::endl;
+  if (selected_rows != v.get_size())
+    std::cout << "  selected rows: " << selected_rows << std::endl;
   std::cout << "  components: " << v.get_components() << std::endl;
   std::cout << "  elements: " << v.get_size() * v.get_components() << std::endl;
   std::cout << "  memory: " << print_memory_size(v.get_size() * v.get_components() * sizeof(T) + 2 * sizeof(double)) << std::endl;
-  for (unsigned int c(0); c < v.get_components(); ++c) {
-    T
-      min(std::numeric_limits<T>::max()),
-      max(std::numeric_limits<T>::lowest());
-    for (unsigned int i(0); i < v.get_size(); ++i) {
-      min = min > v.get_value(i, c) ? v.get_value(i, c) : min;
-      max = max < v.get_value(i, c) ? v.get_value(i, c) : max;
+
+  std::vector<T>
+    min(v.get_components(), std::numeric_limits<T>::max()),
+    max(v.get_components(), std::numeric_limits<T>::lowest());
+  while (v.next()) {
+    for (unsigned int c(0); c < v.get_components(); ++c) {
+      for (std::size_t i(0); i < v.get_window_rows(); ++i) {
+	min[c] = min[c] > v.get_value(i, c) ? v.get_value(i, c) : min[c];
+	max[c] = max[c] < v.get_value(i, c) ? v.get_value(i, c) : max[c];
+      }
     }
-    std::cout << "  component " << c << " range: [" << min << ", " << max << "]" << std::endl;
+  }
+
+  for (unsigned int c(0); c < v.get_components(); ++c)
+    std::cout << "  component " << c << " range: [" << min[c] << ", " << max[c] << "]" << std::endl;
+}
+
+template<typename T>
+void show_array(alucell::database_read_access* db, unsigned int id,
+		const alucell::row_selection& selection, std::size_t buffer_size,
+		const std::vector<char>& payload) {
+  if (payload.size()) {
+    alucell::variable::array_stream<T> v(payload);
+    show_rows<T>(v, v.get_size());
+  } else if (selection.is_all()) {
+    alucell::variable::array_stream<T> v(db, id, buffer_size);
+    show_rows<T>(v, v.get_size());
+  } else {
+    alucell::variable::array_slice_stream<T> v(db, id, selection, buffer_size);
+    show_rows<T>(v, v.get_selected_rows());
   }
 }
   
@@ -560,10 +3228,19 @@ void show_variable(int argc, char* argv[]) {
     ++argv;
 
     std::vector<std::string> variables_to_show;
+    alucell::variable_selector selector;
+    std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
     while (argc > 0) {
       if (argv[0] == std::string("-h")) {
 	std::cout << show_help_message << std::endl;
 	return;
+      } else if (parse_selection_option(argc, argv, selector)) {
+      } else if (argv[0] == std::string("-B")) {
+	if (argc < 2)
+	  throw std::string("show: expected parameter following '-B' option.");
+	buffer_size = parse_memory_size(argv[1]);
+	--argc;
+	++argv;
       } else {
 	variables_to_show.push_back(argv[0]);
       }
@@ -572,37 +3249,64 @@ void show_variable(int argc, char* argv[]) {
       ++argv;
     }
 
+    if (variables_to_show.empty() and selector.empty())
+      throw std::string("Expecting variable name(s).");
 
-    alucell::database_read_access db(db_filename);
-    alucell::database_index index(&db);
+    const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+    alucell::database_read_access& db(*db_access);
+    std::vector<unsigned int> ids;
+    std::vector<alucell::row_selection> selections;
+    std::vector<bool> streamed;
+    resolve_variables(&db, variables_to_show, selector, buffer_size, ids, selections, streamed);
 
-    for (const auto& name: variables_to_show) {
-      const unsigned int id(index.get_variable_id(name));
+    for_each_variable_payload(&db, ids, streamed, buffer_size,
+			      [&](std::size_t k, const std::vector<char>& payload) {
+      const std::string& name(variables_to_show[k]);
+      const unsigned int id(ids[k]);
 
       switch (db.get_variable_type(id)) {
       case alucell::data_type::real_array:
 	std::cout << name << ": real number array" << std::endl;;
-	show_array<double>(&db, id);
+	show_array<double>(&db, id, selections[k], buffer_size, payload);
 	break;
 	
       case alucell::data_type::int_array:
       case alucell::data_type::element_array:
 	std::cout << name << ": integer/element array" << std::endl;;
-	show_array<int>(&db, id);
+	show_array<int>(&db, id, selections[k], buffer_size, payload);
 	break;
 	
       case alucell::data_type::matrix:
-	std::cout << matrix_message << std::endl;
+	{
+	  std::cout << name << ": matrix" << std::endl;
+	  const alucell::matrix_view a(payload.data(), payload.size());
+	  std::cout << "  rows: " << a.get_rows() << std::endl;
+	  std::cout << "  columns: " << a.get_columns() << std::endl;
+	  std::cout << "  memory: " << print_memory_size(payload.size()) << std::endl;
+	  if (a.get_rows() and a.get_columns()) {
+	    const double* data(a.get_data());
+	    const auto range(std::minmax_element(data, data + a.get_rows() * a.get_columns()));
+	    std::cout << "  range: [" << *range.first << ", " << *range.second << "]" << std::endl;
+	  }
+	}
 	break;
 	
       case alucell::data_type::sky_matrix:
-	std::cout << skymatrix_message << std::endl;
+	{
+	  std::cout << name << ": sky matrix" << std::endl;
+	  const alucell::sky_matrix_view a(payload.data(), payload.size());
+	  const alucell::csr_matrix c(alucell::sky_matrix_to_csr(a));
+	  std::cout << "  equations: " << a.get_size() << std::endl;
+	  std::cout << "  symmetric: " << (a.is_symmetric() ? "yes" : "no") << std::endl;
+	  std::cout << "  profile terms above the diagonal: " << a.get_profile_size() << std::endl;
+	  std::cout << "  nonzero terms: " << c.get_nonzeros() << std::endl;
+	}
 	break;
 
       case alucell::data_type::real_number:
 	{
 	  std::cout << name << ": real number" << std::endl;
-	  alucell::variable::number v(&db, id);
+	  alucell::variable::number v(payload);
 	  std::cout << "  value: " << v.get_value() << std::endl;
 	}
 	break;
@@ -610,7 +3314,7 @@ void show_variable(int argc, char* argv[]) {
       case alucell::data_type::expression:
 	{
 	  std::cout << name << ": expression" << std::endl;
-	  alucell::variable::expression v(&db, id);
+	  alucell::variable::expression v(payload);
 	  alucell::expression_decoder d(&v);
 	  std::cout << "  domain dimension: " << d.get_input_rank() << std::endl;
 	  std::cout << "  codomain dimension: " << d.get_output_rank() << std::endl;
@@ -620,7 +3324,7 @@ void show_variable(int argc, char* argv[]) {
       case alucell::data_type::string:
 	{
 	  std::cout << name << ": character string" << std::endl;
-	  alucell::variable::string v(&db, id);
+	  alucell::variable::string v(payload);
 	  std::cout << "  value: '" << v.get_value() << "'" << std::endl;
 	  std::cout << "  length: " << v.get_value().size() << std::endl;
 	}
@@ -629,8 +3333,633 @@ void show_variable(int argc, char* argv[]) {
       default:
 	throw std::string("Unknown type.");
       }
+    });
+  }
+}
+
+template<typename T>
+void print_array_statistics(alucell::database_read_access* db, unsigned int id,
+			    const std::vector<double>& percentiles, unsigned int threads,
+			    std::size_t buffer_size) {
+  const std::pair<std::size_t, unsigned int> dimensions(db->get_array_dimensions(id));
+  const std::vector<alucell::statistics::component_statistics>
+    stats(alucell::statistics::compute_statistics<T>(db, id, percentiles, threads, buffer_size));
+
+  std::cout << "  rows: " << dimensions.first << std::endl;
+  std::cout << "  components: " << dimensions.second << std::endl;
+  for (unsigned int c(0); c < dimensions.second; ++c) {
+    const alucell::statistics::component_statistics& s(stats[c]);
+    std::cout << "  component " << c << ":" << std::endl;
+    std::cout << "    min: " << s.min << std::endl;
+    std::cout << "    max: " << s.max << std::endl;
+    std::cout << "    mean: " << s.mean << std::endl;
+    std::cout << "    L1 norm: " << s.l1_norm << std::endl;
+    std::cout << "    L2 norm: " << s.l2_norm << std::endl;
+    std::cout << "    Linf norm: " << s.linf_norm << std::endl;
+    std::cout << "    NaN: " << s.nan_count << std::endl;
+    std::cout << "    Inf: " << s.inf_count << std::endl;
+    for (const auto& p: s.percentiles)
+      std::cout << "    percentile " << p.first << ": " << p.second << std::endl;
+  }
+}
+
+void compute_variable_statistics(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("stats: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  --argc;
+  ++argv;
+
+  std::vector<std::string> variables_to_process;
+  std::vector<double> percentiles;
+  unsigned int threads(default_threads_number());
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  while (argc) {
+    if (argv[0] == std::string("-h")) {
+      std::cout << stats_help_message << std::endl;
+      return;
+    } else if (argv[0] == std::string("-B")) {
+      if (argc < 2)
+	throw std::string("stats: expected parameter following '-B' option.");
+      buffer_size = parse_memory_size(argv[1]);
+      --argc;
+      ++argv;
+    } else if (argv[0] == std::string("-p")) {
+      if (argc < 2)
+	throw std::string("stats: expected parameter following '-p' option.");
+      percentiles.push_back(std::strtod(argv[1], NULL));
+      --argc;
+      ++argv;
+    } else if (argv[0] == std::string("-j")) {
+      if (argc < 2)
+	throw std::string("stats: expected parameter following '-j' option.");
+      threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      variables_to_process.push_back(argv[0]);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  const std::shared_ptr<alucell::database_read_access> db_access(open_dbfile(db_filename));
+  alucell::database_read_access& db(*db_access);
+  const std::shared_ptr<alucell::database_index> index(index_dbfile(&db));
+
+  std::vector<unsigned int> ids;
+  if (variables_to_process.size() == 0) {
+    for (unsigned int i(0); i < db.get_variables_number(); ++i)
+      if (db.get_variable_type(i) == alucell::data_type::real_array)
+	ids.push_back(i);
+  } else {
+    for (const auto& name: variables_to_process)
+      ids.push_back(index->get_variable_id(name));
+  }
+
+  std::cout.precision(12);
+  for (const auto id: ids) {
+    switch (db.get_variable_type(id)) {
+    case alucell::data_type::real_array:
+      std::cout << db.get_variable_name(id) << ": real number array" << std::endl;
+      print_array_statistics<double>(&db, id, percentiles, threads, buffer_size);
+      break;
+
+    case alucell::data_type::int_array:
+    case alucell::data_type::element_array:
+      std::cout << db.get_variable_name(id) << ": integer/element array" << std::endl;
+      print_array_statistics<int>(&db, id, percentiles, threads, buffer_size);
+      break;
+
+    default:
+      throw std::string("stats: ") + db.get_variable_name(id) + " is not an array.";
+    }
+  }
+}
+
+/*
+ *  Scan of the array variable 'name' of several dbfiles, through an
+ *  asynchronous read engine: at most 'max_open_files' dbfiles are open
+ *  at the same time, and their windows are read concurrently into a
+ *  pool of 'slots' buffers sharing the 'buffer_size' budget. f(values,
+ *  rows, components) is called on each window as soon as it is read,
+ *  so the windows are processed in no particular order.
+ */
+template<typename F>
+class async_array_scan {
+public:
+  static const unsigned int max_open_files = 16;
+
+  async_array_scan(const std::vector<std::string>& _filenames, const std::string& _name,
+		   unsigned int _component, std::size_t buffer_size, F& _f,
+		   unsigned int slots = 8)
+    : filenames(_filenames), name(_name), component(_component), f(_f),
+      files(_filenames.size()), engine(2 * slots), next_file(0), open_files(0),
+      slot_bytes(std::max<std::size_t>(sizeof(double), buffer_size / std::max(1u, slots))),
+      buffers(std::max(1u, slots)), free_slots(), pending() {
+    for (unsigned int s(0); s < buffers.size(); ++s)
+      free_slots.push_back(s);
+  }
+
+  void run() {
+    open_next_files();
+    engine.run();
+  }
+
+private:
+  struct file_state {
+    std::unique_ptr<alucell::database_read_access> db;
+    std::size_t number;
+    std::string filename;
+    unsigned int id;
+    bool integer;
+    std::size_t rows, row_bytes, window_rows, windows_left;
+    double dimensions[2];
+  };
+
+  struct window {
+    file_state* file;
+    std::size_t first_row, rows;
+  };
+
+  const std::vector<std::string>& filenames;
+  const std::string& name;
+  unsigned int component;
+  F& f;
+
+  // Declared before the engine, which waits for the reads in flight
+  // on destruction:
+  std::vector<std::unique_ptr<file_state> > files;
+  alucell::async_read_engine engine;
+  std::size_t next_file;
+  unsigned int open_files;
+
+  std::size_t slot_bytes;
+  std::vector<std::vector<double> > buffers;
+  std::vector<unsigned int> free_slots;
+  std::deque<window> pending;
+
+  void open_next_files() {
+    while (open_files < max_open_files and next_file < filenames.size()) {
+      file_state* file(new file_state);
+      files[next_file].reset(file);
+      file->db.reset(new alucell::database_read_access);
+      file->number = next_file;
+      file->filename = filenames[next_file++];
+      ++open_files;
+      file->db->open_async(&engine, file->filename, [this, file]() { on_open(file); });
+    }
+  }
+
+  void on_open(file_state* file) {
+    alucell::database_index index(file->db.get());
+    if (not index.exists(name))
+      throw file->filename + ": variable " + name + " not found.";
+    file->id = index.get_variable_id(name);
+
+    switch (file->db->get_variable_type(file->id)) {
+    case alucell::data_type::real_array:
+      file->integer = false;
+      break;
+
+    case alucell::data_type::int_array:
+    case alucell::data_type::element_array:
+      file->integer = true;
+      break;
+
+    default:
+      throw file->filename + ": " + name + " is not an array.";
+    }
+
+    file->db->read_data_async(&engine, file->id, 0, sizeof(file->dimensions), file->dimensions,
+			      [this, file]() { on_dimensions(file); });
+  }
+
+  void on_dimensions(file_state* file) {
+    const unsigned int components(file->dimensions[1]);
+    file->rows = file->dimensions[0];
+    if (component != alucell::statistics::all_components and component >= components)
+      throw name + " has only " + std::to_string(components) + " components.";
+
+    file->row_bytes = components * (file->integer ? sizeof(int) : sizeof(double));
+    if (sizeof(file->dimensions) + file->rows * file->row_bytes > file->db->get_variable_size(file->id))
+      throw file->filename + ": inconsistent array dimensions for " + name + ".";
+
+    file->window_rows = std::max<std::size_t>(1, slot_bytes / std::max<std::size_t>(1, file->row_bytes));
+    file->windows_left = (file->rows + file->window_rows - 1) / file->window_rows;
+    if (file->windows_left == 0) {
+      close_file(file);
+      return;
+    }
+
+    for (std::size_t first(0); first < file->rows; first += file->window_rows) {
+      window w = { file, first, std::min(file->window_rows, file->rows - first) };
+      pending.push_back(w);
+    }
+    submit_windows();
+  }
+
+  void submit_windows() {
+    while (free_slots.size() and pending.size()) {
+      const unsigned int slot(free_slots.back());
+      const window w(pending.front());
+      free_slots.pop_back();
+      pending.pop_front();
+
+      std::vector<double>& buffer(buffers[slot]);
+      const std::size_t length(w.rows * w.file->row_bytes);
+      buffer.resize((length + sizeof(double) - 1) / sizeof(double));
+      w.file->db->read_data_async(&engine, w.file->id,
+				  sizeof(w.file->dimensions) + w.first_row * w.file->row_bytes,
+				  length, buffer.data(),
+				  [this, w, slot]() { on_window(w, slot); });
+    }
+  }
+
+  void on_window(const window& w, unsigned int slot) {
+    const unsigned int components(w.file->dimensions[1]);
+    if (w.file->integer)
+      f(reinterpret_cast<const int*>(buffers[slot].data()), w.rows, components);
+    else
+      f(buffers[slot].data(), w.rows, components);
+
+    free_slots.push_back(slot);
+    if (--w.file->windows_left == 0)
+      close_file(w.file);
+    submit_windows();
+  }
+
+  void close_file(file_state* file) {
+    files[file->number].reset();
+    --open_files;
+    open_next_files();
+  }
+};
+
+/*
+ *  Call f(values, rows, components) on the windows of the array
+ *  variable 'name' of each of the dbfiles.
+ */
+template<typename F>
+void for_each_array_variable(const std::vector<std::string>& db_filenames,
+			     const std::string& name, unsigned int component,
+			     std::size_t buffer_size, F& f) {
+  async_array_scan<F> scan(db_filenames, name, component, buffer_size, f);
+  scan.run();
+}
+
+struct histogram_range_finder {
+  histogram_range_finder(unsigned int c, unsigned int t)
+    : component(c), threads(t),
+      min(std::numeric_limits<double>::infinity()),
+      max(-std::numeric_limits<double>::infinity()),
+      min_positive(std::numeric_limits<double>::infinity()) {}
+
+  template<typename T>
+  void operator()(const T* values, std::size_t rows, unsigned int components) {
+    const std::size_t first(component == alucell::statistics::all_components ? 0 : component);
+    const std::size_t stride(component == alucell::statistics::all_components ? 1 : components);
+    const std::size_t n(component == alucell::statistics::all_components ? rows * components : rows);
+
+    std::vector<double> mins(threads, min), maxs(threads, max), positives(threads, min_positive);
+    parallel_for(0, n, threads,
+		 [&](unsigned int t, std::size_t b, std::size_t e) {
+		   double lmin(mins[t]), lmax(maxs[t]), lpos(positives[t]);
+		   for (std::size_t i(b); i < e; ++i) {
+		     const T v(values[first + i * stride]);
+		     if (alucell::statistics::is_nan(v) or alucell::statistics::is_inf(v))
+		       continue;
+		     const double x(v);
+		     lmin = x < lmin ? x : lmin;
+		     lmax = x > lmax ? x : lmax;
+		     lpos = (x > 0. and x < lpos) ? x : lpos;
+		   }
+		   mins[t] = lmin;
+		   maxs[t] = lmax;
+		   positives[t] = lpos;
+		 });
+
+    min = *std::min_element(mins.begin(), mins.end());
+    max = *std::max_element(maxs.begin(), maxs.end());
+    min_positive = *std::min_element(positives.begin(), positives.end());
+  }
+
+  unsigned int component, threads;
+  double min, max, min_positive;
+};
+
+/*
+ *  Fill a histogram and, if given, a quantile sketch, both empty, in one
+ *  pass over each window: each thread fills its own copies, which are
+ *  merged into them at the end by merge().
+ */
+struct histogram_filler {
+  histogram_filler(alucell::statistics::histogram* h, alucell::statistics::quantile_sketch* s,
+		   unsigned int c, unsigned int t)
+    : hist(h), sketch(s), component(c), threads(std::max(1u, t)),
+      histograms(threads, *h), sketches(s ? threads : 0, s ? *s : alucell::statistics::quantile_sketch()) {}
+
+  template<typename T>
+  void operator()(const T* values, std::size_t rows, unsigned int components) {
+    const std::size_t first(component == alucell::statistics::all_components ? 0 : component);
+    const std::size_t stride(component == alucell::statistics::all_components ? 1 : components);
+    const std::size_t n(component == alucell::statistics::all_components ? rows * components : rows);
+
+    parallel_for(0, n, threads,
+		 [&](unsigned int t, std::size_t b, std::size_t e) {
+		   alucell::statistics::histogram& h(histograms[t]);
+		   alucell::statistics::quantile_sketch* s(sketches.empty() ? NULL : &sketches[t]);
+		   for (std::size_t i(b); i < e; ++i) {
+		     const T v(values[first + i * stride]);
+		     h.insert(v);
+		     if (s)
+		       s->insert(v);
+		   }
+		 });
+  }
+
+  void merge() {
+    for (const auto& h: histograms)
+      hist->merge(h);
+    for (const auto& s: sketches)
+      sketch->merge(s);
+  }
+
+  alucell::statistics::histogram* hist;
+  alucell::statistics::quantile_sketch* sketch;
+  unsigned int component, threads;
+  std::vector<alucell::statistics::histogram> histograms;
+  std::vector<alucell::statistics::quantile_sketch> sketches;
+};
+
+void compute_variable_histogram(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("histogram: wrong number of arguments.");
+
+  std::vector<std::string> db_filenames;
+  std::string variable_name;
+  unsigned int component(alucell::statistics::all_components);
+  unsigned int bins(20);
+  bool range_given(false), logarithmic(false);
+  double lower(0.), upper(0.), accuracy(0.005);
+  std::vector<double> percentiles;
+  unsigned int threads(default_threads_number());
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << histogram_help_message << std::endl;
+      return;
+    } else if (option == "-l") {
+      logarithmic = true;
+    } else if (option == "-r") {
+      if (argc < 3)
+	throw std::string("histogram: expected two parameters following '-r' option.");
+      range_given = true;
+      lower = std::strtod(argv[1], NULL);
+      upper = std::strtod(argv[2], NULL);
+      argc -= 2;
+      argv += 2;
+    } else if (option == "-v" or option == "-c" or option == "-b"
+	       or option == "-q" or option == "-a" or option == "-j" or option == "-B") {
+      if (argc < 2)
+	throw "histogram: expected parameter following '" + option + "' option.";
+      if (option == "-v")
+	variable_name = argv[1];
+      else if (option == "-c")
+	component = std::strtoul(argv[1], NULL, 10);
+      else if (option == "-b")
+	bins = std::strtoul(argv[1], NULL, 10);
+      else if (option == "-q")
+	percentiles.push_back(std::strtod(argv[1], NULL));
+      else if (option == "-a")
+	accuracy = std::strtod(argv[1], NULL);
+      else if (option == "-B")
+	buffer_size = parse_memory_size(argv[1]);
+      else
+	threads = std::max(1ul, std::strtoul(argv[1], NULL, 10));
+      --argc;
+      ++argv;
+    } else {
+      check_file_read_accessibility(option, option + " is not accessible");
+      db_filenames.push_back(option);
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  if (db_filenames.empty())
+    throw std::string("histogram: expecting database filename(s).");
+  if (variable_name.empty())
+    throw std::string("histogram: mandatory '-v' option missing.");
+
+  if (not range_given) {
+    histogram_range_finder range(component, threads);
+    for_each_array_variable(db_filenames, variable_name, component, buffer_size, range);
+
+    lower = logarithmic ? range.min_positive : range.min;
+    upper = range.max;
+    if (not (lower <= upper))
+      throw std::string("histogram: no finite value to process.");
+
+    // Make the range half open on the right, and non empty:
+    upper = upper > lower ? std::nextafter(upper, std::numeric_limits<double>::infinity())
+      : (logarithmic ? 2. * lower : lower + 1.);
+  }
+
+  alucell::statistics::histogram hist(lower, upper, bins, logarithmic);
+  alucell::statistics::quantile_sketch sketch(accuracy);
+  histogram_filler filler(&hist, percentiles.size() ? &sketch : NULL, component, threads);
+  for_each_array_variable(db_filenames, variable_name, component, buffer_size, filler);
+  filler.merge();
+
+  std::cout.precision(12);
+  std::cout << variable_name << ": histogram over " << db_filenames.size() << " dbfile(s)" << std::endl;
+  std::cout << "  underflow: " << hist.get_underflow() << std::endl;
+  std::cout << "  overflow: " << hist.get_overflow() << std::endl;
+  std::cout << "  NaN: " << hist.get_nan_count() << std::endl;
+  std::cout << "  Inf: " << hist.get_inf_count() << std::endl;
+  for (unsigned int b(0); b < hist.get_bins_number(); ++b)
+    std::cout << std::setw(20) << std::right << hist.get_bin_lower(b)
+	      << std::setw(20) << std::right << hist.get_bin_upper(b)
+	      << std::setw(14) << std::right << hist.get_count(b) << std::endl;
+  for (const auto q: percentiles)
+    std::cout << "  percentile " << q << ": " << sketch.get_percentile(q) << std::endl;
+}
+
+void parse_action(int argc, char* argv[]);
+
+/*
+ *  Split a command line of 'db batch' on blanks, the single and double
+ *  quotes grouping words.
+ */
+std::vector<std::string> split_command_line(const std::string& line) {
+  std::vector<std::string> words;
+  std::string word;
+  bool in_word(false);
+  char quote(0);
+  for (const char c: line) {
+    if (quote) {
+      if (c == quote)
+	quote = 0;
+      else
+	word += c;
+    } else if (c == '\'' or c == '"') {
+      quote = c;
+      in_word = true;
+    } else if (std::isspace(static_cast<unsigned char>(c))) {
+      if (in_word)
+	words.push_back(word);
+      word.clear();
+      in_word = false;
+    } else {
+      word += c;
+      in_word = true;
+    }
+  }
+  if (quote)
+    throw std::string("batch: unterminated quote.");
+  if (in_word)
+    words.push_back(word);
+  return words;
+}
+
+/*
+ *  Read ahead, with a single plan of the batch read planner, the
+ *  variables named by the 'show' and 'dump' commands, in the order of
+ *  their first use, as long as they fit in 'buffer_size' bytes.
+ */
+void read_batch_payloads(batch_dbfile& batch, const std::vector<std::vector<std::string> >& commands,
+			 std::size_t buffer_size) {
+  std::vector<alucell::read_request> requests;
+  std::size_t total_size(0);
+  for (const auto& words: commands) {
+    if (words[0] != "show" and words[0] != "dump")
+      continue;
+    for (std::size_t k(1); k < words.size(); ++k) {
+      if (not batch.index->exists(words[k]))
+	continue;
+      const unsigned int id(batch.index->get_variable_id(words[k]));
+      const std::size_t size(batch.db->get_variable_size(id));
+      if (batch.payloads.count(id) or total_size + size > buffer_size)
+	continue;
+
+      std::vector<char>& payload(batch.payloads[id]);
+      payload.resize(size);
+      alucell::read_request r = {id, 0, size, payload.data()};
+      requests.push_back(r);
+      total_size += size;
+    }
+  }
+  batch.db->read_batch_from_database(requests);
+}
+
+void run_batch(int argc, char* argv[]) {
+  if (argc < 1)
+    throw std::string("batch: wrong number of arguments.");
+
+  const std::string db_filename(argv[0]);
+  --argc;
+  ++argv;
+
+  std::string commands_filename;
+  std::size_t buffer_size(alucell::variable::default_stream_buffer_size);
+  bool stop_on_error(false);
+  while (argc) {
+    const std::string option(argv[0]);
+    if (option == "-h") {
+      std::cout << batch_help_message << std::endl;
+      return;
+    } else if (option == "-e") {
+      stop_on_error = true;
+    } else if (option == "-f" or option == "-B") {
+      if (argc < 2)
+	throw "batch: expected parameter following '" + option + "' option.";
+      if (option == "-f")
+	commands_filename = argv[1];
+      else
+	buffer_size = parse_memory_size(argv[1]);
+      --argc;
+      ++argv;
+    } else {
+      throw "batch: unexpected argument " + option + ".";
+    }
+
+    --argc;
+    ++argv;
+  }
+
+  check_file_read_accessibility(db_filename, db_filename + " is not accessible");
+
+  std::ifstream commands_file;
+  if (commands_filename.size()) {
+    check_file_read_accessibility(commands_filename, commands_filename + " is not accessible");
+    commands_file.open(commands_filename.c_str());
+  }
+  std::istream& input(commands_filename.size() ? commands_file : std::cin);
+
+  const std::set<std::string> actions({"ls", "show", "dump", "mesh", "info", "extract", "stats", "histogram",
+				       "transfer", "reorder", "probe", "geom", "integrate", "export", "spmv",
+				       "delta", "materialize", "convert"});
+  std::vector<std::string> lines;
+  std::vector<std::vector<std::string> > commands;
+  std::string line;
+  while (std::getline(input, line)) {
+    const std::vector<std::string> words(split_command_line(line));
+    if (words.empty() or words[0][0] == '#')
+      continue;
+    if (not actions.count(words[0]))
+      throw "batch: " + words[0] + " is not an action on a dbfile, in '" + line + "'.";
+    lines.push_back(line);
+    commands.push_back(words);
+  }
+
+  batch_dbfile batch;
+  batch.filename = db_filename;
+  batch.db = std::make_shared<alucell::database_read_access>(db_filename);
+  batch.index = std::make_shared<alucell::database_index>(batch.db.get());
+  read_batch_payloads(batch, commands, buffer_size);
+
+  std::ios initial_format(NULL);
+  initial_format.copyfmt(std::cout);
+  std::size_t failed(0);
+  current_batch = &batch;
+  for (std::size_t c(0); c < commands.size(); ++c) {
+    std::vector<std::string> words(commands[c]);
+    words.insert(words.begin() + 1, db_filename);
+    std::vector<char*> command_argv;
+    for (auto& w: words)
+      command_argv.push_back(&w[0]);
+
+    std::cout << "#@ begin " << c + 1 << " " << lines[c] << std::endl;
+    std::string error;
+    try {
+      parse_action(command_argv.size(), command_argv.data());
+    }
+    catch (const std::string& e) {
+      error = e;
+    }
+    catch (const std::exception& e) {
+      error = e.what();
+    }
+    std::cout.copyfmt(initial_format);
+    std::cout << "#@ end " << c + 1 << (error.empty() ? " ok" : " error " + error) << std::endl;
+
+    if (error.size()) {
+      ++failed;
+      if (stop_on_error)
+	break;
     }
   }
+  current_batch = NULL;
+
+  if (failed)
+    throw "batch: " + std::to_string(failed) + " of " + std::to_string(commands.size()) + " commands failed.";
 }
 
 void print_usage() {
@@ -650,6 +3979,40 @@ void parse_action(int argc, char* argv[]) {
     database_info(argc - 1, argv + 1);
   } else if (std::string("extract") == argv[0]) {
     extract_dbfile_variables(argc - 1, argv + 1);
+  } else if (std::string("transfer") == argv[0]) {
+    transfer_mesh_field(argc - 1, argv + 1);
+  } else if (std::string("reorder") == argv[0]) {
+    reorder_mesh(argc - 1, argv + 1);
+  } else if (std::string("probe") == argv[0]) {
+    probe_mesh_field(argc - 1, argv + 1);
+  } else if (std::string("geom") == argv[0]) {
+    compute_mesh_geometry(argc - 1, argv + 1);
+  } else if (std::string("integrate") == argv[0]) {
+    integrate_mesh_fields(argc - 1, argv + 1);
+  } else if (std::string("export") == argv[0]) {
+    export_mesh_fields(argc - 1, argv + 1);
+  } else if (std::string("spmv") == argv[0]) {
+    benchmark_sparse_products(argc - 1, argv + 1);
+  } else if (std::string("delta") == argv[0]) {
+    write_delta_dbfile(argc - 1, argv + 1);
+  } else if (std::string("materialize") == argv[0]) {
+    materialize_dbfile(argc - 1, argv + 1);
+  } else if (std::string("catalog") == argv[0]) {
+    dbfile_catalog_action(argc - 1, argv + 1);
+  } else if (std::string("serve") == argv[0]) {
+    serve_queries(argc - 1, argv + 1);
+  } else if (std::string("query") == argv[0]) {
+    send_query(argc - 1, argv + 1);
+  } else if (std::string("batch") == argv[0]) {
+    run_batch(argc - 1, argv + 1);
+  } else if (std::string("merge") == argv[0]) {
+    merge_dbfiles(argc - 1, argv + 1);
+  } else if (std::string("convert") == argv[0]) {
+    convert_dbfile(argc - 1, argv + 1);
+  } else if (std::string("stats") == argv[0]) {
+    compute_variable_statistics(argc - 1, argv + 1);
+  } else if (std::string("histogram") == argv[0]) {
+    compute_variable_histogram(argc - 1, argv + 1);
   } else if (std::string("-h") == argv[0]){
     print_usage();
   } else {
@@ -0,0 +1,49 @@
+#ifndef _PARALLEL_UTILS_H_
+#define _PARALLEL_UTILS_H_
+
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+inline unsigned int default_threads_number() {
+  const unsigned int n(std::thread::hardware_concurrency());
+  return n == 0 ? 1 : n;
+}
+
+/*
+ *  Split the range [begin, end) into at most 'threads' contiguous
+ *  ranges of nearly equal length, and call f(thread_id, b, e) on each
+ *  of them from a different thread. The calling thread processes the
+ *  first range. The partition only depends on the range and on the
+ *  number of threads.
+ */
+template<typename F>
+void parallel_for(std::size_t begin, std::size_t end, unsigned int threads, F f) {
+  if (end <= begin)
+    return;
+
+  const std::size_t n(end - begin);
+  if (threads == 0)
+    threads = 1;
+  if (threads > n)
+    threads = n;
+
+  if (threads == 1) {
+    f(0u, begin, end);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (unsigned int t(1); t < threads; ++t)
+    workers.push_back(std::thread(f, t,
+				  begin + n * t / threads,
+				  begin + n * (t + 1) / threads));
+
+  f(0u, begin, begin + n / threads);
+
+  for (auto& w: workers)
+    w.join();
+}
+
+#endif /* _PARALLEL_UTILS_H_ */
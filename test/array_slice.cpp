@@ -0,0 +1,94 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_array_slice.hpp"
+
+/*
+ *  Parse the row selections of 'db dump', and read them from an array of
+ *  100 rows of 3 components, with windows and read extents of a few
+ *  rows: a range with a step, a range clamped to the last row, a single
+ *  row and a file of unsorted row indices starting at 0. Check that a
+ *  row or a range starting past the last row, and invalid ranges, are
+ *  refused.
+ */
+
+const std::size_t rows = 100;
+const unsigned int components = 3;
+
+std::vector<double> read_slice(alucell::database_read_access& db, const std::string& spec) {
+  const std::pair<std::string, alucell::row_selection> slice(alucell::parse_variable_slice(spec));
+  alucell::variable::array_slice_stream<double> v(&db, 0, slice.second, 5 * components * sizeof(double),
+						    2 * components * sizeof(double));
+  std::vector<double> values;
+  while (v.next())
+    values.insert(values.end(), v.get_values(), v.get_values() + v.get_window_rows() * components);
+  return values;
+}
+
+std::vector<double> expected_rows(const std::vector<std::size_t>& indices) {
+  std::vector<double> values;
+  for (const auto i: indices)
+    for (unsigned int j(0); j < components; ++j)
+      values.push_back(i * 10. + j);
+  return values;
+}
+
+bool is_refused(alucell::database_read_access& db, const std::string& spec) {
+  try {
+    read_slice(db, spec);
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    {
+      std::vector<double> values(2 + rows * components);
+      values[0] = rows;
+      values[1] = components;
+      for (std::size_t i(0); i < rows; ++i)
+	for (unsigned int j(0); j < components; ++j)
+	  values[2 + i * components + j] = i * 10. + j;
+      alucell::database_write_access db("array_slice.db");
+      db.insert("a", alucell::data_type::real_array, values.data(), values.size() * sizeof(double));
+    }
+    std::ofstream("array_slice.rows") << "7 0\n99\n  3 7" << std::endl;
+
+    alucell::database_read_access db("array_slice.db");
+    ok = alucell::parse_variable_slice("a[1:5]").first == "a"
+      and alucell::parse_variable_slice("a").second.is_all()
+      and read_slice(db, "a[10:40:7]") == expected_rows({10, 17, 24, 31, 38})
+      and read_slice(db, "a[95:5000]") == expected_rows({95, 96, 97, 98, 99})
+      and read_slice(db, "a[97:]") == expected_rows({97, 98, 99})
+      and read_slice(db, "a[:3]") == expected_rows({0, 1, 2})
+      and read_slice(db, "a[99]") == expected_rows({99})
+      and read_slice(db, "a[5:5]").empty()
+      and read_slice(db, "a@array_slice.rows") == expected_rows({7, 0, 99, 3, 7});
+
+    ok = ok and is_refused(db, "a[100]") and is_refused(db, "a[5000]") and is_refused(db, "a[5000:]")
+      and is_refused(db, "a[-1]") and is_refused(db, "a[1:x]") and is_refused(db, "a[1:2:0]")
+      and is_refused(db, "a[1:2:3:4]") and is_refused(db, "a@missing.rows");
+
+    std::ofstream("array_slice.rows") << "3 100" << std::endl;
+    ok = ok and is_refused(db, "a@array_slice.rows");
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("array_slice.db");
+  ::unlink("array_slice.rows");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/alucell_async_read.hpp"
+
+/*
+ *  With the io_uring backend when it is available, and with the thread
+ *  pool: read a file by many more reads than the queue depth, check the
+ *  data and the results, a read crossing the end of the file (a short
+ *  read, resubmitted, then failing with -EIO) and a read on a closed
+ *  descriptor. Check that a callback which throws leaves run() with its
+ *  exception, that the engine goes on with the other reads, and that it
+ *  can be destroyed with reads in flight.
+ */
+
+const std::size_t file_size = 1 << 20;
+
+bool check_engine(bool use_io_uring, int fd, const std::vector<char>& content) {
+  bool ok(true);
+  const std::size_t reads(200), length(4000);
+  std::vector<std::vector<char> > buffers(reads, std::vector<char>(length));
+  std::vector<char> tail(100);
+
+  /*
+   *  Declared after the buffers, so that it waits for its reads in
+   *  flight before they are freed:
+   */
+  alucell::async_read_engine engine(4, 3, use_io_uring);
+  ok = ok and (use_io_uring or not engine.uses_io_uring());
+
+  std::size_t done(0);
+  for (std::size_t k(0); k < reads; ++k) {
+    const std::size_t offset(k * 5003 % (file_size - length));
+    engine.submit(fd, offset, length, buffers[k].data(),
+		  [&, k, offset](long result) {
+		    ++done;
+		    ok = ok and result == static_cast<long>(length)
+		      and std::equal(buffers[k].begin(), buffers[k].end(), content.begin() + offset);
+		  });
+  }
+
+  long tail_result(0);
+  engine.submit(fd, file_size - 40, tail.size(), tail.data(), [&](long result) { tail_result = result; });
+  long closed_result(0);
+  engine.submit(-1, 0, tail.size(), tail.data(), [&](long result) { closed_result = result; });
+  engine.run();
+  ok = ok and done == reads and tail_result == -EIO
+    and std::equal(tail.begin(), tail.begin() + 40, content.end() - 40) and closed_result == -EBADF;
+
+  /*
+   *  Callback throwing, then the remaining reads, and a new one:
+   */
+  std::size_t called(0);
+  for (std::size_t k(0); k < 8; ++k)
+    engine.submit(fd, k * length, length, buffers[k].data(),
+		  [&](long) {
+		    if (called++ == 0)
+		      throw std::string("callback error");
+		  });
+  bool thrown(false);
+  try {
+    engine.run();
+  }
+  catch (const std::string& e) {
+    thrown = e == "callback error";
+  }
+  engine.run();
+  long after(0);
+  engine.submit(fd, 0, length, buffers[0].data(), [&](long result) { after = result; });
+  engine.run();
+  ok = ok and thrown and called >= 1 and called <= 8 and after == static_cast<long>(length);
+
+  /*
+   *  Reads left in flight when the engine is destroyed:
+   */
+  for (std::size_t k(0); k < 8; ++k)
+    engine.submit(fd, k * length, length, buffers[k].data(), [](long) {});
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<char> content(file_size);
+  for (std::size_t i(0); i < content.size(); ++i)
+    content[i] = static_cast<char>(i * 7919 % 251);
+  {
+    std::ofstream f("async_read.bin", std::ios::binary);
+    f.write(content.data(), content.size());
+  }
+
+  const int fd(::open("async_read.bin", O_RDONLY));
+  bool ok(fd >= 0);
+  try {
+    ok = ok and check_engine(true, fd, content) and check_engine(false, fd, content);
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::close(fd);
+  ::unlink("async_read.bin");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_async_write.hpp"
+
+/*
+ *  Write 50 real arrays with the sequential writer, and with the
+ *  asynchronous writer through a queue smaller than a few payloads, so
+ *  the producer has to wait. Check that the variables inserted before a
+ *  flush are visible to a reader, and that both dbfiles are identical
+ *  once closed. Check that the writes failing on /dev/full are thrown
+ *  by flush and close.
+ */
+
+std::vector<char> read_file(const std::string& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+std::vector<double> build_array(unsigned int v) {
+  const std::size_t rows(100 + v * 37);
+  std::vector<double> values(2 + rows);
+  values[0] = rows;
+  values[1] = 1.;
+  for (std::size_t i(0); i < rows; ++i)
+    values[2 + i] = v * 1000. + i;
+  return values;
+}
+
+int main(int argc, char *argv[]) {
+  {
+    alucell::database_write_access db("dbfile_sequential");
+    for (unsigned int v(0); v < 50; ++v) {
+      const std::vector<double> values(build_array(v));
+      db.insert("array_" + std::to_string(v), alucell::data_type::real_array,
+		values.data(), values.size() * sizeof(double));
+    }
+  }
+
+  bool ok(true);
+  {
+    alucell::database_async_write_access db("dbfile_async", 3 * 2000 * sizeof(double));
+    for (unsigned int v(0); v < 50; ++v) {
+      const std::vector<double> values(build_array(v));
+      std::vector<char> payload(db.acquire(values.size() * sizeof(double)));
+      std::copy(reinterpret_cast<const char*>(values.data()),
+		reinterpret_cast<const char*>(values.data() + values.size()), payload.begin());
+      db.insert("array_" + std::to_string(v), alucell::data_type::real_array, std::move(payload));
+
+      if (v == 24) {
+	db.flush();
+	alucell::database_read_access reader("dbfile_async");
+	ok = ok and reader.get_variables_number() == 25;
+      }
+    }
+    db.close();
+  }
+
+  ok = ok and read_file("dbfile_sequential") == read_file("dbfile_async");
+
+  /*
+   *  Writes failing on a full device, detected by a barrier or by close:
+   */
+  const std::vector<double> values(build_array(1000));
+  for (bool barrier: {true, false}) {
+    bool thrown(false);
+    try {
+      alucell::database_async_write_access db("/dev/full");
+      db.insert("array", alucell::data_type::real_array, values.data(), values.size() * sizeof(double));
+      if (barrier)
+	db.flush();
+      db.close();
+    }
+    catch (const std::string&) {
+      thrown = true;
+    }
+    ok = ok and thrown;
+  }
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../src/alucell_legacy_database.hpp"
+
+/*
+ *  Run 'db batch' on a small dbfile, with the commands read from a file
+ *  or from the standard input, and compare the output of each action,
+ *  between its '#@ begin' and '#@ end' lines, with the output of the same
+ *  action run alone, with all, some or none of the payloads read ahead.
+ *  Check the quoted words, the comments, the failed actions, which do not
+ *  stop the batch unless -e is given but make it fail, and that the
+ *  unknown actions are refused before anything is run. Check that the
+ *  options missing their parameter are refused, alone and in a batch.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name,
+		  std::size_t rows, unsigned int components, const std::vector<double>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.insert(payload.end(), values.begin(), values.end());
+  db.insert(name, alucell::data_type::real_array, payload.data(), payload.size() * sizeof(double));
+}
+
+/*
+ *  Standard output of the 'db' program next to this test, run with
+ *  'arguments', and its exit status.
+ */
+std::string run_db(const std::string& test_path, const std::string& arguments, int& status) {
+  const std::string directory(test_path.substr(0, test_path.find_last_of('/') + 1));
+  FILE* f(::popen((directory + "db " + arguments).c_str(), "r"));
+  if (not f)
+    throw std::string("cannot run db.");
+  std::string output;
+  char buffer[4096];
+  for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0;)
+    output.append(buffer, n);
+  const int s(::pclose(f));
+  status = WIFEXITED(s) ? WEXITSTATUS(s) : -1;
+  return output;
+}
+
+void write_commands(const std::string& filename, const std::string& commands) {
+  std::ofstream f(filename.c_str());
+  f << commands;
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("batch.db");
+      insert_array(db, "box_temperature", 3, 2, {1., 2., 3., 4., 5., 6.});
+      insert_array(db, "box velocity", 2, 1, {-1.5, 2.5});
+      const double time(0.125);
+      db.insert("time", alucell::data_type::real_number, &time, sizeof(time));
+    }
+
+    /*
+     *  Outputs of the actions run alone:
+     */
+    int status(0);
+    const std::vector<std::pair<std::string, std::string> > actions = {
+      {"show box_temperature time", "show batch.db box_temperature time"},
+      {"dump 'box velocity' box_temperature[1:3]", "dump batch.db 'box velocity' 'box_temperature[1:3]'"},
+      {"ls", "ls batch.db"},
+      {"dump time", "dump batch.db time"}
+    };
+    std::vector<std::string> alone;
+    for (const auto& a: actions) {
+      alone.push_back(run_db(argv[0], a.second, status));
+      ok = ok and status == 0 and alone.back().size();
+    }
+
+    auto framed = [&](std::size_t n, const std::string& line, const std::string& output, const std::string& end) {
+      return "#@ begin " + std::to_string(n) + " " + line + "\n" + output + "#@ end " + std::to_string(n) + " " + end + "\n";
+    };
+    std::string expected;
+    for (std::size_t k(0); k < actions.size(); ++k)
+      expected += framed(k + 1, actions[k].first, alone[k], "ok");
+
+    write_commands("batch_commands.txt",
+		   "# Commands of the batch test\n"
+		   "show box_temperature time\n"
+		   "\n"
+		   "  # show box_temperature\n"
+		   "dump 'box velocity' box_temperature[1:3]\n"
+		   "ls\n"
+		   "dump time\n");
+    for (const std::string buffer: {"1M", "40", "1"}) {
+      ok = ok and run_db(argv[0], "batch batch.db -B " + buffer + " -f batch_commands.txt", status) == expected
+	and status == 0
+	and run_db(argv[0], "batch batch.db -B " + buffer + " < batch_commands.txt", status) == expected
+	and status == 0;
+    }
+
+    /*
+     *  Failed actions, with and without -e:
+     */
+    write_commands("batch_commands.txt",
+		   "dump time\n"
+		   "dump pressure\n"
+		   "show \"box velocity\"\n");
+    const std::string failed(run_db(argv[0], "batch batch.db -f batch_commands.txt", status));
+    const std::string error_line("#@ end 2 error ");
+    const std::size_t error(failed.find(error_line));
+    const std::string show(run_db(argv[0], "show batch.db 'box velocity'", status));
+    ok = ok and failed.find(framed(1, "dump time", alone[3], "ok")) == 0
+      and failed.find("#@ begin 2 dump pressure\n") != std::string::npos and error != std::string::npos
+      and failed.find(framed(3, "show \"box velocity\"", show, "ok")) != std::string::npos;
+    run_db(argv[0], "batch batch.db -f batch_commands.txt", status);
+    ok = ok and status != 0;
+
+    const std::string stopped(run_db(argv[0], "batch batch.db -e -f batch_commands.txt", status));
+    ok = ok and status != 0 and stopped.find("#@ begin 2 dump pressure\n") != std::string::npos
+      and stopped.find(error_line) != std::string::npos and stopped.find("#@ begin 3") == std::string::npos;
+
+    /*
+     *  Unknown action, and unterminated quote:
+     */
+    write_commands("batch_commands.txt", "dump time\nrm time\n");
+    const std::string refused(run_db(argv[0], "batch batch.db -f batch_commands.txt", status));
+    ok = ok and status != 0 and refused.find("#@ begin") == std::string::npos
+      and refused.find("rm is not an action") != std::string::npos;
+    write_commands("batch_commands.txt", "dump time\nshow 'box velocity\n");
+    const std::string unterminated(run_db(argv[0], "batch batch.db -f batch_commands.txt", status));
+    ok = ok and status != 0 and unterminated.find("#@ begin") == std::string::npos;
+
+    /*
+     *  Options missing their parameter, alone and in a batch:
+     */
+    for (const std::string a: {"dump batch.db time -B", "dump batch.db time -f", "show batch.db time -B",
+			       "extract batch.db time -o batch_extract.db -B", "extract batch.db time -o batch_extract.db -j"}) {
+      const std::string output(run_db(argv[0], a, status));
+      ok = ok and status != 0 and output.find("expected parameter following '" + a.substr(a.size() - 2) + "' option.")
+	!= std::string::npos;
+    }
+    write_commands("batch_commands.txt", "dump time -B\nshow time -B\n");
+    const std::string missing(run_db(argv[0], "batch batch.db -f batch_commands.txt", status));
+    ok = ok and status != 0 and missing.find("#@ end 1 error dump: expected parameter following '-B' option.\n")
+      != std::string::npos and missing.find("#@ end 2 error show: expected parameter following '-B' option.\n")
+      != std::string::npos;
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("batch.db");
+  ::unlink("batch_commands.txt");
+  ::unlink("batch_extract.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_legacy_variable.hpp"
+
+/*
+ *  Read parts of the variables of a dbfile with the batch planner, in an
+ *  order unrelated to the file order, with overlapping, adjacent and
+ *  distant ranges and several gap and extent limits, and compare with
+ *  the reads of each range alone. Build the string, number and array
+ *  variables from the payloads read, and check that truncated payloads
+ *  and inconsistent lengths are refused.
+ */
+
+template<typename V>
+bool is_refused(const std::vector<char>& payload) {
+  try {
+    V v(payload);
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+std::vector<char> double_payload(const std::vector<double>& values) {
+  std::vector<char> payload(values.size() * sizeof(double));
+  std::memcpy(payload.data(), values.data(), payload.size());
+  return payload;
+}
+
+int main(int argc, char *argv[]) {
+  const unsigned int n(50);
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("batch_read.db");
+      for (unsigned int v(0); v < n; ++v) {
+	std::vector<double> values(2 + 100 * (v % 7 + 1));
+	values[0] = values.size() - 2;
+	values[1] = 1;
+	for (std::size_t i(2); i < values.size(); ++i)
+	  values[i] = v * 1000. + i;
+	db.insert("v" + std::to_string(v), alucell::data_type::real_array, values.data(), values.size() * sizeof(double));
+      }
+      const double pi(3.14159);
+      db.insert("pi", alucell::data_type::real_number, &pi, sizeof(pi));
+      const std::vector<double> title = {5., 0., 0.};
+      std::vector<char> title_payload(double_payload(title));
+      std::memcpy(&title_payload[2 * sizeof(double)], "alucl", 5);
+      db.insert("title", alucell::data_type::string, title_payload.data(), title_payload.size());
+    }
+
+    alucell::database_read_access db("batch_read.db");
+    std::vector<alucell::read_request> requests;
+    std::vector<std::vector<char> > batched, expected;
+    for (unsigned int k(0); k < 3 * n; ++k) {
+      const unsigned int id((k * 37) % n);
+      const std::size_t size(db.get_variable_size(id));
+      const std::size_t offset((k * 104) % size), length(std::min<std::size_t>(size - offset, 8 + k * 24));
+      batched.push_back(std::vector<char>(length));
+      expected.push_back(std::vector<char>(length));
+      db.read_data_from_database(id, offset, length, expected.back().data());
+      alucell::read_request r = {id, offset, length, NULL};
+      requests.push_back(r);
+    }
+
+    const std::size_t limits[][2] = {{0, 1}, {64, 256}, {1 << 16, 1 << 24}};
+    for (const auto& l: limits) {
+      for (std::size_t k(0); k < requests.size(); ++k) {
+	std::fill(batched[k].begin(), batched[k].end(), 0);
+	requests[k].dst = batched[k].data();
+      }
+      db.read_batch_from_database(requests, l[0], l[1]);
+      ok = ok and batched == expected;
+    }
+
+    const unsigned int pi_id(n), title_id(n + 1);
+    std::vector<char> pi(db.get_variable_size(pi_id)), title(db.get_variable_size(title_id)), array(db.get_variable_size(3));
+    const std::vector<alucell::read_request> whole = {
+      {title_id, 0, title.size(), title.data()}, {3, 0, array.size(), array.data()}, {pi_id, 0, pi.size(), pi.data()}
+    };
+    db.read_batch_from_database(whole);
+    const alucell::variable::array<double> a(array);
+    ok = ok and alucell::variable::number(pi).get_value() == 3.14159
+      and alucell::variable::string(title).get_value() == "alucl"
+      and a.get_size() == 400 and a.get_components() == 1 and a.get_value(399, 0) == 3401.;
+
+    ok = ok and is_refused<alucell::variable::number>(std::vector<char>(4))
+      and is_refused<alucell::variable::string>(std::vector<char>(8))
+      and is_refused<alucell::variable::string>(double_payload({100., 0., 0.}))
+      and is_refused<alucell::variable::string>(double_payload({-1., 0., 0.}))
+      and is_refused<alucell::variable::array<double> >(std::vector<char>(12))
+      and is_refused<alucell::variable::array<double> >(double_payload({2., 2., 1., 2., 3.}))
+      and is_refused<alucell::variable::array_stream<double> >(double_payload({2., 2., 1., 2., 3.}))
+      and not is_refused<alucell::variable::array<int> >(double_payload({2., 2., 1., 2.}));
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("batch_read.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_dbfile_catalog.hpp"
+
+/*
+ *  Catalog a directory holding a dbfile with a mesh, a dbfile in a
+ *  subdirectory and a text file, and check the queries by name, pattern,
+ *  type, dimensions and mesh, before and after the catalog is saved and
+ *  loaded. Then modify a dbfile, remove the text file, and check that
+ *  the refresh only opens the modified dbfile.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name, alucell::data_type t,
+		  std::size_t rows, unsigned int components) {
+  std::vector<double> values(2 + rows * components, 1.);
+  values[0] = rows;
+  values[1] = components;
+  db.insert(name, t, values.data(), values.size() * sizeof(double));
+}
+
+void write_pressure_dbfile(bool with_velocity) {
+  alucell::database_write_access db("catalog_dir/run/b");
+  insert_array(db, "cuveb_pressure", alucell::data_type::real_array, 10, 1);
+  if (with_velocity)
+    insert_array(db, "cuveb_velocity", alucell::data_type::real_array, 10, 3);
+}
+
+std::vector<std::string> query(alucell::dbfile_catalog& catalog, const alucell::catalog_query& q) {
+  std::vector<std::string> paths;
+  catalog.query(q, [&](const alucell::catalog_file& file, const std::vector<std::size_t>& variables) {
+      paths.push_back(file.path + ":" + std::to_string(variables.size()));
+    });
+  return paths;
+}
+
+bool check_queries(alucell::dbfile_catalog& catalog) {
+  const std::vector<std::string> a(1, "a:1"), b(1, "run/b:1"), none;
+
+  alucell::catalog_query by_name;
+  by_name.names.push_back("box_temperature");
+  alucell::catalog_query by_pattern;
+  by_pattern.patterns.push_back("cuveb_p*");
+  alucell::catalog_query by_dimensions;
+  by_dimensions.patterns.push_back("*_temp*");
+  by_dimensions.components = 3;
+  by_dimensions.rows = 4;
+  alucell::catalog_query by_type;
+  by_type.types.insert(alucell::data_type::int_array);
+  alucell::catalog_query by_mesh;
+  by_mesh.meshes.push_back("box");
+  alucell::catalog_query missing;
+  missing.names.push_back("box_pressure");
+  alucell::catalog_query wrong_dimensions(by_dimensions);
+  wrong_dimensions.components = 2;
+
+  return query(catalog, by_name) == a
+    and query(catalog, by_pattern) == b
+    and query(catalog, by_dimensions) == a
+    and query(catalog, by_type) == std::vector<std::string>(1, "a:2")
+    and query(catalog, by_mesh) == std::vector<std::string>(1, "a:0")
+    and query(catalog, missing) == none
+    and query(catalog, wrong_dimensions) == none;
+}
+
+int main(int argc, char *argv[]) {
+  mkdir("catalog_dir", 0777);
+  mkdir("catalog_dir/run", 0777);
+  {
+    alucell::database_write_access db("catalog_dir/a");
+    insert_array(db, "box_nodes", alucell::data_type::real_array, 4, 2);
+    insert_array(db, "box_elems", alucell::data_type::int_array, 1, 4);
+    insert_array(db, "box_refs", alucell::data_type::int_array, 1, 1);
+    insert_array(db, "box_temperature", alucell::data_type::real_array, 4, 3);
+  }
+  write_pressure_dbfile(false);
+  std::ofstream("catalog_dir/notes.txt") << "not a dbfile" << std::endl;
+
+  bool ok(true);
+  {
+    alucell::dbfile_catalog catalog;
+    const alucell::dbfile_catalog::refresh_report r(catalog.refresh("catalog_dir", 2));
+    ok = ok and r.added == 3 and r.skipped == 1 and catalog.get_files().size() == 3;
+    ok = ok and check_queries(catalog);
+    catalog.save("catalog_dir/.dbcatalog");
+  }
+
+  alucell::dbfile_catalog catalog;
+  catalog.load("catalog_dir/.dbcatalog");
+  ok = ok and check_queries(catalog);
+
+  sleep(1);
+  write_pressure_dbfile(true);
+  unlink("catalog_dir/notes.txt");
+  const alucell::dbfile_catalog::refresh_report r(catalog.refresh("catalog_dir", 2));
+  ok = ok and r.unchanged == 1 and r.updated == 1 and r.removed == 1 and r.added == 0 and r.skipped == 0;
+  catalog.save("catalog_dir/.dbcatalog");
+  catalog.load("catalog_dir/.dbcatalog");
+
+  alucell::catalog_query velocity;
+  velocity.names.push_back("cuveb_velocity");
+  ok = ok and query(catalog, velocity) == std::vector<std::string>(1, "run/b:1")
+    and check_queries(catalog);
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_dbfile_copy.hpp"
+
+/*
+ *  Merge an extended dbfile, holding a 5 bytes string followed by an
+ *  array, and a legacy dbfile into a new dbfile, as 'db merge' does, by
+ *  3 threads and chunks of a few bytes. Check that the string is padded
+ *  with zeros to 8 bytes instead of being truncated, and that the arrays
+ *  following it are read back unchanged.
+ */
+
+std::vector<double> read_values(alucell::database_read_access& db, unsigned int id) {
+  std::vector<double> values(db.get_variable_size(id) / sizeof(double));
+  db.read_data_from_database(id, values.data());
+  return values;
+}
+
+int main(int argc, char *argv[]) {
+  const std::vector<double> b = {1., 2., 42., 43.};
+  const std::vector<double> c = {2., 1., 7., 8.};
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access extended("dbfile_copy_extended.db", alucell::dbfile_format::extended);
+      extended.insert("a", alucell::data_type::string, "hello", 5);
+      extended.insert("b", alucell::data_type::real_array, b.data(), b.size() * sizeof(double));
+      alucell::database_write_access legacy("dbfile_copy_legacy.db");
+      legacy.insert("b", alucell::data_type::real_array, c.data(), c.size() * sizeof(double));
+      legacy.insert("c", alucell::data_type::real_array, c.data(), c.size() * sizeof(double));
+    }
+
+    alucell::database_read_access extended("dbfile_copy_extended.db"), legacy("dbfile_copy_legacy.db");
+    const std::vector<alucell::copied_variable> variables = {
+      {&extended, 0, "a"}, {&extended, 1, "extended_b"}, {&legacy, 0, "legacy_b"}, {&legacy, 1, "c"}
+    };
+    alucell::copy_dbfile_variables(variables, "dbfile_copy_merged.db", 3, 24);
+
+    alucell::database_read_access merged("dbfile_copy_merged.db");
+    ok = merged.get_format() == alucell::dbfile_format::legacy and merged.get_variables_number() == 4
+      and merged.get_variable_name(1) == "extended_b" and merged.get_variable_name(3) == "c";
+
+    char a[8];
+    ok = ok and merged.get_variable_size(0) == sizeof(a)
+      and merged.get_variable_type(0) == alucell::data_type::string;
+    merged.read_data_from_database(0, a);
+    ok = ok and std::memcmp(a, "hello\0\0\0", sizeof(a)) == 0;
+
+    ok = ok and read_values(merged, 1) == b and read_values(merged, 2) == c and read_values(merged, 3) == c
+      and merged.get_array_dimensions(1) == std::make_pair(std::size_t(1), 2u);
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
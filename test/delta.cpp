@@ -0,0 +1,228 @@
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_delta.hpp"
+
+/*
+ *  Encode payloads relative to base payloads and decode them back: equal,
+ *  slowly varying, unrelated and sparse payloads, of sizes which are or
+ *  are not multiples of 8 bytes, with zero runs longer than 127 bytes.
+ *  Check that truncated and corrupted encodings are refused.
+ *
+ *  Write three snapshots of a dbfile, the second one replacing, removing
+ *  and adding variables, and the third one changing them again, then the
+ *  delta of the second one relative to the first one and the encoded
+ *  delta of the third one relative to this delta. Read the chain and
+ *  materialize it, which gives the snapshots byte for byte since their
+ *  variables are in the order of the deltas: the variables of the base,
+ *  then the new ones. A snapshot in another order has the same variables
+ *  but other bytes. Check that a delta whose base was rewritten is
+ *  refused.
+ */
+
+typedef std::vector<std::pair<std::string, std::vector<double> > > snapshot;
+
+std::vector<char> read_file(const std::string& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+std::vector<char> payload_of(const std::vector<double>& values) {
+  std::vector<char> payload(values.size() * sizeof(double));
+  std::memcpy(payload.data(), values.data(), payload.size());
+  return payload;
+}
+
+void write_snapshot(const std::string& filename, const snapshot& variables) {
+  alucell::database_write_access db(filename);
+  for (const auto& v: variables)
+    db.insert(v.first, alucell::data_type::real_array, v.second.data(), v.second.size() * sizeof(double));
+}
+
+/*
+ *  Delta of 'variables' relative to the dbfile 'base', in the current
+ *  directory, written as 'db delta' does: the variables named in
+ *  'encoded' are stored XORed with their value in 'base_variables'.
+ */
+void write_delta(const std::string& filename, const std::string& base, const std::string& deleted,
+		 const snapshot& variables, const snapshot& base_variables, const std::vector<std::string>& encoded) {
+  alucell::database_write_access db(filename);
+  const std::vector<char> base_path(alucell::delta::string_payload(base));
+  const std::vector<char> signature(alucell::delta::string_payload(
+    alucell::delta::signature(base, alucell::database_read_access::header_size)));
+  const std::vector<char> deleted_names(alucell::delta::string_payload(deleted));
+  db.insert(alucell::delta::base_variable, alucell::data_type::string, base_path.data(), base_path.size());
+  db.insert(alucell::delta::signature_variable, alucell::data_type::string, signature.data(), signature.size());
+  db.insert(alucell::delta::deleted_variable, alucell::data_type::string, deleted_names.data(), deleted_names.size());
+
+  for (const auto& v: variables) {
+    const std::vector<char> payload(payload_of(v.second));
+    if (std::find(encoded.begin(), encoded.end(), v.first) == encoded.end()) {
+      db.insert(v.first, alucell::data_type::real_array, payload.data(), payload.size());
+      continue;
+    }
+    for (const auto& b: base_variables)
+      if (b.first == v.first) {
+	const std::vector<char> e(alucell::delta::encode(payload.data(), payload_of(b.second).data(), payload.size()));
+	db.insert(alucell::delta::xor_prefix + v.first, alucell::data_type::real_array, e.data(), e.size());
+      }
+  }
+}
+
+/*
+ *  Copy all the variables of 'db', in their order, as 'db materialize'.
+ */
+void materialize(alucell::database_read_access& db, const std::string& filename) {
+  alucell::database_write_access output_db(filename);
+  for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+    std::vector<char> payload(db.get_variable_size(id));
+    db.read_data_from_database(id, 0, payload.size(), payload.data());
+    output_db.insert(db.get_variable_name(id), db.get_variable_type(id), payload.data(), payload.size());
+  }
+}
+
+bool reads(alucell::database_read_access& db, const snapshot& variables) {
+  bool ok(db.get_variables_number() == variables.size());
+  for (unsigned int id(0); ok and id < variables.size(); ++id) {
+    std::vector<char> payload(db.get_variable_size(id));
+    db.read_data_from_database(id, 0, payload.size(), payload.data());
+    ok = db.get_variable_name(id) == variables[id].first and payload == payload_of(variables[id].second);
+  }
+  return ok;
+}
+
+bool round_trips(const std::vector<char>& payload, const std::vector<char>& base, std::size_t max_encoded_size) {
+  const std::vector<char> e(alucell::delta::encode(payload.data(), base.data(), payload.size()));
+  std::vector<char> decoded(alucell::delta::decoded_size(e.data(), e.size()), 1);
+  alucell::delta::decode(e.data(), e.size(), base.data(), decoded.data());
+  return decoded == payload and e.size() % 8 == 0 and e.size() <= max_encoded_size;
+}
+
+template<typename F>
+bool is_refused(F f) {
+  try {
+    f();
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+/*
+ *  Smooth field of 'rows' values, shifted by 'shift'.
+ */
+std::vector<double> field(std::size_t rows, double shift) {
+  std::vector<double> values = {double(rows), 1.};
+  for (std::size_t i(0); i < rows; ++i)
+    values.push_back(1000. + i * 0.5 + shift * (i % 7));
+  return values;
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    /*
+     *  Encoding:
+     */
+    std::uint64_t seed(1);
+    auto random_bytes = [&seed](std::size_t size) {
+      std::vector<char> bytes(size);
+      for (auto& b: bytes) {
+	seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+	b = static_cast<char>(seed >> 56);
+      }
+      return bytes;
+    };
+
+    for (std::size_t size: {0, 5, 8, 13, 800, 8003}) {
+      const std::vector<char> base(random_bytes(size));
+      ok = ok and round_trips(base, base, 24) and round_trips(random_bytes(size), base, 32 + size + size / 64);
+
+      std::vector<char> sparse(base);
+      for (std::size_t i(0); i < size; i += 37)
+	sparse[i] ^= 0x5a;
+      if (size > 310) {
+	sparse[300] ^= 1;
+	sparse[302] ^= 1;
+	sparse[305] ^= 1;
+      }
+      ok = ok and round_trips(sparse, base, 32 + size / 2);
+    }
+
+    const std::vector<char> smooth(payload_of(field(1000, 0.))), varied(payload_of(field(1000, 1.e-9)));
+    ok = ok and round_trips(varied, smooth, smooth.size() / 4 * 3);
+
+    std::vector<char> encoded(alucell::delta::encode(varied.data(), smooth.data(), smooth.size()));
+    std::vector<char> decoded(smooth.size());
+    ok = ok and is_refused([&]() { alucell::delta::decode(encoded.data(), 12, smooth.data(), decoded.data()); })
+      and is_refused([&]() { alucell::delta::decode(encoded.data(), 24, smooth.data(), decoded.data()); })
+      and is_refused([&]() { alucell::delta::decoded_size(encoded.data(), 8); });
+    const std::uint64_t shorter(smooth.size() - 100);
+    std::memcpy(encoded.data(), &shorter, sizeof(shorter));
+    ok = ok and is_refused([&]() { alucell::delta::decode(encoded.data(), encoded.size(), smooth.data(), decoded.data()); });
+
+    /*
+     *  Chain of deltas:
+     */
+    const snapshot s0 = {{"a", field(1000, 0.)}, {"b", field(10, 0.)}, {"c", field(20, 0.)}};
+    const snapshot s1 = {{"a", field(1000, 1.e-9)}, {"b", field(10, 0.)}, {"d", field(30, 0.)}};
+    const snapshot s2 = {{"a", field(1000, 2.e-9)}, {"b", field(10, 1.)}, {"d", field(30, 0.)}, {"e", field(5, 0.)}};
+    const snapshot shuffled_s2 = {s2[3], s2[0], s2[1], s2[2]};
+    write_snapshot("delta_s0.db", s0);
+    write_snapshot("delta_s1.db", s1);
+    write_snapshot("delta_s2.db", s2);
+    write_snapshot("delta_shuffled_s2.db", shuffled_s2);
+
+    write_delta("delta_d1.db", "delta_s0.db", "c\n", {s1[0], s1[2]}, s0, {});
+    write_delta("delta_d2.db", "delta_d1.db", "", {s2[0], s2[1], s2[3]}, s1, {"a"});
+    {
+      alucell::database_read_access d1("delta_d1.db"), d2("delta_d2.db");
+      ok = ok and d1.is_delta() and d2.is_delta() and d2.get_base()->is_delta()
+	and not d1.is_variable_encoded(0) and d2.is_variable_encoded(0) and not d2.is_variable_encoded(1)
+	and reads(d1, s1) and reads(d2, s2);
+      materialize(d1, "delta_m1.db");
+      materialize(d2, "delta_m2.db");
+    }
+    ok = ok and read_file("delta_m1.db") == read_file("delta_s1.db")
+      and read_file("delta_m2.db") == read_file("delta_s2.db")
+      and read_file("delta_m2.db") != read_file("delta_shuffled_s2.db");
+
+    /*
+     *  Delta of the snapshot in another order: its variables still follow
+     *  the order of the base.
+     */
+    write_delta("delta_d3.db", "delta_s1.db", "", {shuffled_s2[0], shuffled_s2[1], shuffled_s2[2]}, s1, {"a"});
+    {
+      alucell::database_read_access d3("delta_d3.db");
+      ok = ok and reads(d3, s2);
+      materialize(d3, "delta_m3.db");
+    }
+    ok = ok and read_file("delta_m3.db") == read_file("delta_s2.db");
+
+    write_snapshot("delta_s0.db", {s0[0], s0[1]});
+    ok = ok and is_refused([]() { alucell::database_read_access d1("delta_d1.db"); })
+      and is_refused([]() { alucell::database_read_access d2("delta_d2.db"); });
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  for (const char* f: {"delta_s0.db", "delta_s1.db", "delta_s2.db", "delta_shuffled_s2.db", "delta_d1.db",
+		       "delta_d2.db", "delta_d3.db", "delta_m1.db", "delta_m2.db", "delta_m3.db"})
+    ::unlink(f);
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
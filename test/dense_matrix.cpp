@@ -0,0 +1,174 @@
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_dense_matrix.hpp"
+
+/*
+ *  Transpose matrices whose sizes are not multiples of the tile size,
+ *  stored with leading dimensions larger than their number of rows, into
+ *  arrays with leading dimensions larger than their number of columns,
+ *  with one and several threads, and compare with a naive loop. Check
+ *  the block views and their bounds, and that the short payloads and the
+ *  negative dimensions are refused. Dump a matrix variable with 'db dump'
+ *  in the text, binary and Matrix Market formats, by panels of fewer rows
+ *  than the matrix.
+ */
+
+template<typename F>
+bool is_refused(F f) {
+  try {
+    f();
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+/*
+ *  Standard output of the 'db' program next to this test, run with
+ *  'arguments'.
+ */
+std::string run_db(const std::string& test_path, const std::string& arguments) {
+  const std::string directory(test_path.substr(0, test_path.find_last_of('/') + 1));
+  FILE* f(::popen((directory + "db " + arguments).c_str(), "r"));
+  if (not f)
+    throw std::string("cannot run db.");
+  std::string output;
+  char buffer[4096];
+  for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0;)
+    output.append(buffer, n);
+  if (::pclose(f) != 0)
+    throw "db " + arguments + " failed.";
+  return output;
+}
+
+/*
+ *  Payload of a matrix variable: the dimensions as 4 bytes integers,
+ *  then the terms by columns.
+ */
+std::vector<double> matrix_payload(std::int32_t rows, std::int32_t columns, const std::vector<double>& terms) {
+  std::vector<double> payload(1 + terms.size());
+  const std::int32_t dimensions[] = {rows, columns};
+  std::memcpy(payload.data(), dimensions, sizeof(dimensions));
+  std::copy(terms.begin(), terms.end(), payload.begin() + 1);
+  return payload;
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    /*
+     *  Transposes, the padding of both layouts being left untouched:
+     */
+    const std::size_t sizes[][2] = {{1, 1}, {1, 40}, {33, 70}, {100, 31}, {65, 65}};
+    for (const auto& size: sizes) {
+      const std::size_t rows(size[0]), columns(size[1]), lda(rows + 3);
+      std::vector<double> a(lda * columns);
+      for (std::size_t k(0); k < a.size(); ++k)
+	a[k] = k % lda < rows ? 0.5 * k : -2.;
+      const alucell::matrix_view view(a.data(), rows, columns, lda);
+
+      for (const std::size_t ldb: {columns, columns + 5})
+	for (unsigned int threads: {1u, 3u, 8u}) {
+	  std::vector<double> b(rows * ldb, -1.), expected(rows * ldb, -1.);
+	  for (std::size_t i(0); i < rows; ++i)
+	    for (std::size_t j(0); j < columns; ++j)
+	      expected[j + i * ldb] = a[i + j * lda];
+	  alucell::transpose(view, b.data(), ldb, threads);
+	  ok = ok and b == expected;
+	}
+      ok = ok and is_refused([&]() {
+	  std::vector<double> b(rows * columns);
+	  alucell::transpose(view, b.data(), columns - 1, 2);
+	});
+    }
+
+    /*
+     *  Blocks of a 6 x 7 matrix of leading dimension 8:
+     */
+    std::vector<double> a(8 * 7);
+    for (std::size_t k(0); k < a.size(); ++k)
+      a[k] = k;
+    const alucell::matrix_view view(a.data(), 6, 7, 8);
+    const alucell::matrix_view block(view.block(2, 3, 4, 2)), corner(view.block(5, 6, 1, 1));
+    ok = ok and block.get_rows() == 4 and block.get_columns() == 2 and block.get_leading_dimension() == 8
+      and block(0, 0) == view(2, 3) and block(3, 1) == view(5, 4) and block.get_column(1)[2] == view(4, 4)
+      and corner(0, 0) == 53. and view.block(6, 7, 0, 0).get_rows() == 0
+      and view.block(1, 1, 2, 2).block(1, 0, 1, 2)(0, 1) == view(2, 2)
+      and is_refused([&]() { view.block(3, 0, 4, 1); })
+      and is_refused([&]() { view.block(0, 5, 1, 3); })
+      and is_refused([&]() { block.block(0, 0, 5, 1); })
+      and is_refused([&]() { alucell::matrix_view(a.data(), 6, 7, 5); });
+
+    /*
+     *  Payloads:
+     */
+    const std::vector<double> payload(matrix_payload(2, 3, {1., 2., 3., 4., 5., 6.}));
+    const char* bytes(reinterpret_cast<const char*>(payload.data()));
+    const alucell::matrix_view m(bytes, payload.size() * sizeof(double));
+    ok = ok and m.get_rows() == 2 and m.get_columns() == 3 and m.get_leading_dimension() == 2
+      and m(0, 0) == 1. and m(1, 0) == 2. and m(0, 2) == 5. and m(1, 2) == 6.
+      and alucell::matrix_view(bytes, 8 + 6 * sizeof(double)).get_columns() == 3
+      and is_refused([&]() { alucell::matrix_view(bytes, 7); })
+      and is_refused([&]() { alucell::matrix_view(bytes, 8 + 5 * sizeof(double)); });
+    for (const std::int32_t dimensions: {-1, -2147483647 - 1}) {
+      const std::vector<double> negative_rows(matrix_payload(dimensions, 3, {1.})), negative_columns(matrix_payload(2, dimensions, {1.}));
+      ok = ok and is_refused([&]() { alucell::matrix_view(reinterpret_cast<const char*>(negative_rows.data()), 16); })
+	and is_refused([&]() { alucell::matrix_view(reinterpret_cast<const char*>(negative_columns.data()), 16); });
+    }
+    const std::vector<double> empty(matrix_payload(0, 4, {}));
+    ok = ok and alucell::matrix_view(reinterpret_cast<const char*>(empty.data()), 8).get_columns() == 4;
+
+    /*
+     *  Dumps of a 5 x 3 matrix by panels of 2 rows (48 bytes), of 1 row,
+     *  and in a single panel:
+     */
+    std::vector<double> terms;
+    for (int k(0); k < 15; ++k)
+      terms.push_back(k + 0.25);
+    {
+      alucell::database_write_access db("dense_matrix.db");
+      const std::vector<double> p(matrix_payload(5, 3, terms));
+      db.insert("a", alucell::data_type::matrix, p.data(), p.size() * sizeof(double));
+    }
+
+    std::ostringstream text, market;
+    std::string binary;
+    text.precision(12);
+    market.precision(17);
+    market << "%%MatrixMarket matrix array real general\n5 3\n";
+    for (int i(0); i < 5; ++i) {
+      for (int j(0); j < 3; ++j) {
+	text << std::setw(16) << std::right << terms[i + 5 * j];
+	binary.append(reinterpret_cast<const char*>(&terms[i + 5 * j]), sizeof(double));
+      }
+      text << "\n";
+    }
+    for (const auto t: terms)
+      market << t << "\n";
+
+    for (const std::string buffer: {"48", "1", "1M"})
+      ok = ok and run_db(argv[0], "dump dense_matrix.db -B " + buffer + " a") == text.str()
+	and run_db(argv[0], "dump dense_matrix.db -f binary -B " + buffer + " a") == binary
+	and run_db(argv[0], "dump dense_matrix.db -f market -B " + buffer + " a") == market.str();
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("dense_matrix.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_mesh_catalog.hpp"
+#include "../src/alucell_export.hpp"
+
+/*
+ *  Export a mesh of two triangles, one of them with an unused vertex,
+ *  with a nodal real field of 2 components and an elemental integer
+ *  field, to a VTK unstructured grid, by windows of a few rows. Parse
+ *  the appended section of the .vtu file and check the sizes and values
+ *  of the arrays, the points padded to 3 coordinates, the 0-based
+ *  connectivity, the offsets and the cell types. Check the collection
+ *  file of the time steps.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name, alucell::data_type t,
+		  std::size_t rows, unsigned int components, const std::vector<double>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.insert(payload.end(), values.begin(), values.end());
+  db.insert(name, t, payload.data(), payload.size() * sizeof(double));
+}
+
+void insert_int_array(alucell::database_write_access& db, const std::string& name,
+		      std::size_t rows, unsigned int components, const std::vector<int>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.resize(2 + (values.size() + 1) / 2);
+  std::memcpy(&payload[2], values.data(), values.size() * sizeof(int));
+  db.insert(name, alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+}
+
+std::string read_file(const std::string& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+/*
+ *  Arrays of the appended section, each one preceded by its size.
+ */
+std::vector<std::string> appended_arrays(const std::string& vtu) {
+  std::vector<std::string> arrays;
+  const std::string start("<AppendedData encoding=\"raw\">\n_");
+  std::size_t position(vtu.find(start));
+  if (position == std::string::npos)
+    return arrays;
+  position += start.size();
+  while (position + sizeof(std::uint64_t) <= vtu.size() and vtu[position] != '\n') {
+    std::uint64_t size;
+    std::memcpy(&size, &vtu[position], sizeof(size));
+    position += sizeof(size);
+    if (size > vtu.size() - position)
+      break;
+    arrays.push_back(vtu.substr(position, size));
+    position += size;
+  }
+  return arrays;
+}
+
+template<typename T>
+std::vector<T> values_of(const std::string& array) {
+  std::vector<T> values(array.size() / sizeof(T));
+  std::memcpy(values.data(), array.data(), values.size() * sizeof(T));
+  return values;
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("export_vtk.db");
+      insert_array(db, "tri_nodes", alucell::data_type::real_array, 4, 2, {0., 0., 1., 0., 1., 1., 0., 1.});
+      insert_int_array(db, "tri_elems", 2, 3, {1, 2, 3, 1, 0, 4});
+      insert_int_array(db, "tri_refs", 2, 1, {1, 2});
+      insert_array(db, "tri_velocity", alucell::data_type::real_array, 4, 2, {1., 2., 3., 4., 5., 6., 7., 8.});
+      insert_int_array(db, "tri_material", 2, 1, {7, 9});
+    }
+
+    alucell::database_read_access db("export_vtk.db");
+    const alucell::mesh_catalog catalog(&db);
+    const alucell::mesh_description& description(catalog.get_mesh("tri"));
+    std::vector<alucell::export_field> fields(2);
+    fields[0].name = "material";
+    fields[0].id = 4;
+    fields[0].nodal = false;
+    fields[0].integer = true;
+    fields[0].components = 1;
+    fields[1].name = "velocity";
+    fields[1].id = 3;
+    fields[1].nodal = true;
+    fields[1].integer = false;
+    fields[1].components = 2;
+    alucell::vtk::write_unstructured_grid(&db, description, fields, "export_vtk.0000.vtu", 3 * sizeof(double));
+
+    const std::string vtu(read_file("export_vtk.0000.vtu"));
+    const std::vector<std::string> arrays(appended_arrays(vtu));
+    const std::string end("\n  </AppendedData>\n</VTKFile>\n");
+    ok = vtu.find("<Piece NumberOfPoints=\"4\" NumberOfCells=\"2\">") != std::string::npos
+      and vtu.find("Name=\"velocity\" NumberOfComponents=\"2\" format=\"appended\" offset=\"0\"") != std::string::npos
+      and vtu.find("Name=\"material\" NumberOfComponents=\"1\" format=\"appended\" offset=\"72\"") != std::string::npos
+      and vtu.size() > end.size() and vtu.compare(vtu.size() - end.size(), end.size(), end) == 0
+      and arrays.size() == 6;
+
+    ok = ok and values_of<double>(arrays[0]) == std::vector<double>({1., 2., 3., 4., 5., 6., 7., 8.})
+      and values_of<double>(arrays[1]) == std::vector<double>({7., 9.})
+      and values_of<double>(arrays[2]) == std::vector<double>({0., 0., 0., 1., 0., 0., 1., 1., 0., 0., 1., 0.})
+      and values_of<std::int32_t>(arrays[3]) == std::vector<std::int32_t>({0, 1, 2, 0, 0, 3})
+      and values_of<std::int64_t>(arrays[4]) == std::vector<std::int64_t>({3, 6})
+      and arrays[5] == std::string(2, 5);
+
+    alucell::vtk::write_collection("export_vtk.pvd", {"export_vtk.0000.vtu", "export_vtk.0001.vtu"}, {0., 0.5});
+    ok = ok and read_file("export_vtk.pvd")
+      == "<?xml version=\"1.0\"?>\n"
+      "<VTKFile type=\"Collection\" version=\"1.0\">\n"
+      "  <Collection>\n"
+      "    <DataSet timestep=\"0\" part=\"0\" file=\"export_vtk.0000.vtu\"/>\n"
+      "    <DataSet timestep=\"0.5\" part=\"0\" file=\"export_vtk.0001.vtu\"/>\n"
+      "  </Collection>\n"
+      "</VTKFile>\n";
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("export_vtk.db");
+  ::unlink("export_vtk.0000.vtu");
+  ::unlink("export_vtk.pvd");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstddef>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_async_read.hpp"
+
+/*
+ *  Write 100000 small variables in a dbfile with an extended header, and
+ *  check that they are read back, also through the asynchronous open,
+ *  and that the file is not much larger than their data and names. Check
+ *  that a reader opening the dbfile between the inserts sees all the
+ *  variables inserted so far while the table grows, and that the legacy
+ *  writer refuses a variable once its name slots are all used. Check
+ *  that a truncated dbfile, and a table past the end of the file, are
+ *  refused.
+ */
+
+std::vector<double> payload(unsigned int v) {
+  return std::vector<double>({1., 1., v * 0.5});
+}
+
+bool check_variables(alucell::database_read_access& db, unsigned int n) {
+  if (db.get_format() != alucell::dbfile_format::extended or db.get_variables_number() != n)
+    return false;
+  for (unsigned int v(0); v < n; v += 997) {
+    std::vector<double> values(3, 0.);
+    if (db.get_variable_name(v) != "sweep_" + std::to_string(v)
+	or db.get_variable_type(v) != alucell::data_type::real_array
+	or db.get_variable_size(v) != values.size() * sizeof(double))
+      return false;
+    db.read_data_from_database(v, values.data());
+    if (values != payload(v))
+      return false;
+  }
+  return true;
+}
+
+void write_small_dbfile(const std::string& filename) {
+  alucell::database_write_access db(filename, alucell::dbfile_format::extended);
+  for (unsigned int v(0); v < 3; ++v) {
+    const std::vector<double> p(payload(v));
+    db.insert("sweep_" + std::to_string(v), alucell::data_type::real_array, p.data(), p.size() * sizeof(double));
+  }
+}
+
+bool is_refused(const std::string& filename) {
+  try {
+    alucell::database_read_access db(filename);
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  const unsigned int n(100000);
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("extended_header.db", alucell::dbfile_format::extended);
+      db.defer_infos(true);
+      for (unsigned int v(0); v < n; ++v) {
+	const std::vector<double> p(payload(v));
+	db.insert("sweep_" + std::to_string(v), alucell::data_type::real_array, p.data(), p.size() * sizeof(double));
+      }
+    }
+
+    alucell::database_read_access db("extended_header.db");
+    ok = ok and check_variables(db, n);
+
+    struct stat s;
+    stat("extended_header.db", &s);
+    ok = ok and static_cast<std::size_t>(s.st_size)
+      < n * (3 * sizeof(double) + 3 * alucell::extended_header::get_entry_size(16));
+
+    alucell::async_read_engine engine;
+    alucell::database_read_access async_db;
+    bool opened(false);
+    async_db.open_async(&engine, "extended_header.db", [&]() { opened = true; });
+    engine.run();
+    ok = ok and opened and check_variables(async_db, n);
+
+    alucell::database_write_access growing("extended_header.db", alucell::dbfile_format::extended);
+    for (unsigned int v(0); v < 2000; ++v) {
+      const std::vector<double> p(payload(v));
+      growing.insert("sweep_" + std::to_string(v), alucell::data_type::real_array, p.data(), p.size() * sizeof(double));
+      if (v % 97 == 0) {
+	growing.flush();
+	alucell::database_read_access reader("extended_header.db");
+	ok = ok and check_variables(reader, v + 1);
+      }
+      if (v == 0) {
+	stat("extended_header.db", &s);
+	ok = ok and static_cast<std::size_t>(s.st_size) == sizeof(alucell::extended_header::preamble)
+	  + alucell::extended_header::initial_table_capacity + p.size() * sizeof(double);
+      }
+    }
+
+    bool thrown(false);
+    alucell::database_write_access legacy("extended_header.db");
+    try {
+      const std::vector<double> p(payload(0));
+      for (unsigned int v(0); v <= alucell::database_read_access::max_saved_vectors; ++v)
+	legacy.insert("v" + std::to_string(v), alucell::data_type::real_array, p.data(), p.size() * sizeof(double));
+    }
+    catch (const std::string&) {
+      thrown = true;
+    }
+    legacy.close();
+    alucell::database_read_access full("extended_header.db");
+    ok = ok and thrown and full.get_format() == alucell::dbfile_format::legacy
+      and full.get_variables_number() == alucell::database_read_access::max_saved_vectors;
+
+    /*
+     *  Truncated data, and a table announced past the end of the file:
+     */
+    write_small_dbfile("extended_header.db");
+    stat("extended_header.db", &s);
+    ok = ok and ::truncate("extended_header.db", s.st_size - 8) == 0 and is_refused("extended_header.db");
+
+    write_small_dbfile("extended_header.db");
+    std::fstream f("extended_header.db", std::ios::in | std::ios::out | std::ios::binary);
+    const std::uint64_t table_size(std::uint64_t(1) << 60);
+    f.seekp(offsetof(alucell::extended_header::preamble, table_size));
+    f.write(reinterpret_cast<const char*>(&table_size), sizeof(table_size));
+    f.close();
+    ok = ok and is_refused("extended_header.db");
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_mesh.hpp"
+#include "../src/alucell_field_integration.hpp"
+
+/*
+ *  Integrate fields over the unit square, meshed with quadrangles and
+ *  with triangles whose interior nodes are moved along y, and over the
+ *  unit cube meshed with hexahedra whose interior nodes are moved along
+ *  z, the elements of x < 0.5 being of reference 1 and the others of
+ *  reference 2. The interpolation and the quadrature are exact for the
+ *  fields linear in the coordinates, so the integrals of 1, x, y, z and
+ *  2 x + 3 y + 1 are known by hand, as well as the ones of integer nodal
+ *  fields and of elemental fields. Check that the integrals do not depend
+ *  on the number of threads, on a grid of more than one block.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name,
+		  std::size_t rows, unsigned int components, const std::vector<double>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.insert(payload.end(), values.begin(), values.end());
+  db.insert(name, alucell::data_type::real_array, payload.data(), payload.size() * sizeof(double));
+}
+
+void insert_int_array(alucell::database_write_access& db, const std::string& name,
+		      std::size_t rows, unsigned int components, const std::vector<int>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.resize(2 + (values.size() + 1) / 2);
+  std::memcpy(&payload[2], values.data(), values.size() * sizeof(int));
+  db.insert(name, alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+}
+
+bool near(const std::vector<double>& a, const std::vector<double>& b) {
+  bool ok(a.size() == b.size());
+  for (std::size_t i(0); ok and i < a.size(); ++i)
+    ok = std::fabs(a[i] - b[i]) <= 1e-12 * std::max(1., std::fabs(b[i]));
+  return ok;
+}
+
+/*
+ *  Whether the integrals per reference are the expected ones, over the
+ *  expected numbers of elements.
+ */
+bool integrates_to(const std::map<int, alucell::geometry::region_sum>& integrals, std::size_t elements,
+		   const std::vector<double>& left, const std::vector<double>& right) {
+  return integrals.size() == 2 and integrals.at(1).elements == elements and integrals.at(2).elements == elements
+    and near(integrals.at(1).sums, left) and near(integrals.at(2).sums, right);
+}
+
+bool same(const std::map<int, alucell::geometry::region_sum>& a, const std::map<int, alucell::geometry::region_sum>& b) {
+  bool ok(a.size() == b.size());
+  for (auto i(a.begin()), j(b.begin()); ok and i != a.end(); ++i, ++j)
+    ok = i->first == j->first and i->second.elements == j->second.elements and i->second.sums == j->second.sums;
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  typedef std::vector<double> values;
+  bool ok(true);
+  try {
+    /*
+     *  Grids of nx x ny squares of the unit square, with the node (i, j) at
+     *  the position i + j (nx + 1), and of cubes of the unit cube:
+     */
+    const unsigned int nx(100), ny(50), tx(10), ty(10), cube(4);
+    auto wobble = [](unsigned int i, unsigned int j, unsigned int n) {
+      return j > 0 and j < n ? 0.3 * std::sin(1.3 * i + 0.7 * j) : 0.;
+    };
+    {
+      alucell::database_write_access db("field_integration.db");
+
+      values nodes;
+      std::vector<int> elems, refs;
+      for (unsigned int j(0); j <= ny; ++j)
+	for (unsigned int i(0); i <= nx; ++i)
+	  nodes.insert(nodes.end(), {double(i) / nx, (j + wobble(i, j, ny)) / ny});
+      for (unsigned int j(0); j < ny; ++j)
+	for (unsigned int i(0); i < nx; ++i) {
+	  const int n(i + j * (nx + 1) + 1);
+	  elems.insert(elems.end(), {n, n + 1, n + int(nx) + 2, n + int(nx) + 1});
+	  refs.push_back(2 * i < nx ? 1 : 2);
+	}
+      insert_array(db, "quads_nodes", nodes.size() / 2, 2, nodes);
+      insert_int_array(db, "quads_elems", refs.size(), 4, elems);
+      insert_int_array(db, "quads_refs", refs.size(), 1, refs);
+
+      nodes.clear();
+      elems.clear();
+      refs.clear();
+      for (unsigned int j(0); j <= ty; ++j)
+	for (unsigned int i(0); i <= tx; ++i)
+	  nodes.insert(nodes.end(), {double(i) / tx, (j + wobble(i, j, ty)) / ty});
+      for (unsigned int j(0); j < ty; ++j)
+	for (unsigned int i(0); i < tx; ++i) {
+	  const int n(i + j * (tx + 1) + 1);
+	  elems.insert(elems.end(), {n, n + 1, n + int(tx) + 2, n, n + int(tx) + 2, n + int(tx) + 1});
+	  refs.insert(refs.end(), 2, 2 * i < tx ? 1 : 2);
+	}
+      insert_array(db, "tris_nodes", nodes.size() / 2, 2, nodes);
+      insert_int_array(db, "tris_elems", refs.size(), 3, elems);
+      insert_int_array(db, "tris_refs", refs.size(), 1, refs);
+
+      nodes.clear();
+      elems.clear();
+      refs.clear();
+      for (unsigned int k(0); k <= cube; ++k)
+	for (unsigned int j(0); j <= cube; ++j)
+	  for (unsigned int i(0); i <= cube; ++i)
+	    nodes.insert(nodes.end(), {double(i) / cube, double(j) / cube, (k + wobble(i + 3 * j, k, cube)) / cube});
+      const int plane((cube + 1) * (cube + 1));
+      for (unsigned int k(0); k < cube; ++k)
+	for (unsigned int j(0); j < cube; ++j)
+	  for (unsigned int i(0); i < cube; ++i) {
+	    const int n(i + j * (cube + 1) + k * plane + 1);
+	    elems.insert(elems.end(), {n, n + 1, n + int(cube) + 2, n + int(cube) + 1,
+				       n + plane, n + plane + 1, n + plane + int(cube) + 2, n + plane + int(cube) + 1});
+	    refs.push_back(2 * i < cube ? 1 : 2);
+	  }
+      insert_array(db, "hexas_nodes", nodes.size() / 3, 3, nodes);
+      insert_int_array(db, "hexas_elems", refs.size(), 8, elems);
+      insert_int_array(db, "hexas_refs", refs.size(), 1, refs);
+    }
+
+    alucell::database_read_access db("field_integration.db");
+
+    /*
+     *  Quadrangles: nodal fields (1, x, 2 x + 3 y + 1) and the column
+     *  index of the nodes, elemental fields (1, 10 reference) as reals and
+     *  integers.
+     */
+    {
+      const alucell::mesh m(&db, "quads");
+      const alucell::field_integrator integrator(m, 3);
+      values nodal, elemental;
+      std::vector<int> columns, integer_elemental;
+      for (std::size_t n(0); n < m.get_nodes_number(); ++n) {
+	const double x(m.get_node(n)[0]), y(m.get_node(n)[1]);
+	nodal.insert(nodal.end(), {1., x, 2. * x + 3. * y + 1.});
+	columns.push_back(n % (nx + 1));
+      }
+      for (std::size_t e(0); e < m.get_elements_number(); ++e) {
+	elemental.insert(elemental.end(), {1., 10. * m.get_reference(e)});
+	integer_elemental.insert(integer_elemental.end(), {1, 10 * m.get_reference(e)});
+      }
+
+      const std::size_t half(nx * ny / 2);
+      const auto integrals(integrator.integrate_nodal(nodal.data(), 3, 1));
+      const auto elemental_integrals(integrator.integrate_elemental(elemental.data(), 2, 1));
+      ok = ok and integrates_to(integrator.measure(1), half, {0.5}, {0.5})
+	and integrates_to(integrals, half, {0.5, 0.125, 1.5}, {0.5, 0.375, 2.})
+	and integrates_to(integrator.integrate_nodal(columns.data(), 1, 1), half, {nx * 0.125}, {nx * 0.375})
+	and integrates_to(elemental_integrals, half, {0.5, 5.}, {0.5, 10.})
+	and same(integrator.integrate_elemental(integer_elemental.data(), 2, 1), elemental_integrals);
+
+      for (unsigned int threads: {2u, 7u}) {
+	const alucell::field_integrator threaded(m, threads);
+	ok = ok and threaded.get_measures() == integrator.get_measures()
+	  and same(threaded.integrate_nodal(nodal.data(), 3, threads), integrals)
+	  and same(threaded.integrate_elemental(elemental.data(), 2, threads), elemental_integrals);
+      }
+    }
+
+    /*
+     *  Triangles and hexahedra:
+     */
+    {
+      const alucell::mesh m(&db, "tris");
+      const alucell::field_integrator integrator(m, 2);
+      values nodal;
+      for (std::size_t n(0); n < m.get_nodes_number(); ++n) {
+	const double x(m.get_node(n)[0]), y(m.get_node(n)[1]);
+	nodal.insert(nodal.end(), {1., x, 2. * x + 3. * y + 1.});
+      }
+      ok = ok and integrates_to(integrator.integrate_nodal(nodal.data(), 3, 2), tx * ty, {0.5, 0.125, 1.5}, {0.5, 0.375, 2.});
+    }
+    {
+      const alucell::mesh m(&db, "hexas");
+      const alucell::field_integrator integrator(m, 2);
+      values nodal;
+      for (std::size_t n(0); n < m.get_nodes_number(); ++n)
+	nodal.insert(nodal.end(), {1., m.get_node(n)[0], m.get_node(n)[2]});
+      ok = ok and integrates_to(integrator.integrate_nodal(nodal.data(), 3, 2), cube * cube * cube / 2,
+				{0.5, 0.125, 0.25}, {0.5, 0.375, 0.25});
+    }
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("field_integration.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
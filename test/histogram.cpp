@@ -0,0 +1,181 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+
+#include "../src/alucell_histogram.hpp"
+
+/*
+ *  Fill histograms with fixed width and logarithmic bins with values
+ *  known by hand, out of range and non finite values, and check their
+ *  counts and bin edges. Check that accumulating an array, per component
+ *  or over all of them, with several threads, and merging histograms
+ *  give the counts of the values inserted one by one, and that the
+ *  histograms with different bins are refused. Check the percentiles
+ *  of quantile sketches against the exact ones, within their relative
+ *  accuracy, the minimum and maximum, merging and accumulating with
+ *  several threads, and the refused accuracies.
+ */
+
+namespace statistics = alucell::statistics;
+
+template<typename F>
+bool is_refused(F f) {
+  try {
+    f();
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+bool same(const statistics::histogram& a, const statistics::histogram& b) {
+  bool ok(a.get_bins_number() == b.get_bins_number() and a.get_underflow() == b.get_underflow()
+	  and a.get_overflow() == b.get_overflow() and a.get_nan_count() == b.get_nan_count()
+	  and a.get_inf_count() == b.get_inf_count());
+  for (unsigned int i(0); ok and i < a.get_bins_number(); ++i)
+    ok = a.get_count(i) == b.get_count(i);
+  return ok;
+}
+
+bool counts(const statistics::histogram& h, const std::vector<std::size_t>& expected) {
+  bool ok(h.get_bins_number() == expected.size());
+  for (unsigned int i(0); ok and i < expected.size(); ++i)
+    ok = h.get_count(i) == expected[i];
+  return ok;
+}
+
+bool same_percentiles(const statistics::quantile_sketch& a, const statistics::quantile_sketch& b) {
+  bool ok(a.get_count() == b.get_count());
+  for (double q(0.); ok and q <= 100.; q += 2.5)
+    ok = a.get_percentile(q) == b.get_percentile(q);
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  const double nan(std::numeric_limits<double>::quiet_NaN()), inf(std::numeric_limits<double>::infinity());
+  bool ok(true);
+  try {
+    /*
+     *  Fixed width bins:
+     */
+    statistics::histogram h(0., 100., 10);
+    for (int v(0); v < 100; ++v)
+      h.insert(v);
+    for (double v: {-1., 100., 250., nan, inf, -inf, 99.5})
+      h.insert(v);
+    ok = counts(h, {10, 10, 10, 10, 10, 10, 10, 10, 10, 11})
+      and h.get_underflow() == 1 and h.get_overflow() == 2 and h.get_nan_count() == 1 and h.get_inf_count() == 2
+      and h.get_bin_lower(0) == 0. and h.get_bin_lower(3) == 30. and h.get_bin_upper(9) == 100.;
+
+    /*
+     *  Logarithmic bins [1, 10), [10, 100), [100, 1000), [1000, 10000):
+     */
+    statistics::histogram l(1., 1.e4, 4, true);
+    for (double v: {2., 5., 50., 500., 5000., 9000., 0., -3., 1.e4, nan})
+      l.insert(v);
+    ok = ok and counts(l, {2, 1, 1, 2}) and l.get_underflow() == 2 and l.get_overflow() == 1
+      and l.get_nan_count() == 1 and std::fabs(l.get_bin_lower(2) - 100.) < 1e-10
+      and std::fabs(l.get_bin_upper(2) - 1000.) < 1e-9 and l.get_bin_upper(3) == 1.e4;
+
+    /*
+     *  Array of 1000 rows of 3 components, as reals and integers:
+     */
+    const std::size_t rows(1000);
+    std::vector<double> values;
+    std::vector<int> integers;
+    for (std::size_t i(0); i < rows; ++i)
+      for (int c(0); c < 3; ++c) {
+	integers.push_back(int((i * 37) % 130) - 10 + 20 * c);
+	values.push_back(integers.back() + 0.25);
+      }
+    values[7] = nan;
+    values[11] = inf;
+
+    for (unsigned int c: {0u, 1u, 2u, statistics::all_components}) {
+      statistics::histogram serial(0., 100., 7), serial_integers(0., 100., 7);
+      for (std::size_t i(0); i < values.size(); ++i)
+	if (c == statistics::all_components or i % 3 == c) {
+	  serial.insert(values[i]);
+	  serial_integers.insert(integers[i]);
+	}
+      for (unsigned int threads: {1u, 3u, 8u}) {
+	statistics::histogram a(0., 100., 7), b(0., 100., 7);
+	a.accumulate(values.data(), rows, 3, c, threads);
+	b.accumulate(integers.data(), rows, 3, c, threads);
+	ok = ok and same(a, serial) and same(b, serial_integers);
+      }
+    }
+
+    statistics::histogram first(0., 100., 7), second(0., 100., 7), whole(0., 100., 7);
+    first.accumulate(values.data(), rows / 2, 3, statistics::all_components, 2);
+    second.accumulate(values.data() + rows / 2 * 3, rows / 2, 3, statistics::all_components, 2);
+    whole.accumulate(values.data(), rows, 3, statistics::all_components, 2);
+    first.merge(second);
+    ok = ok and same(first, whole)
+      and is_refused([&]() { first.merge(statistics::histogram(0., 100., 8)); })
+      and is_refused([&]() { first.merge(statistics::histogram(0., 90., 7)); })
+      and is_refused([&]() { first.merge(statistics::histogram(1., 100., 7, true)); })
+      and is_refused([]() { statistics::histogram(0., 1., 0); })
+      and is_refused([]() { statistics::histogram(1., 1., 4); })
+      and is_refused([]() { statistics::histogram(0., 1., 4, true); });
+
+    /*
+     *  Quantile sketches of 1, ..., 10000, whose q-th percentile is the
+     *  value of rank q / 100 (n - 1) rounded:
+     */
+    const double accuracy(0.01);
+    statistics::quantile_sketch s(accuracy), odd(accuracy), even(accuracy);
+    ok = ok and std::isnan(s.get_percentile(50.));
+    for (int v(1); v <= 10000; ++v) {
+      s.insert(v);
+      (v % 2 ? odd : even).insert(v);
+    }
+    s.insert(nan);
+    s.insert(-inf);
+    ok = ok and s.get_count() == 10000 and s.get_percentile(0.) == 1. and s.get_percentile(100.) == 10000.;
+    for (double q: {0.1, 1., 10., 25., 50., 75., 90., 99., 99.9}) {
+      const double exact(std::floor(q / 100. * 9999. + 0.5) + 1.);
+      ok = ok and std::fabs(s.get_percentile(q) - exact) <= accuracy * exact;
+    }
+    odd.merge(even);
+    ok = ok and same_percentiles(odd, s)
+      and is_refused([&]() { odd.merge(statistics::quantile_sketch(0.02)); })
+      and is_refused([]() { statistics::quantile_sketch(0.); })
+      and is_refused([]() { statistics::quantile_sketch(1.); })
+      and is_refused([]() { statistics::quantile_sketch(-0.1); });
+
+    /*
+     *  Values -500, ..., 500, with a zero median:
+     */
+    statistics::quantile_sketch symmetric(accuracy);
+    for (int v(-500); v <= 500; ++v)
+      symmetric.insert(v * 1.5);
+    ok = ok and symmetric.get_percentile(50.) == 0. and symmetric.get_percentile(0.) == -750.
+      and symmetric.get_percentile(100.) == 750.
+      and std::fabs(symmetric.get_percentile(25.) + 375.) <= accuracy * 375.
+      and std::fabs(symmetric.get_percentile(75.) - 375.) <= accuracy * 375.;
+
+    for (unsigned int c: {1u, statistics::all_components}) {
+      statistics::quantile_sketch serial(accuracy);
+      for (std::size_t i(0); i < values.size(); ++i)
+	if (c == statistics::all_components or i % 3 == c)
+	  serial.insert(values[i]);
+      for (unsigned int threads: {1u, 3u, 8u}) {
+	statistics::quantile_sketch threaded(accuracy);
+	threaded.accumulate(values.data(), rows, 3, c, threads);
+	ok = ok and same_percentiles(threaded, serial);
+      }
+    }
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_mesh_bvh.hpp"
+
+/*
+ *  Locate points in a strip of quadrangles with the bounding volume
+ *  hierarchy, before and after it is saved and loaded. Check that the
+ *  saved trees whose sizes do not match the file, whose child or element
+ *  indices are out of range, or which are deeper than the search stack,
+ *  are refused and leave an empty tree, while a deep valid tree is
+ *  accepted.
+ */
+
+const std::string bvh_filename("mesh_bvh.bvh");
+
+/*
+ *  Strip of 'n' unit squares along x, in the mesh 'strip'.
+ */
+void write_strip(const std::string& filename, unsigned int n) {
+  alucell::database_write_access db(filename);
+  std::vector<double> nodes = {2. * (n + 1), 2.};
+  for (unsigned int i(0); i <= n; ++i)
+    nodes.insert(nodes.end(), {double(i), 0., double(i), 1.});
+  db.insert("strip_nodes", alucell::data_type::real_array, nodes.data(), nodes.size() * sizeof(double));
+
+  std::vector<int> elems, refs(n, 1);
+  for (unsigned int i(0); i < n; ++i)
+    elems.insert(elems.end(), {int(2 * i + 1), int(2 * i + 3), int(2 * i + 4), int(2 * i + 2)});
+  std::vector<double> payload = {double(n), 4.};
+  payload.resize(2 + elems.size() / 2);
+  std::memcpy(&payload[2], elems.data(), elems.size() * sizeof(int));
+  db.insert("strip_elems", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  payload = {double(n), 1.};
+  payload.resize(2 + (n + 1) / 2);
+  std::memcpy(&payload[2], refs.data(), refs.size() * sizeof(int));
+  db.insert("strip_refs", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+}
+
+std::vector<char> read_file(const std::string& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& filename, const std::vector<char>& content) {
+  std::ofstream(filename.c_str(), std::ios::binary).write(content.data(), content.size());
+}
+
+/*
+ *  Replace the tree of a saved file, after its tag of 'tag_size' bytes.
+ */
+void write_tree(const std::vector<char>& saved, std::size_t tag_size,
+		const std::vector<alucell::mesh_bvh::node>& nodes, const std::vector<unsigned int>& indices) {
+  std::vector<char> content(saved.begin(), saved.begin() + tag_size);
+  const unsigned long long sizes[] = { nodes.size(), indices.size() };
+  content.insert(content.end(), reinterpret_cast<const char*>(sizes), reinterpret_cast<const char*>(sizes + 2));
+  content.insert(content.end(), reinterpret_cast<const char*>(nodes.data()),
+		 reinterpret_cast<const char*>(nodes.data() + nodes.size()));
+  content.insert(content.end(), reinterpret_cast<const char*>(indices.data()),
+		 reinterpret_cast<const char*>(indices.data() + indices.size()));
+  write_file(bvh_filename, content);
+}
+
+/*
+ *  Left deep tree of 'inner' inner nodes over inner + 1 elements: the
+ *  left child of the inner node i is i + 1, its right child the leaf
+ *  2 * inner - i, and the deepest leaf is 'inner'.
+ */
+std::vector<alucell::mesh_bvh::node> chain(unsigned int inner) {
+  alucell::mesh_bvh::node all;
+  std::fill(all.lower, all.lower + 3, -1.e9);
+  std::fill(all.upper, all.upper + 3, 1.e9);
+  std::vector<alucell::mesh_bvh::node> nodes(2 * inner + 1, all);
+  for (unsigned int i(0); i < inner; ++i) {
+    nodes[i].first = 2 * inner - i;
+    nodes[i].count = 0;
+  }
+  for (unsigned int l(inner); l <= 2 * inner; ++l) {
+    nodes[l].first = l - inner;
+    nodes[l].count = 1;
+  }
+  return nodes;
+}
+
+bool locates(const alucell::mesh& m, const alucell::mesh_bvh& bvh) {
+  const alucell::reference_element r(m.get_dimension(), m.get_nodes_per_element());
+  for (std::size_t e(0); e < m.get_elements_number(); ++e) {
+    const double p[2] = {e + 0.25, 0.5};
+    double xi[3];
+    if (bvh.locate(m, r, p, xi) != e or std::fabs(xi[0] - 0.25) > 1.e-9 or std::fabs(xi[1] - 0.5) > 1.e-9)
+      return false;
+  }
+  const double outside[2] = {-0.5, 0.5};
+  double xi[3];
+  return bvh.locate(m, r, outside, xi) == m.get_elements_number();
+}
+
+bool is_refused(const alucell::database_read_access& db) {
+  alucell::mesh_bvh bvh;
+  return not bvh.load(bvh_filename, db.get_file_identity(), "strip") and bvh.get_nodes().empty()
+    and bvh.get_elements_number() == 0;
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    write_strip("mesh_bvh.db", 100);
+    alucell::database_read_access db("mesh_bvh.db");
+    const alucell::mesh m(&db, "strip");
+    const alucell::mesh_bvh bvh(m);
+    ok = bvh.is_valid() and locates(m, bvh);
+
+    bvh.save(bvh_filename, db.get_file_identity(), "strip");
+    alucell::mesh_bvh loaded;
+    ok = ok and loaded.load(bvh_filename, db.get_file_identity(), "strip") and locates(m, loaded)
+      and not loaded.load(bvh_filename, db.get_file_identity(), "other") and loaded.get_nodes().empty();
+
+    const std::vector<char> saved(read_file(bvh_filename));
+    const std::size_t tree_size(bvh.get_nodes().size() * sizeof(alucell::mesh_bvh::node) + 100 * sizeof(unsigned int));
+    const std::size_t tag_size(saved.size() - tree_size - 2 * sizeof(unsigned long long));
+    std::vector<unsigned int> indices(100);
+    for (unsigned int e(0); e < 100; ++e)
+      indices[e] = e;
+
+    write_file(bvh_filename, std::vector<char>(saved.begin(), saved.end() - 4));
+    ok = ok and is_refused(db);
+
+    std::vector<char> huge(saved);
+    const unsigned long long huge_size(1ull << 60);
+    std::memcpy(&huge[tag_size], &huge_size, sizeof(huge_size));
+    write_file(bvh_filename, huge);
+    ok = ok and is_refused(db);
+
+    std::vector<alucell::mesh_bvh::node> nodes(bvh.get_nodes());
+    nodes[0].first = nodes.size();
+    write_tree(saved, tag_size, nodes, indices);
+    ok = ok and is_refused(db);
+
+    nodes = bvh.get_nodes();
+    indices[7] = 100;
+    write_tree(saved, tag_size, nodes, indices);
+    ok = ok and is_refused(db);
+    indices[7] = 3;
+    write_tree(saved, tag_size, nodes, indices);
+    ok = ok and is_refused(db);
+    indices[7] = 7;
+
+    nodes.back().count += 1;
+    write_tree(saved, tag_size, nodes, indices);
+    ok = ok and is_refused(db);
+
+    /*
+     *  Left deep trees, within and beyond the search stack:
+     */
+    for (unsigned int inner: {40u, 70u}) {
+      write_strip("mesh_bvh.db", inner + 1);
+      alucell::database_read_access strip_db("mesh_bvh.db");
+      const alucell::mesh strip(&strip_db, "strip");
+      const alucell::mesh_bvh strip_bvh(strip);
+      strip_bvh.save(bvh_filename, strip_db.get_file_identity(), "strip");
+      const std::vector<char> strip_saved(read_file(bvh_filename));
+      const std::size_t strip_tag_size(strip_saved.size() - 2 * sizeof(unsigned long long)
+				       - strip_bvh.get_nodes().size() * sizeof(alucell::mesh_bvh::node)
+				       - (inner + 1) * sizeof(unsigned int));
+
+      std::vector<unsigned int> strip_indices(inner + 1);
+      for (unsigned int e(0); e <= inner; ++e)
+	strip_indices[e] = e;
+      write_tree(strip_saved, strip_tag_size, chain(inner), strip_indices);
+      alucell::mesh_bvh deep;
+      const bool accepted(deep.load(bvh_filename, strip_db.get_file_identity(), "strip"));
+      ok = ok and (inner < 62 ? accepted and locates(strip, deep) : not accepted and is_refused(strip_db));
+    }
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("mesh_bvh.db");
+  ::unlink(bvh_filename.c_str());
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
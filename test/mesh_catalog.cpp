@@ -0,0 +1,176 @@
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_database_index.hpp"
+#include "../src/alucell_mesh_catalog.hpp"
+#include "../src/string_utils.hpp"
+
+/*
+ *  List the meshes of a dbfile as 'db mesh' does, from the mesh catalog,
+ *  and compare with the listing of the previous implementation, which
+ *  scanned the variables for each mesh, for every combination of the
+ *  -n, -e, -s and rank options. The dbfile holds a mesh with as many
+ *  nodes as elements, a nested mesh, a mesh named "", a mesh with an
+ *  invalid _refs array and arrays of other sizes.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name, alucell::data_type t,
+		  std::size_t rows, unsigned int components) {
+  std::vector<double> values(2 + rows * components, 1.);
+  values[0] = rows;
+  values[1] = components;
+  db.insert(name, t, values.data(), values.size() * sizeof(double));
+}
+
+void insert_mesh(alucell::database_write_access& db, const std::string& name,
+		 std::size_t nodes_number, std::size_t elements_number) {
+  insert_array(db, name + "_nodes", alucell::data_type::real_array, nodes_number, 2);
+  insert_array(db, name + "_elems", alucell::data_type::int_array, elements_number, 3);
+  insert_array(db, name + "_refs", alucell::data_type::int_array, elements_number, 1);
+}
+
+struct listing_options {
+  bool nodal, elemental, scalar;
+  std::set<unsigned int> ranks;
+};
+
+/*
+ *  'db mesh' before the mesh catalog:
+ */
+std::string baseline_listing(alucell::database_read_access& db, const listing_options& o) {
+  std::ostringstream out;
+  alucell::database_index index(&db);
+
+  std::set<std::string> mesh_names;
+  for (unsigned int i(0); i < db.get_variables_number(); ++i) {
+    const std::string name(db.get_variable_name(i));
+    if (suffixed(name, "_nodes") and db.get_variable_type(i) == alucell::data_type::real_array)
+      mesh_names.insert(name.substr(0, name.size() - 6));
+  }
+  for (auto it(mesh_names.begin()); it != mesh_names.end();) {
+    const std::string elems(*it + "_elems"), refs(*it + "_refs");
+    if (not index.exists(elems) or not index.exists(refs)
+	or (db.get_variable_type(index.get_variable_id(elems)) != alucell::data_type::int_array
+	    and db.get_variable_type(index.get_variable_id(elems)) != alucell::data_type::element_array)
+	or db.get_variable_type(index.get_variable_id(refs)) != alucell::data_type::int_array)
+      mesh_names.erase(it++);
+    else
+      ++it;
+  }
+
+  for (const auto& mesh_name: mesh_names) {
+    const std::size_t nodes_number(db.get_array_dimensions(index.get_variable_id(mesh_name + "_nodes")).first);
+    const std::size_t elements_number(db.get_array_dimensions(index.get_variable_id(mesh_name + "_elems")).first);
+    out << mesh_name << ": " << nodes_number << " nodes, " << elements_number << " elements." << std::endl;
+
+    for (unsigned int i(0); i < db.get_variables_number(); ++i) {
+      const std::string name(db.get_variable_name(i));
+      if (not prefixed(name, mesh_name + "_") or suffixed(name, "_nodes") or suffixed(name, "_refs"))
+	continue;
+      if (db.get_variable_type(i) == alucell::data_type::real_array and (o.nodal or o.elemental)) {
+	const std::pair<std::size_t, unsigned int> a(db.get_array_dimensions(i));
+	if (o.ranks.size() == 0 or o.ranks.count(a.second)) {
+	  if (a.first == nodes_number and o.nodal)
+	    out << "  nodal variable: " << name.substr(mesh_name.size() + 1) << std::endl;
+	  else if (a.first == elements_number and o.elemental)
+	    out << "  elemental variable: " << name.substr(mesh_name.size() + 1) << std::endl;
+	}
+      } else if (db.get_variable_type(i) == alucell::data_type::real_number and o.scalar) {
+	out << "  scalar variable: " << name.substr(mesh_name.size() + 1) << std::endl;
+      }
+    }
+    out << std::endl;
+  }
+  return out.str();
+}
+
+/*
+ *  'db mesh' from the mesh catalog:
+ */
+std::string catalog_listing(alucell::database_read_access& db, const listing_options& o) {
+  std::ostringstream out;
+  const alucell::mesh_catalog catalog(&db);
+  for (const auto& mesh: catalog.get_meshes()) {
+    out << mesh.name << ": " << mesh.nodes_number << " nodes, " << mesh.elements_number << " elements." << std::endl;
+    for (const auto& v: mesh.variables) {
+      if (v.kind == alucell::mesh_variable::scalar) {
+	if (o.scalar)
+	  out << "  scalar variable: " << v.name << std::endl;
+      } else if (o.ranks.size() == 0 or o.ranks.count(v.components)) {
+	if (v.kind == alucell::mesh_variable::nodal and o.nodal)
+	  out << "  nodal variable: " << v.name << std::endl;
+	else if ((v.kind == alucell::mesh_variable::elemental or v.also_elemental) and o.elemental)
+	  out << "  elemental variable: " << v.name << std::endl;
+      }
+    }
+    out << std::endl;
+  }
+  return out.str();
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("mesh_catalog.db");
+      insert_mesh(db, "square", 4, 4);
+      insert_array(db, "square_temperature", alucell::data_type::real_array, 4, 1);
+      insert_array(db, "square_velocity", alucell::data_type::real_array, 4, 3);
+      insert_array(db, "square_other", alucell::data_type::real_array, 5, 1);
+      const double time(2.5);
+      db.insert("square_time", alucell::data_type::real_number, &time, sizeof(time));
+
+      insert_mesh(db, "cuve", 10, 6);
+      insert_array(db, "cuve_pressure", alucell::data_type::real_array, 10, 1);
+      insert_array(db, "cuve_flux", alucell::data_type::real_array, 6, 3);
+      insert_mesh(db, "cuve_top", 6, 2);
+      insert_array(db, "cuve_top_height", alucell::data_type::real_array, 6, 1);
+      insert_array(db, "cuve_top_area", alucell::data_type::real_array, 2, 1);
+
+      insert_mesh(db, "", 3, 1);
+      insert_array(db, "_density", alucell::data_type::real_array, 1, 1);
+
+      insert_array(db, "broken_nodes", alucell::data_type::real_array, 3, 2);
+      insert_array(db, "broken_elems", alucell::data_type::int_array, 1, 3);
+      insert_array(db, "broken_refs", alucell::data_type::real_array, 1, 1);
+      insert_array(db, "broken_u", alucell::data_type::real_array, 3, 1);
+    }
+
+    alucell::database_read_access db("mesh_catalog.db");
+    const alucell::mesh_catalog catalog(&db);
+    ok = catalog.exists("") and catalog.exists("square") and catalog.exists("cuve_top")
+      and not catalog.exists("broken") and catalog.get_meshes().size() == 4;
+
+    for (unsigned int flags(0); flags < 8; ++flags)
+      for (unsigned int rank(0); rank < 2; ++rank) {
+	listing_options o;
+	o.nodal = flags & 1;
+	o.elemental = flags & 2;
+	o.scalar = flags & 4;
+	if (rank)
+	  o.ranks.insert(1);
+	const std::string expected(baseline_listing(db, o));
+	if (catalog_listing(db, o) != expected) {
+	  std::cerr << "Expected:" << std::endl << expected
+		    << "Listed:" << std::endl << catalog_listing(db, o);
+	  ok = false;
+	}
+      }
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("mesh_catalog.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
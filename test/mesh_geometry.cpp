@@ -0,0 +1,252 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_mesh.hpp"
+#include "../src/alucell_reference_element.hpp"
+#include "../src/alucell_mesh_geometry.hpp"
+
+/*
+ *  Check the reference elements: the shape functions sum to 1 and their
+ *  gradients to 0, the quadrature rules integrate the constants and the
+ *  shape functions exactly, the jacobian of an element scaled by 2 is
+ *  2^d, and locate inverts the mapping of a perturbed element. Compute
+ *  the measures and centroids of quadrangles, triangles, tetrahedra,
+ *  prisms and hexahedra known by hand, with a crossed quadrangle counted
+ *  as distorted and an element with an unused vertex, the bounding box
+ *  of a mesh, and the sums per reference of a grid of more than one
+ *  block of elements, which must not depend on the number of threads.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name,
+		  std::size_t rows, unsigned int components, const std::vector<double>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.insert(payload.end(), values.begin(), values.end());
+  db.insert(name, alucell::data_type::real_array, payload.data(), payload.size() * sizeof(double));
+}
+
+void insert_int_array(alucell::database_write_access& db, const std::string& name,
+		      std::size_t rows, unsigned int components, const std::vector<int>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.resize(2 + (values.size() + 1) / 2);
+  std::memcpy(&payload[2], values.data(), values.size() * sizeof(int));
+  db.insert(name, alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+}
+
+bool near(double a, double b, double tolerance = 1e-12) {
+  return std::fabs(a - b) <= tolerance;
+}
+
+bool near(const std::vector<double>& a, const std::vector<double>& b, double tolerance = 1e-12) {
+  bool ok(a.size() == b.size());
+  for (std::size_t i(0); ok and i < a.size(); ++i)
+    ok = near(a[i], b[i], tolerance);
+  return ok;
+}
+
+/*
+ *  Reference element, coordinates of its vertices, measure and integral
+ *  of each of its shape functions.
+ */
+struct reference_case {
+  unsigned int dimension, nodes;
+  std::vector<double> vertices;
+  double measure, shape_integral;
+};
+
+bool check_reference(const reference_case& c) {
+  const alucell::reference_element r(c.dimension, c.nodes);
+  const unsigned int d(c.dimension);
+  std::vector<double> points, weights;
+  r.get_quadrature(points, weights);
+  bool ok(points.size() == weights.size() * d);
+
+  /*
+   *  Partition of unity at the center and at the quadrature points, and
+   *  integrals of the constant and of the shape functions:
+   */
+  std::vector<double> xi(d), integrals(c.nodes, 0.);
+  r.get_center(xi.data());
+  points.insert(points.end(), xi.begin(), xi.end());
+  double measure(0.);
+  for (std::size_t q(0); q < points.size() / d; ++q) {
+    double n[alucell::reference_element::max_nodes], g[alucell::reference_element::max_nodes * 3];
+    r.shape_functions(&points[q * d], n);
+    r.shape_gradients(&points[q * d], g);
+    double sum(0.), gradient_sum[3] = {0., 0., 0.};
+    for (unsigned int i(0); i < c.nodes; ++i) {
+      sum += n[i];
+      for (unsigned int a(0); a < d; ++a)
+	gradient_sum[a] += g[i * d + a];
+      if (q < weights.size())
+	integrals[i] += weights[q] * n[i];
+    }
+    ok = ok and near(sum, 1.) and near(gradient_sum[0], 0.) and near(gradient_sum[1], 0.) and near(gradient_sum[2], 0.);
+    if (q < weights.size())
+      measure += weights[q];
+  }
+  ok = ok and near(measure, c.measure) and near(integrals, std::vector<double>(c.nodes, c.shape_integral));
+
+  /*
+   *  Element scaled by 2, then perturbed:
+   */
+  std::vector<double> x(c.vertices);
+  for (auto& v: x)
+    v *= 2.;
+  double j[9];
+  ok = ok and near(r.jacobian(x.data(), xi.data(), j), std::pow(2., d));
+
+  for (unsigned int i(0); i < c.nodes; ++i)
+    for (unsigned int a(0); a < d; ++a)
+      x[i * d + a] += 0.05 * ((i * 7 + a * 3) % 5);
+  const double inside[] = {0.2, 0.3, 0.1}, outside[] = {1.2, 0.3, 0.1};
+  for (const double* target: {inside, outside}) {
+    double n[alucell::reference_element::max_nodes], p[3] = {0., 0., 0.}, located[3];
+    r.shape_functions(target, n);
+    for (unsigned int i(0); i < c.nodes; ++i)
+      for (unsigned int a(0); a < d; ++a)
+	p[a] += n[i] * x[i * d + a];
+    const bool found(r.locate(x.data(), p, located));
+    ok = ok and found == (target == inside);
+    for (unsigned int a(0); a < d; ++a)
+      ok = ok and near(located[a], target[a], 1e-9);
+  }
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  typedef std::vector<double> values;
+  bool ok(true);
+  try {
+    const std::vector<reference_case> references = {
+      {1, 2, {0., 1.}, 1., 1. / 2.},
+      {2, 3, {0., 0., 1., 0., 0., 1.}, 1. / 2., 1. / 6.},
+      {2, 4, {0., 0., 1., 0., 1., 1., 0., 1.}, 1., 1. / 4.},
+      {3, 4, {0., 0., 0., 1., 0., 0., 0., 1., 0., 0., 0., 1.}, 1. / 6., 1. / 24.},
+      {3, 6, {0., 0., 0., 1., 0., 0., 0., 1., 0., 0., 0., 1., 1., 0., 1., 0., 1., 1.}, 1. / 2., 1. / 12.},
+      {3, 8, {0., 0., 0., 1., 0., 0., 1., 1., 0., 0., 1., 0.,
+	      0., 0., 1., 1., 0., 1., 1., 1., 1., 0., 1., 1.}, 1., 1. / 8.}
+    };
+    for (const auto& c: references)
+      ok = ok and check_reference(c);
+
+    {
+      alucell::database_write_access db("mesh_geometry.db");
+
+      /*
+       *  Quadrangles: a 2 x 2 grid of the unit square (reference 1), the
+       *  trapezoid (-1, 3), (1, 3), (0, 4), (-1, 4) (reference 2), a
+       *  crossed quadrangle (reference 3) and a quadrangle with an unused
+       *  vertex (reference 4).
+       */
+      insert_array(db, "quads_nodes", 17, 2, {0., 0., 0.5, 0., 1., 0., 0., 0.5, 0.5, 0.5, 1., 0.5, 0., 1., 0.5, 1., 1., 1.,
+					      -1., 3., 1., 3., 0., 4., -1., 4.,
+					      0., 0., 1., 0., 0., 1., 1., 1.});
+      insert_int_array(db, "quads_elems", 7, 4, {1, 2, 5, 4, 2, 3, 6, 5, 4, 5, 8, 7, 5, 6, 9, 8,
+						 10, 11, 12, 13, 14, 15, 16, 17, 1, 2, 0, 4});
+      insert_int_array(db, "quads_refs", 7, 1, {1, 1, 1, 1, 2, 3, 4});
+
+      insert_array(db, "tris_nodes", 4, 2, {0., 0., 3., 0., 0., 3., 3., 3.});
+      insert_int_array(db, "tris_elems", 2, 3, {1, 2, 3, 2, 4, 3});
+      insert_int_array(db, "tris_refs", 2, 1, {1, 1});
+
+      insert_array(db, "tets_nodes", 4, 3, {0., 0., 0., 1., 0., 0., 0., 1., 0., 0., 0., 1.});
+      insert_int_array(db, "tets_elems", 1, 4, {1, 2, 3, 4});
+      insert_int_array(db, "tets_refs", 1, 1, {1});
+
+      insert_array(db, "prisms_nodes", 6, 3, {0., 0., 0., 1., 0., 0., 0., 1., 0., 0., 0., 2., 1., 0., 2., 0., 1., 2.});
+      insert_int_array(db, "prisms_elems", 1, 6, {1, 2, 3, 4, 5, 6});
+      insert_int_array(db, "prisms_refs", 1, 1, {1});
+
+      insert_array(db, "hexas_nodes", 8, 3, {0., 0., 0., 2., 0., 0., 2., 2., 0., 0., 2., 0.,
+					     0., 0., 2., 2., 0., 2., 2., 2., 2., 0., 2., 2.});
+      insert_int_array(db, "hexas_elems", 1, 8, {1, 2, 3, 4, 5, 6, 7, 8});
+      insert_int_array(db, "hexas_refs", 1, 1, {1});
+
+      /*
+       *  Grid of 150 x 60 quadrangles of the unit square, the interior
+       *  nodes moved along y, the left half of reference 1 and the right
+       *  half of reference 2:
+       */
+      const unsigned int nx(150), ny(60);
+      values nodes;
+      for (unsigned int j(0); j <= ny; ++j)
+	for (unsigned int i(0); i <= nx; ++i) {
+	  nodes.push_back(double(i) / nx);
+	  nodes.push_back((j + (j > 0 and j < ny ? 0.3 * std::sin(1.3 * i + 0.7 * j) : 0.)) / ny);
+	}
+      std::vector<int> elems, refs;
+      for (unsigned int j(0); j < ny; ++j)
+	for (unsigned int i(0); i < nx; ++i) {
+	  const int n(i + j * (nx + 1) + 1);
+	  elems.insert(elems.end(), {n, n + 1, n + int(nx) + 2, n + int(nx) + 1});
+	  refs.push_back(2 * i < nx ? 1 : 2);
+	}
+      insert_array(db, "grid_nodes", (nx + 1) * (ny + 1), 2, nodes);
+      insert_int_array(db, "grid_elems", nx * ny, 4, elems);
+      insert_int_array(db, "grid_refs", nx * ny, 1, refs);
+    }
+
+    alucell::database_read_access db("mesh_geometry.db");
+    {
+      const alucell::mesh m(&db, "quads");
+      const alucell::geometry::element_geometry g(alucell::geometry::compute_element_geometry(m, 3));
+      ok = ok and g.distorted_elements == 1
+	and near(values(g.measures.begin(), g.measures.begin() + 5), {0.25, 0.25, 0.25, 0.25, 1.5})
+	and g.measures[6] == 0. and std::isnan(g.centroids[12]) and std::isnan(g.centroids[13])
+	and near(values(g.centroids.begin(), g.centroids.begin() + 10),
+		 {0.25, 0.25, 0.75, 0.25, 0.25, 0.75, 0.75, 0.75, -2. / 9., 3. + 4. / 9.});
+
+      for (unsigned int threads: {1u, 3u, 8u}) {
+	const alucell::geometry::bounding_box box(alucell::geometry::compute_bounds(m, threads));
+	ok = ok and box.lower == values({-1., 0.}) and box.upper == values({1., 4.});
+      }
+    }
+
+    const std::vector<std::string> names = {"tris", "tets", "prisms", "hexas"};
+    const std::vector<values> measures = {{4.5, 4.5}, {1. / 6.}, {1.}, {8.}};
+    const std::vector<values> centroids = {{1., 1., 2., 2.}, {0.25, 0.25, 0.25}, {1. / 3., 1. / 3., 1.}, {1., 1., 1.}};
+    for (std::size_t k(0); k < names.size(); ++k) {
+      const alucell::mesh m(&db, names[k]);
+      const alucell::geometry::element_geometry g(alucell::geometry::compute_element_geometry(m, 2));
+      ok = ok and g.distorted_elements == 0 and near(g.measures, measures[k]) and near(g.centroids, centroids[k]);
+    }
+
+    /*
+     *  Area and first moments of each half of the grid:
+     */
+    {
+      const alucell::mesh m(&db, "grid");
+      const alucell::geometry::element_geometry g(alucell::geometry::compute_element_geometry(m, 4));
+      values moments;
+      for (std::size_t e(0); e < m.get_elements_number(); ++e)
+	moments.insert(moments.end(), {g.measures[e], g.measures[e] * g.centroids[2 * e],
+				       g.measures[e] * g.centroids[2 * e + 1]});
+
+      const auto sums(alucell::geometry::sum_by_region(m, moments.data(), 3, 1));
+      ok = ok and g.distorted_elements == 0 and sums.size() == 2
+	and sums.at(1).elements == 4500 and sums.at(2).elements == 4500
+	and near(sums.at(1).sums, {0.5, 0.125, 0.25}) and near(sums.at(2).sums, {0.5, 0.375, 0.25});
+      for (unsigned int threads: {3u, 8u}) {
+	const auto threaded_sums(alucell::geometry::sum_by_region(m, moments.data(), 3, threads));
+	ok = ok and threaded_sums.size() == 2
+	  and threaded_sums.at(1).sums == sums.at(1).sums and threaded_sums.at(2).sums == sums.at(2).sums;
+      }
+    }
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("mesh_geometry.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_mesh.hpp"
+#include "../src/alucell_mesh_reorder.hpp"
+
+/*
+ *  Renumber grids of quadrangles whose nodes were numbered in a
+ *  scrambled order. Check the node adjacency of a small grid, that the
+ *  orderings are permutations, that the reverse Cuthill-McKee ordering
+ *  brings the bandwidth of a strip down to 3 and the one of a square
+ *  grid down to at most two rows of nodes, that the Morton ordering follows
+ *  the Z curve of the grid, and that none of them depend on the number
+ *  of threads. Reorder the dbfile of a grid with 'db reorder', and check
+ *  that its real and integer, nodal and elemental variables follow the
+ *  new numbering, while the other variables are copied unchanged.
+ */
+
+/*
+ *  Grid of nx x ny unit squares, the node (i, j) being stored at the
+ *  position scramble(i + j * (nx + 1)), with the nodal variables
+ *  grid_temperature = x + 100 y and grid_ids = i + j (nx + 1), the
+ *  elemental variable grid_material = i + j nx of the square of lower
+ *  left corner (i, j), and the variable 'time' of no mesh.
+ */
+template<typename F>
+void write_grid(const std::string& filename, unsigned int nx, unsigned int ny, F scramble) {
+  const unsigned int nodes_number((nx + 1) * (ny + 1));
+  std::vector<double> nodes = {double(nodes_number), 2.};
+  nodes.resize(2 + 2 * nodes_number);
+  for (unsigned int j(0); j <= ny; ++j)
+    for (unsigned int i(0); i <= nx; ++i) {
+      const unsigned int n(scramble(i + j * (nx + 1)));
+      nodes[2 + 2 * n] = i;
+      nodes[3 + 2 * n] = j;
+    }
+
+  std::vector<double> temperature = {double(nodes_number), 1.};
+  std::vector<int> ids(nodes_number);
+  for (unsigned int n(0); n < nodes_number; ++n) {
+    temperature.push_back(nodes[2 + 2 * n] + 100. * nodes[3 + 2 * n]);
+    ids[n] = nodes[2 + 2 * n] + nodes[3 + 2 * n] * (nx + 1);
+  }
+
+  std::vector<int> elems, refs(nx * ny, 1), material;
+  for (unsigned int j(0); j < ny; ++j)
+    for (unsigned int i(0); i < nx; ++i) {
+      const unsigned int n(i + j * (nx + 1));
+      elems.insert(elems.end(), {int(scramble(n)) + 1, int(scramble(n + 1)) + 1,
+				 int(scramble(n + nx + 2)) + 1, int(scramble(n + nx + 1)) + 1});
+      material.push_back(i + j * nx);
+    }
+
+  alucell::database_write_access db(filename);
+  db.insert("grid_nodes", alucell::data_type::real_array, nodes.data(), nodes.size() * sizeof(double));
+  std::vector<double> payload = {double(nx * ny), 4.};
+  payload.resize(2 + elems.size() / 2);
+  std::memcpy(&payload[2], elems.data(), elems.size() * sizeof(int));
+  db.insert("grid_elems", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  payload = {double(nx * ny), 1.};
+  payload.resize(2 + (refs.size() + 1) / 2);
+  std::memcpy(&payload[2], refs.data(), refs.size() * sizeof(int));
+  db.insert("grid_refs", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  db.insert("grid_temperature", alucell::data_type::real_array, temperature.data(), temperature.size() * sizeof(double));
+  payload = {double(nodes_number), 1.};
+  payload.resize(2 + (ids.size() + 1) / 2);
+  std::memcpy(&payload[2], ids.data(), ids.size() * sizeof(int));
+  db.insert("grid_ids", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  payload = {double(nx * ny), 1.};
+  payload.resize(2 + (material.size() + 1) / 2);
+  std::memcpy(&payload[2], material.data(), material.size() * sizeof(int));
+  db.insert("grid_material", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  const double time(2.5);
+  db.insert("time", alucell::data_type::real_number, &time, sizeof(time));
+}
+
+/*
+ *  Run the 'db' program next to this test with 'arguments', and return
+ *  its exit status.
+ */
+int run_db(const std::string& test_path, const std::string& arguments) {
+  const std::string directory(test_path.substr(0, test_path.find_last_of('/') + 1));
+  FILE* f(::popen((directory + "db " + arguments + " 2>&1").c_str(), "r"));
+  if (not f)
+    throw std::string("cannot run db.");
+  char buffer[4096];
+  while (std::fgets(buffer, sizeof(buffer), f))
+    ;
+  return ::pclose(f);
+}
+
+/*
+ *  Values of the array 'name' of 'db', without their dimensions.
+ */
+template<typename T>
+std::vector<T> read_array(alucell::database_read_access& db, const std::string& name) {
+  for (unsigned int id(0); id < db.get_variables_number(); ++id)
+    if (db.get_variable_name(id) == name) {
+      const std::pair<std::size_t, unsigned int> dimensions(db.get_array_dimensions(id));
+      std::vector<T> values(dimensions.first * dimensions.second);
+      db.read_data_from_database(id, 2 * sizeof(double), values.size() * sizeof(T), values.data());
+      return values;
+    }
+  throw "variable " + name + " not found.";
+}
+
+bool is_permutation(const std::vector<unsigned int>& order, std::size_t size) {
+  std::vector<unsigned int> sorted(order);
+  std::sort(sorted.begin(), sorted.end());
+  for (std::size_t k(0); k < sorted.size(); ++k)
+    if (sorted[k] != k)
+      return false;
+  return sorted.size() == size;
+}
+
+bool is_valid(const alucell::mesh& m, const alucell::mesh_ordering& o) {
+  return is_permutation(o.node_order, m.get_nodes_number())
+    and is_permutation(o.element_order, m.get_elements_number());
+}
+
+int main(int argc, char *argv[]) {
+  bool ok(true);
+  try {
+    /*
+     *  2 x 1 grid, numbered in order:
+     *    3 4 5
+     *    0 1 2
+     */
+    write_grid("mesh_reorder.db", 2, 1, [](unsigned int n) { return n; });
+    {
+      alucell::database_read_access db("mesh_reorder.db");
+      const alucell::mesh m(&db, "grid");
+      std::vector<std::size_t> offsets;
+      std::vector<unsigned int> neighbours;
+      alucell::build_node_neighbours(m, offsets, neighbours, 3);
+      double spread(0.);
+      ok = offsets == std::vector<std::size_t>({0, 3, 8, 11, 14, 19, 22})
+	and neighbours == std::vector<unsigned int>({1, 3, 4, 0, 2, 3, 4, 5, 1, 4, 5,
+						      0, 1, 4, 0, 1, 2, 3, 5, 1, 2, 4})
+	and alucell::mesh_bandwidth(m, &spread) == 4 and spread == 4.;
+
+      std::vector<double> rows = {0., 1., 2., 3., 4., 5.}, permuted(6);
+      alucell::permute_rows(rows.data(), 2, {2, 0, 1}, permuted.data(), 2);
+      ok = ok and permuted == std::vector<double>({4., 5., 0., 1., 2., 3.});
+    }
+
+    /*
+     *  Strip of 200 x 1 squares, numbered with a stride coprime with the
+     *  number of nodes:
+     */
+    const unsigned int strip_nodes(201 * 2);
+    write_grid("mesh_reorder.db", 200, 1, [](unsigned int n) { return (n * 131) % strip_nodes; });
+    {
+      alucell::database_read_access db("mesh_reorder.db");
+      const alucell::mesh m(&db, "grid");
+      const alucell::mesh_ordering o(alucell::reverse_cuthill_mckee_ordering(m, 1));
+      const alucell::mesh reordered(m.permuted(o.node_order, o.element_order));
+      ok = ok and alucell::mesh_bandwidth(m) > 100 and is_valid(m, o)
+	and alucell::mesh_bandwidth(reordered) == 3;
+      for (unsigned int threads: {2, 5}) {
+	const alucell::mesh_ordering p(alucell::reverse_cuthill_mckee_ordering(m, threads));
+	ok = ok and p.node_order == o.node_order and p.element_order == o.element_order;
+      }
+
+      /*
+       *  The elements follow the nodes: along the strip, in one direction
+       *  or the other.
+       */
+      bool increasing(true), decreasing(true);
+      for (std::size_t e(1); e < o.element_order.size(); ++e) {
+	increasing = increasing and m.get_node(m.get_element(o.element_order[e])[0])[0]
+	  == m.get_node(m.get_element(o.element_order[e - 1])[0])[0] + 1.;
+	decreasing = decreasing and m.get_node(m.get_element(o.element_order[e])[0])[0]
+	  == m.get_node(m.get_element(o.element_order[e - 1])[0])[0] - 1.;
+      }
+      ok = ok and (increasing or decreasing);
+    }
+
+    /*
+     *  Square grid of 30 x 30 squares, numbered in a scrambled order:
+     */
+    const unsigned int grid_nodes(31 * 31);
+    write_grid("mesh_reorder.db", 30, 30, [](unsigned int n) { return (n * 97) % grid_nodes; });
+    {
+      alucell::database_read_access db("mesh_reorder.db");
+      const alucell::mesh m(&db, "grid");
+      const alucell::mesh_ordering rcm(alucell::reverse_cuthill_mckee_ordering(m, 4));
+      const alucell::mesh_ordering morton(alucell::morton_ordering(m));
+      const alucell::mesh by_rcm(m.permuted(rcm.node_order, rcm.element_order));
+      const alucell::mesh by_morton(m.permuted(morton.node_order, morton.element_order));
+      double spread(0.), rcm_spread(0.), morton_spread(0.);
+      const std::size_t bandwidth(alucell::mesh_bandwidth(m, &spread));
+      const std::size_t rcm_bandwidth(alucell::mesh_bandwidth(by_rcm, &rcm_spread));
+      alucell::mesh_bandwidth(by_morton, &morton_spread);
+      ok = ok and is_valid(m, rcm) and is_valid(m, morton)
+	and bandwidth > 500 and rcm_bandwidth <= 2 * 31 and rcm_spread < spread / 5
+	and morton_spread < spread / 5;
+
+      /*
+       *  Z curve of the 5 leading bits of the coordinates scaled to 31
+       *  bits, which are distinct for the 31 coordinates of the grid, x
+       *  being the most significant bit of each pair:
+       */
+      std::vector<std::pair<unsigned long long, unsigned int> > curve;
+      for (unsigned int n(0); n < grid_nodes; ++n) {
+	const unsigned int x(static_cast<unsigned long long>(m.get_node(n)[0] / 30. * 2147483647.) >> 26);
+	const unsigned int y(static_cast<unsigned long long>(m.get_node(n)[1] / 30. * 2147483647.) >> 26);
+	unsigned long long code(0);
+	for (unsigned int b(5); b-- > 0;)
+	  code = (code << 2) | (((x >> b) & 1) << 1) | ((y >> b) & 1);
+	curve.push_back(std::make_pair(code, n));
+      }
+      std::sort(curve.begin(), curve.end());
+      bool follows(true);
+      for (unsigned int n(0); n < grid_nodes; ++n)
+	follows = follows and morton.node_order[n] == curve[n].second;
+      ok = ok and follows;
+    }
+
+    /*
+     *  Reordered dbfile:
+     */
+    ok = ok and run_db(argv[0], "reorder mesh_reorder.db grid -o mesh_reorder_rcm.db -r 0 -j 3") == 0;
+    {
+      alucell::database_read_access db("mesh_reorder_rcm.db");
+      const alucell::mesh m(&db, "grid");
+      const std::vector<double> temperature(read_array<double>(db, "grid_temperature"));
+      const std::vector<int> ids(read_array<int>(db, "grid_ids")), material(read_array<int>(db, "grid_material"));
+      ok = ok and db.get_variables_number() == 7 and db.get_variable_name(6) == "time"
+	and alucell::mesh_bandwidth(m) <= 2 * 31 and temperature.size() == grid_nodes and ids.size() == grid_nodes
+	and material.size() == 900;
+
+      for (unsigned int n(0); ok and n < grid_nodes; ++n) {
+	const double x(m.get_node(n)[0]), y(m.get_node(n)[1]);
+	ok = temperature[n] == x + 100. * y and ids[n] == x + 31. * y;
+      }
+      for (unsigned int e(0); ok and e < 900; ++e) {
+	double x(30.), y(30.);
+	for (unsigned int k(0); k < 4; ++k) {
+	  x = std::min(x, m.get_node(m.get_element(e)[k])[0]);
+	  y = std::min(y, m.get_node(m.get_element(e)[k])[1]);
+	}
+	ok = material[e] == x + 30. * y;
+      }
+
+      double time(0.);
+      db.read_data_from_database(6, 0, sizeof(time), &time);
+      alucell::database_read_access original_db("mesh_reorder.db");
+      ok = ok and time == 2.5 and ids != read_array<int>(original_db, "grid_ids");
+    }
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("mesh_reorder.db");
+  ::unlink("mesh_reorder_rcm.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_mesh.hpp"
+
+/*
+ *  Transfer fields between the nodes and the elements of a strip of two
+ *  quadrangles, with a degenerate quadrangle repeating its nodes and a
+ *  node outside of any element, and compare with the means computed by
+ *  hand. Check the node to element adjacency, that the results do not
+ *  depend on the number of threads, and that the transfers on a
+ *  renumbered mesh are the renumbered transfers.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name,
+		  std::size_t rows, unsigned int components, const std::vector<double>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.insert(payload.end(), values.begin(), values.end());
+  db.insert(name, alucell::data_type::real_array, payload.data(), payload.size() * sizeof(double));
+}
+
+void insert_int_array(alucell::database_write_access& db, const std::string& name,
+		      std::size_t rows, unsigned int components, const std::vector<int>& values) {
+  std::vector<double> payload = {double(rows), double(components)};
+  payload.resize(2 + (values.size() + 1) / 2);
+  std::memcpy(&payload[2], values.data(), values.size() * sizeof(int));
+  db.insert(name, alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+}
+
+int main(int argc, char *argv[]) {
+  typedef std::vector<double> values;
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("mesh_transfer.db");
+      insert_array(db, "strip_nodes", 7, 2, {0., 0., 0., 1., 1., 0., 1., 1., 2., 0., 2., 1., 7., 7.});
+      insert_int_array(db, "strip_elems", 3, 4, {1, 3, 4, 2, 3, 5, 6, 4, 1, 3, 3, 1});
+      insert_int_array(db, "strip_refs", 3, 1, {1, 1, 2});
+    }
+
+    alucell::database_read_access db("mesh_transfer.db");
+    const alucell::mesh m(&db, "strip");
+    ok = m.get_nodes_number() == 7 and m.get_elements_number() == 3
+      and m.get_node_elements_offsets() == std::vector<std::size_t>({0, 2, 3, 6, 8, 9, 10, 10})
+      and m.get_node_elements() == std::vector<unsigned int>({0, 2, 0, 0, 1, 2, 0, 1, 1, 1});
+
+    /*
+     *  Elemental field of 2 components (e, 10 e) for e = 1, 3, 5, as reals
+     *  and integers, and nodal field (x, y):
+     */
+    const values elemental = {1., 10., 3., 30., 5., 50.};
+    const std::vector<int> integer_elemental = {1, 10, 3, 30, 5, 50};
+    const values nodal = {0., 0., 0., 1., 1., 0., 1., 1., 2., 0., 2., 1., 7., 7.};
+    const values expected_nodal = {3., 30., 1., 10., 3., 30., 2., 20., 3., 30., 3., 30., 0., 0.};
+    const values expected_elemental = {0.5, 0.5, 1.5, 0.5, 0.5, 0.};
+
+    for (unsigned int threads: {1u, 2u, 5u}) {
+      values to_nodes(14, -1.), integer_to_nodes(14, -1.), to_elements(6, -1.);
+      m.elements_to_nodes(elemental.data(), 2, to_nodes.data(), threads);
+      m.elements_to_nodes(integer_elemental.data(), 2, integer_to_nodes.data(), threads);
+      m.nodes_to_elements(nodal.data(), 2, to_elements.data(), threads);
+      ok = ok and to_nodes == expected_nodal and integer_to_nodes == expected_nodal
+	and to_elements == expected_elemental;
+    }
+
+    /*
+     *  Reversed numberings:
+     */
+    const std::vector<unsigned int> node_order = {6, 5, 4, 3, 2, 1, 0}, element_order = {2, 1, 0};
+    const alucell::mesh reversed(m.permuted(node_order, element_order));
+    values reversed_elemental, reversed_nodal, reversed_expected_nodal, reversed_expected_elemental;
+    for (const auto n: node_order) {
+      reversed_nodal.insert(reversed_nodal.end(), &nodal[2 * n], &nodal[2 * n + 2]);
+      reversed_expected_nodal.insert(reversed_expected_nodal.end(), &expected_nodal[2 * n], &expected_nodal[2 * n + 2]);
+    }
+    for (const auto e: element_order) {
+      reversed_elemental.insert(reversed_elemental.end(), &elemental[2 * e], &elemental[2 * e + 2]);
+      reversed_expected_elemental.insert(reversed_expected_elemental.end(),
+					 &expected_elemental[2 * e], &expected_elemental[2 * e + 2]);
+    }
+    values to_nodes(14), to_elements(6);
+    reversed.elements_to_nodes(reversed_elemental.data(), 2, to_nodes.data(), 3);
+    reversed.nodes_to_elements(reversed_nodal.data(), 2, to_elements.data(), 3);
+    ok = ok and reversed.get_reference(0) == 2
+      and to_nodes == reversed_expected_nodal and to_elements == reversed_expected_elemental;
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("mesh_transfer.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/parallel_utils.hpp"
+
+/*
+ *  Write the same variables, among which long names taking several name
+ *  slots and a payload which is not a multiple of 8 bytes, padded by the
+ *  writers and followed by other variables, with the
+ *  sequential writer and with the parallel writer, whose payloads are
+ *  written by 4 threads in pieces and in reverse order. Check that both
+ *  dbfiles are identical, as well as a copy of the parallel dbfile made
+ *  with copy_data, and that an incomplete parallel dbfile, or one with a
+ *  range written twice and another missing for the same total, is
+ *  neither committed nor left behind.
+ */
+
+struct variable {
+  std::string name;
+  alucell::data_type type;
+  std::vector<char> payload;
+};
+
+std::vector<char> read_file(const std::string& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<variable> variables;
+  for (unsigned int v(0); v < 40; ++v) {
+    variable x;
+    x.name = "array_" + std::to_string(v) + (v % 7 == 0 ? std::string(40 + v, 'x') : std::string());
+    x.type = v % 3 ? alucell::data_type::real_array : alucell::data_type::int_array;
+    const std::size_t rows(v * 97 % 1000);
+    std::vector<double> values(2 + rows);
+    values[0] = rows;
+    values[1] = 1.;
+    for (std::size_t i(0); i < rows; ++i)
+      values[2 + i] = v * 1000. + i;
+    x.payload.assign(reinterpret_cast<const char*>(values.data()),
+		     reinterpret_cast<const char*>(values.data() + values.size()));
+    variables.push_back(x);
+    if (v == 20) {
+      variable s;
+      s.name = "title";
+      s.type = alucell::data_type::string;
+      s.payload.assign(13, 'a');
+      variables.push_back(s);
+    }
+  }
+
+  {
+    alucell::database_write_access db("dbfile_sequential");
+    for (const auto& x: variables)
+      db.insert(x.name, x.type, x.payload.data(), x.payload.size());
+  }
+
+  {
+    alucell::database_parallel_write_access db("dbfile_parallel");
+    for (const auto& x: variables)
+      db.reserve(x.name, x.type, x.payload.size());
+
+    parallel_for(0, variables.size(), 4,
+		 [&](unsigned int, std::size_t b, std::size_t e) {
+		   for (std::size_t k(e); k-- > b;) {
+		     const std::vector<char>& p(variables[k].payload);
+		     const std::size_t half(p.size() / 2);
+		     db.write_data(k, half, p.data() + half, p.size() - half);
+		     db.write_data(k, 0, p.data(), half);
+		   }
+		 });
+    db.commit();
+  }
+
+  const std::vector<char> sequential(read_file("dbfile_sequential")), parallel(read_file("dbfile_parallel"));
+  bool ok(sequential.size() > alucell::database_read_access::header_size and sequential == parallel);
+
+  alucell::database_read_access db("dbfile_parallel");
+  ok = ok and db.get_variables_number() == variables.size();
+  for (unsigned int id(0); ok and id < db.get_variables_number(); ++id) {
+    const std::vector<char>& written(variables[id].payload);
+    std::vector<char> payload(db.get_variable_size(id));
+    db.pread_data_from_database(id, 0, payload.size(), payload.data());
+    ok = db.get_variable_name(id) == variables[id].name
+      and payload.size() == alucell::database_write_access::get_padded_size(written.size())
+      and std::equal(written.begin(), written.end(), payload.begin())
+      and static_cast<std::size_t>(std::count(payload.begin() + written.size(), payload.end(), 0))
+      == payload.size() - written.size();
+  }
+
+  /*
+   *  Copy the variables of the parallel dbfile with copy_data, in two
+   *  pieces each: the copy must be identical too. The sizes are the
+   *  written ones, the padding being left to the writer.
+   */
+  {
+    alucell::database_parallel_write_access copy("dbfile_copied");
+    for (const auto& x: variables)
+      copy.reserve(x.name, x.type, x.payload.size());
+    for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+      const std::size_t size(variables[id].payload.size()), half(size / 2);
+      copy.copy_data(id, half, db.get_variable_descriptor(id), db.get_variable_offset(id) + half, size - half);
+      copy.copy_data(id, 0, db.get_variable_descriptor(id), db.get_variable_offset(id), half);
+    }
+    copy.commit();
+  }
+  ok = ok and read_file("dbfile_copied") == sequential;
+
+  bool rejected(false);
+  try {
+    alucell::database_parallel_write_access incomplete("dbfile_incomplete");
+    incomplete.reserve("a", alucell::data_type::real_array, 64);
+    incomplete.reserve("b", alucell::data_type::real_array, 64);
+    incomplete.write_data(0, 0, variables[1].payload.data(), 64);
+    incomplete.commit();
+  }
+  catch (const std::string& e) {
+    rejected = true;
+  }
+  ok = ok and rejected and access("dbfile_incomplete", F_OK) != 0
+    and access("dbfile_incomplete.partial", F_OK) != 0;
+
+  bool overlap_rejected(false), gap_rejected(false);
+  try {
+    alucell::database_parallel_write_access overlapping("dbfile_incomplete");
+    overlapping.reserve("a", alucell::data_type::real_array, 64);
+    overlapping.reserve("b", alucell::data_type::real_array, 64);
+    overlapping.write_data(0, 0, variables[1].payload.data(), 64);
+    overlapping.write_data(1, 0, variables[1].payload.data(), 32);
+    try {
+      overlapping.write_data(0, 16, variables[1].payload.data(), 32);
+    }
+    catch (const std::string& e) {
+      overlap_rejected = true;
+    }
+    overlapping.commit();
+  }
+  catch (const std::string& e) {
+    gap_rejected = true;
+  }
+  ok = ok and overlap_rejected and gap_rejected and access("dbfile_incomplete", F_OK) != 0
+    and access("dbfile_incomplete.partial", F_OK) != 0;
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <cmath>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_query_server.hpp"
+#include "../src/alucell_query_client.hpp"
+
+/*
+ *  Serve a dbfile holding a mesh of two triangles with a nodal field, and
+ *  check ls, show, dump with a row selection, stats and probe from two
+ *  clients, the error responses, that the server reopens the dbfile
+ *  after it is rewritten, and that a request announcing more values
+ *  than it holds is refused.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name, alucell::data_type t,
+		  std::size_t rows, unsigned int components, const std::vector<double>& values) {
+  std::vector<double> payload(2, 0.);
+  payload[0] = rows;
+  payload[1] = components;
+  payload.insert(payload.end(), values.begin(), values.end());
+  db.insert(name, t, payload.data(), payload.size() * sizeof(double));
+}
+
+/*
+ *  The rewritten dbfile holds a time as well, so that its size changes
+ *  even if its modification time does not.
+ */
+void write_dbfile(double scale, bool with_time = false) {
+  alucell::database_write_access db("query_server.db");
+  insert_array(db, "sq_nodes", alucell::data_type::real_array, 4, 2, {0., 0., 1., 0., 1., 1., 0., 1.});
+  std::vector<int> elems = {1, 2, 3, 1, 3, 4};
+  std::vector<int> refs = {1, 1};
+  std::vector<double> payload = {2., 3.};
+  payload.resize(2 + elems.size() / 2);
+  std::memcpy(&payload[2], elems.data(), elems.size() * sizeof(int));
+  db.insert("sq_elems", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  payload = {2., 1., 0.};
+  std::memcpy(&payload[2], refs.data(), refs.size() * sizeof(int));
+  db.insert("sq_refs", alucell::data_type::int_array, payload.data(), payload.size() * sizeof(double));
+  insert_array(db, "sq_temperature", alucell::data_type::real_array, 4, 1,
+	       {0., scale, 2 * scale, scale});
+  if (with_time)
+    db.insert("time", alucell::data_type::real_number, &scale, sizeof(scale));
+}
+
+bool close(double a, double b) { return std::fabs(a - b) < 1e-12; }
+
+int raw_connection(const std::string& socket_path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size());
+  const int fd(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (fd < 0 or ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    throw std::string("[error] test: unable to connect.");
+  return fd;
+}
+
+int main(int argc, char *argv[]) {
+  write_dbfile(1.);
+
+  alucell::query_server server("query_server.sock", 1);
+  std::thread serving([&]() { server.run(); });
+
+  bool ok(true);
+  try {
+    alucell::query_client a("query_server.sock"), b("query_server.sock");
+
+    const std::vector<alucell::query_client::variable_description> variables(a.ls("query_server.db"));
+    ok = ok and variables.size() == 4 and variables[3].name == "sq_temperature"
+      and variables[3].type == alucell::data_type::real_array;
+
+    const alucell::query_client::variable_summary s(b.show("query_server.db", "sq_temperature"));
+    ok = ok and s.rows == 4 and s.components == 1 and s.values.size() == 2
+      and close(s.values[0], 0.) and close(s.values[1], 2.);
+
+    const alucell::query_client::array_values d(a.dump("query_server.db", "sq_nodes[1:3]"));
+    ok = ok and d.rows == 2 and d.components == 2 and d.values == std::vector<double>({1., 0., 1., 1.});
+
+    const std::vector<alucell::statistics::component_statistics> st(b.stats("query_server.db", "sq_temperature"));
+    ok = ok and st.size() == 1 and st[0].count == 4 and close(st[0].sum, 4.) and close(st[0].max, 2.);
+
+    const alucell::query_client::probe_values p(a.probe("query_server.db", "sq", "sq_temperature",
+							 {0.5, 0.25, 2., 2.}));
+    ok = ok and p.dimension == 2 and p.elements.size() == 2 and p.elements[0] == 1 and p.elements[1] == 0
+      and close(p.values[0], 0.75) and std::isnan(p.values[1]);
+
+    bool thrown(false);
+    try {
+      a.show("query_server.db", "sq_pressure");
+    }
+    catch (const std::string&) {
+      thrown = true;
+    }
+    ok = ok and thrown;
+
+    std::string probe_error;
+    try {
+      a.probe("query_server.db", "sq", "sq_temperature", {0.5, 0.25, 2.});
+    }
+    catch (const std::string& e) {
+      probe_error = e;
+    }
+    ok = ok and probe_error.find("[error] query_server: the number of coordinates") == 0;
+
+    write_dbfile(10., true);
+    const alucell::query_client::variable_summary t(a.show("query_server.db", "sq_temperature"));
+    ok = ok and close(t.values[1], 20.) and server.get_counters().reopened == 1
+      and server.get_counters().errors == 2;
+
+    /*
+     *  A stats request announcing 2^32 - 1 percentiles in a few bytes is
+     *  answered with an error instead of an allocation:
+     */
+    const int raw(raw_connection("query_server.sock"));
+    alucell::query::message_writer w;
+    w.put(alucell::query::operation::stats).put_string("query_server.db").put_string("sq_temperature")
+      .put<std::uint32_t>(0xffffffffu);
+    alucell::query::send_frame(raw, w.get_data());
+    std::vector<char> response;
+    ok = ok and alucell::query::receive_frame(raw, response);
+    alucell::query::message_reader r(response);
+    ok = ok and r.get<std::uint8_t>() == alucell::query::status_error
+      and r.get_string() == "[error] query: truncated message." and server.get_counters().errors == 3;
+    ::close(raw);
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+
+  server.stop();
+  serving.join();
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_legacy_variable.hpp"
+#include "../src/alucell_sparse.hpp"
+
+/*
+ *  Build a symmetric and a non symmetric sky_matrix of 200 equations
+ *  with pseudo random column heights and some zero terms, write them
+ *  into a dbfile and read them back. Check the terms of the views, of
+ *  the CSR conversions and the products against dense copies, with 1,
+ *  3 and 8 threads.
+ */
+
+std::vector<char> build_payload(std::size_t n, bool symmetric, std::vector<double>& dense) {
+  std::vector<std::int32_t> pointers(1, 1);
+  unsigned int seed(12345);
+  for (std::size_t j(0); j < n; ++j) {
+    seed = seed * 1103515245u + 12345u;
+    pointers.push_back(pointers.back() + (j ? (seed >> 16) % std::min<std::size_t>(j + 1, 12) : 0));
+  }
+
+  const std::size_t profile(pointers[n] - 1);
+  std::vector<double> diagonal(n), upper(profile), lower(symmetric ? 0 : profile);
+  dense.assign(n * n, 0.);
+  for (std::size_t j(0); j < n; ++j) {
+    diagonal[j] = 10. + j;
+    dense[j * n + j] = diagonal[j];
+    const std::size_t first(j - (pointers[j + 1] - pointers[j]));
+    for (std::size_t i(first); i < j; ++i) {
+      const std::size_t k(pointers[j] - 1 + i - first);
+      upper[k] = (k % 5 == 0) ? 0. : 1. + 0.01 * k;
+      dense[i * n + j] = upper[k];
+      if (symmetric) {
+	dense[j * n + i] = upper[k];
+      } else {
+	lower[k] = (k % 7 == 0) ? 0. : -2. - 0.01 * k;
+	dense[j * n + i] = lower[k];
+      }
+    }
+  }
+
+  const std::int32_t header[2] = { static_cast<std::int32_t>(n), symmetric ? 0 : 1 };
+  std::vector<char> payload(reinterpret_cast<const char*>(header), reinterpret_cast<const char*>(header + 2));
+  payload.insert(payload.end(), reinterpret_cast<const char*>(pointers.data()),
+		 reinterpret_cast<const char*>(pointers.data() + pointers.size()));
+  payload.resize((payload.size() + 7) / 8 * 8, 0);
+  for (const std::vector<double>* v: {&diagonal, &upper, &lower})
+    payload.insert(payload.end(), reinterpret_cast<const char*>(v->data()),
+		   reinterpret_cast<const char*>(v->data() + v->size()));
+  return payload;
+}
+
+bool check(const alucell::sky_matrix_view& a, const std::vector<double>& dense) {
+  const std::size_t n(a.get_size());
+  bool ok(true);
+  std::size_t nonzeros(0);
+  for (std::size_t i(0); i < n; ++i)
+    for (std::size_t j(0); j < n; ++j) {
+      ok = ok and a.get_value(i, j) == dense[i * n + j];
+      nonzeros += i == j or dense[i * n + j] != 0.;
+    }
+
+  std::vector<double> x(n), expected(n, 0.), y(n);
+  for (std::size_t i(0); i < n; ++i)
+    x[i] = 1. + (i % 10) * 0.1;
+  for (std::size_t i(0); i < n; ++i)
+    for (std::size_t j(0); j < n; ++j)
+      expected[i] += dense[i * n + j] * x[j];
+
+  for (unsigned int threads: {1u, 3u, 8u}) {
+    const alucell::csr_matrix c(alucell::sky_matrix_to_csr(a, false, threads));
+    ok = ok and c.rows == n and c.get_nonzeros() == nonzeros;
+    for (std::size_t i(0); i < n; ++i)
+      for (std::size_t k(c.offsets[i]); k < c.offsets[i + 1]; ++k)
+	ok = ok and c.values[k] == dense[i * n + c.indices[k]]
+	  and (k == c.offsets[i] or c.indices[k - 1] < c.indices[k]);
+
+    alucell::multiply(a, x.data(), y.data(), threads);
+    for (std::size_t i(0); i < n; ++i)
+      ok = ok and std::fabs(y[i] - expected[i]) < 1e-9 * std::fabs(expected[i]);
+
+    alucell::multiply(c, x.data(), y.data(), threads);
+    for (std::size_t i(0); i < n; ++i)
+      ok = ok and std::fabs(y[i] - expected[i]) < 1e-9 * std::fabs(expected[i]);
+
+    std::ostringstream market;
+    alucell::write_matrix_market(market, c, a.is_symmetric());
+    std::size_t lines(0);
+    for (const auto ch: market.str())
+      lines += ch == '\n';
+    ok = ok and lines == 2 + (a.is_symmetric() ? (nonzeros + n) / 2 : nonzeros);
+  }
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<double> symmetric_dense, general_dense;
+  {
+    alucell::database_write_access db("dbfile_sky");
+    const std::vector<char> s(build_payload(200, true, symmetric_dense));
+    const std::vector<char> g(build_payload(200, false, general_dense));
+    db.insert("K_sym", alucell::data_type::sky_matrix, s.data(), s.size());
+    db.insert("K_gen", alucell::data_type::sky_matrix, g.data(), g.size());
+  }
+
+  alucell::database_read_access db("dbfile_sky");
+  const alucell::variable::sky_matrix s(&db, 0), g(&db, 1);
+  bool ok(s.get_view().is_symmetric() and not g.get_view().is_symmetric());
+  ok = check(s.get_view(), symmetric_dense) and ok;
+  ok = check(g.get_view(), general_dense) and ok;
+
+  bool rejected(false);
+  try {
+    std::vector<char> truncated(build_payload(200, false, general_dense));
+    truncated.resize(truncated.size() - 8);
+    alucell::variable::sky_matrix t(truncated);
+  }
+  catch (const std::string& e) {
+    rejected = true;
+  }
+  ok = ok and rejected;
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
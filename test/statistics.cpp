@@ -0,0 +1,87 @@
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_histogram.hpp"
+
+/*
+ *  Compute the statistics of a two components array of 100003 rows
+ *  with 1, 2, 3 and 8 threads, and check that the results are
+ *  bitwise identical. The first component holds 1, 2, ..., the
+ *  second one the same values with a NaN and an Inf. Compute them again
+ *  from a dbfile, by windows of several sizes, with estimated
+ *  percentiles, and check that they match the first ones and do not
+ *  depend on the number of threads either.
+ */
+
+int main(int argc, char *argv[]) {
+  const std::size_t rows(100003);
+  std::vector<double> values(2 * rows);
+  for (std::size_t i(0); i < rows; ++i) {
+    values[2 * i] = i + 1;
+    values[2 * i + 1] = 0.1 * (i + 1);
+  }
+  values[2 * 17 + 1] = NAN;
+  values[2 * 42 + 1] = INFINITY;
+
+  std::vector<alucell::statistics::component_statistics> reference;
+  for (unsigned int threads: {1, 2, 3, 8}) {
+    alucell::statistics::statistics_accumulator acc(2, threads);
+    acc.accumulate(&values[0], rows);
+    const std::vector<alucell::statistics::component_statistics> s(acc.get_statistics());
+
+    if (reference.empty())
+      reference = s;
+
+    for (unsigned int c(0); c < 2; ++c) {
+      std::cout << threads << " threads, component " << c << ": "
+		<< "min " << s[c].min << ", max " << s[c].max
+		<< ", mean " << s[c].mean << ", nan " << s[c].nan_count
+		<< ", inf " << s[c].inf_count << std::endl;
+
+      if (s[c].sum != reference[c].sum or s[c].l2_norm != reference[c].l2_norm)
+	return 1;
+    }
+  }
+
+  const double expected_mean((rows + 1) / 2.);
+  if (reference[0].mean != expected_mean)
+    return 1;
+
+  std::vector<double> payload = {double(rows), 2.};
+  payload.insert(payload.end(), values.begin(), values.end());
+  {
+    alucell::database_write_access db("statistics.db");
+    db.insert("a", alucell::data_type::real_array, payload.data(), payload.size() * sizeof(double));
+  }
+
+  bool ok(true);
+  std::vector<std::pair<double, double> > percentiles;
+  try {
+    alucell::database_read_access db("statistics.db");
+    for (unsigned int threads: {1, 3, 8})
+      for (std::size_t buffer_size: {std::size_t(1) << 20, 5 * 4096 * 2 * sizeof(double)}) {
+	const std::vector<alucell::statistics::component_statistics>
+	  s(alucell::statistics::compute_statistics<double>(&db, 0, {0., 50., 100.}, threads, buffer_size));
+	if (percentiles.empty())
+	  percentiles = s[0].percentiles;
+	for (unsigned int c(0); c < 2; ++c)
+	  ok = ok and s[c].sum == reference[c].sum and s[c].l2_norm == reference[c].l2_norm
+	    and s[c].count == reference[c].count and s[c].nan_count == reference[c].nan_count;
+	ok = ok and s[0].percentiles == percentiles and s[1].percentiles.size() == 3;
+      }
+    ok = ok and percentiles.size() == 3 and percentiles[0].second == 1. and percentiles[2].second == rows
+      and std::fabs(percentiles[1].second - expected_mean) <= 0.005 * expected_mean;
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("statistics.db");
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_variable_cache.hpp"
+
+/*
+ *  Create a dbfile with 8 real arrays of 1000 rows and 2 components,
+ *  and query them repeatedly from 4 threads through a shared cache,
+ *  once with a budget holding all of them and once with a budget
+ *  holding about half of them. Check the values read and the counters.
+ *  The dbfile is a temporary file, removed at the end.
+ */
+
+bool query(const std::string& filename, alucell::variable_cache* cache, unsigned int repeat) {
+  alucell::database_read_access db(filename);
+  bool ok(true);
+  for (unsigned int r(0); r < repeat; ++r)
+    for (unsigned int id(0); id < db.get_variables_number(); ++id) {
+      const std::shared_ptr<const alucell::variable::array<double> >
+	a(cache->get<alucell::variable::array<double> >(&db, id));
+      ok = ok and a->get_size() == 1000 and a->get_components() == 2
+	and a->get_value(999, 1) == id * 10000. + 999 * 2 + 1;
+    }
+  return ok;
+}
+
+bool run(const std::string& filename, alucell::variable_cache* cache, unsigned int threads, unsigned int repeat) {
+  std::vector<std::thread> workers;
+  std::vector<char> results(threads, 0);
+  for (unsigned int t(0); t < threads; ++t)
+    workers.push_back(std::thread([&, t]() { results[t] = query(filename, cache, repeat); }));
+  for (auto& w: workers)
+    w.join();
+
+  bool ok(true);
+  for (auto r: results)
+    ok = ok and r;
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  const char* tmpdir(std::getenv("TMPDIR"));
+  std::string filename(std::string(tmpdir and *tmpdir ? tmpdir : "/tmp") + "/variable_cache.XXXXXX");
+  const int fd(::mkstemp(&filename[0]));
+  if (fd < 0) {
+    std::cerr << "unable to create a temporary file" << std::endl;
+    std::cout << "FAILED" << std::endl;
+    return 1;
+  }
+  ::close(fd);
+
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db(filename);
+      for (unsigned int v(0); v < 8; ++v) {
+	std::vector<double> values(2 + 2000);
+	values[0] = 1000.;
+	values[1] = 2.;
+	for (std::size_t i(0); i < 2000; ++i)
+	  values[2 + i] = v * 10000. + i;
+	db.insert("array_" + std::to_string(v), alucell::data_type::real_array,
+		  &values[0], values.size() * sizeof(double));
+      }
+    }
+
+    const std::size_t variable_bytes((2 + 2000) * sizeof(double));
+
+    alucell::variable_cache large(16 * variable_bytes, 1);
+    ok = ok and run(filename, &large, 4, 10);
+    const alucell::variable_cache::counters c(large.get_counters());
+    std::cout << "large budget: " << c.hits << " hits, " << c.misses << " misses, "
+	      << c.evictions << " evictions, " << c.entries << " entries" << std::endl;
+    ok = ok and c.hits + c.misses == 4 * 10 * 8 and c.misses >= 8 and c.misses <= 4 * 8
+      and c.evictions == 0 and c.entries == 8 and c.bytes == 8 * variable_bytes;
+
+    alucell::variable_cache small(4 * variable_bytes, 2);
+    ok = ok and run(filename, &small, 4, 10);
+    const alucell::variable_cache::counters d(small.get_counters());
+    std::cout << "small budget: " << d.hits << " hits, " << d.misses << " misses, "
+	      << d.evictions << " evictions, " << d.entries << " entries" << std::endl;
+    ok = ok and d.hits + d.misses == 4 * 10 * 8 and d.evictions > 0
+      and d.bytes <= 4 * variable_bytes;
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink(filename.c_str());
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <unistd.h>
+
+#include "../src/alucell_legacy_database.hpp"
+#include "../src/alucell_variable_selector.hpp"
+
+/*
+ *  Select the variables of a dbfile by name, glob pattern, regular
+ *  expression, datatype, size predicate and mesh, alone and combined.
+ *  Check the size predicates with every operator, with suffixes and with
+ *  a null size, and that invalid predicates are refused.
+ */
+
+void insert_array(alucell::database_write_access& db, const std::string& name, alucell::data_type t,
+		  std::size_t rows, unsigned int components) {
+  std::vector<double> values(2 + rows * components, 1.);
+  values[0] = rows;
+  values[1] = components;
+  db.insert(name, t, values.data(), values.size() * sizeof(double));
+}
+
+std::vector<unsigned int> select_sizes(alucell::database_read_access& db, const std::vector<std::string>& predicates) {
+  alucell::variable_selector selector;
+  for (const auto& p: predicates)
+    selector.add_size_predicate(p);
+  return selector.select(&db);
+}
+
+bool is_refused(const std::string& predicate) {
+  try {
+    alucell::variable_selector().add_size_predicate(predicate);
+  }
+  catch (const std::string&) {
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  typedef std::vector<unsigned int> ids;
+  bool ok(true);
+  try {
+    {
+      alucell::database_write_access db("variable_selector.db");
+      insert_array(db, "box_nodes", alucell::data_type::real_array, 4, 2);     // 0: 80 bytes
+      insert_array(db, "box_elems", alucell::data_type::int_array, 1, 4);      // 1: 48 bytes
+      insert_array(db, "box_refs", alucell::data_type::int_array, 1, 1);       // 2: 24 bytes
+      insert_array(db, "box_temperature", alucell::data_type::real_array, 4, 1);  // 3: 48 bytes
+      insert_array(db, "large", alucell::data_type::real_array, 128, 1);       // 4: 1040 bytes
+      const double time(1.);
+      db.insert("box_time", alucell::data_type::real_number, &time, sizeof(time));  // 5: 8 bytes
+      db.insert("empty", alucell::data_type::expression, NULL, 0);             // 6: 0 bytes
+    }
+
+    alucell::database_read_access db("variable_selector.db");
+    ok = alucell::variable_selector().empty() and alucell::variable_selector().select(&db).size() == 7;
+
+    alucell::variable_selector names;
+    names.add_name("large");
+    names.add_pattern("box_*s");
+    alucell::variable_selector expressions;
+    expressions.add_regex("^box_t");
+    expressions.add_type(alucell::data_type::real_number);
+    alucell::variable_selector meshes;
+    meshes.add_mesh("box");
+    alucell::variable_selector combined(meshes);
+    combined.add_pattern("*e*");
+    combined.add_size_predicate(">=48");
+    ok = ok and names.select(&db) == ids({0, 1, 2, 4}) and expressions.select(&db) == ids({5})
+      and meshes.select(&db) == ids({0, 1, 2, 3, 5}) and combined.select(&db) == ids({0, 1, 3});
+
+    ok = ok and select_sizes(db, {"=0"}) == ids({6})
+      and select_sizes(db, {">0"}) == ids({0, 1, 2, 3, 4, 5})
+      and select_sizes(db, {"<=0"}) == ids({6})
+      and select_sizes(db, {">=0"}).size() == 7
+      and select_sizes(db, {"<0"}).empty()
+      and select_sizes(db, {"!=0", "<48"}) == ids({2, 5})
+      and select_sizes(db, {">=1K"}) == ids({4})
+      and select_sizes(db, {"<1k", "!=48"}) == ids({0, 2, 5, 6})
+      and select_sizes(db, {"=0.5K"}).empty()
+      and select_sizes(db, {">0.04k", "<=80"}) == ids({0, 1, 3})
+      and select_sizes(db, {"<1M", ">0G"}).size() == 6;
+
+    ok = ok and is_refused("48") and is_refused("=") and is_refused("=-1") and is_refused("=1X")
+      and is_refused("<>1") and is_refused("=K") and is_refused("=nan");
+  }
+  catch (const std::string& e) {
+    std::cerr << e << std::endl;
+    ok = false;
+  }
+  ::unlink("variable_selector.db");
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}